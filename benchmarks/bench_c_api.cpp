@@ -0,0 +1,224 @@
+// Per-lookup cost of resolving package names through libunipm's C API,
+// against running the unipm binary for each name the way scripts do
+// (`unipm install --dry-run --output=ndjson <name>`, reading the
+// resolution event). Both use the same synthetic package database.
+//
+// Usage: bench_c_api [unipm-binary] [entries] [cli-runs] [lookups]
+// Defaults: the unipm built alongside, 2000 entries, 50 CLI runs, 20000
+// library lookups.
+//
+// Exits 1 if the two disagree on a resolution.
+
+#include "unipm/unipm.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedUs(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static void writeSyntheticDatabase(const std::string& path, size_t count) {
+    std::ofstream out(path);
+    out << "{\n  \"packages\": {\n";
+    for (size_t i = 0; i < count; ++i) {
+        out << "    \"package-" << i << "\": {\"aliases\": [\"pkg" << i << "\"], \"apt\": \"native-"
+            << i << "\", \"pacman\": \"native-" << i << "\", \"dnf\": \"native-" << i
+            << "\", \"brew\": \"native-" << i << "\"}" << (i + 1 < count ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+}
+
+// Run unipm for one name and pull "resolved" out of its resolution event;
+// empty on failure
+static std::string resolveWithCli(const std::string& binary, const std::string& pm,
+                                  const std::string& name) {
+    int fds[2];
+    if (pipe(fds) != 0) return "";
+
+    std::vector<std::string> args = {binary,        "install", "--dry-run", "--yes",
+                                     "--pm=" + pm, "--output=ndjson", name};
+    std::vector<char*> argv;
+    for (auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    pid_t pid;
+    int rc = posix_spawn(&pid, binary.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return "";
+    }
+
+    std::string output;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, static_cast<size_t>(n));
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    // Good enough for the names generated here; tools would use a JSON parser
+    size_t event = output.find("\"event\":\"resolution\"");
+    size_t key = output.find("\"resolved\":\"", event);
+    if (event == std::string::npos || key == std::string::npos) return "";
+    size_t start = key + 12;
+    return output.substr(start, output.find('"', start) - start);
+}
+
+static std::string resolveWithLibrary(unipm_db* db, const std::string& pm,
+                                      const std::string& name) {
+    unipm_resolutions* out = nullptr;
+    if (unipm_resolve(db, pm.c_str(), name.c_str(), nullptr, 0, &out) != UNIPM_OK) return "";
+    std::string resolved = unipm_resolutions_get(out, 0)->resolved_name;
+    unipm_resolutions_free(out);
+    return resolved;
+}
+
+static void report(const char* label, std::vector<double>& samplesUs) {
+    std::sort(samplesUs.begin(), samplesUs.end());
+    double sum = 0;
+    for (double us : samplesUs) sum += us;
+    std::printf("%-34s %10.2f us mean, %10.2f us p50, %10.2f us p99\n", label,
+                sum / samplesUs.size(), samplesUs[samplesUs.size() / 2],
+                samplesUs[std::min(samplesUs.size() - 1, samplesUs.size() * 99 / 100)]);
+}
+
+int main(int argc, char* argv[]) {
+    std::string binary = argc > 1 ? argv[1] : UNIPM_BINARY;
+    size_t entries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    int cliRuns = argc > 3 ? std::atoi(argv[3]) : 50;
+    int lookups = argc > 4 ? std::atoi(argv[4]) : 20000;
+    if (entries == 0 || cliRuns <= 0 || lookups <= 0) {
+        std::cerr << "Usage: bench_c_api [unipm-binary] [entries] [cli-runs] [lookups]"
+                  << std::endl;
+        return 2;
+    }
+
+    // unipm finds data/packages.json relative to its working directory
+    const std::string dir = "/tmp/unipm_bench_c_api";
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/data").c_str(), 0755);
+    if (chdir(dir.c_str()) != 0) {
+        std::cerr << "Cannot enter " << dir << std::endl;
+        return 1;
+    }
+    writeSyntheticDatabase("data/packages.json", entries);
+    setenv("UNIPM_CACHE_DIR", (dir + "/cache").c_str(), 1);
+    setenv("UNIPM_NO_DAEMON", "1", 1);  // Measure the binary on its own
+
+    const char* detected = nullptr;
+    std::string pm = unipm_default_pm(&detected) == UNIPM_OK ? detected : "apt";
+
+    // Names alternate between package names and aliases
+    auto nameFor = [entries](int i) {
+        size_t n = static_cast<size_t>(i) * 7919 % entries;
+        return (i % 2 ? "pkg" : "package-") + std::to_string(n);
+    };
+
+    auto start = Clock::now();
+    unipm_db* db = nullptr;
+    if (unipm_db_open("data/packages.json", &db) != UNIPM_OK) {
+        std::cerr << "Cannot load the database: " << unipm_last_error() << std::endl;
+        return 1;
+    }
+    double openUs = elapsedUs(start);
+    std::cout << "Database: " << unipm_db_package_count(db) << " packages, resolving for " << pm
+              << std::endl;
+    std::printf("%-34s %10.2f us once\n", "unipm_db_open", openUs);
+
+    int mismatches = 0;
+    std::vector<double> cli;
+    for (int i = 0; i < cliRuns; ++i) {
+        std::string name = nameFor(i);
+        auto started = Clock::now();
+        std::string resolved = resolveWithCli(binary, pm, name);
+        cli.push_back(elapsedUs(started));
+        if (resolved.empty()) {
+            std::cerr << "Failed to run " << binary << std::endl;
+            return 1;
+        }
+        if (resolved != resolveWithLibrary(db, pm, name)) {
+            std::cerr << name << ": unipm says " << resolved << ", libunipm says "
+                      << resolveWithLibrary(db, pm, name) << std::endl;
+            mismatches++;
+        }
+    }
+    report("exec unipm per lookup", cli);
+
+    // Opening the database for every lookup, as a fresh process must
+    std::vector<double> reopen;
+    for (int i = 0; i < std::min(cliRuns, lookups); ++i) {
+        auto started = Clock::now();
+        unipm_db* fresh = nullptr;
+        if (unipm_db_open("data/packages.json", &fresh) == UNIPM_OK) {
+            resolveWithLibrary(fresh, pm, nameFor(i));
+            unipm_db_close(fresh);
+        }
+        reopen.push_back(elapsedUs(started));
+    }
+    report("libunipm, open + resolve + close", reopen);
+
+    std::vector<double> reused;
+    for (int i = 0; i < lookups; ++i) {
+        auto started = Clock::now();
+        resolveWithLibrary(db, pm, nameFor(i));
+        reused.push_back(elapsedUs(started));
+    }
+    report("libunipm, reused handle", reused);
+
+    // Fuzzy lookups score every package, so cost grows with the database
+    std::vector<double> fuzzy;
+    for (int i = 0; i < std::min(lookups, 200); ++i) {
+        auto started = Clock::now();
+        resolveWithLibrary(db, pm, "packag-" + std::to_string(i));
+        fuzzy.push_back(elapsedUs(started));
+    }
+    report("libunipm, reused handle, fuzzy", fuzzy);
+
+    std::vector<std::string> names;
+    for (int i = 0; i < lookups; ++i) names.push_back(nameFor(i));
+    std::vector<const char*> pointers;
+    for (const auto& name : names) pointers.push_back(name.c_str());
+    start = Clock::now();
+    unipm_resolutions* batch = nullptr;
+    if (unipm_resolve_batch(db, pm.c_str(), pointers.data(), pointers.size(), 0, &batch) ==
+        UNIPM_OK) {
+        unipm_resolutions_free(batch);
+    }
+    std::printf("%-34s %10.2f us per name (%d names)\n", "libunipm, one batch",
+                elapsedUs(start) / lookups, lookups);
+
+    unipm_db_close(db);
+
+    std::sort(cli.begin(), cli.end());
+    std::sort(reused.begin(), reused.end());
+    std::printf("exec unipm / reused handle:        %10.0fx (p50)\n",
+                cli[cli.size() / 2] / std::max(reused[reused.size() / 2], 0.001));
+    if (mismatches > 0) {
+        std::printf("FAIL: %d resolutions differ\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
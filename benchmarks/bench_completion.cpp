@@ -0,0 +1,145 @@
+// Measures `unipm __complete` from process start to the first byte of output,
+// against a synthetic package database, and compares it with loading the
+// database the way every other command does.
+//
+// Usage: bench_completion [unipm-binary] [entries] [iterations]
+// Defaults: the unipm built alongside, 100000 entries, 50 runs.
+
+#include "unipm/config.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace unipm;
+using Clock = std::chrono::steady_clock;
+
+static constexpr double BUDGET_MS = 10.0;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void writeSyntheticDatabase(const std::string& path, size_t count) {
+    std::ofstream out(path);
+    out << "{\n  \"packages\": {\n";
+    for (size_t i = 0; i < count; ++i) {
+        out << "    \"package-" << i << "\": {\"aliases\": [\"pkg" << i << "\", \"package" << i
+            << "-cli\"], \"apt\": \"package-" << i << "\", \"pacman\": \"package-" << i
+            << "\", \"brew\": \"package-" << i << "\"}" << (i + 1 < count ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+}
+
+// Spawn unipm and time it until its first byte of output; -1 on failure
+static double timeFirstByte(const std::string& binary, const std::vector<std::string>& args,
+                            size_t& lines) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1.0;
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+
+    auto start = Clock::now();
+    pid_t pid;
+    int rc = posix_spawn(&pid, binary.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return -1.0;
+    }
+
+    double firstByteMs = -1.0;
+    lines = 0;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        if (firstByteMs < 0) firstByteMs = elapsedMs(start);
+        lines += static_cast<size_t>(std::count(buffer, buffer + n, '\n'));
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? firstByteMs : -1.0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string binary = argc > 1 ? argv[1] : UNIPM_BINARY;
+    size_t entries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+    int iterations = argc > 3 ? std::atoi(argv[3]) : 50;
+
+    // unipm finds data/packages.json relative to its working directory
+    const std::string dir = "/tmp/unipm_bench_completion";
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/data").c_str(), 0755);
+    if (chdir(dir.c_str()) != 0) {
+        std::cerr << "Cannot enter " << dir << std::endl;
+        return 1;
+    }
+    writeSyntheticDatabase("data/packages.json", entries);
+    setenv("UNIPM_CACHE_DIR", (dir + "/cache").c_str(), 1);
+    std::remove((dir + "/cache/completion.idx").c_str());
+
+    Config probe;
+    if (probe.findDatabase() != "data/packages.json") {
+        std::cout << "note: " << probe.findDatabase() << " takes precedence over the synthetic"
+                  << " database" << std::endl;
+    }
+    std::cout << "Database: " << entries << " packages, 3 names each" << std::endl;
+
+    const std::vector<std::string> args = {"__complete", "install", "package-1234"};
+    size_t lines = 0;
+    double coldMs = timeFirstByte(binary, args, lines);
+    if (coldMs < 0) {
+        std::cerr << "Failed to run " << binary << std::endl;
+        return 1;
+    }
+    std::printf("first run (builds index): %8.3f ms  (%zu candidates)\n", coldMs, lines);
+
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        double ms = timeFirstByte(binary, args, lines);
+        if (ms < 0) {
+            std::cerr << "Failed to run " << binary << std::endl;
+            return 1;
+        }
+        samples.push_back(ms);
+    }
+    std::sort(samples.begin(), samples.end());
+    double p50 = samples[samples.size() / 2];
+    double p95 = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+    std::printf("startup to first byte:    %8.3f ms p50, %.3f ms p95, %.3f ms max (%d runs)\n",
+                p50, p95, samples.back(), iterations);
+
+    // What each Tab press would cost if it loaded the database instead
+    auto start = Clock::now();
+    Config config;
+    config.load("data/packages.json");
+    std::printf("Config::load for comparison: %5.3f ms\n", elapsedMs(start));
+
+    bool withinBudget = p95 < BUDGET_MS;
+    std::printf("%s: p95 %s the %.0f ms budget\n", withinBudget ? "PASS" : "FAIL",
+                withinBudget ? "within" : "over", BUDGET_MS);
+    return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+// Compares the native dpkg status reader against spawning apt/dpkg-query.
+//
+// Usage: bench_dpkg_status [status-file] [iterations]
+// Without a status file, a synthetic one with 5000 packages is generated.
+
+#include "unipm/dpkg_status.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace unipm;
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static std::string writeSyntheticStatus(size_t count) {
+    std::string path = "/tmp/unipm_bench_dpkg_status";
+    std::ofstream out(path);
+    for (size_t i = 0; i < count; ++i) {
+        out << "Package: package-" << i << "\n"
+            << "Status: install ok installed\n"
+            << "Priority: optional\n"
+            << "Section: libs\n"
+            << "Installed-Size: " << (100 + i) << "\n"
+            << "Maintainer: Nobody <nobody@example.org>\n"
+            << "Architecture: amd64\n"
+            << "Version: 1." << i << "-1\n"
+            << "Depends: libc6 (>= 2.36)\n"
+            << "Description: synthetic package " << i << "\n"
+            << " A longer description line that the reader has to skip over.\n"
+            << " .\n"
+            << " And another paragraph.\n\n";
+    }
+    return path;
+}
+
+// Run a command and drain its output, as the CLI fallback path would
+static double timeSpawn(const std::string& command, size_t& lines) {
+    auto start = Clock::now();
+    FILE* pipe = popen((command + " 2>/dev/null").c_str(), "r");
+    if (!pipe) return -1.0;
+
+    char buffer[4096];
+    lines = 0;
+    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        ++lines;
+    }
+    int status = pclose(pipe);
+    return status == 0 ? elapsedMs(start) : -1.0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : writeSyntheticStatus(5000);
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    std::cout << "Status file: " << path << std::endl;
+
+    double totalMs = 0.0;
+    size_t installed = 0;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = Clock::now();
+        DpkgStatus status;
+        if (!status.load(path)) {
+            std::cerr << "Failed to load " << path << std::endl;
+            return 1;
+        }
+        installed = status.installedPackages().size();
+        totalMs += elapsedMs(start);
+    }
+    std::printf("native reader:        %8.3f ms/run (%zu installed, %d runs)\n",
+                totalMs / iterations, installed, iterations);
+
+    // Spawned commands only make sense against the real system database
+    const char* commands[] = {"apt list --installed", "dpkg-query -W"};
+    for (const char* command : commands) {
+        size_t lines = 0;
+        double ms = timeSpawn(command, lines);
+        if (ms < 0) {
+            std::printf("%-21s not available\n", command);
+        } else {
+            std::printf("%-21s %8.3f ms     (%zu lines)\n", command, ms, lines);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,380 @@
+// Load harness: many unipm processes at once against fake package managers,
+// then checks that the history log, the metrics textfile and the caches
+// came through intact.
+//
+// Fake apt, dnf, pacman and sudo scripts go into a scratch PATH with a set
+// latency, output volume, lock behaviour and failure rate; HOME, the cache
+// and the metrics directory are scratch too. Every run installs (or
+// removes) a package of its own, so its history record and its package
+// manager call can be traced back to it.
+//
+// Usage: bench_load [--unipm=<binary>] [--pm=apt|dnf|pacman] [--command=install|remove]
+//                   [--processes=16] [--runs=200] [--latency-ms=50] [--output-lines=20]
+//                   [--lock=wait|fail|none] [--fail-percent=0] [--keep]
+//
+// --lock=wait makes the fakes queue on a lock the way dpkg and rpm do;
+// --lock=fail makes them give up at once like apt does without a timeout.
+// Exits 1 when a correctness issue was found.
+
+#include "unipm/apt_index.h"
+#include "unipm/cache.h"
+#include "unipm/history.h"
+#include "unipm/install_timings.h"
+#include "unipm/inventory.h"
+#include "unipm/parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace unipm;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string unipm = UNIPM_BINARY;
+    std::string pm = "apt";
+    std::string command = "install";
+    size_t processes = 16;
+    size_t runs = 200;
+    int latencyMs = 50;
+    int outputLines = 20;
+    std::string lock = "wait";
+    int failPercent = 0;
+    bool keep = false;
+};
+
+struct Run {
+    int exitCode = -1;
+    double ms = 0.0;
+};
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--unipm") options.unipm = value;
+        else if (key == "--pm") options.pm = value;
+        else if (key == "--command") options.command = value;
+        else if (key == "--processes") options.processes = std::strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--runs") options.runs = std::strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--latency-ms") options.latencyMs = std::atoi(value.c_str());
+        else if (key == "--output-lines") options.outputLines = std::atoi(value.c_str());
+        else if (key == "--lock") options.lock = value;
+        else if (key == "--fail-percent") options.failPercent = std::atoi(value.c_str());
+        else if (key == "--keep") options.keep = true;
+        else return false;
+    }
+    return (options.pm == "apt" || options.pm == "dnf" || options.pm == "pacman") &&
+           (options.command == "install" || options.command == "remove") &&
+           (options.lock == "wait" || options.lock == "fail" || options.lock == "none") &&
+           options.processes > 0 && options.runs > 0;
+}
+
+static bool writeScript(const std::string& path, const std::string& text) {
+    std::ofstream out(path);
+    out << text;
+    out.close();
+    return out.good() && chmod(path.c_str(), 0755) == 0;
+}
+
+// A package manager that takes latencyMs per change, prints outputLines
+// lines, fails failPercent of the time and logs each change to calls.log
+static std::string fakePackageManager(const std::string& name, const std::string& state,
+                                      const Options& options) {
+    char latency[32];
+    std::snprintf(latency, sizeof(latency), "%.3f", options.latencyMs / 1000.0);
+    std::ostringstream out;
+    out << "#!/bin/sh\n"
+        << "# Fake " << name << " for bench_load\n"
+        << "state='" << state << "'\n"
+        << "case \"$1\" in\n"
+        << "    --version|-V) echo '" << name << " 0.0.0-fake'; exit 0 ;;\n"
+        << "    install|remove|upgrade|update|-S*|-R*) ;;\n"
+        << "    *) exit 0 ;;\n"
+        << "esac\n"
+        << "if [ '" << options.lock << "' != none ]; then\n"
+        << "    while ! mkdir \"$state/" << name << ".lock\" 2>/dev/null; do\n"
+        << "        if [ '" << options.lock << "' = fail ]; then\n"
+        << "            echo \"E: Could not get lock $state/" << name << ".lock\" >&2\n"
+        << "            exit 100\n"
+        << "        fi\n"
+        << "        sleep 0.005\n"
+        << "    done\n"
+        << "    trap 'rmdir \"$state/" << name << ".lock\"' EXIT\n"
+        << "fi\n"
+        << "echo \"$*\" >> \"$state/calls.log\"\n"
+        << "sleep " << latency << "\n"
+        << "yes \"Fake " << name << " output for $*\" | head -n " << options.outputLines << "\n"
+        << "r=$(od -An -N2 -tu2 /dev/urandom | tr -d ' ')\n"
+        << "if [ $((r % 100)) -lt " << options.failPercent << " ]; then\n"
+        << "    echo 'E: simulated failure' >&2\n"
+        << "    exit 1\n"
+        << "fi\n";
+    return out.str();
+}
+
+static std::string packageFor(size_t run) {
+    return "loadpkg-" + std::to_string(run);
+}
+
+// Run unipm once, output into a log file; exit code and wall time
+static Run runUnipm(const Options& options, const std::string& root, size_t index,
+                    char** envp) {
+    std::vector<std::string> args = {options.unipm,
+                                     options.command,
+                                     packageFor(index),
+                                     "--yes",
+                                     "--pm=" + options.pm,
+                                     "--metrics-dir=" + root + "/metrics"};
+    std::vector<char*> argv;
+    for (auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    std::string logPath = root + "/out/" + std::to_string(index) + ".log";
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logPath.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+    Run run;
+    auto start = Clock::now();
+    pid_t pid;
+    int rc = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), envp);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        return run;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    run.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    run.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return run;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+static std::vector<std::string> readLines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Files left behind by an interrupted Cache::writeAtomic
+static std::vector<std::string> strayTempFiles(const std::string& dir) {
+    std::vector<std::string> found;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return found;
+    while (struct dirent* entry = readdir(d)) {
+        if (std::strstr(entry->d_name, ".tmp.")) {
+            found.push_back(dir + "/" + entry->d_name);
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: bench_load [--unipm=<binary>] [--pm=apt|dnf|pacman] "
+                     "[--command=install|remove] [--processes=N] [--runs=N] [--latency-ms=N] "
+                     "[--output-lines=N] [--lock=wait|fail|none] [--fail-percent=N] [--keep]"
+                  << std::endl;
+        return 2;
+    }
+
+    char scratch[] = "/tmp/unipm-load.XXXXXX";
+    if (!mkdtemp(scratch)) {
+        std::perror("mkdtemp");
+        return 2;
+    }
+    const std::string root = scratch;
+    for (const char* sub : {"/bin", "/home", "/cache", "/metrics", "/out", "/state"}) {
+        Cache::createDirectories(root + sub);
+    }
+    for (const char* pm : {"apt", "dnf", "pacman"}) {
+        writeScript(root + "/bin/" + pm, fakePackageManager(pm, root + "/state", options));
+    }
+    writeScript(root + "/bin/sudo", "#!/bin/sh\n# Fake sudo for bench_load\nexec \"$@\"\n");
+
+    // Only what the scratch tree provides, plus the system tools the fakes use;
+    // a running unipmd would answer from the real system
+    std::vector<std::string> envStrings = {"PATH=" + root + "/bin:/usr/bin:/bin",
+                                           "HOME=" + root + "/home",
+                                           "UNIPM_CACHE_DIR=" + root + "/cache",
+                                           "UNIPM_NO_DAEMON=1", "LC_ALL=C"};
+    std::vector<char*> envp;
+    for (auto& entry : envStrings) envp.push_back(const_cast<char*>(entry.c_str()));
+    envp.push_back(nullptr);
+
+    std::cout << "bench_load: " << options.runs << " x unipm " << options.command << " --pm="
+              << options.pm << ", " << options.processes << " at a time; fake PM "
+              << options.latencyMs << " ms, " << options.outputLines << " lines, lock="
+              << options.lock << ", " << options.failPercent << "% failures" << std::endl;
+    std::cout << "  scratch: " << root << std::endl;
+
+    std::vector<Run> runs(options.runs);
+    auto start = Clock::now();
+    parallelFor(
+        options.runs, [&](size_t i) { runs[i] = runUnipm(options, root, i, envp.data()); },
+        options.processes);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<std::string> issues;
+    auto issue = [&issues](const std::string& text) {
+        if (issues.size() < 50) issues.push_back(text);
+        else if (issues.size() == 50) issues.push_back("...");
+    };
+
+    std::vector<double> latencies;
+    size_t failed = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (runs[i].exitCode < 0) {
+            issue("run " + std::to_string(i) + ": could not start " + options.unipm);
+            continue;
+        }
+        latencies.push_back(runs[i].ms);
+        if (runs[i].exitCode != 0) {
+            failed++;
+            if (options.failPercent == 0 && options.lock != "fail") {
+                issue("run " + std::to_string(i) + ": exit code " +
+                      std::to_string(runs[i].exitCode) + " with nothing set to fail (see " +
+                      root + "/out/" + std::to_string(i) + ".log)");
+            }
+        }
+    }
+
+    // One intact history record per run, with the run's exit code
+    std::map<std::string, size_t> runByPackage;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        runByPackage[packageFor(i)] = i;
+    }
+    std::vector<int> recordsPerRun(runs.size(), 0);
+    size_t records = 0;
+    for (const auto& line : readLines(root + "/home/.unipm/history.jsonl")) {
+        HistoryRecord record;
+        if (!HistoryRecord::fromJson(line, record)) {
+            issue("corrupt history line: " + line.substr(0, 80));
+            continue;
+        }
+        records++;
+        auto it = record.packages.size() == 1 ? runByPackage.find(record.packages[0])
+                                              : runByPackage.end();
+        if (it == runByPackage.end()) {
+            issue("history record for unknown packages: " + record.command);
+            continue;
+        }
+        recordsPerRun[it->second]++;
+        if (record.exitCode != runs[it->second].exitCode) {
+            issue("run " + std::to_string(it->second) + ": history says exit code " +
+                  std::to_string(record.exitCode) + ", unipm exited " +
+                  std::to_string(runs[it->second].exitCode));
+        }
+    }
+    if (Cache::stat(root + "/home/.unipm/history.jsonl.1.gz").exists ||
+        Cache::stat(root + "/home/.unipm/history.jsonl.1").exists) {
+        std::cout << "  history rotated; only the current file was checked" << std::endl;
+    } else {
+        for (size_t i = 0; i < runs.size(); ++i) {
+            if (recordsPerRun[i] != 1 && runs[i].exitCode >= 0) {
+                issue("run " + std::to_string(i) + ": " + std::to_string(recordsPerRun[i]) +
+                      " history records");
+            }
+        }
+    }
+
+    // Each run reached the package manager exactly once (unless the lock turned it away)
+    std::map<std::string, int> calls;
+    for (const auto& line : readLines(root + "/state/calls.log")) {
+        calls[line.substr(line.find_last_of(' ') + 1)]++;
+    }
+    for (size_t i = 0; i < runs.size(); ++i) {
+        int count = calls[packageFor(i)];
+        bool turnedAway = options.lock == "fail" && runs[i].exitCode == 100;
+        if (count > 1 || (count == 0 && !turnedAway)) {
+            issue("run " + std::to_string(i) + ": " + std::to_string(count) +
+                  " package manager calls");
+        }
+    }
+
+    // The metrics textfile counted every run: no lost read-modify-write
+    double operations = 0;
+    for (const auto& line : readLines(root + "/metrics/unipm.prom")) {
+        if (line.rfind("unipm_operations_total{", 0) == 0) {
+            operations += std::atof(line.c_str() + line.find_last_of(' ') + 1);
+        }
+    }
+    if (operations != static_cast<double>(runs.size())) {
+        issue("metrics count " + std::to_string(static_cast<long long>(operations)) +
+              " operations for " + std::to_string(runs.size()) + " runs");
+    }
+
+    // Caches written concurrently must still load
+    const std::string cache = root + "/cache/";
+    if (Cache::stat(cache + AptIndex::CACHE_FILE).exists &&
+        !AptIndex().loadCache(cache + AptIndex::CACHE_FILE)) {
+        issue(std::string("unreadable cache: ") + AptIndex::CACHE_FILE);
+    }
+    std::vector<std::string> names;
+    if (Cache::stat(cache + Inventory::CACHE_FILE).exists &&
+        !Inventory::readCachedNames(cache + Inventory::CACHE_FILE, names)) {
+        issue(std::string("unreadable cache: ") + Inventory::CACHE_FILE);
+    }
+    InstallTimings timings(cache + InstallTimings::CACHE_FILE);
+    if (Cache::stat(cache + InstallTimings::CACHE_FILE).exists && !timings.load()) {
+        issue(std::string("unreadable cache: ") + InstallTimings::CACHE_FILE);
+    }
+    for (const auto& dir : {root + "/cache", root + "/metrics"}) {
+        for (const auto& stray : strayTempFiles(dir)) {
+            issue("leftover temporary file: " + stray);
+        }
+    }
+
+    std::printf("  throughput: %.1f runs/s (%zu runs in %.2f s)\n", runs.size() / seconds,
+                runs.size(), seconds);
+    std::printf("  latency:    p50 %.0f ms  p90 %.0f ms  p99 %.0f ms  max %.0f ms\n",
+                percentile(latencies, 0.50), percentile(latencies, 0.90),
+                percentile(latencies, 0.99), percentile(latencies, 1.0));
+    std::printf("  failed:     %zu runs exited non-zero\n", failed);
+    std::printf("  history:    %zu records\n", records);
+    if (issues.empty()) {
+        std::printf("  correctness: no issues\n");
+    } else {
+        std::printf("  correctness: %zu issues\n", issues.size());
+        for (const auto& text : issues) {
+            std::printf("    - %s\n", text.c_str());
+        }
+    }
+
+    if (!options.keep && issues.empty()) {
+        std::system(("rm -rf '" + root + "'").c_str());
+    }
+    return issues.empty() ? 0 : 1;
+}
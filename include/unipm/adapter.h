@@ -1,9 +1,11 @@
 #pragma once
 
+#include "unipm/command.h"
 #include "unipm/types.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
 
 namespace unipm {
 
@@ -15,107 +17,249 @@ public:
     virtual PackageManager getType() const = 0;
     virtual std::string getName() const = 0;
     
-    // Generate command strings
-    virtual std::string getInstallCommand(const std::vector<std::string>& packages) = 0;
-    virtual std::string getRemoveCommand(const std::vector<std::string>& packages) = 0;
-    virtual std::string getUpdateCommand() = 0;
-    virtual std::string getSearchCommand(const std::string& query) = 0;
-    virtual std::string getListCommand() = 0;
-    virtual std::string getInfoCommand(const std::string& package) = 0;
+    // Generate structured command plans (argv vectors the executor spawns directly)
+    virtual CommandPlan planInstall(const std::vector<std::string>& packages) = 0;
+    virtual CommandPlan planRemove(const std::vector<std::string>& packages) = 0;
+    virtual CommandPlan planUpdate() = 0;
+    virtual CommandPlan planSearch(const std::string& query) = 0;
+    virtual CommandPlan planList() = 0;
+    virtual CommandPlan planInfo(const std::string& package) = 0;
+    
+    // Fetch packages without installing them, into stagingDir (empty: the
+    // PM's own cache). An empty plan means the PM has no download-only mode.
+    virtual CommandPlan planDownload(const std::vector<std::string>& packages,
+                                     const std::string& stagingDir) {
+        (void)packages;
+        (void)stagingDir;
+        return {};
+    }
+    
+    // Install packages already fetched by planDownload() into stagingDir
+    virtual CommandPlan planInstallStaged(const std::vector<std::string>& packages,
+                                          const std::string& stagingDir) {
+        (void)stagingDir;
+        return planInstall(packages);
+    }
+    
+    // Upgrade against the repository metadata already on disk, without
+    // refreshing it first. PMs that can't separate the two just update.
+    virtual CommandPlan planUpgrade() { return planUpdate(); }
+    
+    // Files/directories rewritten when the PM refreshes its repository metadata
+    virtual std::vector<std::string> getRepositoryMetadataPaths() { return {}; }
+    
+    // Lock files the PM holds while it changes the system: fcntl-locked
+    // files, or ".lck"/".pid" files whose presence (or live PID) is the lock
+    virtual std::vector<std::string> getLockPaths() { return {}; }
+    
+    // Shell-equivalent command strings, derived from the plans
+    std::string getInstallCommand(const std::vector<std::string>& packages) {
+        return planInstall(packages).toString();
+    }
+    std::string getRemoveCommand(const std::vector<std::string>& packages) {
+        return planRemove(packages).toString();
+    }
+    std::string getUpdateCommand() { return planUpdate().toString(); }
+    std::string getSearchCommand(const std::string& query) { return planSearch(query).toString(); }
+    std::string getListCommand() { return planList().toString(); }
+    std::string getInfoCommand(const std::string& package) { return planInfo(package).toString(); }
     
     // Does this PM require root/admin privileges?
     virtual bool requiresRoot() = 0;
     
+    // Read the installed set from the PM's local metadata without spawning it.
+    // Returns false when unsupported or unreadable; callers then fall back to
+    // getListCommand().
+    virtual bool readInstalled(std::vector<InstalledPackage>& packages) {
+        (void)packages;
+        return false;
+    }
+    
+    // Look up a single installed package natively (see readInstalled)
+    virtual bool findInstalled(const std::string& name, InstalledPackage& package);
+    
+    // Files/directories whose modification means the installed set changed
+    virtual std::vector<std::string> getInstalledMetadataPaths() { return {}; }
+    
+    // Search the PM's local repository index without spawning it.
+    // Returns false when unsupported; callers fall back to getSearchCommand().
+    virtual bool searchAvailable(const std::string& query, std::vector<AvailablePackage>& results) {
+        (void)query;
+        (void)results;
+        return false;
+    }
+    
+    // Parse the output of the planSearch() command into results.
+    // Returns false when the format isn't recognised.
+    virtual bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) {
+        (void)output;
+        (void)results;
+        return false;
+    }
+    
+    // Check a native name against the local repository index
+    virtual Availability checkAvailable(const std::string& name) {
+        (void)name;
+        return Availability::UNKNOWN;
+    }
+    
     // Format package names for this PM
     virtual std::string formatPackageName(const std::string& name) {
         return name;
     }
+
+protected:
+    // Parse "repo/name version ..." lines each followed by an indented
+    // description, as printed by apt search and pacman -Ss
+    static void parseRepoListing(const std::string& output, PackageManager pm,
+                                 std::vector<AvailablePackage>& results);
 };
 
 // Factory for creating adapters
 class AdapterFactory {
 public:
     static std::unique_ptr<PackageManagerAdapter> create(PackageManager pm);
+    
+    // Create an adapter configured for a detected installation
+    static std::unique_ptr<PackageManagerAdapter> create(const PMInfo& info);
 };
 
 // Concrete adapter implementations
 
+class AptIndex;
+
 class APTAdapter : public PackageManagerAdapter {
 public:
+    APTAdapter();
+    ~APTAdapter() override;
+    
     PackageManager getType() const override { return PackageManager::APT; }
     std::string getName() const override { return "apt"; }
-    std::string getInstallCommand(const std::vector<std::string>& packages) override;
-    std::string getRemoveCommand(const std::vector<std::string>& packages) override;
-    std::string getUpdateCommand() override;
-    std::string getSearchCommand(const std::string& query) override;
-    std::string getListCommand() override;
-    std::string getInfoCommand(const std::string& package) override;
+    CommandPlan planInstall(const std::vector<std::string>& packages) override;
+    CommandPlan planRemove(const std::vector<std::string>& packages) override;
+    CommandPlan planUpdate() override;
+    CommandPlan planSearch(const std::string& query) override;
+    CommandPlan planList() override;
+    CommandPlan planInfo(const std::string& package) override;
+    CommandPlan planUpgrade() override;
+    CommandPlan planDownload(const std::vector<std::string>& packages,
+                             const std::string& stagingDir) override;
+    CommandPlan planInstallStaged(const std::vector<std::string>& packages,
+                                  const std::string& stagingDir) override;
     bool requiresRoot() override { return true; }
+    bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) override;
+    bool readInstalled(std::vector<InstalledPackage>& packages) override;
+    bool findInstalled(const std::string& name, InstalledPackage& package) override;
+    std::vector<std::string> getInstalledMetadataPaths() override;
+    std::vector<std::string> getRepositoryMetadataPaths() override;
+    std::vector<std::string> getLockPaths() override;
+    bool searchAvailable(const std::string& query, std::vector<AvailablePackage>& results) override;
+    Availability checkAvailable(const std::string& name) override;
+
+private:
+    std::unique_ptr<AptIndex> index_;
+    bool indexLoaded_ = false;
+    
+    // Package-list index, loaded on first use; nullptr if unavailable
+    const AptIndex* index();
 };
 
 class PacmanAdapter : public PackageManagerAdapter {
 public:
     PackageManager getType() const override { return PackageManager::PACMAN; }
     std::string getName() const override { return "pacman"; }
-    std::string getInstallCommand(const std::vector<std::string>& packages) override;
-    std::string getRemoveCommand(const std::vector<std::string>& packages) override;
-    std::string getUpdateCommand() override;
-    std::string getSearchCommand(const std::string& query) override;
-    std::string getListCommand() override;
-    std::string getInfoCommand(const std::string& package) override;
+    CommandPlan planInstall(const std::vector<std::string>& packages) override;
+    CommandPlan planRemove(const std::vector<std::string>& packages) override;
+    CommandPlan planUpdate() override;
+    CommandPlan planSearch(const std::string& query) override;
+    CommandPlan planList() override;
+    CommandPlan planInfo(const std::string& package) override;
+    CommandPlan planUpgrade() override;
+    CommandPlan planDownload(const std::vector<std::string>& packages,
+                             const std::string& stagingDir) override;
     bool requiresRoot() override { return true; }
+    bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) override;
+    bool readInstalled(std::vector<InstalledPackage>& packages) override;
+    bool findInstalled(const std::string& name, InstalledPackage& package) override;
+    std::vector<std::string> getInstalledMetadataPaths() override;
+    std::vector<std::string> getRepositoryMetadataPaths() override;
+    std::vector<std::string> getLockPaths() override;
 };
 
 class BrewAdapter : public PackageManagerAdapter {
 public:
+    // prefix: brew installation prefix; located automatically when empty
+    explicit BrewAdapter(std::string prefix = "") : prefix_(std::move(prefix)) {}
+    
     PackageManager getType() const override { return PackageManager::BREW; }
     std::string getName() const override { return "brew"; }
-    std::string getInstallCommand(const std::vector<std::string>& packages) override;
-    std::string getRemoveCommand(const std::vector<std::string>& packages) override;
-    std::string getUpdateCommand() override;
-    std::string getSearchCommand(const std::string& query) override;
-    std::string getListCommand() override;
-    std::string getInfoCommand(const std::string& package) override;
+    CommandPlan planInstall(const std::vector<std::string>& packages) override;
+    CommandPlan planRemove(const std::vector<std::string>& packages) override;
+    CommandPlan planUpdate() override;
+    CommandPlan planSearch(const std::string& query) override;
+    CommandPlan planList() override;
+    CommandPlan planInfo(const std::string& package) override;
+    CommandPlan planUpgrade() override;
+    CommandPlan planDownload(const std::vector<std::string>& packages,
+                             const std::string& stagingDir) override;
     bool requiresRoot() override { return false; }
+    bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) override;
+    bool readInstalled(std::vector<InstalledPackage>& packages) override;
+    bool findInstalled(const std::string& name, InstalledPackage& package) override;
+    std::vector<std::string> getInstalledMetadataPaths() override;
+
+private:
+    std::string prefix_;
+    
+    const std::string& prefix();
 };
 
 class DNFAdapter : public PackageManagerAdapter {
 public:
     PackageManager getType() const override { return PackageManager::DNF; }
     std::string getName() const override { return "dnf"; }
-    std::string getInstallCommand(const std::vector<std::string>& packages) override;
-    std::string getRemoveCommand(const std::vector<std::string>& packages) override;
-    std::string getUpdateCommand() override;
-    std::string getSearchCommand(const std::string& query) override;
-    std::string getListCommand() override;
-    std::string getInfoCommand(const std::string& package) override;
+    CommandPlan planInstall(const std::vector<std::string>& packages) override;
+    CommandPlan planRemove(const std::vector<std::string>& packages) override;
+    CommandPlan planUpdate() override;
+    CommandPlan planSearch(const std::string& query) override;
+    CommandPlan planList() override;
+    CommandPlan planInfo(const std::string& package) override;
+    CommandPlan planUpgrade() override;
+    CommandPlan planDownload(const std::vector<std::string>& packages,
+                             const std::string& stagingDir) override;
     bool requiresRoot() override { return true; }
+    bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) override;
+    bool readInstalled(std::vector<InstalledPackage>& packages) override;
+    std::vector<std::string> getInstalledMetadataPaths() override;
+    std::vector<std::string> getLockPaths() override;
 };
 
 class WingetAdapter : public PackageManagerAdapter {
 public:
     PackageManager getType() const override { return PackageManager::WINGET; }
     std::string getName() const override { return "winget"; }
-    std::string getInstallCommand(const std::vector<std::string>& packages) override;
-    std::string getRemoveCommand(const std::vector<std::string>& packages) override;
-    std::string getUpdateCommand() override;
-    std::string getSearchCommand(const std::string& query) override;
-    std::string getListCommand() override;
-    std::string getInfoCommand(const std::string& package) override;
+    CommandPlan planInstall(const std::vector<std::string>& packages) override;
+    CommandPlan planRemove(const std::vector<std::string>& packages) override;
+    CommandPlan planUpdate() override;
+    CommandPlan planSearch(const std::string& query) override;
+    CommandPlan planList() override;
+    CommandPlan planInfo(const std::string& package) override;
     bool requiresRoot() override { return false; }
+    bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) override;
 };
 
 class ChocolateyAdapter : public PackageManagerAdapter {
 public:
     PackageManager getType() const override { return PackageManager::CHOCOLATEY; }
     std::string getName() const override { return "choco"; }
-    std::string getInstallCommand(const std::vector<std::string>& packages) override;
-    std::string getRemoveCommand(const std::vector<std::string>& packages) override;
-    std::string getUpdateCommand() override;
-    std::string getSearchCommand(const std::string& query) override;
-    std::string getListCommand() override;
-    std::string getInfoCommand(const std::string& package) override;
+    CommandPlan planInstall(const std::vector<std::string>& packages) override;
+    CommandPlan planRemove(const std::vector<std::string>& packages) override;
+    CommandPlan planUpdate() override;
+    CommandPlan planSearch(const std::string& query) override;
+    CommandPlan planList() override;
+    CommandPlan planInfo(const std::string& package) override;
     bool requiresRoot() override { return true; }
+    bool parseSearchOutput(const std::string& output, std::vector<AvailablePackage>& results) override;
 };
 
 } // namespace unipm
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/mapped_file.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace unipm {
+
+// One available package; fields point into the index blob
+struct AptIndexEntry {
+    std::string_view name;
+    std::string_view version;      // Candidate (highest) version across lists
+    std::string_view section;
+    std::string_view description;  // Synopsis line
+    uint64_t size = 0;             // Download size in bytes
+};
+
+/**
+ * AptIndex - Compact index over apt's downloaded package lists
+ *
+ * Built from the *_Packages files in /var/lib/apt/lists (one parallel
+ * task per list file, each memory-mapped) and cached in the unipm cache
+ * directory. The cache is keyed on the size and mtime of every list file,
+ * so it is rebuilt automatically after `apt update`. Answers search, "is this
+ * name available?" and candidate-version queries without running apt.
+ */
+class AptIndex {
+public:
+    static constexpr const char* DEFAULT_LISTS_DIR = "/var/lib/apt/lists";
+    static constexpr const char* CACHE_FILE = "apt-index.bin";
+
+    AptIndex() = default;
+    ~AptIndex() = default;
+
+    AptIndex(const AptIndex&) = delete;
+    AptIndex& operator=(const AptIndex&) = delete;
+
+    // Load from cache if it is still current, otherwise rebuild from the
+    // lists and refresh the cache. Pass an empty cachePath to skip caching.
+    bool load(const std::string& listsDir = DEFAULT_LISTS_DIR,
+              const std::string& cachePath = Cache::pathFor(CACHE_FILE));
+
+    // Load only the cache file, whether or not the lists changed since.
+    // For readers that can live with slightly stale data (completion).
+    bool loadCache(const std::string& cachePath = Cache::pathFor(CACHE_FILE));
+
+    // Did the last load() come from the cache?
+    bool loadedFromCache() const { return fromCache_; }
+
+    size_t size() const { return entries_.size(); }
+    const std::vector<AptIndexEntry>& entries() const { return entries_; }
+
+    // Exact name lookup (binary search), or nullptr
+    const AptIndexEntry* find(std::string_view name) const;
+
+    bool isAvailable(std::string_view name) const { return find(name) != nullptr; }
+
+    // Candidate version for name, or empty
+    std::string candidateVersion(std::string_view name) const;
+
+    // Case-insensitive match on name, then description. Exact and prefix
+    // name matches rank first.
+    std::vector<const AptIndexEntry*> search(const std::string& query, size_t maxResults = 0) const;
+
+    // dpkg version ordering: <0 if a < b, 0 if equal, >0 if a > b
+    static int compareVersions(std::string_view a, std::string_view b);
+
+private:
+    struct Source {
+        std::string path;
+        FileStamp stamp;
+    };
+
+    MappedFile cacheFile_;
+    std::string blob_;  // Owned index data when not mapped from cache
+    std::vector<AptIndexEntry> entries_;
+    bool fromCache_ = false;
+
+    static std::vector<Source> listSources(const std::string& listsDir);
+    bool build(const std::vector<Source>& sources);
+    bool parseBlob(std::string_view blob, const std::vector<Source>* expected);
+};
+
+} // namespace unipm
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace unipm {
+
+// Helpers for the binary cache files unipm writes (apt index, history index).
+// Values are stored in native byte order; the files never leave the host.
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+inline void putString16(std::string& out, std::string_view value) {
+    size_t len = std::min<size_t>(value.size(), 0xFFFF);
+    put<uint16_t>(out, static_cast<uint16_t>(len));
+    out.append(value.data(), len);
+}
+
+// Bounds-checked reader over a blob
+class BlobReader {
+public:
+    explicit BlobReader(std::string_view blob) : blob_(blob) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (pos_ + sizeof(T) > blob_.size()) return false;
+        std::memcpy(&value, blob_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool bytes(size_t len, std::string_view& out) {
+        if (pos_ + len > blob_.size()) return false;
+        out = blob_.substr(pos_, len);
+        pos_ += len;
+        return true;
+    }
+
+    bool string16(std::string_view& out) {
+        uint16_t len;
+        return get(len) && bytes(len, out);
+    }
+
+private:
+    std::string_view blob_;
+    size_t pos_ = 0;
+};
+
+} // namespace unipm
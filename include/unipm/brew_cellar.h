@@ -0,0 +1,49 @@
+#pragma once
+
+#include "unipm/types.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace unipm {
+
+/**
+ * BrewCellar - Filesystem-based Homebrew inventory
+ *
+ * Enumerates <prefix>/Cellar (formulae) and <prefix>/Caskroom (casks)
+ * directly, reading INSTALL_RECEIPT.json for the install reason. This
+ * avoids booting brew's Ruby runtime just to list what is installed, and
+ * works the same for macOS and Linuxbrew prefixes.
+ */
+class BrewCellar {
+public:
+    BrewCellar() = default;
+    ~BrewCellar() = default;
+
+    // Enumerate formulae and casks under a brew prefix
+    bool load(const std::string& prefix);
+
+    // Read a single formula or cask
+    bool loadPackage(const std::string& prefix, const std::string& name);
+
+    const std::vector<InstalledPackage>& packages() const { return packages_; }
+
+    // Installed formula or cask by name, or nullptr
+    const InstalledPackage* find(const std::string& name) const;
+
+    bool isInstalled(const std::string& name) const { return find(name) != nullptr; }
+
+    // Derive the prefix from the brew binary path (<prefix>/bin/brew)
+    static std::string prefixFromBinary(const std::string& brewPath);
+
+    // HOMEBREW_PREFIX, then the standard macOS and Linuxbrew locations
+    static std::string findPrefix();
+
+private:
+    std::vector<InstalledPackage> packages_;
+    std::unordered_map<std::string, size_t> index_;
+
+    void add(InstalledPackage pkg);
+};
+
+} // namespace unipm
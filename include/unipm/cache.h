@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace unipm {
+
+// Size and modification time of a file, used to validate cached data
+struct FileStamp {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return exists == other.exists && size == other.size && mtimeNs == other.mtimeNs;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+/**
+ * Cache - unipm's on-disk cache directory
+ *
+ * ~/.cache/unipm on Unix, %LOCALAPPDATA%\unipm\cache on Windows.
+ * UNIPM_CACHE_DIR overrides the location (used by tests).
+ */
+class Cache {
+public:
+    static std::string getDirectory();
+
+    // Path of a file inside the cache directory
+    static std::string pathFor(const std::string& name);
+
+    // Create the cache directory (and parents) if missing
+    static bool ensureDirectory();
+
+    // mkdir -p
+    static bool createDirectories(const std::string& path);
+
+    // Write through a temporary file and rename, so concurrent readers
+    // see either the old or the new contents, never a partial file
+    static bool writeAtomic(const std::string& path, const std::string& data);
+
+    static bool readFile(const std::string& path, std::string& data);
+
+    static FileStamp stat(const std::string& path);
+};
+
+} // namespace unipm
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace unipm {
+
+// One process to spawn, without a shell
+struct CommandStep {
+    std::vector<std::string> argv;
+    std::vector<std::pair<std::string, std::string>> env;  // Overrides on top of our environment
+    bool requiresRoot = false;
+    std::string lockDomain;         // Steps sharing a non-empty domain never overlap
+    size_t operandIndex = 0;        // argv[operandIndex..] may be split across runs; 0 = never
+    bool dependsOnPrevious = true;  // Wait for every earlier step before starting
+
+    // Read-only query: no privileges, no package-manager lock
+    static CommandStep query(std::vector<std::string> argv);
+
+    // State-changing operation holding the package manager's lock
+    static CommandStep mutation(std::vector<std::string> argv, std::string lockDomain,
+                                bool requiresRoot);
+
+    // Append package operands; the executor may split them to stay under ARG_MAX
+    CommandStep& withOperands(const std::vector<std::string>& operands);
+
+    CommandStep& withEnv(const std::string& name, const std::string& value);
+
+    // Shell-equivalent form, e.g. "HOMEBREW_NO_AUTO_UPDATE=1 brew upgrade"
+    std::string toString() const;
+};
+
+// Ordered steps that together implement one unipm command
+struct CommandPlan {
+    std::vector<CommandStep> steps;
+
+    CommandPlan() = default;
+    CommandPlan(std::initializer_list<CommandStep> init) : steps(init) {}
+
+    bool empty() const { return steps.empty(); }
+    bool requiresRoot() const;
+
+    // Steps joined with " && ", as a shell would run them
+    std::string toString() const;
+};
+
+// Quote an argument for display/execution by the platform shell when needed
+std::string shellQuote(const std::string& arg);
+
+} // namespace unipm
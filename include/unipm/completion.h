@@ -0,0 +1,89 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/mapped_file.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace unipm {
+
+// Files whose package names go into the completion index
+struct CompletionSources {
+    std::string database;   // packages.json: canonical names and aliases
+    std::string aptIndex;   // AptIndex cache: packages available from apt
+    std::string inventory;  // Inventory cache: installed packages, every PM
+
+    // The database main would load and the default cache files
+    static CompletionSources defaults();
+};
+
+/**
+ * CompletionIndex - Sorted package names for shell completion
+ *
+ * A flat file in the unipm cache directory: the size and mtime of each
+ * source, a table of offsets and the names themselves, sorted and
+ * NUL-terminated. It is memory-mapped and prefix-searched by binary search
+ * over the offsets, so completing a word costs a few stat calls and page
+ * faults instead of parsing the package database. The file is rebuilt when
+ * any source changes, which is the only time the sources are read.
+ */
+class CompletionIndex {
+public:
+    static constexpr const char* CACHE_FILE = "completion.idx";
+
+    explicit CompletionIndex(std::string path = Cache::pathFor(CACHE_FILE));
+
+    CompletionIndex(const CompletionIndex&) = delete;
+    CompletionIndex& operator=(const CompletionIndex&) = delete;
+
+    // Map the index, rebuilding it first if it is missing or stale
+    bool load(const CompletionSources& sources);
+
+    // Did the last load() use the existing file?
+    bool loadedFromCache() const { return fromCache_; }
+
+    size_t size() const { return count_; }
+
+    // Names starting with prefix, in sorted order, at most limit of them
+    std::vector<std::string_view> complete(std::string_view prefix, size_t limit) const;
+
+private:
+    std::string path_;
+    MappedFile file_;
+    std::string blob_;  // Owned index data when not mapped from the file
+    std::string_view offsets_;
+    std::string_view names_;
+    uint32_t count_ = 0;
+    bool fromCache_ = false;
+
+    bool parse(std::string_view blob, const std::vector<std::string>& paths);
+    std::string_view at(uint32_t i) const;
+    static std::string build(const CompletionSources& sources,
+                             const std::vector<std::string>& paths);
+};
+
+/**
+ * Completion - The `unipm __complete` entry point used by the shell scripts
+ *
+ * Takes the words after `unipm` with the one being completed last (empty
+ * when the cursor follows a space) and prints one candidate per line:
+ * commands, flags and flag values, or package names from the index. Nothing
+ * else in unipm is initialized on this path.
+ */
+class Completion {
+public:
+    // Enough for any shell's menu; more only slows the shell down
+    static constexpr size_t MAX_RESULTS = 500;
+
+    // The index is only loaded when the word is a package name
+    static std::vector<std::string> candidates(const std::vector<std::string>& words,
+                                               CompletionIndex& index,
+                                               const CompletionSources& sources);
+
+    // argv[0] is the program, argv[1] "__complete"
+    static int run(int argc, char* argv[]);
+};
+
+} // namespace unipm
@@ -4,6 +4,7 @@
 #include <json.hpp>
 #include <string>
 #include <map>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -18,37 +19,128 @@ struct PackageInfo {
     std::map<std::string, std::map<PackageManager, std::string>> versionMappings;
 };
 
+/**
+ * PackageDatabase - One loaded version of the package database
+ *
+ * Immutable once built, so any number of threads may query it while a
+ * reload builds the next one. Hold it by shared_ptr for as long as a
+ * lookup needs a consistent view.
+ */
+class PackageDatabase {
+public:
+    // An empty database
+    PackageDatabase() = default;
+    
+    // Parse the "packages" object of a database document
+    explicit PackageDatabase(const json& data, std::string path = "");
+    
+    // File it was loaded from, or empty
+    const std::string& path() const { return path_; }
+    
+    // Package info by name or alias; empty if unknown
+    PackageInfo getPackageInfo(const std::string& name) const;
+    
+    bool hasPackage(const std::string& name) const;
+    
+    std::vector<std::string> getAllPackageNames() const;
+    
+    // Number of packages, aliases not counted
+    size_t size() const { return packages_.size(); }
+    
+    // Mapping for a specific PM, or the name as-is
+    std::string getMapping(const std::string& packageName, PackageManager pm) const;
+    
+    // Reverse mapping: database name for a native package name, or empty
+    std::string getCanonicalName(const std::string& nativeName, PackageManager pm) const;
+
+private:
+    std::string path_;
+    std::map<std::string, PackageInfo> packages_;
+    std::map<std::string, std::string> aliases_;  // Alias -> first package declaring it
+    std::map<std::pair<PackageManager, std::string>, std::string> canonicalNames_;
+    
+    const PackageInfo* find(const std::string& name) const;
+};
+
+/**
+ * DatabaseHandle - The current PackageDatabase of a long-lived process
+ *
+ * Readers take the current version with current() and keep it for the
+ * rest of their lookup; publish() swaps in a new one without waiting for
+ * them. The old version is freed when its last reader lets go.
+ *
+ * Not lock-free: C++17's std::atomic_load/std::atomic_store on a
+ * shared_ptr take a mutex from a small global pool hashed by address
+ * (libstdc++'s _Sp_locker), held only for the pointer copy. Readers may
+ * briefly contend on it, but never wait on a parse.
+ */
+class DatabaseHandle {
+public:
+    explicit DatabaseHandle(std::shared_ptr<const PackageDatabase> database =
+                                std::make_shared<const PackageDatabase>());
+    
+    std::shared_ptr<const PackageDatabase> current() const;
+    void publish(std::shared_ptr<const PackageDatabase> database);
+
+private:
+    // Only ever accessed through std::atomic_load/std::atomic_store, which
+    // serialize on a hashed global mutex rather than on the loader
+    std::shared_ptr<const PackageDatabase> database_;
+};
+
+/**
+ * Config - Loads the package database and publishes it to a DatabaseHandle
+ *
+ * Loading runs on one thread at a time; the queries read whatever version
+ * was published last and may run on any thread meanwhile.
+ */
 class Config {
 public:
     Config();
     ~Config() = default;
 
-    // Load package database from JSON file
+    // Load package database from JSON file. Nothing is published on failure.
     bool load(const std::string& path);
     
     // Load default package database
     bool loadDefault();
     
+    // Database file main loads: the default one, else data/packages.json.
+    // Empty when neither exists.
+    std::string findDatabase();
+    
+    // Path of the last database loaded, or empty
+    std::string path() const { return snapshot()->path(); }
+    
+    // Content hash of a database file ("fnv1a64:<hex>"); empty if unreadable
+    static std::string hashDatabase(const std::string& path);
+    
     // Merge user config with default config
     void mergeUserConfig(const std::string& userConfigPath);
     
+    // The version loaded last, and the handle it is published to
+    std::shared_ptr<const PackageDatabase> snapshot() const { return handle_->current(); }
+    const std::shared_ptr<DatabaseHandle>& handle() const { return handle_; }
+    
     // Get package info by name
-    PackageInfo getPackageInfo(const std::string& name);
+    PackageInfo getPackageInfo(const std::string& name) const;
     
     // Check if package exists in database
-    bool hasPackage(const std::string& name);
+    bool hasPackage(const std::string& name) const;
     
     // Get all package names
-    std::vector<std::string> getAllPackageNames();
+    std::vector<std::string> getAllPackageNames() const;
     
     // Get package mapping for specific PM
-    std::string getMapping(const std::string& packageName, PackageManager pm);
+    std::string getMapping(const std::string& packageName, PackageManager pm) const;
+    
+    // Reverse mapping: database name for a native package name, or empty
+    std::string getCanonicalName(const std::string& nativeName, PackageManager pm) const;
 
 private:
-    json data_;
-    std::map<std::string, PackageInfo> packages_;
+    json data_;  // The loaded document, kept for merging
+    std::shared_ptr<DatabaseHandle> handle_;
     
-    void parsePackages();
     std::string getDefaultConfigPath();
     std::string getUserConfigPath();
 };
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/types.h"
+#include <json.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace unipm {
+
+class DatabaseHandle;
+class Inventory;
+class PackageManagerAdapter;
+
+/**
+ * Daemon - unipmd, which keeps host facts, the package database, repository
+ * indexes and installed-package inventories in memory for unipm to query
+ *
+ * It listens on a per-user Unix socket. run() watches every connection and
+ * hands those with a request waiting to a fixed pool of worker threads, so
+ * a client that stays connected holds no worker between requests. Requests
+ * and responses are JSON objects, one per line, any number per connection:
+ *
+ *   {"op":"hello"}                              protocol, pid, database
+ *   {"op":"detect","pm":"apt"}                  OS and the default (or named) PM
+ *   {"op":"resolve","pm":..,"name":..,"version":..,"check":true}
+ *   {"op":"installed","pm":..,"names":[..]}     installed entries, null if absent
+ *   {"op":"list","pm":..}                       the whole installed set
+ *   {"op":"search","pm":..,"query":..}          the PM's local repository index
+ *   {"op":"reload"}                             detect and load everything again
+ *
+ * Failures are answered with {"error":"..."}. The database is reloaded when
+ * its file changes and a PM's repository index when its metadata does
+ * (inotify on Linux, a stat check every two seconds elsewhere); inventories
+ * watch the PMs' installed metadata themselves. The daemon only answers
+ * questions: installs and removals still run in the unipm process.
+ */
+class Daemon {
+public:
+    static constexpr int PROTOCOL = 1;
+
+    // UNIPM_SOCKET, else $XDG_RUNTIME_DIR/unipm.sock, else /tmp/unipm-<uid>.sock
+    static std::string socketPath();
+
+    // database: the file to serve; empty finds it the way unipm does.
+    // threads: workers, 0 for one per core (at least two).
+    explicit Daemon(std::string socketPath = Daemon::socketPath(), std::string database = "",
+                    size_t threads = 0);
+    ~Daemon();
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+
+    // Detect, load and bind the socket. False with error when another
+    // daemon is listening there or the socket can't be created.
+    bool start(std::string& error);
+
+    // Serve connections until stop()
+    void run();
+
+    // Make run() return; safe to call from a signal handler
+    void stop();
+
+    // Answer one request
+    nlohmann::json handle(const nlohmann::json& request);
+
+    // Path of the database being served, or empty
+    std::string databasePath();
+
+private:
+    // An adapter per detected PM. Lookups take a reference to the current
+    // adapter; a repository metadata change swaps in a fresh one.
+    struct Manager {
+        PMInfo info;
+        std::vector<std::string> metadataPaths;
+        std::vector<FileStamp> stamps;
+        std::shared_ptr<PackageManagerAdapter> adapter;
+    };
+
+    // A client connection and its unanswered partial request
+    struct Connection {
+        int fd = -1;
+        std::string buffer;
+    };
+
+    std::string socketPath_;
+    std::string requestedDatabase_;
+    size_t threads_;
+    int listenFd_ = -1;
+    int stopPipe_[2] = {-1, -1};
+    int wakePipe_[2] = {-1, -1};  // Workers hand connections back to run()
+    int watchFd_ = -1;
+    std::atomic<bool> stopping_{false};
+
+    // Lookups read the database without taking stateMutex_; a reload
+    // publishes the new version here
+    const std::shared_ptr<DatabaseHandle> packages_;
+
+    std::mutex stateMutex_;  // Guards everything down to inventory_
+    OSInfo os_{};
+    std::vector<PMInfo> detected_;
+    PMInfo defaultPM_{};
+    std::map<PackageManager, Manager> managers_;
+    std::string database_;
+    FileStamp databaseStamp_;
+
+    std::mutex inventoryMutex_;
+    std::unique_ptr<Inventory> inventory_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueReady_;
+    std::deque<Connection> ready_;      // A request waiting, for the workers
+    std::vector<Connection> returned_;  // Served, back to run() to watch
+    std::thread watcher_;
+
+    void load();
+    void loadDatabase();
+    void addWatch(const std::string& path);
+    void watch();
+    void checkForChanges();
+    // Answer what the connection sent; false when it should be closed
+    bool serve(Connection& connection);
+    void work();
+
+    std::shared_ptr<PackageManagerAdapter> adapterFor(PackageManager pm);
+};
+
+/**
+ * DaemonClient - unipm's side of the unipmd socket
+ *
+ * Calls return false whenever the daemon can't answer (none running, a
+ * different protocol, gone mid-run, too slow), and the client stays
+ * disconnected from then on, so callers simply do the work themselves.
+ * Only sockets owned by the current user are trusted.
+ */
+class DaemonClient {
+public:
+    static constexpr int TIMEOUT_MS = 10000;
+    // A daemon that can't even say hello this fast isn't worth waiting for
+    static constexpr int CONNECT_TIMEOUT_MS = 200;
+
+    explicit DaemonClient(std::string socketPath = Daemon::socketPath());
+    ~DaemonClient();
+
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    // Connect and agree on the protocol; false if no usable daemon listens
+    bool connect();
+    bool connected() const { return fd_ >= 0; }
+
+    // Database the daemon serves as an absolute path, or empty (known once
+    // connected)
+    const std::string& database() const { return database_; }
+
+    // Whether the daemon serves path, wherever either was started
+    bool servesDatabase(const std::string& path) const;
+
+    // One request and its response; a response carrying "error" fails
+    bool call(const nlohmann::json& request, nlohmann::json& response,
+              int timeoutMs = TIMEOUT_MS);
+
+    // OS and the default PM, or pm when named; info.type is UNKNOWN when
+    // that PM isn't available
+    bool detect(const std::string& pm, OSInfo& os, PMInfo& info);
+
+    // Resolver::resolve() against the daemon's database. check confirms
+    // names against the PM's repository index.
+    bool resolve(const std::string& name, const std::string& version, PackageManager pm,
+                 bool check, ResolvedPackage& resolved);
+
+    // Installed entries for names (an empty name where absent). tracked
+    // says whether pm's installed set could be read at all.
+    bool installed(const std::vector<std::string>& names, PackageManager pm, bool& tracked,
+                   std::vector<InstalledPackage>& packages);
+
+    bool list(PackageManager pm, bool& tracked, std::vector<InstalledPackage>& packages);
+
+    // supported is false when pm has no local repository index
+    bool search(const std::string& query, PackageManager pm, bool& supported,
+                std::vector<AvailablePackage>& results);
+
+private:
+    std::string socketPath_;
+    std::string database_;
+    std::string buffer_;
+    int fd_ = -1;
+
+    void disconnect();
+};
+
+} // namespace unipm
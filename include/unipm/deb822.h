@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+namespace unipm {
+namespace deb822 {
+
+/**
+ * Walk the fields of RFC 822-style control data (dpkg status, apt lists,
+ * extended_states) without copying.
+ *
+ * onField(key, value) receives the first line of each field's value;
+ * continuation lines are skipped. onStanzaEnd() fires after every stanza,
+ * including a final stanza that isn't followed by a blank line.
+ */
+template <typename FieldFn, typename EndFn>
+void parse(std::string_view text, FieldFn&& onField, EndFn&& onStanzaEnd) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    bool inStanza = false;
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+
+        std::string_view line(p, eol - p);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        p = eol + 1;
+
+        if (line.empty()) {
+            if (inStanza) {
+                onStanzaEnd();
+                inStanza = false;
+            }
+            continue;
+        }
+
+        // Continuation of a multi-line value, or a comment
+        if (line[0] == ' ' || line[0] == '\t' || line[0] == '#') {
+            continue;
+        }
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+
+        inStanza = true;
+        onField(line.substr(0, colon), value);
+    }
+
+    if (inStanza) {
+        onStanzaEnd();
+    }
+}
+
+} // namespace deb822
+} // namespace unipm
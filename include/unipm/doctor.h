@@ -4,9 +4,11 @@
 
 namespace unipm {
 
+class DoctorContext;
+
 /**
  * Doctor - System diagnostics and health check
- * 
+ *
  * Checks:
  * - unipm installation and version
  * - PATH configuration
@@ -14,6 +16,9 @@ namespace unipm {
  * - Package database status
  * - Configuration file validity
  * - Network connectivity
+ *
+ * The checks run concurrently and share one OS/package manager detection
+ * and database load; each prints its own section, in order, with its time.
  */
 class Doctor {
 public:
@@ -23,14 +28,32 @@ public:
      */
     static int runDiagnostics();
     
+    /**
+     * Measure what drives unipm's latency on this host (doctor --perf):
+     * process spawn cost, database load time, cache directory I/O,
+     * package manager lock contention and mirror reachability
+     * @return 0 if every measurement is within its expected bound
+     */
+    static int runPerformanceProfile();
+
 private:
-    static bool checkInstallation();
-    static bool checkPath();
-    static bool checkPackageManagers();
-    static bool checkDatabase();
-    static bool checkConfig();
-    static bool checkNetwork();
+    using Context = DoctorContext;
+    struct Report;
+    
+    static bool checkInstallation(Report& report);
+    static bool checkPath(Report& report);
+    static bool checkPackageManagers(Context& context, Report& report);
+    static bool checkDatabase(Context& context, Report& report);
+    static bool checkConfig(Report& report);
+    static bool checkNetwork(Context& context, Report& report);
+    
+    static bool measureSpawn(Report& report);
+    static bool measureDatabase(Context& context, Report& report);
+    static bool measureCacheIO(Report& report);
+    static bool measureLocks(Context& context, Report& report);
+    static bool measureMirrors(Context& context, Report& report);
     
+    static void printReport(const Report& report);
     static void printCheckResult(const std::string& check, bool passed, const std::string& message = "");
 };
 
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "types.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace unipm {
+
+// The measurements behind unipm doctor, split out of doctor.cpp so they can
+// be tested on their own; nothing else should need them
+
+#ifndef _WIN32
+// Milliseconds to resolve host and open a TCP connection to port, or -1
+double connectMs(const std::string& host, const std::string& port, int timeoutMs);
+
+// lockHolder's answer for a lock file unipm may not open and whose holder
+// the kernel's lock table can't name (not Linux); run as root to check it
+constexpr long LOCK_UNINSPECTABLE = -2;
+
+// PID holding a package manager lock; 0 when free, -1 for a holder
+// unipm can't identify (a presence lock, or one held across namespaces).
+// Files unipm may not open are looked up in /proc/locks by inode
+long lockHolder(const std::string& path);
+#endif
+
+// A host and port to connect to
+struct Endpoint {
+    std::string host;
+    std::string port;
+};
+
+// Where pm's enabled repositories are served from, read from its
+// configuration (root prefixes the paths, as for MirrorList); its default
+// repository hosts when it has no readable configuration
+std::vector<Endpoint> repositoryEndpoints(PackageManager pm, const std::string& root = "");
+
+/**
+ * DoctorContext - Detection results shared by the doctor's checks
+ *
+ * Each is computed once, by whichever check asks first; the others wait
+ * for it. Safe to use from any number of threads.
+ */
+class DoctorContext {
+public:
+    const OSInfo& os();
+
+    // Package managers found on this system, probed concurrently
+    const std::vector<PackageManager>& managers();
+
+    // Load the package database the way main does, timing it
+    bool database(std::string& path, double& ms);
+
+    // Packages in the database; valid once database() has returned
+    size_t databasePackages() const { return databasePackages_; }
+
+private:
+    std::once_flag osOnce_;
+    std::once_flag managersOnce_;
+    std::once_flag databaseOnce_;
+    OSInfo os_;
+    std::vector<PackageManager> managers_;
+    std::string databasePath_;
+    bool databaseLoaded_ = false;
+    double databaseMs_ = 0.0;
+    size_t databasePackages_ = 0;
+};
+
+} // namespace unipm
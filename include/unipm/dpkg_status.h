@@ -0,0 +1,75 @@
+#pragma once
+
+#include "unipm/mapped_file.h"
+#include "unipm/types.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace unipm {
+
+// One stanza of the dpkg status file. Fields point into the mapped file.
+struct DpkgEntry {
+    std::string_view name;
+    std::string_view version;
+    std::string_view architecture;
+    std::string_view status;         // "want flag state", e.g. "install ok installed"
+    std::string_view section;
+    std::string_view installedSize;  // KiB, as written by dpkg
+    std::string_view description;    // First (synopsis) line only
+
+    bool isInstalled() const;
+};
+
+/**
+ * DpkgStatus - Native reader for /var/lib/dpkg/status
+ *
+ * Answers installed-state and version queries on Debian-based systems
+ * without spawning apt or dpkg-query. The file is memory-mapped and
+ * stanzas are parsed in place; entries stay valid while the reader lives.
+ */
+class DpkgStatus {
+public:
+    static constexpr const char* DEFAULT_PATH = "/var/lib/dpkg/status";
+    static constexpr const char* EXTENDED_STATES_PATH = "/var/lib/apt/extended_states";
+
+    DpkgStatus() = default;
+    ~DpkgStatus() = default;
+
+    DpkgStatus(const DpkgStatus&) = delete;
+    DpkgStatus& operator=(const DpkgStatus&) = delete;
+
+    // Map and parse a status file
+    bool load(const std::string& path = DEFAULT_PATH);
+
+    // Read apt's auto-installed markers so dependencies can be told apart
+    bool loadExtendedStates(const std::string& path = EXTENDED_STATES_PATH);
+
+    // All stanzas, including removed/config-files entries
+    const std::vector<DpkgEntry>& entries() const { return entries_; }
+
+    // Installed entry for a package name, or nullptr
+    const DpkgEntry* find(std::string_view name) const;
+
+    bool isInstalled(std::string_view name) const { return find(name) != nullptr; }
+
+    // Was the package pulled in automatically as a dependency?
+    bool isAutoInstalled(std::string_view name, std::string_view architecture) const;
+
+    // Owned copies of every installed entry
+    std::vector<InstalledPackage> installedPackages() const;
+
+    static InstalledPackage toInstalledPackage(const DpkgEntry& entry);
+
+private:
+    MappedFile file_;
+    std::vector<DpkgEntry> entries_;
+    std::unordered_map<std::string_view, size_t> installed_;
+    std::unordered_set<std::string> autoInstalled_;  // "name:arch"
+
+    void parse(std::string_view contents);
+};
+
+} // namespace unipm
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "unipm/command.h"
+#include "unipm/types.h"
+#include <json.hpp>
+#include <string>
+#include <string_view>
+
+namespace unipm {
+
+struct HistoryRecord;
+
+/**
+ * Events - Machine-readable output for --output=ndjson
+ *
+ * Every event is one JSON object per line on stdout, with an "event" type
+ * and "ts" in Unix milliseconds. Once enabled, the UI reports through events
+ * instead of formatted text, and anything else written to std::cout becomes
+ * a "text" event, so stdout carries nothing but NDJSON. Events are queued
+ * like relayed PM output and written in frames rather than one write each.
+ *
+ * Every function here is a no-op unless events are enabled.
+ */
+class Events {
+public:
+    static void enable();
+    static bool enabled() { return enabled_; }
+
+    // Any event; fields are merged into the object
+    static void emit(const std::string& type,
+                     nlohmann::ordered_json fields = nlohmann::ordered_json::object());
+
+    // info, success, warning or error
+    static void message(const std::string& level, const std::string& text);
+
+    static void detection(const OSInfo& os, const PMInfo& pm);
+    static void resolution(const ResolvedPackage& pkg);
+    static void plan(const CommandPlan& plan, bool dryRun);
+    static void prompt(const std::string& message, bool defaultYes);
+
+    // A chunk of package manager output, as it arrives
+    static void output(std::string_view chunk, const char* stream = "stdout");
+
+    static void result(const ExecutionResult& result, double seconds);
+    static void installed(const InstalledPackage& pkg);
+    static void available(const AvailablePackage& pkg);
+    static void search(const SearchOutcome& outcome);
+    static void history(const HistoryRecord& record);
+    static void check(const std::string& name, bool passed, const std::string& message);
+
+    // Write out queued events now
+    static void flush();
+
+private:
+    static bool enabled_;
+};
+
+} // namespace unipm
@@ -1,7 +1,15 @@
 #pragma once
 
+#include "unipm/command.h"
 #include "unipm/types.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace unipm {
 
@@ -13,8 +21,32 @@ public:
     // Execute a command
     ExecutionResult execute(const std::string& command, bool requiresRoot = false);
     
+    // Execute a structured plan. Steps are spawned directly (no shell), long
+    // operand lists are split under ARG_MAX, and steps that don't depend on
+    // their predecessor run concurrently unless they share a lock domain.
+    ExecutionResult execute(const CommandPlan& plan);
+    
+    // Run one step quietly and return its output. The process is killed
+    // if it runs past timeout (zero: no limit).
+    ExecutionResult capture(const CommandStep& step,
+                            std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    
     // Execute with dry-run mode (just print the command)
     void preview(const std::string& command, bool requiresRoot = false);
+    void preview(const CommandPlan& plan);
+    
+    // What the next executions are for, as recorded in the history log
+    void setHistoryContext(std::string action, PackageManager pm,
+                           std::vector<std::string> packages);
+    
+    // Hand child output to handler instead of the terminal (or --output
+    // events). It runs on the thread calling execute(), in step order.
+    void setOutputHandler(std::function<void(std::string_view)> handler) {
+        outputHandler_ = std::move(handler);
+    }
+    
+    // Byte budget for one invocation's arguments; 0 uses the system limit
+    void setArgumentLimit(size_t bytes) { argumentLimit_ = bytes; }
     
     // Check if sudo is available
     bool hasSudo();
@@ -23,7 +55,26 @@ public:
     bool isAdmin();
 
 private:
+    size_t argumentLimit_ = 0;
+    int sudoState_ = -1;  // Cached hasSudo(): -1 unknown
+    std::function<void(std::string_view)> outputHandler_;
+    
+    std::string historyAction_;
+    PackageManager historyPm_ = PackageManager::UNKNOWN;
+    std::vector<std::string> historyPackages_;
+    
+    // Queue a history record for a finished execution
+    struct Usage;
+    void recordHistory(const ExecutionResult& result, const Usage& start);
+    
     std::string prependSudo(const std::string& command);
+    
+    // argv vectors for one step: elevated if needed and split under the limit
+    std::vector<std::vector<std::string>> expandStep(const CommandStep& step);
+    ExecutionResult spawn(const std::vector<std::string>& argv,
+                          const std::vector<std::pair<std::string, std::string>>& env,
+                          bool stream,
+                          std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
     ExecutionResult executeWindows(const std::string& command);
     ExecutionResult executeUnix(const std::string& command);
     
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "unipm/types.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace unipm {
+
+// One executed command, as stored in the history log
+struct HistoryRecord {
+    int64_t timestampMs = 0;     // Unix time the command started
+    std::string action;          // unipm command: install, remove, update, ...
+    std::string packageManager;
+    std::vector<std::string> packages;
+    std::string command;         // What was run, shell-quoted
+    double durationSeconds = 0.0;
+    int exitCode = 0;
+    bool success = false;
+
+    // Resource usage of the child processes
+    double userSeconds = 0.0;
+    double systemSeconds = 0.0;
+    int64_t maxRssKb = 0;
+    int64_t blockReads = 0;
+    int64_t blockWrites = 0;
+    int64_t voluntarySwitches = 0;
+    int64_t involuntarySwitches = 0;
+    std::vector<ProcessUsage> processes;  // Each child, when they were waited for one by one
+
+    // One line of JSON, without the trailing newline
+    std::string toJson() const;
+    static bool fromJson(const std::string& line, HistoryRecord& record);
+};
+
+/**
+ * HistoryLog - Append-only JSONL log of executed commands
+ *
+ * append() only queues the record; a background thread formats it and
+ * writes each record with a single O_APPEND write while holding an flock
+ * on a sibling lock file, so records from concurrent unipm processes never
+ * interleave. Once the log passes maxBytes it's rotated to history.jsonl.1.gz
+ * (gzip when built with zlib), keeping KEEP_ROTATED older files.
+ */
+class HistoryLog {
+public:
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 1024 * 1024;
+    static constexpr int KEEP_ROTATED = 3;
+
+    explicit HistoryLog(std::string path = defaultPath(), uint64_t maxBytes = DEFAULT_MAX_BYTES);
+
+    // Writes out anything still queued
+    ~HistoryLog();
+
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    // The process-wide log at defaultPath()
+    static HistoryLog& instance();
+
+    // ~/.unipm/history.jsonl (%APPDATA%\unipm\history.jsonl on Windows)
+    static std::string defaultPath();
+
+    void append(HistoryRecord record);
+
+    // Block until every queued record has been written
+    void flush();
+
+    const std::string& path() const { return path_; }
+
+    // Path of the n-th rotated file (1 is the newest)
+    std::string rotatedPath(int n) const;
+
+private:
+    std::string path_;
+    uint64_t maxBytes_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::deque<HistoryRecord> queue_;
+    bool writing_ = false;
+    bool stopping_ = false;
+    std::thread writer_;
+
+    void run();
+    bool writeLine(const std::string& line);
+    void rotate();
+};
+
+} // namespace unipm
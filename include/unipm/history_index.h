@@ -0,0 +1,102 @@
+#pragma once
+
+#include "unipm/history.h"
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace unipm {
+
+// Which history records a query selects
+struct HistoryQuery {
+    enum class Outcome { ANY, SUCCEEDED, FAILED };
+
+    std::string package;         // Exact package name; empty matches every record
+    std::string packageManager;  // Empty matches every manager
+    int64_t sinceMs = std::numeric_limits<int64_t>::min();
+    int64_t untilMs = std::numeric_limits<int64_t>::max();
+    Outcome outcome = Outcome::ANY;
+    size_t limit = 0;  // Keep only the newest N matches; 0 keeps all
+
+    // Parse "30m", "12h", "7d", "2w" (before nowMs) or a local
+    // "YYYY-MM-DD[ HH:MM]" / "YYYY-MM-DDTHH:MM" into Unix milliseconds
+    static bool parseTime(const std::string& text, int64_t nowMs, int64_t& ms);
+};
+
+// Aggregates over the records a query selects
+struct HistoryStats {
+    struct Manager {
+        size_t count = 0;
+        size_t failed = 0;
+        double totalSeconds = 0.0;
+        double p50Seconds = 0.0;
+        double p95Seconds = 0.0;
+    };
+
+    size_t count = 0;
+    size_t failed = 0;
+    std::map<std::string, Manager> managers;  // By package manager ("" for none)
+};
+
+/**
+ * HistoryIndex - Sidecar index over the JSONL history log
+ *
+ * history.jsonl.idx maps each record to its byte range in the log, with its
+ * time, manager, outcome and duration, plus package name -> record postings.
+ * update() indexes only the records appended since the last run (a rotated
+ * log is detected by its first bytes and indexed afresh). Queries filter on
+ * the index and then parse just the matching records from the mapped log;
+ * stats never touch the log at all. Rotated generations aren't indexed.
+ */
+class HistoryIndex {
+public:
+    static constexpr const char* INDEX_SUFFIX = ".idx";
+
+    explicit HistoryIndex(std::string logPath = HistoryLog::defaultPath());
+
+    // Bring the index up to date with the log and save it.
+    // Returns false when there's no log to index.
+    bool update();
+
+    size_t size() const { return entries_.size(); }
+
+    // Records that match, oldest first
+    std::vector<HistoryRecord> query(const HistoryQuery& query) const;
+
+    HistoryStats stats(const HistoryQuery& query) const;
+
+    const std::string& indexPath() const { return indexPath_; }
+
+private:
+    struct Entry {
+        uint64_t offset = 0;
+        uint32_t length = 0;
+        uint16_t manager = 0;  // Into managers_
+        uint8_t success = 0;
+        int64_t timestampMs = 0;
+        double durationSeconds = 0.0;
+    };
+
+    static constexpr size_t HEAD_BYTES = 256;  // Prefix hashed to recognise the log
+
+    std::string logPath_;
+    std::string indexPath_;
+    uint64_t indexedBytes_ = 0;
+    uint64_t headLength_ = 0;
+    uint64_t headHash_ = 0;
+    std::vector<std::string> managers_;
+    std::vector<Entry> entries_;
+    std::map<std::string, std::vector<uint32_t>> postings_;
+
+    bool load();
+    bool save() const;
+    void clear();
+    void indexRecords(std::string_view log);
+    uint16_t managerId(const std::string& name);
+    std::vector<uint32_t> select(const HistoryQuery& query) const;
+};
+
+} // namespace unipm
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/types.h"
+#include <map>
+#include <string>
+#include <utility>
+
+namespace unipm {
+
+/**
+ * InstallTimings - How long recent installs took, per package manager
+ *
+ * Keeps an exponential moving average of the wall time of each install
+ * invocation, and of that time divided by the number of packages, in the
+ * unipm cache. Used to estimate the time saved by skipping work.
+ */
+class InstallTimings {
+public:
+    static constexpr const char* CACHE_FILE = "install-timings.tsv";
+
+    explicit InstallTimings(std::string path = Cache::pathFor(CACHE_FILE))
+        : path_(std::move(path)) {}
+
+    bool load();
+    bool save() const;
+
+    // Fold one successful install of packageCount packages into the averages
+    void record(PackageManager pm, double seconds, size_t packageCount);
+
+    // Average seconds per install invocation, or a negative value without history
+    double invocationSeconds(PackageManager pm) const;
+
+    // Average seconds per installed package, or a negative value without history
+    double perPackageSeconds(PackageManager pm) const;
+
+private:
+    struct Average {
+        double invocation = 0.0;
+        double perPackage = 0.0;
+        unsigned samples = 0;
+    };
+
+    static constexpr double SMOOTHING = 0.3;  // Weight of the newest sample
+
+    std::string path_;
+    std::map<PackageManager, Average> averages_;
+};
+
+} // namespace unipm
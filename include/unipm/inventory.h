@@ -0,0 +1,107 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/types.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace unipm {
+
+class PackageManagerAdapter;
+
+/**
+ * Inventory - Installed packages across every tracked package manager
+ *
+ * Each source is read through its adapter's native reader and persisted in
+ * the unipm cache together with the size/mtime of the PM's metadata
+ * (dpkg status, pacman's local DB, brew's Cellar, the rpmdb). A refresh only
+ * re-reads sources whose metadata changed; the rest come from the cache.
+ * Long-lived processes can additionally watch the metadata with inotify so
+ * unchanged sources are not even stat'ed.
+ */
+class Inventory {
+public:
+    static constexpr const char* CACHE_FILE = "inventory.tsv";
+
+    explicit Inventory(std::string cachePath = Cache::pathFor(CACHE_FILE));
+    ~Inventory();
+
+    Inventory(const Inventory&) = delete;
+    Inventory& operator=(const Inventory&) = delete;
+
+    // Track a detected package manager
+    void addSource(const PMInfo& info);
+
+    // Track a package manager through a specific adapter
+    void addSource(PackageManager pm, std::unique_ptr<PackageManagerAdapter> adapter);
+
+    // Bring all sources up to date. Returns the number of sources re-read.
+    size_t refresh();
+
+    // Watch the sources' metadata for changes (inotify, Linux only).
+    // Returns false when watching is unsupported; refresh() still works.
+    bool startWatching();
+
+    // Descriptor that becomes readable when watched metadata changes, or -1
+    int watchDescriptor() const { return watchFd_; }
+
+    // Drain pending change events and refresh. Returns sources re-read.
+    size_t poll();
+
+    // Installed via any tracked package manager?
+    bool isInstalled(const std::string& name) const;
+    bool isInstalled(const std::string& name, PackageManager pm) const;
+
+    // Installed entry for name under pm, or nullptr
+    const InstalledPackage* find(const std::string& name, PackageManager pm) const;
+
+    // Package managers that have name installed
+    std::vector<PackageManager> managersFor(const std::string& name) const;
+
+    // Was pm's installed set read successfully?
+    bool isTracked(PackageManager pm) const;
+
+    const std::vector<InstalledPackage>& packages(PackageManager pm) const;
+
+    // Names of every package in a cache file, without adding sources or
+    // checking the metadata (used for shell completion)
+    static bool readCachedNames(const std::string& cachePath, std::vector<std::string>& names);
+
+private:
+    struct Source {
+        PackageManager pm = PackageManager::UNKNOWN;
+        std::unique_ptr<PackageManagerAdapter> adapter;
+        std::vector<std::string> paths;
+        std::vector<FileStamp> stamps;
+        std::vector<InstalledPackage> packages;
+        std::unordered_map<std::string, size_t> byName;
+        bool loaded = false;
+        bool dirty = true;  // Set by watch events
+    };
+
+    struct Watch {
+        size_t source;
+        std::string name;  // Entry to filter on when watching a file's parent
+    };
+
+    std::string cachePath_;
+    std::vector<Source> sources_;
+    std::unordered_map<std::string, uint32_t> owners_;  // name -> bit per source
+    bool cacheRead_ = false;
+    int watchFd_ = -1;
+    std::unordered_multimap<int, Watch> watches_;
+
+    Source* sourceFor(PackageManager pm);
+    const Source* sourceFor(PackageManager pm) const;
+    static std::vector<FileStamp> stampPaths(const std::vector<std::string>& paths);
+    static void index(Source& source);
+    bool reload(Source& source);
+    void rebuildOwners();
+    void loadCache();
+    bool saveCache() const;
+};
+
+} // namespace unipm
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "unipm/types.h"
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace unipm {
+
+// One requested package and what it resolved to
+struct LockedPackage {
+    std::string name;     // As requested, e.g. "node"
+    std::string version;  // Requested version key, e.g. "lts"; may be empty
+    std::string native;   // Native package name the resolver chose
+};
+
+// Everything locked for one package manager
+struct LockedManager {
+    std::string databaseHash;  // Config::hashDatabase() of the database used
+    std::vector<LockedPackage> packages;
+};
+
+/**
+ * Lockfile - Pre-resolved native package names, per package manager
+ *
+ * `unipm lock` resolves a package list once and records the native names,
+ * keyed by package manager and tagged with the hash of the package database
+ * they came from. `unipm install --locked` replays them without loading the
+ * database or matching names, and refuses to run when the database changed.
+ * Locking on several platforms fills in one section per package manager.
+ */
+class Lockfile {
+public:
+    static constexpr const char* DEFAULT_PATH = "unipm.lock";
+    static constexpr int FORMAT_VERSION = 1;
+
+    explicit Lockfile(std::string path = DEFAULT_PATH) : path_(std::move(path)) {}
+
+    // False with a reason when the file is missing or malformed
+    bool load(std::string& error);
+    bool save() const;
+
+    const LockedManager* find(PackageManager pm) const;
+    void set(PackageManager pm, LockedManager entry);
+
+    const std::string& path() const { return path_; }
+
+    // Read a manifest: one "name [version]" per line, '#' starts a comment
+    static bool readManifest(const std::string& path, std::vector<std::string>& packages,
+                             std::string& error);
+
+private:
+    std::string path_;
+    std::map<PackageManager, LockedManager> managers_;
+};
+
+} // namespace unipm
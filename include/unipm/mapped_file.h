@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace unipm {
+
+/**
+ * MappedFile - Read-only view of a file's contents
+ *
+ * Uses mmap on Unix so large metadata files (dpkg status, apt lists)
+ * can be parsed in place without copying. On Windows the file is read
+ * into an owned buffer instead.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the file at path; returns false if it can't be opened
+    bool open(const std::string& path);
+
+    // Release the mapping
+    void close();
+
+    bool isOpen() const { return open_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    bool mapped_ = false;
+    std::string buffer_;  // Fallback storage when mmap isn't used
+};
+
+} // namespace unipm
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/types.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace unipm {
+
+/**
+ * MetadataFreshness - When each package manager last refreshed its repository indexes
+ *
+ * The age is taken from the newest of the PM's own index files and the time
+ * unipm last ran a refresh itself (stamped in the unipm cache), since a
+ * refresh that found nothing new may leave the index files untouched.
+ * `update` skips the refresh while the metadata is younger than the TTL.
+ */
+class MetadataFreshness {
+public:
+    static constexpr const char* CACHE_FILE = "metadata-refresh.tsv";
+    static constexpr int64_t DEFAULT_TTL_SECONDS = 3600;
+
+    explicit MetadataFreshness(std::string path = Cache::pathFor(CACHE_FILE))
+        : path_(std::move(path)) {}
+
+    bool load();
+    bool save() const;
+
+    // Seconds since the metadata was refreshed, or a negative value when unknown
+    int64_t ageSeconds(PackageManager pm, const std::vector<std::string>& metadataPaths) const;
+
+    // Record a successful refresh at the current time
+    void markRefreshed(PackageManager pm);
+
+    // TTL from UNIPM_METADATA_TTL (seconds), or the default
+    static int64_t defaultTtl();
+
+private:
+    std::string path_;
+    std::map<PackageManager, int64_t> refreshedAt_;  // Unix seconds
+};
+
+} // namespace unipm
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "unipm/types.h"
+#include <chrono>
+#include <string>
+
+namespace unipm {
+
+/**
+ * Metrics - Cumulative Prometheus metrics for node-exporter's textfile collector
+ *
+ * A run records what it did here (command, package manager, outcome, phase
+ * durations, how names resolved, cache lookups), and write() folds that
+ * into <dir>/unipm.prom: the counters and histograms already in the file
+ * are read back, this run is added, and the result replaces the file by
+ * rename, so a scrape sees the old totals or the new ones and never a
+ * partial file. A lock file next to it serializes concurrent runs.
+ *
+ * Recording is process-wide and thread-safe, and costs a mutex and a map
+ * update per event; nothing is written unless write() is called.
+ */
+class Metrics {
+public:
+    static constexpr const char* FILE_NAME = "unipm.prom";
+
+    // Upper bounds of the duration histogram buckets, in seconds
+    static constexpr double BUCKETS[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                         1,     2.5,  5,     10,   30,  60,   300, 900};
+
+    // UNIPM_METRICS_DIR, or empty
+    static std::string defaultDirectory();
+
+    // What this run was; the package manager stays "unknown" until detected
+    static void setCommand(const std::string& command);
+    static void setPackageManager(PackageManager pm);
+
+    // "cancelled" or "dry_run"; otherwise write() derives success or failure
+    // from the exit code
+    static void setOutcome(const std::string& outcome);
+
+    // Time spent in a phase: resolve, plan or execute
+    static void observe(const std::string& phase, double seconds);
+
+    // A name resolution: exact (confidence 1), fuzzy or passthrough (0).
+    // Fuzzy matches below LOW_CONFIDENCE are also counted as low-confidence.
+    static void resolution(const ResolvedPackage& resolved);
+    static constexpr float LOW_CONFIDENCE = 0.8f;
+
+    // The user was asked whether to go on with a low-confidence match
+    static void lowConfidencePrompt(bool continued);
+
+    // A lookup in one of unipm's caches (apt_index, inventory, mirror_ranking)
+    static void cacheLookup(const char* cache, bool hit);
+
+    // Add this run to dir/unipm.prom. Does nothing (and succeeds) when no
+    // command was recorded; false if the file couldn't be written.
+    static bool write(const std::string& dir, int exitCode);
+
+    // Forget everything recorded since the last reset
+    static void reset();
+};
+
+/**
+ * PhaseTimer - Times the rest of a scope into Metrics::observe()
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(const char* phase)
+        : phase_(phase), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() { stop(); }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    // Record the phase now rather than at the end of the scope
+    void stop();
+
+private:
+    const char* phase_;
+    std::chrono::steady_clock::time_point start_;
+    bool stopped_ = false;
+};
+
+} // namespace unipm
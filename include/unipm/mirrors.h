@@ -0,0 +1,163 @@
+#pragma once
+
+#include "unipm/cache.h"
+#include "unipm/command.h"
+#include "unipm/types.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace unipm {
+
+// A repository base URL as the package manager's configuration spells it
+struct Mirror {
+    std::string url;        // May hold PM variables: $repo, $arch, $basearch, $releasever
+    std::string probePath;  // Small index file under url to fetch when probing
+    bool configured = true; // In use now, rather than a candidate
+};
+
+// How one mirror answered a probe
+struct MirrorProbe {
+    std::string url;
+    bool reachable = false;
+    double connectMs = -1.0;
+    double firstByteMs = -1.0;    // From sending the request to the first response byte
+    double bytesPerSecond = 0.0;  // 0 when only latency could be measured
+    std::string error;
+
+    // Estimated milliseconds to fetch 1 MiB, for mirrors with a measured
+    // throughput; otherwise the best latency figure available
+    double cost() const;
+};
+
+/**
+ * MirrorProber - Concurrent latency and throughput probes of package mirrors
+ *
+ * Every mirror gets one ranged GET for the first PROBE_BYTES of its probe
+ * file, all mirrors at once. http:// is probed directly over a socket;
+ * https:// goes through curl when it is installed, and otherwise only the
+ * TCP connect is timed. Mirrors with a measured throughput rank by cost(),
+ * ahead of latency-only ones, and unreachable mirrors come last.
+ */
+class MirrorProber {
+public:
+    static constexpr size_t PROBE_BYTES = 256 * 1024;
+    static constexpr std::chrono::milliseconds DEFAULT_TIMEOUT{3000};
+
+    explicit MirrorProber(std::chrono::milliseconds timeout = DEFAULT_TIMEOUT,
+                          std::string root = "");
+
+    MirrorProbe probe(const Mirror& mirror) const;
+
+    // Probe every mirror at once; fastest first
+    std::vector<MirrorProbe> rank(const std::vector<Mirror>& mirrors) const;
+
+    // url/probePath with the PM variables filled in for this host
+    std::string probeUrl(const Mirror& mirror) const;
+
+private:
+    std::chrono::milliseconds timeout_;
+    std::string root_;
+};
+
+/**
+ * MirrorList - The mirrors a package manager is configured with
+ *
+ * apt: one-line and deb822 entries in sources.list and sources.list.d.
+ * pacman: Server lines of the mirrorlist; commented-out ones are candidates.
+ * dnf: baseurl lines of enabled repos; commented-out ones are candidates.
+ * root prefixes every path read (tests use a fake /etc).
+ */
+class MirrorList {
+public:
+    // Mirrors in use first (apt's by how many entries use them), then candidates
+    static std::vector<Mirror> read(PackageManager pm, const std::string& root = "");
+
+    // The mirror that a faster one would replace: the first one in use.
+    // Empty when none is.
+    static std::string primary(const std::vector<Mirror>& mirrors);
+
+    // A user-supplied candidate, probed like the primary mirror
+    static Mirror candidate(const std::string& url, const std::vector<Mirror>& mirrors);
+
+    // The best-ranked reachable mirror that can stand in for the primary one,
+    // or empty. pacman's Server lines all mirror the same repositories; for
+    // apt and dnf another configured URL is another repository.
+    static std::string fastest(PackageManager pm, const std::vector<Mirror>& mirrors,
+                               const std::vector<MirrorProbe>& ranking);
+};
+
+/**
+ * MirrorRanking - Probe results per package manager, cached with their time
+ */
+class MirrorRanking {
+public:
+    static constexpr const char* CACHE_FILE = "mirrors.tsv";
+    static constexpr int64_t DEFAULT_TTL_SECONDS = 24 * 3600;
+
+    explicit MirrorRanking(std::string path = Cache::pathFor(CACHE_FILE))
+        : path_(std::move(path)) {}
+
+    bool load();
+    bool save() const;
+
+    // Ranking for pm probed within ttlSeconds, or nullptr
+    const std::vector<MirrorProbe>* find(PackageManager pm, int64_t ttlSeconds) const;
+
+    // Record a ranking probed now
+    void set(PackageManager pm, std::vector<MirrorProbe> ranking);
+
+private:
+    std::string path_;
+    std::map<PackageManager, std::pair<int64_t, std::vector<MirrorProbe>>> rankings_;
+};
+
+/**
+ * MirrorOverride - Point one run of a package manager at another mirror
+ *
+ * Writes a copy of the PM's repository configuration into a scratch
+ * directory with the mirror swapped, and adds the options that make the PM
+ * read the copy (apt's Dir::Etc::SourceList and SourceParts, pacman's
+ * --config). The system configuration is never modified. apt names its
+ * package lists after the source URL, so apt also gets scratch lists,
+ * fetched from the new mirror by an update step added to the plan; the
+ * system lists stay as they were.
+ */
+class MirrorOverride {
+public:
+    MirrorOverride(PackageManager pm, std::string from, std::string to,
+                   std::string dir = defaultDirectory(), std::string root = "");
+
+    // Can this package manager be redirected for a single run?
+    static bool supported(PackageManager pm);
+
+    // A per-process directory in the unipm cache
+    static std::string defaultDirectory();
+
+    // Write the configuration copy
+    bool prepare() const;
+
+    // Make the plan's package manager steps read the copy
+    void apply(CommandPlan& plan) const;
+
+    // Remove the copy. apt writes the scratch lists as root, so this runs
+    // with the plan's privileges.
+    CommandStep cleanupStep(bool requiresRoot) const;
+
+    // Replace URL `from` with `to` wherever it appears as a whole URL or a
+    // path prefix of one
+    static std::string rewrite(const std::string& text, const std::string& from,
+                               const std::string& to);
+
+private:
+    PackageManager pm_;
+    std::string from_;
+    std::string to_;
+    std::string dir_;
+    std::string root_;
+};
+
+} // namespace unipm
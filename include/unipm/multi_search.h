@@ -0,0 +1,69 @@
+#pragma once
+
+#include "unipm/adapter.h"
+#include "unipm/config.h"
+#include "unipm/types.h"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace unipm {
+
+/**
+ * MultiSearch - Query several package managers at once
+ *
+ * Every adapter is searched on its own thread, natively when it can and
+ * otherwise by running its search command under a deadline. Outcomes are
+ * handed back on the calling thread as each manager finishes, so total
+ * latency is that of the slowest manager (capped by the deadline).
+ */
+class MultiSearch {
+public:
+    static constexpr std::chrono::milliseconds DEFAULT_DEADLINE{10000};
+
+    explicit MultiSearch(std::chrono::milliseconds deadline = DEFAULT_DEADLINE)
+        : deadline_(deadline) {}
+
+    void add(std::unique_ptr<PackageManagerAdapter> adapter);
+
+    size_t size() const { return adapters_.size(); }
+
+    // Run every search; onOutcome is called in completion order.
+    // Returns all outcomes in the order the adapters were added.
+    std::vector<SearchOutcome> run(const std::string& query,
+                                   const std::function<void(const SearchOutcome&)>& onOutcome);
+
+private:
+    std::chrono::milliseconds deadline_;
+    std::vector<std::unique_ptr<PackageManagerAdapter>> adapters_;
+
+    SearchOutcome searchOne(PackageManagerAdapter& adapter, const std::string& query);
+};
+
+/**
+ * SearchMerger - Dedupe results across package managers
+ *
+ * Native names are mapped back to their package database entry, so
+ * "nodejs" from apt and "node" from brew count as the same package.
+ */
+class SearchMerger {
+public:
+    explicit SearchMerger(std::shared_ptr<Config> config) : config_(std::move(config)) {}
+
+    // Results not already reported by another package manager
+    std::vector<AvailablePackage> add(const SearchOutcome& outcome);
+
+    // Canonical names offered by more than one package manager
+    std::map<std::string, std::vector<PackageManager>> duplicates() const;
+
+    std::string canonicalName(const AvailablePackage& pkg) const;
+
+private:
+    std::shared_ptr<Config> config_;
+    std::map<std::string, std::vector<PackageManager>> sources_;
+};
+
+} // namespace unipm
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "unipm/types.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace unipm {
+
+/**
+ * PacmanLocalDB - Native reader for pacman's local package database
+ *
+ * Each installed package is a directory "<name>-<pkgver>-<pkgrel>" under
+ * /var/lib/pacman/local holding a small "desc" file. The directories are
+ * read concurrently and collected into an in-memory index so `list` and
+ * installed checks don't have to spawn pacman.
+ */
+class PacmanLocalDB {
+public:
+    static constexpr const char* DEFAULT_PATH = "/var/lib/pacman/local";
+
+    PacmanLocalDB() = default;
+    ~PacmanLocalDB() = default;
+
+    // Read every package directory under path
+    bool load(const std::string& path = DEFAULT_PATH);
+
+    // Read only the entries whose directory could belong to name.
+    // Cheaper than load() for a single installed check.
+    bool loadPackage(const std::string& name, const std::string& path = DEFAULT_PATH);
+
+    const std::vector<InstalledPackage>& packages() const { return packages_; }
+
+    // Installed package by name, or nullptr
+    const InstalledPackage* find(const std::string& name) const;
+
+    bool isInstalled(const std::string& name) const { return find(name) != nullptr; }
+
+    // Parse the contents of a desc file; returns false without %NAME%
+    static bool parseDesc(std::string_view text, InstalledPackage& pkg);
+
+private:
+    std::vector<InstalledPackage> packages_;
+    std::unordered_map<std::string, size_t> index_;
+
+    bool readEntries(const std::string& path, const std::vector<std::string>& dirs);
+};
+
+} // namespace unipm
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace unipm {
+
+// Number of worker threads to use for I/O-bound fan-out (at least 1)
+size_t defaultConcurrency();
+
+// Run fn(i) for every i in [0, count) across up to maxThreads threads.
+// Work is handed out dynamically so uneven items don't stall a worker.
+// Blocks until every call has returned. fn must not throw.
+void parallelFor(size_t count, const std::function<void(size_t)>& fn, size_t maxThreads = 0);
+
+} // namespace unipm
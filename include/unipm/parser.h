@@ -19,8 +19,9 @@ public:
 
 private:
     CommandType parseCommandType(const std::string& cmd);
-    void parseFlags(const std::vector<std::string>& args, Command& cmd, size_t& index);
-    std::vector<std::string> parsePackages(const std::vector<std::string>& args, size_t startIndex);
+    
+    // Parse the flag at args[index]; advances index past a separate value
+    void parseFlag(const std::vector<std::string>& args, Command& cmd, size_t& index);
     
     // Helper to check if string is a flag
     bool isFlag(const std::string& arg);
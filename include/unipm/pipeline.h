@@ -0,0 +1,58 @@
+#pragma once
+
+#include "unipm/adapter.h"
+#include "unipm/command.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace unipm {
+
+/**
+ * InstallPipeline - Overlap downloading and installing a large package list
+ *
+ * The list is split into chunks. Chunk 0 is downloaded on its own, then
+ * installing chunk k runs alongside downloading chunk k+1, so the network
+ * and the disk are both busy. Each chunk is staged in its own directory
+ * under stagingRoot. When the adapter's lock domains keep a download from
+ * overlapping an install (pacman, or apt without staging directories),
+ * the plan is the plain install: serial chunks would only be slower.
+ */
+class InstallPipeline {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 8;
+
+    // stagingRoot: scratch directory for per-chunk downloads; empty uses
+    // the package manager's own cache
+    InstallPipeline(PackageManagerAdapter& adapter, size_t chunkSize,
+                    std::string stagingRoot = defaultStagingRoot());
+
+    // A per-process directory in the unipm cache
+    static std::string defaultStagingRoot();
+
+    // The pipelined plan, or the adapter's plain install plan when the list
+    // fits in one chunk, the PM has no download-only mode, or its downloads
+    // can't overlap its installs
+    CommandPlan plan(const std::vector<std::string>& packages);
+
+    // Did the last plan() actually pipeline?
+    bool pipelined() const { return chunks_ > 1; }
+    size_t chunkCount() const { return chunks_; }
+
+    std::string stagingDir(size_t chunk) const;
+
+    // Create the staging directories for the last plan()
+    bool prepare() const;
+
+    // Remove the staging directories. Their contents belong to whoever ran
+    // the downloads, so this runs with the same privileges.
+    CommandStep cleanupStep() const;
+
+private:
+    PackageManagerAdapter& adapter_;
+    size_t chunkSize_;
+    std::string stagingRoot_;
+    size_t chunks_ = 0;
+};
+
+} // namespace unipm
@@ -18,6 +18,9 @@ public:
     
     // Check if a specific package manager is available
     bool isAvailable(PackageManager pm);
+    
+    // Detect one specific package manager (type is UNKNOWN if missing)
+    PMInfo detect(PackageManager pm);
 
 private:
     // Check if a binary exists in PATH
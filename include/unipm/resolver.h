@@ -2,6 +2,7 @@
 
 #include "unipm/types.h"
 #include "unipm/config.h"
+#include <functional>
 #include <string>
 #include <vector>
 #include <memory>
@@ -10,7 +11,11 @@ namespace unipm {
 
 class Resolver {
 public:
+    // Follows config's database across reloads
     explicit Resolver(std::shared_ptr<Config> config);
+    
+    // Each lookup uses the version current when it starts
+    explicit Resolver(std::shared_ptr<DatabaseHandle> database);
     ~Resolver() = default;
 
     // Resolve a package name for a specific package manager
@@ -20,9 +25,18 @@ public:
     
     // Get suggestions for a package name
     std::vector<std::string> getSuggestions(const std::string& packageName, size_t maxResults = 5);
+    
+    // Check mapped names against the configured repositories before
+    // committing to them. The callback returns false for names the
+    // repositories are known not to contain.
+    void setAvailabilityCheck(std::function<bool(const std::string&)> check);
 
 private:
-    std::shared_ptr<Config> config_;
+    std::shared_ptr<DatabaseHandle> database_;
+    std::function<bool(const std::string&)> isAvailable_;
+    
+    std::vector<std::string> getSuggestions(const PackageDatabase& database,
+                                            const std::string& packageName, size_t maxResults);
     
     // Fuzzy matching using Levenshtein distance
     float fuzzyMatch(const std::string& a, const std::string& b);
@@ -22,7 +22,7 @@ public:
     // Escape shell special characters
     static std::string escapeShell(const std::string& input);
     
-    // Log operation to history file
+    // Log a bare command to the history file (see HistoryLog for full records)
     static void logOperation(const std::string& command, bool success);
     
     // Get history file path
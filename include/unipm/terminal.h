@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace unipm {
+
+// What the attached terminal can do, detected once per process
+struct TerminalCapabilities {
+    bool stdoutTty = false;
+    bool stderrTty = false;
+    bool color = false;  // ANSI colors on stdout; off for NO_COLOR and TERM=dumb
+};
+
+/**
+ * Terminal - Buffered stdout shared by the UI, the executor and std::cout
+ *
+ * Output collects in one buffer and leaves in a single write. On a terminal
+ * that happens at the end of each line group (a UI message, a std::endl);
+ * otherwise only when the buffer fills, before input is read or a child's
+ * output is relayed, before anything goes to stderr, and at exit.
+ *
+ * Package manager output passed to relay() is drawn at most FRAME_RATE times
+ * a second, and carriage-return progress redraws that a later redraw fully
+ * covers are dropped. The unipm binary routes std::cout and std::cerr
+ * through the terminal too, so all of its output stays in order.
+ */
+class Terminal {
+public:
+    static constexpr int FRAME_RATE = 30;
+    static constexpr size_t BUFFER_LIMIT = 64 * 1024;
+
+    static Terminal& instance();
+
+    Terminal(const Terminal&) = delete;
+    Terminal& operator=(const Terminal&) = delete;
+
+    const TerminalCapabilities& capabilities() const { return caps_; }
+
+    // Send std::cout and std::cerr through the terminal until exit
+    void attachStandardStreams();
+
+    // Draw relayed output in frames (the default on a terminal) rather
+    // than holding it until the buffer fills
+    void setFramed(bool framed);
+
+    // Queue text for stdout; endGroup() marks the end of a line group
+    void write(std::string_view text);
+    void endGroup();
+
+    // Write to stderr straight away, after everything queued for stdout
+    void writeError(std::string_view text);
+
+    // Queue live package manager output, drawing a frame when one is due
+    void relay(std::string_view output);
+
+    // Milliseconds until queued relay output is due, or -1 with none waiting
+    int frameTimeoutMs();
+
+    // Draw queued relay output if its frame is due
+    void tick();
+
+    void flush();
+
+    // Drop carriage-return redraws in text that a later redraw of the same
+    // line covers completely. lineStart says whether text begins a line.
+    static std::string collapseRedraws(std::string_view text, bool lineStart);
+
+private:
+    class StreamBuffer;
+
+    Terminal();
+    ~Terminal();
+
+    TerminalCapabilities caps_;
+    std::mutex mutex_;
+    std::string pending_;
+    bool framed_;
+    bool relayPending_ = false;
+    bool lineStart_ = true;  // Whether the last byte written ended a line
+    std::chrono::steady_clock::time_point lastFrame_;
+
+    std::unique_ptr<StreamBuffer> out_;
+    std::unique_ptr<StreamBuffer> err_;
+    std::streambuf* savedOut_ = nullptr;
+    std::streambuf* savedErr_ = nullptr;
+
+    void flushLocked();
+};
+
+} // namespace unipm
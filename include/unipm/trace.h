@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace unipm {
+
+/**
+ * Trace - Chrome trace-event timeline of a run (--trace=file.json)
+ *
+ * Spans are complete ("X") events in microseconds since start(), one track
+ * per thread, buffered in memory and written by finish(); open the file in
+ * Perfetto or chrome://tracing. Every child process gets a span with its
+ * argv and exit status, and a counter track of running and total
+ * subprocesses.
+ *
+ * Nothing is recorded until start(). Instrumentation goes through the
+ * UNIPM_TRACE_* macros below, which expand to nothing unless the build
+ * defines UNIPM_ENABLE_TRACING; otherwise a span costs one acquire load (a
+ * plain load on x86) while no trace is being recorded.
+ */
+class Trace {
+public:
+    // Record from now on; finish() writes the events to path
+    static void start(const std::string& path);
+
+    // Acquire pairs with start(), so now() sees the new trace's origin
+    static bool enabled() { return enabled_.load(std::memory_order_acquire); }
+
+    // Write the trace file and stop recording. False if nothing was being
+    // recorded or the file couldn't be written.
+    static bool finish();
+
+    // Microseconds since start()
+    static int64_t now();
+
+    // A finished span; argsJson is the body of a JSON object, or empty
+    static void complete(const std::string& name, const char* category, int64_t startUs,
+                         int64_t durationUs, const std::string& argsJson);
+
+    // A child process was started or reaped; feeds the subprocess counters
+    static void processStarted();
+    static void processExited();
+
+    // Child processes started since start()
+    static int64_t processCount();
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+/**
+ * TraceSpan - Scoped timer for one trace span
+ *
+ * Use through UNIPM_TRACE_SCOPE / UNIPM_TRACE_SPAN so it compiles away.
+ * name and category must outlive the span (string literals); rename()
+ * copies, for names only known at run time.
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "unipm");
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Is this span being recorded? The macros skip building names and
+    // args when it is not.
+    bool active() const { return start_ >= 0; }
+
+    void rename(const std::string& name);
+
+    // Record the span now rather than at the end of the scope
+    void end();
+
+    // Detail shown with the span
+    void arg(const char* key, const std::string& value);
+    void arg(const char* key, int64_t value);
+
+private:
+    const char* name_;
+    const char* category_;
+    int64_t start_ = -1;  // -1 while no trace is being recorded
+    std::string dynamicName_;
+    std::string args_;
+};
+
+} // namespace unipm
+
+#ifdef UNIPM_ENABLE_TRACING
+#define UNIPM_TRACE_CONCAT_(a, b) a##b
+#define UNIPM_TRACE_CONCAT(a, b) UNIPM_TRACE_CONCAT_(a, b)
+// Time the rest of the enclosing scope
+#define UNIPM_TRACE_SCOPE(name, category) \
+    ::unipm::TraceSpan UNIPM_TRACE_CONCAT(unipmTraceSpan, __LINE__)(name, category)
+// A named span, for UNIPM_TRACE_ARG and UNIPM_TRACE_RENAME
+#define UNIPM_TRACE_SPAN(var, name, category) ::unipm::TraceSpan var(name, category)
+#define UNIPM_TRACE_ARG(var, key, value) \
+    ((var).active() ? (var).arg(key, value) : static_cast<void>(0))
+#define UNIPM_TRACE_RENAME(var, name) \
+    ((var).active() ? (var).rename(name) : static_cast<void>(0))
+#define UNIPM_TRACE_END(var) (var).end()
+#define UNIPM_TRACE_PROCESS_STARTED() ::unipm::Trace::processStarted()
+#define UNIPM_TRACE_PROCESS_EXITED() ::unipm::Trace::processExited()
+#else
+#define UNIPM_TRACE_SCOPE(name, category) static_cast<void>(0)
+#define UNIPM_TRACE_SPAN(var, name, category) static_cast<void>(0)
+#define UNIPM_TRACE_ARG(var, key, value) static_cast<void>(0)
+#define UNIPM_TRACE_RENAME(var, name) static_cast<void>(0)
+#define UNIPM_TRACE_END(var) static_cast<void>(0)
+#define UNIPM_TRACE_PROCESS_STARTED() static_cast<void>(0)
+#define UNIPM_TRACE_PROCESS_EXITED() static_cast<void>(0)
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -52,6 +53,9 @@ enum class CommandType {
     HELP,
     VERSION,
     DOCTOR,
+    HISTORY,
+    LOCK,
+    MIRRORS,
     SELF_UNINSTALL
 };
 
@@ -69,6 +73,7 @@ struct PMInfo {
     std::string name;
     std::string path;
     std::string version;
+    std::string prefix;  // Installation prefix, when the PM has one (brew)
 };
 
 // Parsed command structure
@@ -90,6 +95,25 @@ struct ResolvedPackage {
     PackageManager packageManager;
     float confidence;  // Matching confidence (0.0 - 1.0)
     std::vector<std::string> suggestions;  // Alternative suggestions
+    bool available = true;  // False when a repository index says the name doesn't exist
+};
+
+// Resources used by a child process and the descendants it waited for
+// (wait4), or a sum of those
+struct ProcessUsage {
+    std::string command;     // argv, shell-quoted; empty for a sum
+    double wallSeconds = 0.0;
+    double userSeconds = 0.0;
+    double systemSeconds = 0.0;
+    int64_t maxRssKb = 0;    // Largest single process
+    int64_t blockReads = 0;  // Filesystem input operations
+    int64_t blockWrites = 0;
+    int64_t voluntarySwitches = 0;    // Gave up the CPU to wait: I/O, locks, the network
+    int64_t involuntarySwitches = 0;  // Preempted while runnable: CPU-bound
+
+    // Sum CPU, I/O and switches; keep the larger RSS. Wall time is left
+    // alone, since children may have overlapped.
+    void add(const ProcessUsage& other);
 };
 
 // Execution result
@@ -99,6 +123,47 @@ struct ExecutionResult {
     std::string stdoutOutput;
     std::string stderrOutput;
     std::string command;
+    bool timedOut = false;  // Killed after exceeding its deadline
+    double busySeconds = 0.0;  // Sum of the steps' run times; above wall time when they overlapped
+    ProcessUsage usage;        // Totals over every child, with the wall time of the whole run
+    std::vector<ProcessUsage> processes;  // Each child, in the order it was started
+};
+
+// Installed package record read from a package manager's local metadata
+struct InstalledPackage {
+    std::string name;
+    std::string version;
+    std::string architecture;
+    std::string description;  // Short (first line) description
+    uint64_t installedSize = 0;  // Bytes, 0 if unknown
+    bool explicitlyInstalled = true;  // False when pulled in as a dependency
+    PackageManager packageManager = PackageManager::UNKNOWN;
+};
+
+// Package available from the configured repositories
+struct AvailablePackage {
+    std::string name;
+    std::string version;  // Candidate version
+    std::string section;
+    std::string description;
+    uint64_t size = 0;  // Download size in bytes, 0 if unknown
+    PackageManager packageManager = PackageManager::UNKNOWN;
+};
+
+// Search results from one package manager
+struct SearchOutcome {
+    PackageManager packageManager = PackageManager::UNKNOWN;
+    bool success = false;
+    bool timedOut = false;
+    double seconds = 0.0;
+    std::vector<AvailablePackage> results;
+};
+
+// Result of checking a name against a local repository index
+enum class Availability {
+    AVAILABLE,
+    MISSING,
+    UNKNOWN  // No local index to answer from
 };
 
 // Helper functions
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "unipm/types.h"
+#include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 
 namespace unipm {
 
+struct HistoryRecord;
+struct HistoryStats;
+struct MirrorProbe;
+
 class UI {
 public:
     UI() = default;
@@ -34,6 +40,48 @@ public:
     
     // Print execution result
     static void printResult(const ExecutionResult& result);
+    
+    // Print installed packages read from native PM metadata
+    static void printInstalledPackages(std::vector<InstalledPackage> packages);
+    
+    // Print details of a single installed package
+    static void printInstalledInfo(const InstalledPackage& pkg);
+    
+    // Print search results from a local repository index
+    static void printSearchResults(const std::vector<AvailablePackage>& results);
+    
+    // Report packages left out of an install because they're already present.
+    // savedSeconds is an estimate; negative when there's no install history.
+    static void printSkippedPackages(const std::vector<std::string>& skipped, double checkMs,
+                                     double savedSeconds, const std::string& pmName);
+    
+    // Report whether update refreshes repository metadata, and why.
+    // ageSeconds is negative when the age is unknown.
+    static void printMetadataFreshness(const std::string& pmName, int64_t ageSeconds,
+                                       int64_t ttlSeconds, bool refresh, bool forced);
+    
+    // Compare a pipelined install's wall time with its steps' total run time
+    static void printPipelineSummary(size_t chunks, double wallSeconds, double busySeconds);
+    
+    // Wall time, CPU, memory, block I/O and context switches of each child
+    static void printProcessUsage(const ExecutionResult& result);
+    
+    // Print one package manager's results during a multi-PM search
+    static void printSearchHits(PackageManager pm, const std::vector<AvailablePackage>& hits);
+    
+    // Per-PM timing and the packages several managers provide
+    static void printSearchSummary(const std::vector<SearchOutcome>& outcomes,
+                                   const std::map<std::string, std::vector<PackageManager>>& shared);
+
+    // Print history records, one line each
+    static void printHistory(const std::vector<HistoryRecord>& records);
+    
+    // Per-PM run counts, failures and duration percentiles
+    static void printHistoryStats(const HistoryStats& stats);
+    
+    // Probed mirrors, fastest first, marking the one in use
+    static void printMirrorRanking(const std::string& pmName, const std::vector<MirrorProbe>& ranking,
+                                   const std::string& primary, bool cached);
 
 private:
     // ANSI color codes
@@ -0,0 +1,186 @@
+#pragma once
+
+/*
+ * libunipm - C interface to unipm's package database, resolver and adapters
+ *
+ * For tools that would otherwise run the unipm binary and parse its output
+ * once per lookup. Load the database once and keep the handle: every call
+ * after that is an in-process lookup.
+ *
+ * Conventions:
+ *  - Functions that can fail return a unipm_status; unipm_last_error()
+ *    then describes the failure on the calling thread.
+ *  - Objects handed out through an out parameter belong to the caller and
+ *    are released with their *_free function. Strings and arrays read from
+ *    them stay valid until then.
+ *  - Package managers are named as on the command line: "apt", "pacman",
+ *    "brew", "dnf", "yum", "winget", "choco", "snap", "flatpak".
+ *  - A unipm_db may be shared between threads, including while another
+ *    thread reloads it. Plans and result objects may not.
+ *
+ * The ABI only grows: functions and enum values are added, never changed,
+ * and UNIPM_API_VERSION goes up with each addition.
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(UNIPM_BUILDING_LIBRARY)
+#define UNIPM_API __declspec(dllexport)
+#else
+#define UNIPM_API __declspec(dllimport)
+#endif
+#else
+#define UNIPM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UNIPM_API_VERSION 1
+
+typedef enum {
+    UNIPM_OK = 0,
+    UNIPM_ERROR_INVALID_ARGUMENT = 1,
+    UNIPM_ERROR_NOT_FOUND = 2,       /* Database file missing or nothing detected */
+    UNIPM_ERROR_PARSE = 3,           /* Database file isn't valid */
+    UNIPM_ERROR_UNSUPPORTED = 4,     /* Unknown package manager or operation */
+    UNIPM_ERROR_EXECUTION = 5,       /* A command could not be run or failed */
+    UNIPM_ERROR_INTERNAL = 6
+} unipm_status;
+
+/* Resolution flags */
+#define UNIPM_RESOLVE_EXACT 1u /* Database names and aliases only, no fuzzy matching */
+
+typedef enum {
+    UNIPM_OP_INSTALL = 0,
+    UNIPM_OP_REMOVE = 1,
+    UNIPM_OP_UPDATE = 2, /* Refresh repository metadata and upgrade */
+    UNIPM_OP_UPGRADE = 3, /* Upgrade against the metadata already on disk */
+    UNIPM_OP_SEARCH = 4,
+    UNIPM_OP_LIST = 5,
+    UNIPM_OP_INFO = 6
+} unipm_operation;
+
+typedef struct unipm_db unipm_db;
+typedef struct unipm_resolutions unipm_resolutions;
+typedef struct unipm_strings unipm_strings;
+typedef struct unipm_plan unipm_plan;
+
+/*
+ * One resolved package. The library allocates these, so fields may be
+ * appended in later versions.
+ */
+typedef struct {
+    const char* original_name;
+    const char* resolved_name; /* Native name for the package manager */
+    const char* version;       /* Version specifier asked for, or "" */
+    float confidence;          /* 1 for database hits, 0 when nothing matched */
+    const char* const* suggestions;
+    size_t suggestion_count;
+} unipm_resolution;
+
+/* Receives a command's output as it is produced, in order */
+typedef void (*unipm_output_fn)(const char* data, size_t size, void* userdata);
+
+/* UNIPM_API_VERSION of the loaded library */
+UNIPM_API int unipm_api_version(void);
+
+/* Message for the last failure on this thread, or "" */
+UNIPM_API const char* unipm_last_error(void);
+
+/*
+ * Database
+ */
+
+/* Load a package database. path NULL or "" finds it the way unipm does. */
+UNIPM_API unipm_status unipm_db_open(const char* path, unipm_db** db);
+
+/*
+ * Load the database again (path NULL: the same file) and swap it in.
+ * Lookups already running finish against the old version; on failure the
+ * old version stays.
+ */
+UNIPM_API unipm_status unipm_db_reload(unipm_db* db, const char* path);
+
+/* File the current version was loaded from; valid until the next reload */
+UNIPM_API const char* unipm_db_path(const unipm_db* db);
+
+UNIPM_API size_t unipm_db_package_count(const unipm_db* db);
+
+UNIPM_API void unipm_db_close(unipm_db* db);
+
+/*
+ * Resolution
+ */
+
+/* Resolve one name (and optional version specifier) for pm */
+UNIPM_API unipm_status unipm_resolve(unipm_db* db, const char* pm, const char* name,
+                                     const char* version, unsigned flags,
+                                     unipm_resolutions** out);
+
+/* Resolve count names for pm in parallel, all against one database version */
+UNIPM_API unipm_status unipm_resolve_batch(unipm_db* db, const char* pm, const char* const* names,
+                                           size_t count, unsigned flags,
+                                           unipm_resolutions** out);
+
+UNIPM_API size_t unipm_resolutions_count(const unipm_resolutions* resolutions);
+
+/* The index-th resolution, in the order the names were given */
+UNIPM_API const unipm_resolution* unipm_resolutions_get(const unipm_resolutions* resolutions,
+                                                        size_t index);
+
+UNIPM_API void unipm_resolutions_free(unipm_resolutions* resolutions);
+
+/* Database packages whose name or alias is closest to name, best first */
+UNIPM_API unipm_status unipm_suggest(unipm_db* db, const char* name, size_t max_results,
+                                     unipm_strings** out);
+
+UNIPM_API size_t unipm_strings_count(const unipm_strings* strings);
+UNIPM_API const char* unipm_strings_get(const unipm_strings* strings, size_t index);
+UNIPM_API void unipm_strings_free(unipm_strings* strings);
+
+/*
+ * Package managers and plans
+ */
+
+/* The package manager unipm would use on this host, detected once */
+UNIPM_API unipm_status unipm_default_pm(const char** pm);
+
+/*
+ * The commands pm runs for op on packages (native names, e.g. from
+ * unipm_resolve; search and info use the first one).
+ */
+UNIPM_API unipm_status unipm_plan_create(const char* pm, unipm_operation op,
+                                         const char* const* packages, size_t count,
+                                         unipm_plan** out);
+
+UNIPM_API size_t unipm_plan_step_count(const unipm_plan* plan);
+
+/* NULL-terminated argv of a step, before any sudo is added */
+UNIPM_API const char* const* unipm_plan_step_argv(const unipm_plan* plan, size_t step);
+
+/* Whether any step needs root; execution prepends sudo when not root */
+UNIPM_API int unipm_plan_requires_root(const unipm_plan* plan);
+
+/* Shell-equivalent form, e.g. "apt install -y docker.io" */
+UNIPM_API const char* unipm_plan_string(const unipm_plan* plan);
+
+/*
+ * Run the plan's steps, passing their combined stdout and stderr to
+ * on_output (may be NULL) on the calling thread. exit_code (may be NULL)
+ * receives the first failing step's exit code, else 0. Returns
+ * UNIPM_ERROR_EXECUTION when a step fails; a program that can't be started
+ * exits with 127 and is named in on_output and unipm_last_error(). Nothing
+ * is written to this process's stdout or stderr. Runs are recorded in
+ * unipm's history like those of the CLI.
+ */
+UNIPM_API unipm_status unipm_plan_execute(unipm_plan* plan, unipm_output_fn on_output,
+                                          void* userdata, int* exit_code);
+
+UNIPM_API void unipm_plan_free(unipm_plan* plan);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+# bash completion for unipm
+#
+# Install to /usr/share/bash-completion/completions/unipm, or source it
+# from ~/.bashrc. Candidates come from `unipm __complete`.
+
+_unipm() {
+    # Split the line on whitespace only, so "--pm=ap" stays one word
+    local line="${COMP_LINE:0:COMP_POINT}"
+    local -a words
+    read -ra words <<< "$line"
+    [[ $line == *[[:space:]] ]] && words+=("")
+    local cur="${words[${#words[@]}-1]}"
+
+    local IFS=$'\n'
+    COMPREPLY=($(unipm __complete "${words[@]:1}" 2>/dev/null))
+
+    # bash completes the text after '=' as a word of its own
+    if [[ $cur == *=* && $COMP_WORDBREAKS == *=* ]]; then
+        COMPREPLY=("${COMPREPLY[@]#*=}")
+    fi
+
+    # Flags that take a value: don't add a space after the '='
+    if [[ ${#COMPREPLY[@]} -eq 1 && ${COMPREPLY[0]} == *= ]]; then
+        compopt -o nospace 2>/dev/null
+    fi
+}
+
+complete -F _unipm unipm
@@ -0,0 +1,11 @@
+# fish completion for unipm
+#
+# Install to /usr/share/fish/vendor_completions.d/unipm.fish or
+# ~/.config/fish/completions/unipm.fish. Candidates come from `unipm __complete`.
+
+function __unipm_complete
+    set -l words (commandline -opc) (commandline -ct)
+    unipm __complete $words[2..-1] 2>/dev/null
+end
+
+complete -c unipm -f -a '(__unipm_complete)'
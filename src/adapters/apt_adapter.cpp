@@ -1,42 +1,154 @@
 #include "unipm/adapter.h"
-
-#include <sstream>
+#include "unipm/apt_index.h"
+#include "unipm/dpkg_status.h"
 
 namespace unipm {
 
 // APT Adapter Implementation
-std::string APTAdapter::getInstallCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "apt install -y";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
+APTAdapter::APTAdapter() = default;
+APTAdapter::~APTAdapter() = default;
+
+// APT uses separate locks for the package lists and the dpkg database
+CommandPlan APTAdapter::planInstall(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"apt", "install", "-y"}, "dpkg", true).withOperands(packages)};
+}
+
+CommandPlan APTAdapter::planRemove(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"apt", "remove", "-y"}, "dpkg", true).withOperands(packages)};
+}
+
+CommandPlan APTAdapter::planUpdate() {
+    return {CommandStep::mutation({"apt", "update"}, "apt-lists", true),
+            CommandStep::mutation({"apt", "upgrade", "-y"}, "dpkg", true)};
+}
+
+CommandPlan APTAdapter::planUpgrade() {
+    return {CommandStep::mutation({"apt", "upgrade", "-y"}, "dpkg", true)};
+}
+
+CommandPlan APTAdapter::planSearch(const std::string& query) {
+    return {CommandStep::query({"apt", "search", query})};
+}
+
+CommandPlan APTAdapter::planList() {
+    return {CommandStep::query({"apt", "list", "--installed"})};
+}
+
+CommandPlan APTAdapter::planInfo(const std::string& package) {
+    return {CommandStep::query({"apt", "show", package})};
+}
+
+// Each chunk downloads into its own archive directory: apt locks the archive
+// directory (not the dpkg database) for --download-only, so fetching one
+// chunk doesn't block installing another
+CommandPlan APTAdapter::planDownload(const std::vector<std::string>& packages,
+                                     const std::string& stagingDir) {
+    if (stagingDir.empty()) {
+        return {CommandStep::mutation({"apt", "install", "-y", "--download-only"}, "dpkg", true)
+                    .withOperands(packages)};
     }
-    return oss.str();
+    return {CommandStep::mutation({"apt", "install", "-y", "--download-only", "-o",
+                                   "Dir::Cache::Archives=" + stagingDir + "/"},
+                                  "apt-archives:" + stagingDir, true)
+                .withOperands(packages)};
 }
 
-std::string APTAdapter::getRemoveCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "apt remove -y";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
+CommandPlan APTAdapter::planInstallStaged(const std::vector<std::string>& packages,
+                                          const std::string& stagingDir) {
+    if (stagingDir.empty()) {
+        return planInstall(packages);
     }
-    return oss.str();
+    return {CommandStep::mutation(
+                {"apt", "install", "-y", "-o", "Dir::Cache::Archives=" + stagingDir + "/"}, "dpkg",
+                true)
+                .withOperands(packages)};
 }
 
-std::string APTAdapter::getUpdateCommand() {
-    return "apt update && apt upgrade -y";
+bool APTAdapter::readInstalled(std::vector<InstalledPackage>& packages) {
+    DpkgStatus status;
+    if (!status.load()) {
+        return false;
+    }
+    
+    status.loadExtendedStates();
+    packages = status.installedPackages();
+    return true;
 }
 
-std::string APTAdapter::getSearchCommand(const std::string& query) {
-    return "apt search " + query;
+bool APTAdapter::findInstalled(const std::string& name, InstalledPackage& package) {
+    DpkgStatus status;
+    if (!status.load()) {
+        return false;
+    }
+    
+    const DpkgEntry* entry = status.find(name);
+    if (!entry) {
+        return false;
+    }
+    
+    status.loadExtendedStates();
+    package = DpkgStatus::toInstalledPackage(*entry);
+    package.explicitlyInstalled = !status.isAutoInstalled(entry->name, entry->architecture);
+    return true;
+}
+
+std::vector<std::string> APTAdapter::getInstalledMetadataPaths() {
+    return {DpkgStatus::DEFAULT_PATH, DpkgStatus::EXTENDED_STATES_PATH};
+}
+
+// apt renames fresh lists into place; the periodic stamp covers unattended updates
+std::vector<std::string> APTAdapter::getRepositoryMetadataPaths() {
+    return {AptIndex::DEFAULT_LISTS_DIR, "/var/lib/apt/periodic/update-success-stamp"};
+}
+
+std::vector<std::string> APTAdapter::getLockPaths() {
+    return {"/var/lib/dpkg/lock-frontend", "/var/lib/dpkg/lock", "/var/lib/apt/lists/lock",
+            "/var/cache/apt/archives/lock"};
 }
 
-std::string APTAdapter::getListCommand() {
-    return "apt list --installed";
+const AptIndex* APTAdapter::index() {
+    if (!indexLoaded_) {
+        indexLoaded_ = true;
+        auto index = std::make_unique<AptIndex>();
+        if (index->load()) {
+            index_ = std::move(index);
+        }
+    }
+    return index_.get();
+}
+
+bool APTAdapter::searchAvailable(const std::string& query, std::vector<AvailablePackage>& results) {
+    const AptIndex* aptIndex = index();
+    if (!aptIndex) {
+        return false;
+    }
+    
+    results.clear();
+    for (const AptIndexEntry* entry : aptIndex->search(query)) {
+        AvailablePackage pkg;
+        pkg.name = std::string(entry->name);
+        pkg.version = std::string(entry->version);
+        pkg.section = std::string(entry->section);
+        pkg.description = std::string(entry->description);
+        pkg.size = entry->size;
+        pkg.packageManager = PackageManager::APT;
+        results.push_back(std::move(pkg));
+    }
+    return true;
+}
+
+Availability APTAdapter::checkAvailable(const std::string& name) {
+    const AptIndex* aptIndex = index();
+    if (!aptIndex) {
+        return Availability::UNKNOWN;
+    }
+    return aptIndex->isAvailable(name) ? Availability::AVAILABLE : Availability::MISSING;
 }
 
-std::string APTAdapter::getInfoCommand(const std::string& package) {
-    return "apt show " + package;
+bool APTAdapter::parseSearchOutput(const std::string& output,
+                                   std::vector<AvailablePackage>& results) {
+    parseRepoListing(output, PackageManager::APT, results);
+    return true;
 }
 
 } // namespace unipm
@@ -1,41 +1,118 @@
 #include "unipm/adapter.h"
 #include <sstream>
+#include "unipm/brew_cellar.h"
 
 namespace unipm {
 
 // Homebrew Adapter Implementation
-std::string BrewAdapter::getInstallCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "brew install";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
-    }
-    return oss.str();
+CommandPlan BrewAdapter::planInstall(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"brew", "install"}, "brew", false).withOperands(packages)};
+}
+
+CommandPlan BrewAdapter::planRemove(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"brew", "uninstall"}, "brew", false).withOperands(packages)};
+}
+
+CommandPlan BrewAdapter::planUpdate() {
+    // The upgrade runs right after an explicit update; skip brew's own auto-update
+    return {CommandStep::mutation({"brew", "update"}, "brew", false),
+            CommandStep::mutation({"brew", "upgrade"}, "brew", false)
+                .withEnv("HOMEBREW_NO_AUTO_UPDATE", "1")};
+}
+
+CommandPlan BrewAdapter::planUpgrade() {
+    return {CommandStep::mutation({"brew", "upgrade"}, "brew", false)
+                .withEnv("HOMEBREW_NO_AUTO_UPDATE", "1")};
+}
+
+// Bottles are fetched into brew's cache; install locks per formula
+CommandPlan BrewAdapter::planDownload(const std::vector<std::string>& packages,
+                                      const std::string& stagingDir) {
+    (void)stagingDir;
+    return {CommandStep::mutation({"brew", "fetch"}, "brew-download", false)
+                .withEnv("HOMEBREW_NO_AUTO_UPDATE", "1")
+                .withOperands(packages)};
+}
+
+CommandPlan BrewAdapter::planSearch(const std::string& query) {
+    return {CommandStep::query({"brew", "search", query})};
+}
+
+CommandPlan BrewAdapter::planList() {
+    return {CommandStep::query({"brew", "list"})};
+}
+
+CommandPlan BrewAdapter::planInfo(const std::string& package) {
+    return {CommandStep::query({"brew", "info", package})};
 }
 
-std::string BrewAdapter::getRemoveCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "brew uninstall";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
+const std::string& BrewAdapter::prefix() {
+    if (prefix_.empty()) {
+        prefix_ = BrewCellar::findPrefix();
     }
-    return oss.str();
+    return prefix_;
 }
 
-std::string BrewAdapter::getUpdateCommand() {
-    return "brew update && brew upgrade";
+bool BrewAdapter::readInstalled(std::vector<InstalledPackage>& packages) {
+    BrewCellar cellar;
+    if (prefix().empty() || !cellar.load(prefix())) {
+        return false;
+    }
+    
+    packages = cellar.packages();
+    return true;
 }
 
-std::string BrewAdapter::getSearchCommand(const std::string& query) {
-    return "brew search " + query;
+bool BrewAdapter::findInstalled(const std::string& name, InstalledPackage& package) {
+    BrewCellar cellar;
+    if (prefix().empty() || !cellar.loadPackage(prefix(), name)) {
+        return false;
+    }
+    
+    const InstalledPackage* pkg = cellar.find(name);
+    if (!pkg) {
+        return false;
+    }
+    
+    package = *pkg;
+    return true;
 }
 
-std::string BrewAdapter::getListCommand() {
-    return "brew list";
+std::vector<std::string> BrewAdapter::getInstalledMetadataPaths() {
+    if (prefix().empty()) {
+        return {};
+    }
+    // Upgrades add a keg inside Cellar/<formula>, but always relink opt/<formula>
+    return {prefix() + "/Cellar", prefix() + "/Caskroom", prefix() + "/opt"};
 }
 
-std::string BrewAdapter::getInfoCommand(const std::string& package) {
-    return "brew info " + package;
+bool BrewAdapter::parseSearchOutput(const std::string& output,
+                                    std::vector<AvailablePackage>& results) {
+    // One name per line when piped, under "==> Formulae" / "==> Casks" headings
+    std::istringstream lines(output);
+    std::string line;
+    std::string section = "formula";
+    while (std::getline(lines, line)) {
+        if (line.rfind("==> ", 0) == 0) {
+            section = line.find("Cask") != std::string::npos ? "cask" : "formula";
+            continue;
+        }
+        
+        // Names only; skip hints such as 'If you meant "x" precisely:'
+        std::istringstream words(line);
+        std::string name;
+        std::string extra;
+        if (!(words >> name) || ((words >> extra) && extra != "\u2714")) {
+            continue;
+        }
+        
+        AvailablePackage pkg;
+        pkg.name = name;
+        pkg.section = section;
+        pkg.packageManager = PackageManager::BREW;
+        results.push_back(std::move(pkg));
+    }
+    return true;
 }
 
 } // namespace unipm
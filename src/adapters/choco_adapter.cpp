@@ -1,41 +1,49 @@
 #include "unipm/adapter.h"
 #include <sstream>
+#include <cctype>
 
 namespace unipm {
 
 // Chocolatey Adapter Implementation
-std::string ChocolateyAdapter::getInstallCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "choco install -y";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
-    }
-    return oss.str();
+CommandPlan ChocolateyAdapter::planInstall(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"choco", "install", "-y"}, "choco", true).withOperands(packages)};
 }
 
-std::string ChocolateyAdapter::getRemoveCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "choco uninstall -y";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
-    }
-    return oss.str();
+CommandPlan ChocolateyAdapter::planRemove(const std::vector<std::string>& packages) {
+    return {
+        CommandStep::mutation({"choco", "uninstall", "-y"}, "choco", true).withOperands(packages)};
+}
+
+CommandPlan ChocolateyAdapter::planUpdate() {
+    return {CommandStep::mutation({"choco", "upgrade", "all", "-y"}, "choco", true)};
 }
 
-std::string ChocolateyAdapter::getUpdateCommand() {
-    return "choco upgrade all -y";
+CommandPlan ChocolateyAdapter::planSearch(const std::string& query) {
+    return {CommandStep::query({"choco", "search", query})};
 }
 
-std::string ChocolateyAdapter::getSearchCommand(const std::string& query) {
-    return "choco search " + query;
+CommandPlan ChocolateyAdapter::planList() {
+    return {CommandStep::query({"choco", "list", "--local-only"})};
 }
 
-std::string ChocolateyAdapter::getListCommand() {
-    return "choco list --local-only";
+CommandPlan ChocolateyAdapter::planInfo(const std::string& package) {
+    return {CommandStep::query({"choco", "info", package})};
 }
 
-std::string ChocolateyAdapter::getInfoCommand(const std::string& package) {
-    return "choco info " + package;
+// Default native lookup: scan the full installed set
+bool PackageManagerAdapter::findInstalled(const std::string& name, InstalledPackage& package) {
+    std::vector<InstalledPackage> installed;
+    if (!readInstalled(installed)) {
+        return false;
+    }
+    
+    for (auto& pkg : installed) {
+        if (pkg.name == name) {
+            package = std::move(pkg);
+            return true;
+        }
+    }
+    return false;
 }
 
 // Adapter Factory Implementation
@@ -58,4 +66,73 @@ std::unique_ptr<PackageManagerAdapter> AdapterFactory::create(PackageManager pm)
     }
 }
 
+std::unique_ptr<PackageManagerAdapter> AdapterFactory::create(const PMInfo& info) {
+    if (info.type == PackageManager::BREW) {
+        return std::make_unique<BrewAdapter>(info.prefix);
+    }
+    return create(info.type);
+}
+
+bool ChocolateyAdapter::parseSearchOutput(const std::string& output,
+                                          std::vector<AvailablePackage>& results) {
+    // "name version [Approved] ..." between the banner and the summary line
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string name;
+        std::string version;
+        if (!(words >> name >> version)) continue;
+        if (name == "Chocolatey" || version == "packages" || version == "package") continue;
+        if (version.empty() || !std::isdigit(static_cast<unsigned char>(version[0]))) continue;
+        
+        AvailablePackage pkg;
+        pkg.name = name;
+        pkg.version = version;
+        pkg.packageManager = PackageManager::CHOCOLATEY;
+        results.push_back(std::move(pkg));
+    }
+    return true;
+}
+
+void PackageManagerAdapter::parseRepoListing(const std::string& output, PackageManager pm,
+                                             std::vector<AvailablePackage>& results) {
+    std::istringstream lines(output);
+    std::string line;
+    AvailablePackage* last = nullptr;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        
+        if (line[0] == ' ' || line[0] == '\t') {
+            // Description of the preceding package
+            if (last && last->description.empty()) {
+                size_t start = line.find_first_not_of(" \t");
+                if (start != std::string::npos) last->description = line.substr(start);
+            }
+            continue;
+        }
+        
+        // "repo/name version ..." or "name/suite[,suite] version arch ..."
+        size_t space = line.find(' ');
+        size_t slash = line.find('/');
+        if (space == std::string::npos || slash == std::string::npos || slash > space) {
+            last = nullptr;
+            continue;
+        }
+        
+        AvailablePackage pkg;
+        std::string first = line.substr(0, space);
+        // pacman prints repo/name, apt prints name/suites
+        pkg.name = pm == PackageManager::PACMAN ? first.substr(slash + 1) : first.substr(0, slash);
+        pkg.section = pm == PackageManager::PACMAN ? first.substr(0, slash) : first.substr(slash + 1);
+        size_t versionEnd = line.find(' ', space + 1);
+        pkg.version = line.substr(space + 1, versionEnd == std::string::npos ? std::string::npos
+                                                                              : versionEnd - space - 1);
+        pkg.packageManager = pm;
+        results.push_back(std::move(pkg));
+        last = &results.back();
+    }
+}
+
 } // namespace unipm
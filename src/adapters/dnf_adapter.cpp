@@ -1,41 +1,136 @@
 #include "unipm/adapter.h"
+#include "unipm/trace.h"
 #include <sstream>
+#include <cstdio>
+#include <cstdlib>
 
 namespace unipm {
 
 // DNF Adapter Implementation
-std::string DNFAdapter::getInstallCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "dnf install -y";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
-    }
-    return oss.str();
+CommandPlan DNFAdapter::planInstall(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"dnf", "install", "-y"}, "rpm", true).withOperands(packages)};
 }
 
-std::string DNFAdapter::getRemoveCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "dnf remove -y";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
-    }
-    return oss.str();
+CommandPlan DNFAdapter::planRemove(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"dnf", "remove", "-y"}, "rpm", true).withOperands(packages)};
 }
 
-std::string DNFAdapter::getUpdateCommand() {
-    return "dnf upgrade -y";
+// unipm decides when metadata is stale (see MetadataFreshness), so a refresh
+// ignores dnf's own metadata_expire
+CommandPlan DNFAdapter::planUpdate() {
+    return {CommandStep::mutation({"dnf", "upgrade", "-y", "--refresh"}, "rpm", true)};
 }
 
-std::string DNFAdapter::getSearchCommand(const std::string& query) {
-    return "dnf search " + query;
+// Never treat the cached repository metadata as expired for this run
+CommandPlan DNFAdapter::planUpgrade() {
+    return {CommandStep::mutation({"dnf", "upgrade", "-y", "--setopt=metadata_expire=-1"}, "rpm",
+                                  true)};
 }
 
-std::string DNFAdapter::getListCommand() {
-    return "dnf list installed";
+// Downloads land in dnf's package cache, which the install then reuses.
+// dnf waits on its own cache lock rather than failing, so the two can overlap.
+CommandPlan DNFAdapter::planDownload(const std::vector<std::string>& packages,
+                                     const std::string& stagingDir) {
+    (void)stagingDir;
+    return {CommandStep::mutation({"dnf", "install", "-y", "--downloadonly"}, "rpm-download", true)
+                .withOperands(packages)};
 }
 
-std::string DNFAdapter::getInfoCommand(const std::string& package) {
-    return "dnf info " + package;
+CommandPlan DNFAdapter::planSearch(const std::string& query) {
+    return {CommandStep::query({"dnf", "search", query})};
+}
+
+CommandPlan DNFAdapter::planList() {
+    return {CommandStep::query({"dnf", "list", "installed"})};
+}
+
+CommandPlan DNFAdapter::planInfo(const std::string& package) {
+    return {CommandStep::query({"dnf", "info", package})};
+}
+
+bool DNFAdapter::readInstalled(std::vector<InstalledPackage>& packages) {
+#ifdef _WIN32
+    (void)packages;
+    return false;
+#else
+    // One batched rpm query is far cheaper than 'dnf list installed'
+    UNIPM_TRACE_SCOPE("rpm -qa", "process");
+    FILE* pipe = popen("rpm -qa --qf '%{NAME}\\t%{VERSION}-%{RELEASE}\\t%{ARCH}\\t%{SIZE}\\t%{SUMMARY}\\n' "
+                       "2>/dev/null", "r");
+    if (!pipe) {
+        return false;
+    }
+    
+    UNIPM_TRACE_PROCESS_STARTED();
+    packages.clear();
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        std::string line(buffer);
+        if (!line.empty() && line.back() == '\n') line.pop_back();
+        
+        std::vector<std::string> fields;
+        std::istringstream iss(line);
+        std::string field;
+        while (std::getline(iss, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 4 || fields[0].empty()) continue;
+        
+        InstalledPackage pkg;
+        pkg.name = fields[0];
+        pkg.version = fields[1];
+        pkg.architecture = fields[2];
+        pkg.installedSize = std::strtoull(fields[3].c_str(), nullptr, 10);
+        if (fields.size() > 4) pkg.description = fields[4];
+        pkg.packageManager = PackageManager::DNF;
+        packages.push_back(std::move(pkg));
+    }
+    
+    bool ok = pclose(pipe) == 0;
+    UNIPM_TRACE_PROCESS_EXITED();
+    return ok;
+#endif
+}
+
+std::vector<std::string> DNFAdapter::getInstalledMetadataPaths() {
+    // sqlite rpmdb on current releases, Berkeley DB on older ones
+    return {"/var/lib/rpm/rpmdb.sqlite", "/var/lib/rpm/Packages"};
+}
+
+std::vector<std::string> DNFAdapter::getLockPaths() {
+    return {"/var/lib/dnf/rpmdb_lock.pid", "/var/cache/dnf/metadata_lock.pid"};
+}
+
+bool DNFAdapter::parseSearchOutput(const std::string& output,
+                                   std::vector<AvailablePackage>& results) {
+    // "name.arch : summary" (dnf4) or " name.arch<TAB>summary" (dnf5),
+    // grouped under "=== ... Matched ===" banners
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '=') continue;
+        
+        size_t sep = line.find(" : ", start);
+        size_t descStart = sep == std::string::npos ? std::string::npos : sep + 3;
+        if (sep == std::string::npos) {
+            sep = line.find('\t', start);
+            descStart = sep == std::string::npos ? std::string::npos : sep + 1;
+        }
+        if (sep == std::string::npos) continue;
+        
+        std::string nameArch = line.substr(start, sep - start);
+        while (!nameArch.empty() && nameArch.back() == ' ') nameArch.pop_back();
+        size_t dot = nameArch.rfind('.');
+        if (dot == std::string::npos || nameArch.find(' ') != std::string::npos) continue;
+        
+        AvailablePackage pkg;
+        pkg.name = nameArch.substr(0, dot);
+        pkg.description = line.substr(descStart);
+        pkg.packageManager = PackageManager::DNF;
+        results.push_back(std::move(pkg));
+    }
+    return true;
 }
 
 } // namespace unipm
@@ -1,41 +1,91 @@
 #include "unipm/adapter.h"
-#include <sstream>
+#include "unipm/pacman_db.h"
 
 namespace unipm {
 
 // Pacman Adapter Implementation
-std::string PacmanAdapter::getInstallCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "pacman -S --noconfirm";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
+CommandPlan PacmanAdapter::planInstall(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"pacman", "-S", "--noconfirm"}, "pacman", true)
+                .withOperands(packages)};
+}
+
+CommandPlan PacmanAdapter::planRemove(const std::vector<std::string>& packages) {
+    return {CommandStep::mutation({"pacman", "-R", "--noconfirm"}, "pacman", true)
+                .withOperands(packages)};
+}
+
+CommandPlan PacmanAdapter::planUpdate() {
+    return {CommandStep::mutation({"pacman", "-Syu", "--noconfirm"}, "pacman", true)};
+}
+
+// -Su without -y: a full upgrade against the sync databases on disk
+CommandPlan PacmanAdapter::planUpgrade() {
+    return {CommandStep::mutation({"pacman", "-Su", "--noconfirm"}, "pacman", true)};
+}
+
+// pacman -Sw holds the same database lock as an install, so downloads never
+// overlap an install and InstallPipeline falls back to one pacman -S
+CommandPlan PacmanAdapter::planDownload(const std::vector<std::string>& packages,
+                                        const std::string& stagingDir) {
+    (void)stagingDir;
+    return {CommandStep::mutation({"pacman", "-Sw", "--noconfirm"}, "pacman", true)
+                .withOperands(packages)};
+}
+
+CommandPlan PacmanAdapter::planSearch(const std::string& query) {
+    return {CommandStep::query({"pacman", "-Ss", query})};
+}
+
+CommandPlan PacmanAdapter::planList() {
+    return {CommandStep::query({"pacman", "-Q"})};
+}
+
+CommandPlan PacmanAdapter::planInfo(const std::string& package) {
+    return {CommandStep::query({"pacman", "-Si", package})};
+}
+
+bool PacmanAdapter::readInstalled(std::vector<InstalledPackage>& packages) {
+    PacmanLocalDB db;
+    if (!db.load()) {
+        return false;
     }
-    return oss.str();
+    
+    packages = db.packages();
+    return true;
 }
 
-std::string PacmanAdapter::getRemoveCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "pacman -R --noconfirm";
-    for (const auto& pkg : packages) {
-        oss << " " << pkg;
+bool PacmanAdapter::findInstalled(const std::string& name, InstalledPackage& package) {
+    PacmanLocalDB db;
+    if (!db.loadPackage(name)) {
+        return false;
+    }
+    
+    const InstalledPackage* pkg = db.find(name);
+    if (!pkg) {
+        return false;
     }
-    return oss.str();
+    
+    package = *pkg;
+    return true;
 }
 
-std::string PacmanAdapter::getUpdateCommand() {
-    return "pacman -Syu --noconfirm";
+std::vector<std::string> PacmanAdapter::getInstalledMetadataPaths() {
+    // Installs, upgrades and removals all add or remove package directories
+    return {PacmanLocalDB::DEFAULT_PATH};
 }
 
-std::string PacmanAdapter::getSearchCommand(const std::string& query) {
-    return "pacman -Ss " + query;
+std::vector<std::string> PacmanAdapter::getRepositoryMetadataPaths() {
+    return {"/var/lib/pacman/sync"};
 }
 
-std::string PacmanAdapter::getListCommand() {
-    return "pacman -Q";
+std::vector<std::string> PacmanAdapter::getLockPaths() {
+    return {"/var/lib/pacman/db.lck"};
 }
 
-std::string PacmanAdapter::getInfoCommand(const std::string& package) {
-    return "pacman -Si " + package;
+bool PacmanAdapter::parseSearchOutput(const std::string& output,
+                                      std::vector<AvailablePackage>& results) {
+    parseRepoListing(output, PackageManager::PACMAN, results);
+    return true;
 }
 
 } // namespace unipm
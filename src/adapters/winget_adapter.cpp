@@ -4,38 +4,97 @@
 namespace unipm {
 
 // Winget Adapter Implementation
-std::string WingetAdapter::getInstallCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "winget install";
+CommandPlan WingetAdapter::planInstall(const std::vector<std::string>& packages) {
+    // winget takes one package per invocation
+    CommandPlan plan;
     for (const auto& pkg : packages) {
-        oss << " --id " << pkg << " --silent --accept-package-agreements --accept-source-agreements";
+        plan.steps.push_back(CommandStep::mutation(
+            {"winget", "install", "--id", pkg, "--silent", "--accept-package-agreements",
+             "--accept-source-agreements"},
+            "winget", false));
     }
-    return oss.str();
+    return plan;
 }
 
-std::string WingetAdapter::getRemoveCommand(const std::vector<std::string>& packages) {
-    std::ostringstream oss;
-    oss << "winget uninstall";
+CommandPlan WingetAdapter::planRemove(const std::vector<std::string>& packages) {
+    CommandPlan plan;
     for (const auto& pkg : packages) {
-        oss << " --id " << pkg << " --silent";
+        plan.steps.push_back(
+            CommandStep::mutation({"winget", "uninstall", "--id", pkg, "--silent"}, "winget", false));
     }
-    return oss.str();
+    return plan;
 }
 
-std::string WingetAdapter::getUpdateCommand() {
-    return "winget upgrade --all --silent --accept-package-agreements --accept-source-agreements";
+CommandPlan WingetAdapter::planUpdate() {
+    return {CommandStep::mutation({"winget", "upgrade", "--all", "--silent",
+                                   "--accept-package-agreements", "--accept-source-agreements"},
+                                  "winget", false)};
 }
 
-std::string WingetAdapter::getSearchCommand(const std::string& query) {
-    return "winget search " + query;
+CommandPlan WingetAdapter::planSearch(const std::string& query) {
+    return {CommandStep::query({"winget", "search", query})};
 }
 
-std::string WingetAdapter::getListCommand() {
-    return "winget list";
+CommandPlan WingetAdapter::planList() {
+    return {CommandStep::query({"winget", "list"})};
 }
 
-std::string WingetAdapter::getInfoCommand(const std::string& package) {
-    return "winget show --id " + package;
+CommandPlan WingetAdapter::planInfo(const std::string& package) {
+    return {CommandStep::query({"winget", "show", "--id", package})};
+}
+
+bool WingetAdapter::parseSearchOutput(const std::string& output,
+                                      std::vector<AvailablePackage>& results) {
+    // Fixed-width table; column offsets come from the header row
+    std::istringstream lines(output);
+    std::string line;
+    size_t idCol = std::string::npos;
+    size_t versionCol = std::string::npos;
+    size_t afterVersionCol = std::string::npos;
+    bool inTable = false;
+    
+    auto trim = [](std::string value) {
+        size_t end = value.find_last_not_of(" \r");
+        return end == std::string::npos ? std::string() : value.substr(0, end + 1);
+    };
+    
+    while (std::getline(lines, line)) {
+        // Progress spinners are overwritten with carriage returns
+        size_t cr = line.rfind('\r', line.size() > 1 ? line.size() - 2 : 0);
+        if (cr != std::string::npos && cr + 1 < line.size()) line = line.substr(cr + 1);
+        
+        if (idCol == std::string::npos) {
+            size_t name = line.find("Name");
+            size_t id = line.find(" Id ");
+            size_t version = line.find(" Version");
+            if (name != std::string::npos && id != std::string::npos && version != std::string::npos) {
+                idCol = id + 1 - name;
+                versionCol = version + 1 - name;
+                size_t next = line.find_first_not_of(' ', version + 8);
+                afterVersionCol = next == std::string::npos ? std::string::npos : next - name;
+            }
+            continue;
+        }
+        
+        if (!inTable) {
+            inTable = line.find("---") != std::string::npos;
+            continue;
+        }
+        if (line.size() <= versionCol) continue;
+        
+        std::string idField = trim(line.substr(idCol, versionCol - idCol));
+        if (idField.empty() || idField.find(' ') != std::string::npos) continue;
+        
+        AvailablePackage pkg;
+        pkg.name = idField;
+        pkg.description = trim(line.substr(0, idCol));
+        pkg.version = trim(line.substr(versionCol, afterVersionCol == std::string::npos
+                                                       ? std::string::npos
+                                                       : afterVersionCol - versionCol));
+        pkg.packageManager = PackageManager::WINGET;
+        results.push_back(std::move(pkg));
+    }
+    return idCol != std::string::npos;
 }
 
 } // namespace unipm
@@ -0,0 +1,359 @@
+#include "unipm/apt_index.h"
+#include "unipm/blob_io.h"
+#include "unipm/deb822.h"
+#include "unipm/metrics.h"
+#include "unipm/parallel.h"
+#include "unipm/trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+namespace unipm {
+
+namespace {
+
+constexpr char MAGIC[8] = {'U', 'P', 'M', 'A', 'I', 'D', 'X', '1'};
+
+int versionOrder(int c) {
+    if (std::isdigit(c)) return 0;
+    if (std::isalpha(c)) return c;
+    if (c == '~') return -1;
+    if (c) return c + 256;
+    return 0;
+}
+
+// dpkg's verrevcmp over one version component
+int compareFragment(std::string_view a, std::string_view b) {
+    size_t i = 0, j = 0;
+    auto at = [](std::string_view s, size_t k) -> int {
+        return k < s.size() ? static_cast<unsigned char>(s[k]) : 0;
+    };
+
+    while (i < a.size() || j < b.size()) {
+        int firstDiff = 0;
+        while ((i < a.size() && !std::isdigit(at(a, i))) ||
+               (j < b.size() && !std::isdigit(at(b, j)))) {
+            int ac = versionOrder(at(a, i));
+            int bc = versionOrder(at(b, j));
+            if (ac != bc) return ac - bc;
+            ++i;
+            ++j;
+        }
+        while (at(a, i) == '0') ++i;
+        while (at(b, j) == '0') ++j;
+        while (std::isdigit(at(a, i)) && std::isdigit(at(b, j))) {
+            if (!firstDiff) firstDiff = at(a, i) - at(b, j);
+            ++i;
+            ++j;
+        }
+        if (std::isdigit(at(a, i))) return 1;
+        if (std::isdigit(at(b, j))) return -1;
+        if (firstDiff) return firstDiff;
+    }
+    return 0;
+}
+
+void splitVersion(std::string_view v, long& epoch, std::string_view& upstream,
+                  std::string_view& revision) {
+    epoch = 0;
+    size_t colon = v.find(':');
+    if (colon != std::string_view::npos) {
+        epoch = std::strtol(std::string(v.substr(0, colon)).c_str(), nullptr, 10);
+        v = v.substr(colon + 1);
+    }
+    size_t dash = v.rfind('-');
+    if (dash != std::string_view::npos) {
+        upstream = v.substr(0, dash);
+        revision = v.substr(dash + 1);
+    } else {
+        upstream = v;
+        revision = {};
+    }
+}
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    if (needle.empty()) return true;
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                          [](char a, char b) {
+                              return std::tolower(static_cast<unsigned char>(a)) == b;
+                          });
+    return it != haystack.end();
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view lowerB) {
+    return a.size() == lowerB.size() && containsIgnoreCase(a, lowerB);
+}
+
+} // namespace
+
+int AptIndex::compareVersions(std::string_view a, std::string_view b) {
+    long epochA, epochB;
+    std::string_view upA, upB, revA, revB;
+    splitVersion(a, epochA, upA, revA);
+    splitVersion(b, epochB, upB, revB);
+
+    if (epochA != epochB) return epochA < epochB ? -1 : 1;
+    int rc = compareFragment(upA, upB);
+    if (rc != 0) return rc;
+    return compareFragment(revA, revB);
+}
+
+std::vector<AptIndex::Source> AptIndex::listSources(const std::string& listsDir) {
+    std::vector<Source> sources;
+#ifndef _WIN32
+    DIR* dir = opendir(listsDir.c_str());
+    if (!dir) {
+        return sources;
+    }
+
+    const std::string suffix = "_Packages";
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        // Compressed lists (Acquire::GzipIndexes) aren't supported; apt falls back
+        if (name.size() <= suffix.size() ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        Source source;
+        source.path = listsDir + "/" + name;
+        source.stamp = Cache::stat(source.path);
+        if (source.stamp.exists) {
+            sources.push_back(std::move(source));
+        }
+    }
+    closedir(dir);
+
+    // Stable order so the cache key doesn't depend on readdir order
+    std::sort(sources.begin(), sources.end(),
+              [](const Source& a, const Source& b) { return a.path < b.path; });
+#else
+    (void)listsDir;
+#endif
+    return sources;
+}
+
+bool AptIndex::loadCache(const std::string& cachePath) {
+    entries_.clear();
+    blob_.clear();
+    cacheFile_.close();
+    fromCache_ = false;
+
+    if (!cacheFile_.open(cachePath) || !parseBlob(cacheFile_.view(), nullptr)) {
+        cacheFile_.close();
+        entries_.clear();
+        return false;
+    }
+    fromCache_ = true;
+    return true;
+}
+
+bool AptIndex::load(const std::string& listsDir, const std::string& cachePath) {
+    UNIPM_TRACE_SCOPE("AptIndex::load", "index");
+    entries_.clear();
+    blob_.clear();
+    cacheFile_.close();
+    fromCache_ = false;
+
+    std::vector<Source> sources = listSources(listsDir);
+    if (sources.empty()) {
+        return false;
+    }
+
+    if (!cachePath.empty() && cacheFile_.open(cachePath)) {
+        if (parseBlob(cacheFile_.view(), &sources)) {
+            fromCache_ = true;
+            Metrics::cacheLookup("apt_index", true);
+            return true;
+        }
+        cacheFile_.close();
+        entries_.clear();
+    }
+    if (!cachePath.empty()) {
+        Metrics::cacheLookup("apt_index", false);
+    }
+
+    if (!build(sources)) {
+        return false;
+    }
+
+    if (!cachePath.empty()) {
+        size_t slash = cachePath.find_last_of("/\\");
+        if (slash != std::string::npos) {
+            Cache::createDirectories(cachePath.substr(0, slash));
+        }
+        // A failed cache write only costs a rebuild next time
+        Cache::writeAtomic(cachePath, blob_);
+    }
+    return true;
+}
+
+bool AptIndex::build(const std::vector<Source>& sources) {
+    // Parse every list in place; entries point into the mapped files
+    std::vector<MappedFile> files(sources.size());
+    std::vector<std::vector<AptIndexEntry>> perFile(sources.size());
+
+    parallelFor(sources.size(), [&](size_t i) {
+        if (!files[i].open(sources[i].path)) {
+            return;
+        }
+        AptIndexEntry current;
+        deb822::parse(
+            files[i].view(),
+            [&](std::string_view key, std::string_view value) {
+                if (key == "Package") current.name = value;
+                else if (key == "Version") current.version = value;
+                else if (key == "Section") current.section = value;
+                else if (key == "Description") current.description = value;
+                else if (key == "Size")
+                    current.size = std::strtoull(std::string(value).c_str(), nullptr, 10);
+            },
+            [&]() {
+                if (!current.name.empty()) {
+                    perFile[i].push_back(current);
+                }
+                current = AptIndexEntry();
+            });
+    });
+
+    std::vector<AptIndexEntry> merged;
+    for (auto& entries : perFile) {
+        merged.insert(merged.end(), entries.begin(), entries.end());
+    }
+
+    // Group by name with the highest version first, then keep one per name
+    std::sort(merged.begin(), merged.end(), [](const AptIndexEntry& a, const AptIndexEntry& b) {
+        if (a.name != b.name) return a.name < b.name;
+        return compareVersions(a.version, b.version) > 0;
+    });
+    merged.erase(std::unique(merged.begin(), merged.end(),
+                             [](const AptIndexEntry& a, const AptIndexEntry& b) {
+                                 return a.name == b.name;
+                             }),
+                 merged.end());
+
+    blob_.clear();
+    blob_.append(MAGIC, sizeof(MAGIC));
+    put<uint32_t>(blob_, static_cast<uint32_t>(sources.size()));
+    put<uint32_t>(blob_, static_cast<uint32_t>(merged.size()));
+    for (const auto& source : sources) {
+        put<uint64_t>(blob_, source.stamp.size);
+        put<int64_t>(blob_, source.stamp.mtimeNs);
+        put<uint32_t>(blob_, static_cast<uint32_t>(source.path.size()));
+        blob_ += source.path;
+    }
+    for (const auto& entry : merged) {
+        put<uint64_t>(blob_, entry.size);
+        putString16(blob_, entry.name);
+        putString16(blob_, entry.version);
+        putString16(blob_, entry.section);
+        putString16(blob_, entry.description);
+    }
+
+    // Re-point entries at the owned blob before the list mappings go away
+    return parseBlob(blob_, nullptr);
+}
+
+bool AptIndex::parseBlob(std::string_view blob, const std::vector<Source>* expected) {
+    BlobReader reader(blob);
+
+    std::string_view magic;
+    uint32_t sourceCount = 0, entryCount = 0;
+    if (!reader.bytes(sizeof(MAGIC), magic) || magic != std::string_view(MAGIC, sizeof(MAGIC)) ||
+        !reader.get(sourceCount) || !reader.get(entryCount)) {
+        return false;
+    }
+
+    if (expected && sourceCount != expected->size()) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < sourceCount; ++i) {
+        uint64_t size;
+        int64_t mtimeNs;
+        uint32_t pathLen;
+        std::string_view path;
+        if (!reader.get(size) || !reader.get(mtimeNs) || !reader.get(pathLen) ||
+            !reader.bytes(pathLen, path)) {
+            return false;
+        }
+        if (expected) {
+            const Source& source = (*expected)[i];
+            if (path != source.path || size != source.stamp.size ||
+                mtimeNs != source.stamp.mtimeNs) {
+                return false;  // Lists changed since the cache was written
+            }
+        }
+    }
+
+    entries_.clear();
+    entries_.reserve(entryCount);
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        AptIndexEntry entry;
+        if (!reader.get(entry.size) || !reader.string16(entry.name) ||
+            !reader.string16(entry.version) || !reader.string16(entry.section) ||
+            !reader.string16(entry.description)) {
+            entries_.clear();
+            return false;
+        }
+        entries_.push_back(entry);
+    }
+    return true;
+}
+
+const AptIndexEntry* AptIndex::find(std::string_view name) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+                               [](const AptIndexEntry& e, std::string_view n) { return e.name < n; });
+    if (it != entries_.end() && it->name == name) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+std::string AptIndex::candidateVersion(std::string_view name) const {
+    const AptIndexEntry* entry = find(name);
+    return entry ? std::string(entry->version) : std::string();
+}
+
+std::vector<const AptIndexEntry*> AptIndex::search(const std::string& query,
+                                                   size_t maxResults) const {
+    std::string needle = query;
+    std::transform(needle.begin(), needle.end(), needle.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    // rank: 0 exact name, 1 name prefix, 2 name substring, 3 description
+    std::vector<std::pair<int, const AptIndexEntry*>> matches;
+    for (const auto& entry : entries_) {
+        int rank;
+        if (equalsIgnoreCase(entry.name, needle)) {
+            rank = 0;
+        } else if (entry.name.size() > needle.size() &&
+                   equalsIgnoreCase(entry.name.substr(0, needle.size()), needle)) {
+            rank = 1;
+        } else if (containsIgnoreCase(entry.name, needle)) {
+            rank = 2;
+        } else if (containsIgnoreCase(entry.description, needle)) {
+            rank = 3;
+        } else {
+            continue;
+        }
+        matches.emplace_back(rank, &entry);
+    }
+
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<const AptIndexEntry*> results;
+    size_t count = maxResults ? std::min(maxResults, matches.size()) : matches.size();
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        results.push_back(matches[i].second);
+    }
+    return results;
+}
+
+} // namespace unipm
@@ -0,0 +1,241 @@
+#include "unipm/brew_cellar.h"
+#include "unipm/parallel.h"
+#include "unipm/trace.h"
+#include <json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace unipm {
+
+namespace {
+
+// Natural order so "1.10" sorts after "1.9"
+bool versionLess(const std::string& a, const std::string& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (std::isdigit(static_cast<unsigned char>(a[i])) &&
+            std::isdigit(static_cast<unsigned char>(b[j]))) {
+            size_t iEnd = i, jEnd = j;
+            while (iEnd < a.size() && std::isdigit(static_cast<unsigned char>(a[iEnd]))) ++iEnd;
+            while (jEnd < b.size() && std::isdigit(static_cast<unsigned char>(b[jEnd]))) ++jEnd;
+            unsigned long long x = std::strtoull(a.substr(i, iEnd - i).c_str(), nullptr, 10);
+            unsigned long long y = std::strtoull(b.substr(j, jEnd - j).c_str(), nullptr, 10);
+            if (x != y) return x < y;
+            i = iEnd;
+            j = jEnd;
+        } else {
+            if (a[i] != b[j]) return a[i] < b[j];
+            ++i;
+            ++j;
+        }
+    }
+    return a.size() - i < b.size() - j;
+}
+
+#ifndef _WIN32
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Subdirectory names of path, skipping dotfiles (e.g. Caskroom/x/.metadata)
+std::vector<std::string> listSubdirs(const std::string& path) {
+    std::vector<std::string> names;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return names;
+    }
+
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) continue;
+        if (entry->d_type == DT_UNKNOWN && !isDirectory(path + "/" + entry->d_name)) continue;
+#else
+        if (!isDirectory(path + "/" + entry->d_name)) continue;
+#endif
+        names.emplace_back(entry->d_name);
+    }
+
+    closedir(dir);
+    return names;
+}
+
+// Version currently linked into <prefix>/opt, if any
+std::string linkedVersion(const std::string& prefix, const std::string& formula) {
+    char target[1024];
+    std::string optPath = prefix + "/opt/" + formula;
+    ssize_t len = readlink(optPath.c_str(), target, sizeof(target) - 1);
+    if (len <= 0) {
+        return "";
+    }
+    target[len] = '\0';
+
+    // "../Cellar/<formula>/<version>"
+    std::string link(target);
+    size_t slash = link.find_last_of('/');
+    return slash == std::string::npos ? link : link.substr(slash + 1);
+}
+
+bool readFormula(const std::string& prefix, const std::string& formula, InstalledPackage& pkg) {
+    std::string formulaDir = prefix + "/Cellar/" + formula;
+    std::vector<std::string> versions = listSubdirs(formulaDir);
+    if (versions.empty()) {
+        return false;
+    }
+
+    std::string version = linkedVersion(prefix, formula);
+    if (version.empty() || std::find(versions.begin(), versions.end(), version) == versions.end()) {
+        // Not linked: report the newest keg
+        version = *std::max_element(versions.begin(), versions.end(), versionLess);
+    }
+
+    pkg.name = formula;
+    pkg.version = version;
+    pkg.packageManager = PackageManager::BREW;
+
+    std::ifstream receipt(formulaDir + "/" + version + "/INSTALL_RECEIPT.json");
+    if (receipt.is_open()) {
+        json data = json::parse(receipt, nullptr, false);
+        if (!data.is_discarded() && data.contains("installed_on_request") &&
+            data["installed_on_request"].is_boolean()) {
+            pkg.explicitlyInstalled = data["installed_on_request"].get<bool>();
+        }
+    }
+    return true;
+}
+
+bool readCask(const std::string& prefix, const std::string& cask, InstalledPackage& pkg) {
+    std::vector<std::string> versions = listSubdirs(prefix + "/Caskroom/" + cask);
+    if (versions.empty()) {
+        return false;
+    }
+
+    pkg.name = cask;
+    pkg.version = *std::max_element(versions.begin(), versions.end(), versionLess);
+    pkg.description = "cask";
+    pkg.packageManager = PackageManager::BREW;
+    return true;
+}
+#endif
+
+} // namespace
+
+bool BrewCellar::load(const std::string& prefix) {
+    UNIPM_TRACE_SCOPE("BrewCellar::load", "index");
+    packages_.clear();
+    index_.clear();
+
+#ifdef _WIN32
+    (void)prefix;
+    return false;
+#else
+    std::string cellar = prefix + "/Cellar";
+    if (!isDirectory(cellar)) {
+        return false;
+    }
+
+    std::vector<std::string> formulae = listSubdirs(cellar);
+    std::vector<std::string> casks = listSubdirs(prefix + "/Caskroom");
+
+    // Formulae first, then casks; each reads its own small directory
+    std::vector<InstalledPackage> results(formulae.size() + casks.size());
+    std::vector<char> valid(results.size(), 0);
+
+    parallelFor(results.size(), [&](size_t i) {
+        bool ok = i < formulae.size()
+                      ? readFormula(prefix, formulae[i], results[i])
+                      : readCask(prefix, casks[i - formulae.size()], results[i]);
+        valid[i] = ok ? 1 : 0;
+    });
+
+    packages_.reserve(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (valid[i]) {
+            add(std::move(results[i]));
+        }
+    }
+    return true;
+#endif
+}
+
+bool BrewCellar::loadPackage(const std::string& prefix, const std::string& name) {
+    packages_.clear();
+    index_.clear();
+
+#ifdef _WIN32
+    (void)prefix;
+    (void)name;
+    return false;
+#else
+    if (!isDirectory(prefix + "/Cellar")) {
+        return false;
+    }
+
+    // Formula names may be tap-qualified ("user/tap/name")
+    std::string base = name.substr(name.find_last_of('/') + 1);
+
+    InstalledPackage pkg;
+    if (readFormula(prefix, base, pkg) || readCask(prefix, base, pkg)) {
+        add(std::move(pkg));
+    }
+    return true;
+#endif
+}
+
+void BrewCellar::add(InstalledPackage pkg) {
+    index_.emplace(pkg.name, packages_.size());
+    packages_.push_back(std::move(pkg));
+}
+
+const InstalledPackage* BrewCellar::find(const std::string& name) const {
+    auto it = index_.find(name.substr(name.find_last_of('/') + 1));
+    return it != index_.end() ? &packages_[it->second] : nullptr;
+}
+
+std::string BrewCellar::prefixFromBinary(const std::string& brewPath) {
+    // <prefix>/bin/brew -> <prefix>
+    size_t binSlash = brewPath.find_last_of("/\\");
+    if (binSlash == std::string::npos) {
+        return "";
+    }
+    size_t prefixSlash = brewPath.find_last_of("/\\", binSlash == 0 ? 0 : binSlash - 1);
+    if (prefixSlash == std::string::npos || brewPath.compare(prefixSlash, 5, "/bin/") != 0) {
+        return "";
+    }
+    return brewPath.substr(0, prefixSlash);
+}
+
+std::string BrewCellar::findPrefix() {
+    const char* env = std::getenv("HOMEBREW_PREFIX");
+    if (env && *env) {
+        return env;
+    }
+
+#ifndef _WIN32
+    const char* candidates[] = {"/opt/homebrew", "/usr/local", "/home/linuxbrew/.linuxbrew"};
+    for (const char* candidate : candidates) {
+        if (isDirectory(std::string(candidate) + "/Cellar")) {
+            return candidate;
+        }
+    }
+
+    const char* home = std::getenv("HOME");
+    if (home && isDirectory(std::string(home) + "/.linuxbrew/Cellar")) {
+        return std::string(home) + "/.linuxbrew";
+    }
+#endif
+    return "";
+}
+
+} // namespace unipm
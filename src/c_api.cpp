@@ -0,0 +1,426 @@
+#include "unipm/unipm.h"
+
+#include "unipm/adapter.h"
+#include "unipm/cache.h"
+#include "unipm/config.h"
+#include "unipm/executor.h"
+#include "unipm/history.h"
+#include "unipm/os_detector.h"
+#include "unipm/parallel.h"
+#include "unipm/pm_detector.h"
+#include "unipm/resolver.h"
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace unipm;
+
+struct unipm_db {
+    std::mutex loadMutex;  // Reloads take turns; lookups never wait on it
+    Config config;
+};
+
+struct unipm_resolutions {
+    std::vector<ResolvedPackage> packages;
+    std::vector<std::vector<const char*>> suggestions;
+    std::vector<unipm_resolution> views;
+};
+
+struct unipm_strings {
+    std::vector<std::string> values;
+};
+
+struct unipm_plan {
+    PackageManager pm = PackageManager::UNKNOWN;
+    unipm_operation op = UNIPM_OP_INSTALL;
+    std::vector<std::string> packages;
+    CommandPlan plan;
+    std::string text;
+    std::vector<std::vector<const char*>> argv;
+};
+
+namespace {
+
+// Below this many names a batch isn't worth starting threads for
+constexpr size_t PARALLEL_BATCH = 64;
+
+thread_local std::string lastError;
+
+unipm_status fail(unipm_status status, std::string message) {
+    lastError = std::move(message);
+    return status;
+}
+
+unipm_status succeed() {
+    lastError.clear();
+    return UNIPM_OK;
+}
+
+// Exceptions must not cross the C boundary
+template <typename Fn>
+unipm_status guarded(Fn&& fn) {
+    try {
+        return fn();
+    } catch (const std::bad_alloc&) {
+        return fail(UNIPM_ERROR_INTERNAL, "Out of memory");
+    } catch (const std::exception& e) {
+        return fail(UNIPM_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(UNIPM_ERROR_INTERNAL, "Unknown error");
+    }
+}
+
+unipm_status load(Config& config, const std::string& path) {
+    if (path.empty()) {
+        return fail(UNIPM_ERROR_NOT_FOUND, "No package database found");
+    }
+    if (!Cache::stat(path).exists) {
+        return fail(UNIPM_ERROR_NOT_FOUND, "No package database at " + path);
+    }
+    if (!config.load(path)) {
+        return fail(UNIPM_ERROR_PARSE, "Cannot parse package database " + path);
+    }
+    return succeed();
+}
+
+unipm_status parsePM(const char* name, PackageManager& pm) {
+    if (!name) {
+        return fail(UNIPM_ERROR_INVALID_ARGUMENT, "No package manager given");
+    }
+    pm = stringToPackageManager(name);
+    if (pm == PackageManager::UNKNOWN) {
+        return fail(UNIPM_ERROR_UNSUPPORTED, std::string("Unknown package manager: ") + name);
+    }
+    return UNIPM_OK;
+}
+
+ResolvedPackage resolveOne(Resolver& resolver, const PackageDatabase& database,
+                           const std::string& name, const std::string& version,
+                           PackageManager pm, unsigned flags) {
+    if ((flags & UNIPM_RESOLVE_EXACT) && !database.hasPackage(name)) {
+        // What the resolver reports when nothing matches
+        ResolvedPackage result;
+        result.originalName = name;
+        result.resolvedName = name;
+        result.version = version;
+        result.packageManager = pm;
+        result.confidence = 0.0f;
+        return result;
+    }
+    return resolver.resolve(name, pm, version);
+}
+
+// Point the C views at the resolved strings, once nothing moves anymore
+void publishViews(unipm_resolutions& out) {
+    out.suggestions.resize(out.packages.size());
+    out.views.resize(out.packages.size());
+    for (size_t i = 0; i < out.packages.size(); ++i) {
+        const ResolvedPackage& package = out.packages[i];
+        for (const auto& suggestion : package.suggestions) {
+            out.suggestions[i].push_back(suggestion.c_str());
+        }
+        unipm_resolution& view = out.views[i];
+        view.original_name = package.originalName.c_str();
+        view.resolved_name = package.resolvedName.c_str();
+        view.version = package.version.c_str();
+        view.confidence = package.confidence;
+        view.suggestions = out.suggestions[i].data();
+        view.suggestion_count = out.suggestions[i].size();
+    }
+}
+
+unipm_status resolveAll(unipm_db* db, const char* pmName, const char* const* names, size_t count,
+                        const char* version, unsigned flags, unipm_resolutions** out) {
+    if (!db || !out || (count > 0 && !names)) {
+        return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!names[i]) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Null package name");
+        }
+    }
+    PackageManager pm;
+    if (unipm_status status = parsePM(pmName, pm)) {
+        return status;
+    }
+
+    // Pin one version for the whole call
+    std::shared_ptr<const PackageDatabase> database = db->config.snapshot();
+    Resolver resolver(std::make_shared<DatabaseHandle>(database));
+
+    auto result = std::make_unique<unipm_resolutions>();
+    result->packages.resize(count);
+    const size_t threads = count < PARALLEL_BATCH ? 1 : std::thread::hardware_concurrency();
+    parallelFor(
+        count,
+        [&](size_t i) {
+            result->packages[i] =
+                resolveOne(resolver, *database, names[i], version ? version : "", pm, flags);
+        },
+        threads);
+    publishViews(*result);
+    *out = result.release();
+    return succeed();
+}
+
+} // namespace
+
+extern "C" {
+
+int unipm_api_version(void) {
+    return UNIPM_API_VERSION;
+}
+
+const char* unipm_last_error(void) {
+    return lastError.c_str();
+}
+
+unipm_status unipm_db_open(const char* path, unipm_db** db) {
+    return guarded([&] {
+        if (!db) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        auto handle = std::make_unique<unipm_db>();
+        std::string file = path && *path ? path : handle->config.findDatabase();
+        if (unipm_status status = load(handle->config, file)) {
+            return status;
+        }
+        *db = handle.release();
+        return succeed();
+    });
+}
+
+unipm_status unipm_db_reload(unipm_db* db, const char* path) {
+    return guarded([&] {
+        if (!db) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        std::lock_guard<std::mutex> lock(db->loadMutex);
+        return load(db->config, path && *path ? std::string(path) : db->config.path());
+    });
+}
+
+const char* unipm_db_path(const unipm_db* db) {
+    // The handle keeps the current version alive until the next reload
+    return db ? db->config.handle()->current()->path().c_str() : "";
+}
+
+size_t unipm_db_package_count(const unipm_db* db) {
+    size_t count = 0;
+    guarded([&] {
+        if (db) {
+            count = db->config.snapshot()->size();
+        }
+        return UNIPM_OK;
+    });
+    return count;
+}
+
+void unipm_db_close(unipm_db* db) {
+    delete db;
+}
+
+unipm_status unipm_resolve(unipm_db* db, const char* pm, const char* name, const char* version,
+                           unsigned flags, unipm_resolutions** out) {
+    return guarded([&] {
+        if (!name) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        return resolveAll(db, pm, &name, 1, version, flags, out);
+    });
+}
+
+unipm_status unipm_resolve_batch(unipm_db* db, const char* pm, const char* const* names,
+                                 size_t count, unsigned flags, unipm_resolutions** out) {
+    return guarded([&] { return resolveAll(db, pm, names, count, nullptr, flags, out); });
+}
+
+size_t unipm_resolutions_count(const unipm_resolutions* resolutions) {
+    return resolutions ? resolutions->views.size() : 0;
+}
+
+const unipm_resolution* unipm_resolutions_get(const unipm_resolutions* resolutions,
+                                              size_t index) {
+    if (!resolutions || index >= resolutions->views.size()) {
+        return nullptr;
+    }
+    return &resolutions->views[index];
+}
+
+void unipm_resolutions_free(unipm_resolutions* resolutions) {
+    delete resolutions;
+}
+
+unipm_status unipm_suggest(unipm_db* db, const char* name, size_t max_results,
+                           unipm_strings** out) {
+    return guarded([&] {
+        if (!db || !name || !out) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        Resolver resolver(db->config.handle());
+        auto result = std::make_unique<unipm_strings>();
+        result->values = resolver.getSuggestions(name, max_results);
+        *out = result.release();
+        return succeed();
+    });
+}
+
+size_t unipm_strings_count(const unipm_strings* strings) {
+    return strings ? strings->values.size() : 0;
+}
+
+const char* unipm_strings_get(const unipm_strings* strings, size_t index) {
+    if (!strings || index >= strings->values.size()) {
+        return nullptr;
+    }
+    return strings->values[index].c_str();
+}
+
+void unipm_strings_free(unipm_strings* strings) {
+    delete strings;
+}
+
+unipm_status unipm_default_pm(const char** pm) {
+    return guarded([&] {
+        if (!pm) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        // Detection looks at the host, which doesn't change under us
+        static const std::string detected = [] {
+            PMInfo info = PMDetector().detectDefault(OSDetector().detect());
+            return info.type == PackageManager::UNKNOWN ? std::string()
+                                                        : packageManagerToString(info.type);
+        }();
+        if (detected.empty()) {
+            return fail(UNIPM_ERROR_NOT_FOUND, "No supported package manager found");
+        }
+        *pm = detected.c_str();
+        return succeed();
+    });
+}
+
+unipm_status unipm_plan_create(const char* pmName, unipm_operation op,
+                               const char* const* packages, size_t count, unipm_plan** out) {
+    return guarded([&] {
+        if (!out || (count > 0 && !packages)) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        PackageManager pm;
+        if (unipm_status status = parsePM(pmName, pm)) {
+            return status;
+        }
+        std::unique_ptr<PackageManagerAdapter> adapter = AdapterFactory::create(pm);
+        if (!adapter) {
+            return fail(UNIPM_ERROR_UNSUPPORTED,
+                        std::string("No adapter for package manager: ") + pmName);
+        }
+
+        auto result = std::make_unique<unipm_plan>();
+        result->pm = pm;
+        result->op = op;
+        for (size_t i = 0; i < count; ++i) {
+            if (!packages[i] || !*packages[i]) {
+                return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Empty package name");
+            }
+            result->packages.push_back(packages[i]);
+        }
+
+        const bool needsPackages = op == UNIPM_OP_INSTALL || op == UNIPM_OP_REMOVE ||
+                                   op == UNIPM_OP_SEARCH || op == UNIPM_OP_INFO;
+        if (needsPackages && result->packages.empty()) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "No packages given");
+        }
+        switch (op) {
+            case UNIPM_OP_INSTALL: result->plan = adapter->planInstall(result->packages); break;
+            case UNIPM_OP_REMOVE: result->plan = adapter->planRemove(result->packages); break;
+            case UNIPM_OP_UPDATE: result->plan = adapter->planUpdate(); break;
+            case UNIPM_OP_UPGRADE: result->plan = adapter->planUpgrade(); break;
+            case UNIPM_OP_SEARCH: result->plan = adapter->planSearch(result->packages[0]); break;
+            case UNIPM_OP_LIST: result->plan = adapter->planList(); break;
+            case UNIPM_OP_INFO: result->plan = adapter->planInfo(result->packages[0]); break;
+            default: return fail(UNIPM_ERROR_UNSUPPORTED, "Unknown operation");
+        }
+        if (result->plan.empty()) {
+            return fail(UNIPM_ERROR_UNSUPPORTED, adapter->getName() + " has no such operation");
+        }
+
+        result->text = result->plan.toString();
+        for (const auto& step : result->plan.steps) {
+            std::vector<const char*> argv;
+            for (const auto& arg : step.argv) {
+                argv.push_back(arg.c_str());
+            }
+            argv.push_back(nullptr);
+            result->argv.push_back(std::move(argv));
+        }
+        *out = result.release();
+        return succeed();
+    });
+}
+
+size_t unipm_plan_step_count(const unipm_plan* plan) {
+    return plan ? plan->plan.steps.size() : 0;
+}
+
+const char* const* unipm_plan_step_argv(const unipm_plan* plan, size_t step) {
+    if (!plan || step >= plan->argv.size()) {
+        return nullptr;
+    }
+    return plan->argv[step].data();
+}
+
+int unipm_plan_requires_root(const unipm_plan* plan) {
+    return plan && plan->plan.requiresRoot() ? 1 : 0;
+}
+
+const char* unipm_plan_string(const unipm_plan* plan) {
+    return plan ? plan->text.c_str() : "";
+}
+
+unipm_status unipm_plan_execute(unipm_plan* plan, unipm_output_fn on_output, void* userdata,
+                                int* exit_code) {
+    return guarded([&] {
+        if (!plan) {
+            return fail(UNIPM_ERROR_INVALID_ARGUMENT, "Missing argument");
+        }
+        static const char* const ACTIONS[] = {"install", "remove", "update", "upgrade",
+                                              "search",  "list",   "info"};
+
+        Executor executor;
+        executor.setHistoryContext(ACTIONS[plan->op], plan->pm, plan->packages);
+        // Output goes to the caller either way, never to our terminal
+        executor.setOutputHandler([on_output, userdata](std::string_view chunk) {
+            if (on_output) {
+                on_output(chunk.data(), chunk.size(), userdata);
+            }
+        });
+        ExecutionResult result = executor.execute(plan->plan);
+        // Embedders may exit without running our static destructors
+        HistoryLog::instance().flush();
+
+        if (exit_code) {
+            *exit_code = result.exitCode;
+        }
+        if (!result.success) {
+            // stderrOutput only carries unipm's own errors, e.g. a missing program
+            std::string message =
+                result.command + " exited with " + std::to_string(result.exitCode);
+            if (!result.stderrOutput.empty()) {
+                message += ": " + result.stderrOutput;
+            }
+            return fail(UNIPM_ERROR_EXECUTION, message);
+        }
+        return succeed();
+    });
+}
+
+void unipm_plan_free(unipm_plan* plan) {
+    delete plan;
+}
+
+} // extern "C"
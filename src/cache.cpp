@@ -0,0 +1,175 @@
+#include "unipm/cache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/stat.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+std::string Cache::getDirectory() {
+    const char* override = std::getenv("UNIPM_CACHE_DIR");
+    if (override && *override) {
+        return override;
+    }
+
+#ifdef _WIN32
+    const char* localappdata = std::getenv("LOCALAPPDATA");
+    if (localappdata) {
+        return std::string(localappdata) + "\\unipm\\cache";
+    }
+#else
+    const char* home = std::getenv("HOME");
+    if (home) {
+        return std::string(home) + "/.cache/unipm";
+    }
+#endif
+    return "";
+}
+
+std::string Cache::pathFor(const std::string& name) {
+    std::string dir = getDirectory();
+    if (dir.empty()) {
+        return "";
+    }
+#ifdef _WIN32
+    return dir + "\\" + name;
+#else
+    return dir + "/" + name;
+#endif
+}
+
+bool Cache::ensureDirectory() {
+    std::string dir = getDirectory();
+    return !dir.empty() && createDirectories(dir);
+}
+
+bool Cache::createDirectories(const std::string& path) {
+    if (path.empty()) {
+        return false;
+    }
+
+    // Create each component in turn; existing ones are fine
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos != path.size() && path[pos] != '/' && path[pos] != '\\') {
+            continue;
+        }
+        std::string partial = path.substr(0, pos);
+        if (partial.size() == 2 && partial[1] == ':') {
+            continue;  // Drive letter
+        }
+#ifdef _WIN32
+        int rc = _mkdir(partial.c_str());
+#else
+        int rc = mkdir(partial.c_str(), 0755);
+#endif
+        if (rc != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Cache::writeAtomic(const std::string& path, const std::string& data) {
+    if (path.empty()) {
+        return false;
+    }
+
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+
+#ifdef _WIN32
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good()) {
+            return false;
+        }
+    }
+    if (!MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+#else
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char* p = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t n = write(fd, p, remaining);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        p += n;
+        remaining -= static_cast<size_t>(n);
+    }
+
+    close(fd);
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool Cache::readFile(const std::string& path, std::string& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    data = contents.str();
+    return true;
+}
+
+FileStamp Cache::stat(const std::string& path) {
+    FileStamp stamp;
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) == 0) {
+        stamp.exists = true;
+        stamp.size = static_cast<uint64_t>(st.st_size);
+        stamp.mtimeNs = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+    }
+#else
+    struct ::stat st;
+    if (::stat(path.c_str(), &st) == 0) {
+        stamp.exists = true;
+        stamp.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+        stamp.mtimeNs = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL +
+                        st.st_mtimespec.tv_nsec;
+#else
+        stamp.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL +
+                        st.st_mtim.tv_nsec;
+#endif
+    }
+#endif
+    return stamp;
+}
+
+} // namespace unipm
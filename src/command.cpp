@@ -0,0 +1,99 @@
+#include "unipm/command.h"
+#include <cstring>
+
+namespace unipm {
+
+CommandStep CommandStep::query(std::vector<std::string> argv) {
+    CommandStep step;
+    step.argv = std::move(argv);
+    return step;
+}
+
+CommandStep CommandStep::mutation(std::vector<std::string> argv, std::string lockDomain,
+                                  bool requiresRoot) {
+    CommandStep step;
+    step.argv = std::move(argv);
+    step.lockDomain = std::move(lockDomain);
+    step.requiresRoot = requiresRoot;
+    return step;
+}
+
+CommandStep& CommandStep::withOperands(const std::vector<std::string>& operands) {
+    if (!operands.empty()) {
+        operandIndex = argv.size();
+        argv.insert(argv.end(), operands.begin(), operands.end());
+    }
+    return *this;
+}
+
+CommandStep& CommandStep::withEnv(const std::string& name, const std::string& value) {
+    env.emplace_back(name, value);
+    return *this;
+}
+
+std::string CommandStep::toString() const {
+    std::string out;
+    for (const auto& var : env) {
+        out += var.first + "=" + shellQuote(var.second) + " ";
+    }
+    for (size_t i = 0; i < argv.size(); ++i) {
+        if (i > 0) out += ' ';
+        out += shellQuote(argv[i]);
+    }
+    return out;
+}
+
+bool CommandPlan::requiresRoot() const {
+    for (const auto& step : steps) {
+        if (step.requiresRoot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string CommandPlan::toString() const {
+    std::string out;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (i > 0) out += " && ";
+        out += steps[i].toString();
+    }
+    return out;
+}
+
+std::string shellQuote(const std::string& arg) {
+    static const char* safe =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789@%+=:,./_-";
+
+    bool needsQuoting = arg.empty();
+    for (char c : arg) {
+        if (std::strchr(safe, c) == nullptr || c == '\0') {
+            needsQuoting = true;
+            break;
+        }
+    }
+    if (!needsQuoting) {
+        return arg;
+    }
+
+#ifdef _WIN32
+    std::string quoted = "\"";
+    for (char c : arg) {
+        if (c == '"') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+#endif
+}
+
+} // namespace unipm
@@ -0,0 +1,306 @@
+#include "unipm/completion.h"
+#include "unipm/apt_index.h"
+#include "unipm/blob_io.h"
+#include "unipm/config.h"
+#include "unipm/inventory.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace unipm {
+
+namespace {
+
+constexpr char MAGIC[8] = {'U', 'P', 'M', 'C', 'I', 'D', 'X', '1'};
+
+const char* const COMMANDS[] = {"install", "remove",  "update",    "upgrade", "search",
+                                "list",    "info",    "doctor",    "history", "lock",
+                                "mirrors", "help",    "version", "uninstall"};
+
+// Commands whose arguments are package names, aliases included
+const char* const PACKAGE_COMMANDS[] = {"install", "i",    "remove", "rm",   "uninstall",
+                                        "search",  "find", "info",   "show", "lock",
+                                        "history"};
+
+const char* const FLAGS[] = {
+    "--dry-run", "--yes", "--verbose", "--pm=", "--all", "--timeout=", "--no-skip",
+    "--refresh", "--metadata-ttl=", "--since=", "--until=", "--failed", "--succeeded",
+    "--stats", "--limit=", "--pipeline", "--chunk-size=", "--output=", "--manifest=",
+    "--locked", "--lockfile=", "--perf", "--fastest-mirror", "--mirrors=", "--trace=",
+    "--metrics-dir=", "--no-daemon", "--self"};
+
+// Package managers with an adapter
+const char* const MANAGERS[] = {"apt", "pacman", "brew", "dnf", "winget", "choco"};
+
+const char* const OUTPUT_FORMATS[] = {"text", "ndjson"};
+
+bool startsWith(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+template <size_t N>
+void addMatches(const char* const (&words)[N], std::string_view prefix,
+                std::string_view valuePrefix, std::vector<std::string>& out) {
+    for (const char* word : words) {
+        if (startsWith(word, valuePrefix)) {
+            out.push_back(std::string(prefix) + word);
+        }
+    }
+}
+
+// One line per name in the shell's output, so no whitespace or controls
+bool isCompletable(std::string_view name) {
+    if (name.empty()) {
+        return false;
+    }
+    for (unsigned char c : name) {
+        if (c <= ' ' || c == 0x7f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void putStamp(std::string& out, const std::string& path) {
+    FileStamp stamp = Cache::stat(path);
+    put<uint8_t>(out, stamp.exists ? 1 : 0);
+    put<uint64_t>(out, stamp.size);
+    put<int64_t>(out, stamp.mtimeNs);
+    put<uint32_t>(out, static_cast<uint32_t>(path.size()));
+    out += path;
+}
+
+} // namespace
+
+CompletionSources CompletionSources::defaults() {
+    CompletionSources sources;
+    sources.database = Config().findDatabase();
+    sources.aptIndex = Cache::pathFor(AptIndex::CACHE_FILE);
+    sources.inventory = Cache::pathFor(Inventory::CACHE_FILE);
+    return sources;
+}
+
+CompletionIndex::CompletionIndex(std::string path) : path_(std::move(path)) {}
+
+bool CompletionIndex::load(const CompletionSources& sources) {
+    file_.close();
+    blob_.clear();
+    count_ = 0;
+    fromCache_ = false;
+
+    const std::vector<std::string> paths = {sources.database, sources.aptIndex,
+                                            sources.inventory};
+
+    if (!path_.empty() && file_.open(path_)) {
+        if (parse(file_.view(), paths)) {
+            fromCache_ = true;
+            return true;
+        }
+        file_.close();
+    }
+
+    blob_ = build(sources, paths);
+    if (!path_.empty()) {
+        size_t slash = path_.find_last_of("/\\");
+        if (slash != std::string::npos) {
+            Cache::createDirectories(path_.substr(0, slash));
+        }
+        // A failed write only costs another build next time
+        Cache::writeAtomic(path_, blob_);
+    }
+    return parse(blob_, paths);
+}
+
+std::vector<std::string_view> CompletionIndex::complete(std::string_view prefix,
+                                                        size_t limit) const {
+    // First name not less than prefix; every match follows it contiguously
+    uint32_t low = 0;
+    uint32_t high = count_;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (at(mid) < prefix) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    std::vector<std::string_view> matches;
+    for (uint32_t i = low; i < count_ && matches.size() < limit; ++i) {
+        std::string_view name = at(i);
+        if (!startsWith(name, prefix)) {
+            break;
+        }
+        matches.push_back(name);
+    }
+    return matches;
+}
+
+std::string_view CompletionIndex::at(uint32_t i) const {
+    uint32_t offset;
+    std::memcpy(&offset, offsets_.data() + i * sizeof(uint32_t), sizeof(offset));
+    if (offset >= names_.size()) {
+        return {};
+    }
+    // parse() checked that the names end in a NUL
+    return names_.substr(offset, names_.find('\0', offset) - offset);
+}
+
+std::string CompletionIndex::build(const CompletionSources& sources,
+                                   const std::vector<std::string>& paths) {
+    // Stamp the sources before reading them: a change mid-build shows up
+    // as a stale index next time instead of going unnoticed
+    std::string out(MAGIC, sizeof(MAGIC));
+    put<uint32_t>(out, static_cast<uint32_t>(paths.size()));
+    for (const auto& path : paths) {
+        putStamp(out, path);
+    }
+
+    std::vector<std::string> names;
+    std::string data;
+    if (!sources.database.empty() && Cache::readFile(sources.database, data)) {
+        json root = json::parse(data, nullptr, false);
+        if (!root.is_discarded() && root.contains("packages") && root["packages"].is_object()) {
+            for (const auto& [name, info] : root["packages"].items()) {
+                names.push_back(name);
+                if (info.is_object() && info.contains("aliases") && info["aliases"].is_array()) {
+                    for (const auto& alias : info["aliases"]) {
+                        if (alias.is_string()) {
+                            names.push_back(alias.get<std::string>());
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    AptIndex apt;
+    if (!sources.aptIndex.empty() && apt.loadCache(sources.aptIndex)) {
+        for (const auto& entry : apt.entries()) {
+            names.emplace_back(entry.name);
+        }
+    }
+
+    if (!sources.inventory.empty()) {
+        Inventory::readCachedNames(sources.inventory, names);
+    }
+
+    names.erase(std::remove_if(names.begin(), names.end(),
+                               [](const std::string& name) { return !isCompletable(name); }),
+                names.end());
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    std::string text;
+    put<uint32_t>(out, static_cast<uint32_t>(names.size()));
+    for (const auto& name : names) {
+        put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+        text += name;
+        text += '\0';
+    }
+    put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+    out += text;
+    return out;
+}
+
+bool CompletionIndex::parse(std::string_view blob, const std::vector<std::string>& paths) {
+    BlobReader reader(blob);
+
+    std::string_view magic;
+    uint32_t sourceCount = 0;
+    if (!reader.bytes(sizeof(MAGIC), magic) || magic != std::string_view(MAGIC, sizeof(MAGIC)) ||
+        !reader.get(sourceCount) || sourceCount != paths.size()) {
+        return false;
+    }
+
+    for (const auto& expected : paths) {
+        uint8_t exists;
+        uint64_t size;
+        int64_t mtimeNs;
+        uint32_t pathLen;
+        std::string_view path;
+        if (!reader.get(exists) || !reader.get(size) || !reader.get(mtimeNs) ||
+            !reader.get(pathLen) || !reader.bytes(pathLen, path)) {
+            return false;
+        }
+        FileStamp stamp = Cache::stat(expected);
+        if (path != expected || (exists != 0) != stamp.exists ||
+            (stamp.exists && (size != stamp.size || mtimeNs != stamp.mtimeNs))) {
+            return false;  // A source changed since the index was built
+        }
+    }
+
+    uint32_t count = 0;
+    uint32_t namesSize = 0;
+    std::string_view offsets;
+    std::string_view names;
+    if (!reader.get(count) || !reader.bytes(size_t{count} * sizeof(uint32_t), offsets) ||
+        !reader.get(namesSize) || !reader.bytes(namesSize, names) ||
+        (namesSize > 0 && names.back() != '\0')) {
+        return false;
+    }
+
+    offsets_ = offsets;
+    names_ = names;
+    count_ = count;
+    return true;
+}
+
+std::vector<std::string> Completion::candidates(const std::vector<std::string>& words,
+                                                CompletionIndex& index,
+                                                const CompletionSources& sources) {
+    std::vector<std::string> out;
+    if (words.empty()) {
+        return out;
+    }
+
+    const std::string& word = words.back();
+    if (words.size() == 1) {
+        addMatches(COMMANDS, "", word, out);
+        return out;
+    }
+
+    if (startsWith(word, "--pm=")) {
+        addMatches(MANAGERS, "--pm=", word.substr(5), out);
+        return out;
+    }
+    if (startsWith(word, "--output=")) {
+        addMatches(OUTPUT_FORMATS, "--output=", word.substr(9), out);
+        return out;
+    }
+    if (startsWith(word, "-")) {
+        if (word.find('=') == std::string::npos) {
+            addMatches(FLAGS, "", word, out);
+        }
+        return out;
+    }
+
+    const std::string& command = words.front();
+    bool packages = std::any_of(std::begin(PACKAGE_COMMANDS), std::end(PACKAGE_COMMANDS),
+                                [&command](const char* name) { return command == name; });
+    if (packages && index.load(sources)) {
+        for (std::string_view name : index.complete(word, MAX_RESULTS)) {
+            out.emplace_back(name);
+        }
+    }
+    return out;
+}
+
+int Completion::run(int argc, char* argv[]) {
+    std::vector<std::string> words(argv + std::min(argc, 2), argv + argc);
+    if (words.empty()) {
+        words.emplace_back();
+    }
+
+    CompletionIndex index;
+    std::string output;
+    for (const auto& candidate : candidates(words, index, CompletionSources::defaults())) {
+        output += candidate;
+        output += '\n';
+    }
+    std::fwrite(output.data(), 1, output.size(), stdout);
+    std::fflush(stdout);
+    return 0;
+}
+
+} // namespace unipm
@@ -1,7 +1,10 @@
 #include "unipm/config.h"
+#include "unipm/cache.h"
+#include "unipm/trace.h"
+#include <cstdio>
 #include <fstream>
 #include <iostream>
-#include <algorithm>
+#include <memory>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,19 +17,142 @@
 
 namespace unipm {
 
-Config::Config() {
-    // Initialize empty
+PackageDatabase::PackageDatabase(const json& data, std::string path) : path_(std::move(path)) {
+    if (!data.contains("packages")) {
+        return;
+    }
+    
+    for (auto& [key, value] : data["packages"].items()) {
+        PackageInfo info;
+        info.name = key;
+        
+        // Parse aliases
+        if (value.contains("aliases") && value["aliases"].is_array()) {
+            for (const auto& alias : value["aliases"]) {
+                info.aliases.push_back(alias.get<std::string>());
+            }
+        }
+        
+        // Parse package manager mappings
+        const std::vector<std::string> pmKeys = {
+            "apt", "pacman", "brew", "dnf", "yum", "winget", "choco", "snap", "flatpak"
+        };
+        
+        for (const auto& pmKey : pmKeys) {
+            if (value.contains(pmKey)) {
+                PackageManager pm = stringToPackageManager(pmKey);
+                info.pmMappings[pm] = value[pmKey].get<std::string>();
+                // First database entry wins when several map to one native name
+                canonicalNames_.emplace(std::make_pair(pm, info.pmMappings[pm]), key);
+            }
+        }
+        
+        // Parse version mappings
+        if (value.contains("versions")) {
+            for (auto& [versionKey, versionValue] : value["versions"].items()) {
+                std::map<PackageManager, std::string> versionPmMappings;
+                
+                for (const auto& pmKey : pmKeys) {
+                    if (versionValue.contains(pmKey)) {
+                        PackageManager pm = stringToPackageManager(pmKey);
+                        versionPmMappings[pm] = versionValue[pmKey].get<std::string>();
+                    }
+                }
+                
+                info.versionMappings[versionKey] = versionPmMappings;
+            }
+        }
+        
+        packages_[key] = info;
+    }
+    
+    // Packages are visited in name order, so the first one declaring an
+    // alias keeps it, as when the aliases were searched one by one
+    for (const auto& [name, info] : packages_) {
+        for (const auto& alias : info.aliases) {
+            aliases_.emplace(alias, name);
+        }
+    }
+}
+
+const PackageInfo* PackageDatabase::find(const std::string& name) const {
+    auto it = packages_.find(name);
+    if (it != packages_.end()) {
+        return &it->second;
+    }
+    
+    // Check aliases
+    auto aliasIt = aliases_.find(name);
+    if (aliasIt != aliases_.end()) {
+        return &packages_.at(aliasIt->second);
+    }
+    return nullptr;
+}
+
+PackageInfo PackageDatabase::getPackageInfo(const std::string& name) const {
+    const PackageInfo* info = find(name);
+    return info ? *info : PackageInfo();
+}
+
+bool PackageDatabase::hasPackage(const std::string& name) const {
+    return find(name) != nullptr;
+}
+
+std::vector<std::string> PackageDatabase::getAllPackageNames() const {
+    std::vector<std::string> names;
+    names.reserve(packages_.size());
+    for (const auto& [name, info] : packages_) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::string PackageDatabase::getMapping(const std::string& packageName, PackageManager pm) const {
+    const PackageInfo* info = find(packageName);
+    if (info) {
+        auto it = info->pmMappings.find(pm);
+        if (it != info->pmMappings.end()) {
+            return it->second;
+        }
+    }
+    
+    // Return the package name as-is if no mapping found
+    return packageName;
+}
+
+std::string PackageDatabase::getCanonicalName(const std::string& nativeName,
+                                              PackageManager pm) const {
+    auto it = canonicalNames_.find({pm, nativeName});
+    return it != canonicalNames_.end() ? it->second : std::string();
+}
+
+DatabaseHandle::DatabaseHandle(std::shared_ptr<const PackageDatabase> database)
+    : database_(std::move(database)) {}
+
+std::shared_ptr<const PackageDatabase> DatabaseHandle::current() const {
+    return std::atomic_load(&database_);
+}
+
+void DatabaseHandle::publish(std::shared_ptr<const PackageDatabase> database) {
+    std::atomic_store(&database_, std::move(database));
 }
 
+Config::Config() : handle_(std::make_shared<DatabaseHandle>()) {}
+
 bool Config::load(const std::string& path) {
+    UNIPM_TRACE_SPAN(span, "Config::load", "config");
+    UNIPM_TRACE_ARG(span, "path", path);
     std::ifstream file(path);
     if (!file.is_open()) {
         return false;
     }
     
     try {
-        file >> data_;
-        parsePackages();
+        json data;
+        file >> data;
+        auto database = std::make_shared<const PackageDatabase>(data, path);
+        data_ = std::move(data);
+        handle_->publish(std::move(database));
         return true;
     } catch (const json::exception& e) {
         std::cerr << "Error parsing JSON: " << e.what() << std::endl;
@@ -39,6 +165,31 @@ bool Config::loadDefault() {
     return load(defaultPath);
 }
 
+std::string Config::findDatabase() {
+    for (const std::string& path : {getDefaultConfigPath(), std::string("data/packages.json")}) {
+        if (Cache::stat(path).exists) {
+            return path;
+        }
+    }
+    return "";
+}
+
+std::string Config::hashDatabase(const std::string& path) {
+    std::string data;
+    if (path.empty() || !Cache::readFile(path, data)) {
+        return "";
+    }
+    
+    // FNV-1a: detects edits, no need for a cryptographic hash
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return std::string("fnv1a64:") + hex;
+}
+
 void Config::mergeUserConfig(const std::string& userConfigPath) {
     std::ifstream file(userConfigPath);
     if (!file.is_open()) {
@@ -50,120 +201,39 @@ void Config::mergeUserConfig(const std::string& userConfigPath) {
         file >> userData;
         
         // Merge user data with default data
+        json merged = data_;
         if (userData.contains("packages")) {
             for (auto& [key, value] : userData["packages"].items()) {
-                data_["packages"][key] = value;
+                merged["packages"][key] = value;
             }
         }
         
-        parsePackages();
+        auto database = std::make_shared<const PackageDatabase>(merged, path());
+        data_ = std::move(merged);
+        handle_->publish(std::move(database));
     } catch (const json::exception& e) {
         std::cerr << "Error parsing user config: " << e.what() << std::endl;
     }
 }
 
-PackageInfo Config::getPackageInfo(const std::string& name) {
-    auto it = packages_.find(name);
-    if (it != packages_.end()) {
-        return it->second;
-    }
-    
-    // Check aliases
-    for (const auto& [pkgName, pkgInfo] : packages_) {
-        auto aliasIt = std::find(pkgInfo.aliases.begin(), pkgInfo.aliases.end(), name);
-        if (aliasIt != pkgInfo.aliases.end()) {
-            return pkgInfo;
-        }
-    }
-    
-    // Return empty package info
-    return PackageInfo();
+PackageInfo Config::getPackageInfo(const std::string& name) const {
+    return snapshot()->getPackageInfo(name);
 }
 
-bool Config::hasPackage(const std::string& name) {
-    if (packages_.find(name) != packages_.end()) {
-        return true;
-    }
-    
-    // Check aliases
-    for (const auto& [pkgName, pkgInfo] : packages_) {
-        auto aliasIt = std::find(pkgInfo.aliases.begin(), pkgInfo.aliases.end(), name);
-        if (aliasIt != pkgInfo.aliases.end()) {
-            return true;
-        }
-    }
-    
-    return false;
+bool Config::hasPackage(const std::string& name) const {
+    return snapshot()->hasPackage(name);
 }
 
-std::vector<std::string> Config::getAllPackageNames() {
-    std::vector<std::string> names;
-    for (const auto& [name, info] : packages_) {
-        names.push_back(name);
-    }
-    return names;
+std::vector<std::string> Config::getAllPackageNames() const {
+    return snapshot()->getAllPackageNames();
 }
 
-std::string Config::getMapping(const std::string& packageName, PackageManager pm) {
-    PackageInfo info = getPackageInfo(packageName);
-    
-    auto it = info.pmMappings.find(pm);
-    if (it != info.pmMappings.end()) {
-        return it->second;
-    }
-    
-    // Return the package name as-is if no mapping found
-    return packageName;
+std::string Config::getMapping(const std::string& packageName, PackageManager pm) const {
+    return snapshot()->getMapping(packageName, pm);
 }
 
-void Config::parsePackages() {
-    packages_.clear();
-    
-    if (!data_.contains("packages")) {
-        return;
-    }
-    
-    for (auto& [key, value] : data_["packages"].items()) {
-        PackageInfo info;
-        info.name = key;
-        
-        // Parse aliases
-        if (value.contains("aliases") && value["aliases"].is_array()) {
-            for (const auto& alias : value["aliases"]) {
-                info.aliases.push_back(alias.get<std::string>());
-            }
-        }
-        
-        // Parse package manager mappings
-        const std::vector<std::string> pmKeys = {
-            "apt", "pacman", "brew", "dnf", "yum", "winget", "choco", "snap", "flatpak"
-        };
-        
-        for (const auto& pmKey : pmKeys) {
-            if (value.contains(pmKey)) {
-                PackageManager pm = stringToPackageManager(pmKey);
-                info.pmMappings[pm] = value[pmKey].get<std::string>();
-            }
-        }
-        
-        // Parse version mappings
-        if (value.contains("versions")) {
-            for (auto& [versionKey, versionValue] : value["versions"].items()) {
-                std::map<PackageManager, std::string> versionPmMappings;
-                
-                for (const auto& pmKey : pmKeys) {
-                    if (versionValue.contains(pmKey)) {
-                        PackageManager pm = stringToPackageManager(pmKey);
-                        versionPmMappings[pm] = versionValue[pmKey].get<std::string>();
-                    }
-                }
-                
-                info.versionMappings[versionKey] = versionPmMappings;
-            }
-        }
-        
-        packages_[key] = info;
-    }
+std::string Config::getCanonicalName(const std::string& nativeName, PackageManager pm) const {
+    return snapshot()->getCanonicalName(nativeName, pm);
 }
 
 std::string Config::getDefaultConfigPath() {
@@ -0,0 +1,969 @@
+#include "unipm/daemon.h"
+#include "unipm/adapter.h"
+#include "unipm/config.h"
+#include "unipm/inventory.h"
+#include "unipm/os_detector.h"
+#include "unipm/pm_detector.h"
+#include "unipm/resolver.h"
+#include "unipm/trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace unipm {
+
+namespace {
+
+// Without inotify, how often the daemon checks its files for changes
+constexpr int POLL_INTERVAL_MS = 2000;
+
+// Changes come in bursts (apt update renames every list); let them settle
+constexpr int SETTLE_MS = 200;
+
+// Longest request line a client may send
+constexpr size_t MAX_REQUEST = 1024 * 1024;
+
+// A client that stops reading its responses gives up its worker after this
+constexpr int SEND_TIMEOUT_S = 10;
+
+json osJson(const OSInfo& os) {
+    return {{"type", static_cast<int>(os.type)},
+            {"distro", static_cast<int>(os.distro)},
+            {"version", os.version},
+            {"codename", os.codename}};
+}
+
+OSInfo osFrom(const json& j) {
+    OSInfo os;
+    os.type = static_cast<OSType>(j.value("type", static_cast<int>(OSType::UNKNOWN)));
+    os.distro =
+        static_cast<LinuxDistro>(j.value("distro", static_cast<int>(LinuxDistro::UNKNOWN)));
+    os.version = j.value("version", "");
+    os.codename = j.value("codename", "");
+    return os;
+}
+
+json pmJson(const PMInfo& info) {
+    return {{"type", packageManagerToString(info.type)},
+            {"name", info.name},
+            {"path", info.path},
+            {"version", info.version},
+            {"prefix", info.prefix}};
+}
+
+PMInfo pmFrom(const json& j) {
+    PMInfo info;
+    info.type = stringToPackageManager(j.value("type", ""));
+    info.name = j.value("name", "");
+    info.path = j.value("path", "");
+    info.version = j.value("version", "");
+    info.prefix = j.value("prefix", "");
+    return info;
+}
+
+json resolvedJson(const ResolvedPackage& pkg) {
+    return {{"name", pkg.originalName},
+            {"resolved", pkg.resolvedName},
+            {"version", pkg.version},
+            {"pm", packageManagerToString(pkg.packageManager)},
+            {"confidence", pkg.confidence},
+            {"suggestions", pkg.suggestions},
+            {"available", pkg.available}};
+}
+
+ResolvedPackage resolvedFrom(const json& j) {
+    ResolvedPackage pkg;
+    pkg.originalName = j.value("name", "");
+    pkg.resolvedName = j.value("resolved", "");
+    pkg.version = j.value("version", "");
+    pkg.packageManager = stringToPackageManager(j.value("pm", ""));
+    pkg.confidence = j.value("confidence", 0.0f);
+    pkg.suggestions = j.value("suggestions", std::vector<std::string>());
+    pkg.available = j.value("available", true);
+    return pkg;
+}
+
+json installedJson(const InstalledPackage& pkg) {
+    return {{"name", pkg.name},
+            {"version", pkg.version},
+            {"architecture", pkg.architecture},
+            {"description", pkg.description},
+            {"installed_size", pkg.installedSize},
+            {"explicit", pkg.explicitlyInstalled},
+            {"pm", packageManagerToString(pkg.packageManager)}};
+}
+
+InstalledPackage installedFrom(const json& j) {
+    InstalledPackage pkg;
+    if (j.is_null()) {
+        return pkg;
+    }
+    pkg.name = j.value("name", "");
+    pkg.version = j.value("version", "");
+    pkg.architecture = j.value("architecture", "");
+    pkg.description = j.value("description", "");
+    pkg.installedSize = j.value("installed_size", static_cast<uint64_t>(0));
+    pkg.explicitlyInstalled = j.value("explicit", true);
+    pkg.packageManager = stringToPackageManager(j.value("pm", ""));
+    return pkg;
+}
+
+json availableJson(const AvailablePackage& pkg) {
+    return {{"name", pkg.name},
+            {"version", pkg.version},
+            {"section", pkg.section},
+            {"description", pkg.description},
+            {"size", pkg.size},
+            {"pm", packageManagerToString(pkg.packageManager)}};
+}
+
+AvailablePackage availableFrom(const json& j) {
+    AvailablePackage pkg;
+    pkg.name = j.value("name", "");
+    pkg.version = j.value("version", "");
+    pkg.section = j.value("section", "");
+    pkg.description = j.value("description", "");
+    pkg.size = j.value("size", static_cast<uint64_t>(0));
+    pkg.packageManager = stringToPackageManager(j.value("pm", ""));
+    return pkg;
+}
+
+std::string line(const json& message) {
+    // Package descriptions aren't always valid UTF-8
+    return message.dump(-1, ' ', false, json::error_handler_t::replace) + "\n";
+}
+
+std::vector<FileStamp> stampPaths(const std::vector<std::string>& paths) {
+    std::vector<FileStamp> stamps;
+    for (const auto& path : paths) {
+        stamps.push_back(Cache::stat(path));
+    }
+    return stamps;
+}
+
+// Repository index loaded up front, so lookups only ever read it
+std::shared_ptr<PackageManagerAdapter> freshAdapter(const PMInfo& info) {
+    std::shared_ptr<PackageManagerAdapter> adapter = AdapterFactory::create(info);
+    if (adapter) {
+        adapter->checkAvailable(std::string());
+    }
+    return adapter;
+}
+
+#ifndef _WIN32
+int connectSocket(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;  // SO_NOSIGPIPE is set instead
+#endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, flags);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Only the user running the daemon may talk to it
+bool peerIsOwner(int fd) {
+#if defined(SO_PEERCRED)
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 &&
+           credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+#endif
+
+// Absolute form of a database path, so a daemon and a client started in
+// different directories can tell whether they mean the same file
+std::string canonicalPath(const std::string& path) {
+#ifndef _WIN32
+    char resolved[PATH_MAX];
+    if (!path.empty() && ::realpath(path.c_str(), resolved)) {
+        return resolved;
+    }
+#endif
+    return path;
+}
+
+} // namespace
+
+std::string Daemon::socketPath() {
+    const char* path = std::getenv("UNIPM_SOCKET");
+    if (path && *path) {
+        return path;
+    }
+#ifdef _WIN32
+    return "";
+#else
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/unipm.sock";
+    }
+    return "/tmp/unipm-" + std::to_string(getuid()) + ".sock";
+#endif
+}
+
+Daemon::Daemon(std::string socketPath, std::string database, size_t threads)
+    : socketPath_(std::move(socketPath)), requestedDatabase_(std::move(database)),
+      threads_(threads ? threads : std::max<size_t>(2, std::thread::hardware_concurrency())),
+      packages_(std::make_shared<DatabaseHandle>()), inventory_(std::make_unique<Inventory>()) {}
+
+Daemon::~Daemon() {
+#ifndef _WIN32
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath_.c_str());
+    }
+    for (int fd : {stopPipe_[0], stopPipe_[1], wakePipe_[0], wakePipe_[1], watchFd_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+bool Daemon::start(std::string& error) {
+#ifdef _WIN32
+    error = "unipmd needs Unix domain sockets";
+    return false;
+#else
+    sockaddr_un address{};
+    if (socketPath_.empty() || socketPath_.size() >= sizeof(address.sun_path)) {
+        error = "Unusable socket path: " + socketPath_;
+        return false;
+    }
+
+    // Something answering there is a running daemon; anything else is stale
+    int existing = connectSocket(socketPath_);
+    if (existing >= 0) {
+        ::close(existing);
+        error = "unipmd is already running on " + socketPath_;
+        return false;
+    }
+
+    if (::pipe(stopPipe_) != 0 || ::pipe(wakePipe_) != 0) {
+        error = std::string("pipe: ") + std::strerror(errno);
+        return false;
+    }
+    for (int fd : {stopPipe_[0], stopPipe_[1], wakePipe_[0], wakePipe_[1]}) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    fcntl(wakePipe_[0], F_SETFL, O_NONBLOCK);
+#ifdef __linux__
+    watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+    load();
+
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    fcntl(listenFd_, F_SETFD, FD_CLOEXEC);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath_.c_str(), socketPath_.size() + 1);
+
+    ::unlink(socketPath_.c_str());
+    mode_t mask = ::umask(0177);  // Socket readable and writable by the owner only
+    int bound = ::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::umask(mask);
+    if (bound != 0 || ::listen(listenFd_, 64) != 0) {
+        error = socketPath_ + ": " + std::strerror(errno);
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    return true;
+#endif
+}
+
+void Daemon::run() {
+#ifndef _WIN32
+    if (listenFd_ < 0) {
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads_; ++i) {
+        workers.emplace_back(&Daemon::work, this);
+    }
+    watcher_ = std::thread(&Daemon::watch, this);
+
+    // Connections between requests wait here rather than in a worker, so
+    // clients that stay connected cost nothing until they ask something
+    std::vector<Connection> idle;
+    for (;;) {
+        std::vector<pollfd> fds = {
+            {listenFd_, POLLIN, 0}, {stopPipe_[0], POLLIN, 0}, {wakePipe_[0], POLLIN, 0}};
+        for (const auto& connection : idle) {
+            fds.push_back({connection.fd, POLLIN, 0});
+        }
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        // Requests (or hang-ups) go to the workers
+        std::vector<Connection> waiting;
+        size_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            for (size_t i = 0; i < idle.size(); ++i) {
+                if (fds[i + 3].revents != 0) {
+                    ready_.push_back(std::move(idle[i]));
+                    queued++;
+                } else {
+                    waiting.push_back(std::move(idle[i]));
+                }
+            }
+            if (fds[2].revents != 0) {
+                char drain[256];
+                while (::read(wakePipe_[0], drain, sizeof(drain)) > 0) {
+                }
+                for (auto& connection : returned_) {
+                    waiting.push_back(std::move(connection));
+                }
+                returned_.clear();
+            }
+        }
+        for (size_t i = 0; i < queued; ++i) {
+            queueReady_.notify_one();
+        }
+        idle = std::move(waiting);
+
+        if (fds[0].revents == 0) {
+            continue;
+        }
+        int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if (!peerIsOwner(fd)) {
+            ::close(fd);
+            continue;
+        }
+        timeval timeout{SEND_TIMEOUT_S, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        Connection connection;
+        connection.fd = fd;
+        idle.push_back(std::move(connection));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopping_ = true;
+    }
+    queueReady_.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    watcher_.join();
+
+    for (auto* connections : {&idle, &returned_}) {
+        for (const auto& connection : *connections) {
+            ::close(connection.fd);
+        }
+        connections->clear();
+    }
+    for (const auto& connection : ready_) {
+        ::close(connection.fd);
+    }
+    ready_.clear();
+    ::close(listenFd_);
+    listenFd_ = -1;
+    ::unlink(socketPath_.c_str());
+#endif
+}
+
+void Daemon::stop() {
+#ifndef _WIN32
+    // Never read: every poll() on it wakes up from now on
+    if (stopPipe_[1] >= 0 && ::write(stopPipe_[1], "x", 1) < 0) {
+        // Nothing more a signal handler can do
+    }
+#endif
+}
+
+std::string Daemon::databasePath() {
+    return packages_->current()->path();
+}
+
+json Daemon::handle(const json& request) {
+    try {
+        const std::string op = request.value("op", "");
+        const PackageManager pm = stringToPackageManager(request.value("pm", ""));
+
+        if (op == "hello") {
+#ifdef _WIN32
+            const int pid = 0;
+#else
+            const int pid = static_cast<int>(getpid());
+#endif
+            return {{"protocol", PROTOCOL}, {"pid", pid}, {"database", databasePath()}};
+        }
+
+        if (op == "detect") {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            json info = nullptr;
+            if (request.value("pm", "").empty()) {
+                if (defaultPM_.type != PackageManager::UNKNOWN) {
+                    info = pmJson(defaultPM_);
+                }
+            } else {
+                for (const auto& detected : detected_) {
+                    if (detected.type == pm) {
+                        info = pmJson(detected);
+                    }
+                }
+            }
+            return {{"os", osJson(os_)}, {"pm", info}};
+        }
+
+        if (op == "resolve") {
+            Resolver resolver(packages_);
+            std::shared_ptr<PackageManagerAdapter> adapter;
+            if (request.value("check", false)) {
+                adapter = adapterFor(pm);
+            }
+            if (adapter) {
+                resolver.setAvailabilityCheck([&adapter](const std::string& name) {
+                    return adapter->checkAvailable(name) != Availability::MISSING;
+                });
+            }
+            ResolvedPackage resolved = resolver.resolve(request.at("name").get<std::string>(), pm,
+                                                        request.value("version", ""));
+            return {{"resolved", resolvedJson(resolved)}};
+        }
+
+        if (op == "installed" || op == "list") {
+            std::lock_guard<std::mutex> lock(inventoryMutex_);
+            inventory_->poll();
+            bool tracked = inventory_->isTracked(pm);
+            json packages = json::array();
+            if (op == "list") {
+                if (tracked) {
+                    for (const auto& pkg : inventory_->packages(pm)) {
+                        packages.push_back(installedJson(pkg));
+                    }
+                }
+            } else {
+                for (const auto& name : request.at("names")) {
+                    const InstalledPackage* pkg = inventory_->find(name.get<std::string>(), pm);
+                    packages.push_back(pkg ? installedJson(*pkg) : json(nullptr));
+                }
+            }
+            return {{"tracked", tracked}, {"packages", std::move(packages)}};
+        }
+
+        if (op == "search") {
+            std::shared_ptr<PackageManagerAdapter> adapter = adapterFor(pm);
+            std::vector<AvailablePackage> results;
+            bool supported =
+                adapter && adapter->searchAvailable(request.at("query").get<std::string>(), results);
+            json packages = json::array();
+            for (const auto& pkg : results) {
+                packages.push_back(availableJson(pkg));
+            }
+            return {{"supported", supported}, {"packages", std::move(packages)}};
+        }
+
+        if (op == "reload") {
+            load();
+            return {{"reloaded", true}};
+        }
+
+        return {{"error", "Unknown request: " + op}};
+    } catch (const json::exception& e) {
+        return {{"error", std::string("Malformed request: ") + e.what()}};
+    } catch (const std::exception& e) {
+        // Out of memory, or a system error from an adapter or the inventory:
+        // fail this request, not the daemon
+        return {{"error", std::string("Request failed: ") + e.what()}};
+    }
+}
+
+void Daemon::load() {
+    OSInfo os = OSDetector().detect();
+    PMDetector detector;
+    std::vector<PMInfo> detected = detector.detectAll();
+    PMInfo defaultPM = detector.detectDefault(os);
+
+    std::map<PackageManager, Manager> managers;
+    auto inventory = std::make_unique<Inventory>();
+    for (const auto& info : detected) {
+        Manager manager;
+        manager.info = info;
+        manager.adapter = freshAdapter(info);
+        if (!manager.adapter) {
+            continue;  // Detected, but no adapter (snap, flatpak, yum)
+        }
+        manager.metadataPaths = manager.adapter->getRepositoryMetadataPaths();
+        manager.stamps = stampPaths(manager.metadataPaths);
+        for (const auto& path : manager.metadataPaths) {
+            addWatch(path);
+        }
+        managers.emplace(info.type, std::move(manager));
+        inventory->addSource(info);
+    }
+    inventory->refresh();
+    inventory->startWatching();
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        os_ = os;
+        detected_ = std::move(detected);
+        defaultPM_ = defaultPM;
+        managers_ = std::move(managers);
+    }
+    {
+        std::lock_guard<std::mutex> lock(inventoryMutex_);
+        inventory_ = std::move(inventory);
+    }
+    loadDatabase();
+}
+
+void Daemon::loadDatabase() {
+    std::string path = requestedDatabase_;
+    if (path.empty()) {
+        path = Config().findDatabase();
+    }
+    path = canonicalPath(path);
+    addWatch(path);
+
+    FileStamp stamp = Cache::stat(path);
+    Config config;
+    bool loaded = !path.empty() && config.load(path);
+
+    // The lock only orders reloads; lookups carry on with the old version
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    database_ = path;
+    databaseStamp_ = stamp;
+    if (!loaded && stamp.exists && packages_->current()->path() == path) {
+        // Half-written or broken: keep serving the last good version
+        std::cerr << "unipmd: keeping the last good version of " << path << std::endl;
+        return;
+    }
+    packages_->publish(config.snapshot());
+}
+
+void Daemon::addWatch(const std::string& path) {
+#ifdef __linux__
+    if (watchFd_ < 0 || path.empty()) {
+        return;
+    }
+    // Files are replaced by rename; watch the parent instead
+    std::string target = path;
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        size_t slash = path.find_last_of('/');
+        target = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    }
+    // Watching a directory twice just returns the same watch
+    inotify_add_watch(watchFd_, target.c_str(),
+                      IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+                          IN_ATTRIB);
+#else
+    (void)path;
+#endif
+}
+
+void Daemon::watch() {
+#ifndef _WIN32
+    while (!stopping_) {
+        pollfd fds[2] = {{stopPipe_[0], POLLIN, 0}, {watchFd_, POLLIN, 0}};
+        bool inotify = watchFd_ >= 0;
+        if (::poll(fds, inotify ? 2 : 1, inotify ? -1 : POLL_INTERVAL_MS) < 0 && errno != EINTR) {
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+#ifdef __linux__
+        if (inotify && fds[1].revents != 0) {
+            if (::poll(fds, 1, SETTLE_MS) > 0) {
+                return;
+            }
+            // Which file changed doesn't matter: the stamps tell
+            alignas(struct inotify_event) char buffer[8192];
+            while (::read(watchFd_, buffer, sizeof(buffer)) > 0) {
+            }
+        }
+#endif
+        checkForChanges();
+    }
+#endif
+}
+
+void Daemon::checkForChanges() {
+    std::string database;
+    FileStamp databaseStamp;
+    std::vector<std::pair<PMInfo, std::vector<std::string>>> managers;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        database = database_;
+        databaseStamp = databaseStamp_;
+        for (const auto& entry : managers_) {
+            if (stampPaths(entry.second.metadataPaths) != entry.second.stamps) {
+                managers.emplace_back(entry.second.info, entry.second.metadataPaths);
+            }
+        }
+    }
+
+    if (!database.empty() && Cache::stat(database) != databaseStamp) {
+        loadDatabase();
+        std::cerr << "unipmd: reloaded " << database << std::endl;
+    }
+
+    // Load outside the lock: lookups keep using the old index meanwhile
+    for (const auto& entry : managers) {
+        std::vector<FileStamp> stamps = stampPaths(entry.second);
+        std::shared_ptr<PackageManagerAdapter> adapter = freshAdapter(entry.first);
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        auto it = managers_.find(entry.first.type);
+        if (it != managers_.end() && adapter) {
+            it->second.adapter = std::move(adapter);
+            it->second.stamps = std::move(stamps);
+        }
+        std::cerr << "unipmd: reloaded the " << entry.first.name << " repository index"
+                  << std::endl;
+    }
+}
+
+bool Daemon::serve(Connection& connection) {
+#ifndef _WIN32
+    // run() saw it readable, so this doesn't wait
+    char chunk[16384];
+    ssize_t n = ::recv(connection.fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return true;
+    }
+    if (n <= 0) {
+        return false;
+    }
+    connection.buffer.append(chunk, static_cast<size_t>(n));
+
+    size_t newline;
+    while ((newline = connection.buffer.find('\n')) != std::string::npos && !stopping_) {
+        json response;
+        try {
+            response = handle(json::parse(connection.buffer.begin(),
+                                          connection.buffer.begin() + newline));
+        } catch (const json::exception& e) {
+            response = {{"error", std::string("Malformed request: ") + e.what()}};
+        } catch (const std::exception& e) {
+            response = {{"error", std::string("Request failed: ") + e.what()}};
+        }
+        connection.buffer.erase(0, newline + 1);
+        if (!sendAll(connection.fd, line(response))) {
+            return false;
+        }
+    }
+    return !stopping_ && connection.buffer.size() <= MAX_REQUEST;
+#else
+    (void)connection;
+    return false;
+#endif
+}
+
+void Daemon::work() {
+#ifndef _WIN32
+    for (;;) {
+        Connection connection;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueReady_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            connection = std::move(ready_.front());
+            ready_.pop_front();
+        }
+        if (!serve(connection)) {
+            ::close(connection.fd);
+            continue;
+        }
+        // Back to run() to wait for the next request
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            returned_.push_back(std::move(connection));
+        }
+        if (::write(wakePipe_[1], "x", 1) < 0) {
+            // The pipe is full, so run() is about to wake up anyway
+        }
+    }
+#endif
+}
+
+std::shared_ptr<PackageManagerAdapter> Daemon::adapterFor(PackageManager pm) {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    auto it = managers_.find(pm);
+    return it != managers_.end() ? it->second.adapter : nullptr;
+}
+
+DaemonClient::DaemonClient(std::string socketPath) : socketPath_(std::move(socketPath)) {}
+
+DaemonClient::~DaemonClient() {
+    disconnect();
+}
+
+bool DaemonClient::connect() {
+#ifdef _WIN32
+    return false;
+#else
+    if (fd_ >= 0) {
+        return true;
+    }
+    if (socketPath_.empty()) {
+        return false;
+    }
+    // Another user's socket could answer anything; only trust our own
+    struct stat st;
+    if (::lstat(socketPath_.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode) ||
+        st.st_uid != getuid()) {
+        return false;
+    }
+    fd_ = connectSocket(socketPath_);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    json response;
+    if (!call({{"op", "hello"}}, response, CONNECT_TIMEOUT_MS) || !response.contains("protocol") ||
+        response["protocol"] != Daemon::PROTOCOL) {
+        disconnect();
+        return false;
+    }
+    database_ = response.value("database", "");
+    return true;
+#endif
+}
+
+bool DaemonClient::servesDatabase(const std::string& path) const {
+    return connected() && !database_.empty() && database_ == canonicalPath(path);
+}
+
+bool DaemonClient::call(const json& request, json& response, int timeoutMs) {
+#ifdef _WIN32
+    (void)request;
+    (void)response;
+    (void)timeoutMs;
+    return false;
+#else
+    if (fd_ < 0) {
+        return false;
+    }
+    UNIPM_TRACE_SPAN(span, "unipmd", "ipc");
+    UNIPM_TRACE_ARG(span, "op", request.value("op", ""));
+
+    if (!sendAll(fd_, line(request))) {
+        disconnect();
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    size_t newline;
+    while ((newline = buffer_.find('\n')) == std::string::npos) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             deadline - std::chrono::steady_clock::now()).count();
+        pollfd pfd = {fd_, POLLIN, 0};
+        int ready = remaining > 0 ? ::poll(&pfd, 1, static_cast<int>(remaining)) : 0;
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        char chunk[16384];
+        ssize_t n = ready > 0 ? ::read(fd_, chunk, sizeof(chunk)) : 0;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            disconnect();  // Gone, or too slow to wait for
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(n));
+    }
+
+    try {
+        response = json::parse(buffer_.begin(), buffer_.begin() + newline);
+    } catch (const json::exception&) {
+        disconnect();
+        return false;
+    }
+    buffer_.erase(0, newline + 1);
+    return response.is_object() && !response.contains("error");
+#endif
+}
+
+bool DaemonClient::detect(const std::string& pm, OSInfo& os, PMInfo& info) {
+    json request = {{"op", "detect"}};
+    if (!pm.empty()) {
+        request["pm"] = pm;
+    }
+    json response;
+    if (!call(request, response)) {
+        return false;
+    }
+    try {
+        os = osFrom(response.at("os"));
+        info = PMInfo();
+        info.type = PackageManager::UNKNOWN;
+        if (response.at("pm").is_object()) {
+            info = pmFrom(response["pm"]);
+        }
+        return true;
+    } catch (const json::exception&) {
+        disconnect();
+        return false;
+    }
+}
+
+bool DaemonClient::resolve(const std::string& name, const std::string& version, PackageManager pm,
+                           bool check, ResolvedPackage& resolved) {
+    json response;
+    if (!call({{"op", "resolve"},
+               {"pm", packageManagerToString(pm)},
+               {"name", name},
+               {"version", version},
+               {"check", check}},
+              response)) {
+        return false;
+    }
+    try {
+        resolved = resolvedFrom(response.at("resolved"));
+        return true;
+    } catch (const json::exception&) {
+        disconnect();
+        return false;
+    }
+}
+
+bool DaemonClient::installed(const std::vector<std::string>& names, PackageManager pm,
+                             bool& tracked, std::vector<InstalledPackage>& packages) {
+    json response;
+    if (!call({{"op", "installed"}, {"pm", packageManagerToString(pm)}, {"names", names}},
+              response)) {
+        return false;
+    }
+    try {
+        tracked = response.at("tracked").get<bool>();
+        packages.clear();
+        for (const auto& pkg : response.at("packages")) {
+            packages.push_back(installedFrom(pkg));
+        }
+        return packages.size() == names.size();
+    } catch (const json::exception&) {
+        disconnect();
+        return false;
+    }
+}
+
+bool DaemonClient::list(PackageManager pm, bool& tracked, std::vector<InstalledPackage>& packages) {
+    json response;
+    if (!call({{"op", "list"}, {"pm", packageManagerToString(pm)}}, response)) {
+        return false;
+    }
+    try {
+        tracked = response.at("tracked").get<bool>();
+        packages.clear();
+        for (const auto& pkg : response.at("packages")) {
+            packages.push_back(installedFrom(pkg));
+        }
+        return true;
+    } catch (const json::exception&) {
+        disconnect();
+        return false;
+    }
+}
+
+bool DaemonClient::search(const std::string& query, PackageManager pm, bool& supported,
+                          std::vector<AvailablePackage>& results) {
+    json response;
+    if (!call({{"op", "search"}, {"pm", packageManagerToString(pm)}, {"query", query}},
+              response)) {
+        return false;
+    }
+    try {
+        supported = response.at("supported").get<bool>();
+        results.clear();
+        for (const auto& pkg : response.at("packages")) {
+            results.push_back(availableFrom(pkg));
+        }
+        return true;
+    } catch (const json::exception&) {
+        disconnect();
+        return false;
+    }
+}
+
+void DaemonClient::disconnect() {
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+    fd_ = -1;
+    buffer_.clear();
+}
+
+} // namespace unipm
@@ -1,22 +1,397 @@
 #include "unipm/doctor.h"
+#include "unipm/doctor_probes.h"
+#include "unipm/adapter.h"
+#include "unipm/cache.h"
 #include "unipm/config.h"
+#include "unipm/events.h"
+#include "unipm/mirrors.h"
 #include "unipm/os_detector.h"
+#include "unipm/parallel.h"
 #include "unipm/pm_detector.h"
 #include "unipm/ui.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <cstdio>
 #include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <vector>
 
 #ifdef _WIN32
     #include <windows.h>
 #else
     #include <unistd.h>
     #include <sys/stat.h>
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <spawn.h>
+    #include <sys/socket.h>
+    #include <sys/wait.h>
+    #ifdef __linux__
+        #include <sys/sysmacros.h>
+    #endif
+
+extern char** environ;
 #endif
 
 namespace unipm {
 
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Bounds for doctor --perf: anything slower is flagged
+constexpr double SPAWN_BOUND_MS = 5.0;
+constexpr double SHELL_BOUND_MS = 10.0;
+constexpr double DATABASE_BOUND_MS = 100.0;
+constexpr double CACHE_IO_BOUND_MS = 10.0;
+constexpr double CONNECT_BOUND_MS = 300.0;
+constexpr int CONNECT_TIMEOUT_MS = 2000;
+
+const std::vector<PackageManager> MANAGERS = {
+    PackageManager::APT,
+    PackageManager::PACMAN,
+    PackageManager::BREW,
+    PackageManager::DNF,
+    PackageManager::WINGET,
+    PackageManager::CHOCOLATEY
+};
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::string formatMs(double ms) {
+    char buffer[32];
+    bool whole = ms == static_cast<double>(static_cast<long long>(ms));
+    std::snprintf(buffer, sizeof(buffer), ms < 10 && !whole ? "%.2f ms" : "%.0f ms", ms);
+    return buffer;
+}
+
+double median(std::vector<double> samples) {
+    if (samples.empty()) {
+        return -1.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Hosts serving each package manager's default repositories, for managers
+// whose configuration MirrorList can't read
+std::vector<std::string> mirrorHosts(PackageManager pm) {
+    switch (pm) {
+        case PackageManager::APT: return {"deb.debian.org", "archive.ubuntu.com"};
+        case PackageManager::PACMAN: return {"geo.mirror.pkgbuild.com"};
+        case PackageManager::BREW: return {"formulae.brew.sh", "ghcr.io"};
+        case PackageManager::DNF: return {"mirrors.fedoraproject.org"};
+        case PackageManager::WINGET: return {"cdn.winget.microsoft.com"};
+        case PackageManager::CHOCOLATEY: return {"community.chocolatey.org"};
+        default: return {};
+    }
+}
+
+// Host and port of an http, https or ftp URL; false for anything else
+// (cdrom:, file:) and for hosts left to PM variables
+bool parseEndpoint(const std::string& url, Endpoint& endpoint) {
+    size_t schemeEnd = url.find("://");
+    if (schemeEnd == std::string::npos) {
+        return false;
+    }
+    std::string scheme = url.substr(0, schemeEnd);
+    if (scheme == "https") {
+        endpoint.port = "443";
+    } else if (scheme == "http") {
+        endpoint.port = "80";
+    } else if (scheme == "ftp") {
+        endpoint.port = "21";
+    } else {
+        return false;
+    }
+
+    size_t hostStart = schemeEnd + 3;
+    std::string authority = url.substr(hostStart, url.find('/', hostStart) - hostStart);
+    size_t at = authority.rfind('@');
+    if (at != std::string::npos) {
+        authority.erase(0, at + 1);  // user:password@
+    }
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+        endpoint.port = authority.substr(colon + 1);
+        authority.resize(colon);
+    }
+    if (authority.size() > 2 && authority.front() == '[' && authority.back() == ']') {
+        authority = authority.substr(1, authority.size() - 2);
+    }
+    endpoint.host = authority;
+    return !endpoint.host.empty() && endpoint.host.find('$') == std::string::npos &&
+           !endpoint.port.empty();
+}
+
+void addEndpoint(std::vector<Endpoint>& endpoints, const Endpoint& endpoint) {
+    for (const auto& e : endpoints) {
+        if (e.host == endpoint.host && e.port == endpoint.port) {
+            return;
+        }
+    }
+    endpoints.push_back(endpoint);
+}
+
+#ifndef _WIN32
+std::string endpointName(const Endpoint& endpoint) {
+    return endpoint.port == "443" ? endpoint.host : endpoint.host + ":" + endpoint.port;
+}
+
+// Where package downloads connect to: the proxy when the environment sets
+// one, since direct connections are often blocked then; otherwise the
+// repository hosts of every detected package manager
+std::vector<Endpoint> downloadEndpoints(DoctorContext& context, bool& proxied) {
+    proxied = false;
+    for (const char* name : {"https_proxy", "HTTPS_PROXY", "http_proxy", "HTTP_PROXY"}) {
+        const char* value = std::getenv(name);
+        if (value == nullptr || *value == '\0') {
+            continue;
+        }
+        std::string url = value;
+        Endpoint proxy;
+        if (parseEndpoint(url.find("://") == std::string::npos ? "http://" + url : url, proxy)) {
+            proxied = true;
+            return {proxy};
+        }
+    }
+
+    std::vector<Endpoint> endpoints;
+    for (PackageManager pm : context.managers()) {
+        for (const auto& endpoint : repositoryEndpoints(pm)) {
+            addEndpoint(endpoints, endpoint);
+        }
+    }
+    return endpoints;
+}
+
+// Milliseconds to spawn a program and reap it, or -1
+double spawnMs(const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    
+    auto start = Clock::now();
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+        return -1.0;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsedMs(start) : -1.0;
+}
+
+std::string processName(long pid) {
+    std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
+    std::string name;
+    std::getline(comm, name);
+    return name;
+}
+
+// Holder of a lock on the file st describes, from the kernel's lock table;
+// for files unipm may not open (apt's are root's, mode 0640)
+long lockTableHolder(const struct stat& st) {
+#ifdef __linux__
+    std::ifstream locks("/proc/locks");
+    if (!locks) {
+        return LOCK_UNINSPECTABLE;
+    }
+    // "1: POSIX  ADVISORY  WRITE 1234 08:01:131090 0 EOF"; blocked waiters
+    // follow their lock as "1: -> POSIX ..."
+    std::string line;
+    while (std::getline(locks, line)) {
+        std::istringstream fields(line);
+        std::string id, kind, mode, access, file;
+        long pid = 0;
+        if (!(fields >> id >> kind) || kind == "->" ||
+            !(fields >> mode >> access >> pid >> file)) {
+            continue;
+        }
+        unsigned int maj = 0;
+        unsigned int min = 0;
+        unsigned long inode = 0;
+        if (std::sscanf(file.c_str(), "%x:%x:%lu", &maj, &min, &inode) == 3 &&
+            inode == static_cast<unsigned long>(st.st_ino) && maj == major(st.st_dev) &&
+            min == minor(st.st_dev)) {
+            return pid > 0 ? pid : -1;
+        }
+    }
+    return 0;
+#else
+    (void)st;
+    return LOCK_UNINSPECTABLE;
+#endif
+}
+#endif
+
+} // namespace
+
+#ifndef _WIN32
+double connectMs(const std::string& host, const std::string& port, int timeoutMs) {
+    auto start = Clock::now();
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        return -1.0;
+    }
+    
+    double result = -1.0;
+    for (addrinfo* ai = addresses; ai && result < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc != 0 && errno == EINPROGRESS) {
+            int remaining = timeoutMs - static_cast<int>(elapsedMs(start));
+            pollfd pfd{fd, POLLOUT, 0};
+            if (remaining > 0 && poll(&pfd, 1, remaining) == 1) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+                rc = error == 0 ? 0 : -1;
+            }
+        }
+        if (rc == 0) {
+            result = elapsedMs(start);
+        }
+        close(fd);
+    }
+    freeaddrinfo(addresses);
+    return result;
+}
+
+long lockHolder(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0 && errno == EACCES) {
+        return lockTableHolder(st);
+    }
+    if (fd >= 0) {
+        struct flock lock{};
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        int rc = fcntl(fd, F_GETLK, &lock);
+        close(fd);
+        if (rc == 0 && lock.l_type != F_UNLCK) {
+            return lock.l_pid > 0 ? lock.l_pid : -1;
+        }
+    }
+    
+    auto endsWith = [&path](const char* suffix) {
+        size_t len = std::char_traits<char>::length(suffix);
+        return path.size() >= len && path.compare(path.size() - len, len, suffix) == 0;
+    };
+    if (endsWith(".lck")) {
+        return -1;  // pacman: the file existing is the lock
+    }
+    if (endsWith(".pid")) {
+        std::ifstream file(path);
+        long pid = 0;
+        if (file >> pid && pid > 0 && (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM)) {
+            return pid;
+        }
+    }
+    return 0;
+}
+#endif
+
+std::vector<Endpoint> repositoryEndpoints(PackageManager pm, const std::string& root) {
+    std::vector<Endpoint> endpoints;
+    for (const auto& mirror : MirrorList::read(pm, root)) {
+        Endpoint endpoint;
+        if (mirror.configured && parseEndpoint(mirror.url, endpoint)) {
+            addEndpoint(endpoints, endpoint);
+        }
+    }
+    if (endpoints.empty()) {
+        for (const auto& host : mirrorHosts(pm)) {
+            addEndpoint(endpoints, {host, "443"});
+        }
+    }
+    return endpoints;
+}
+
+const OSInfo& DoctorContext::os() {
+    std::call_once(osOnce_, [this] { os_ = OSDetector().detect(); });
+    return os_;
+}
+
+const std::vector<PackageManager>& DoctorContext::managers() {
+    std::call_once(managersOnce_, [this] {
+        std::vector<char> found(MANAGERS.size(), 0);
+        parallelFor(MANAGERS.size(), [&found](size_t i) {
+            found[i] = PMDetector().isAvailable(MANAGERS[i]) ? 1 : 0;
+        });
+        for (size_t i = 0; i < MANAGERS.size(); ++i) {
+            if (found[i]) {
+                managers_.push_back(MANAGERS[i]);
+            }
+        }
+    });
+    return managers_;
+}
+
+bool DoctorContext::database(std::string& path, double& ms) {
+    std::call_once(databaseOnce_, [this] {
+        Config config;
+        databasePath_ = config.findDatabase();
+        auto start = Clock::now();
+        databaseLoaded_ = !databasePath_.empty() && config.load(databasePath_);
+        databaseMs_ = elapsedMs(start);
+        databasePackages_ = config.getAllPackageNames().size();
+    });
+    path = databasePath_;
+    ms = databaseMs_;
+    return databaseLoaded_;
+}
+
+// One section of output, collected while the check runs and printed after
+struct Doctor::Report {
+    struct Line {
+        bool isCheck;
+        std::string name;  // The note text, for notes
+        bool passed;
+        std::string message;
+    };
+    
+    std::string title;
+    std::vector<Line> lines;
+    bool passed = false;
+    double ms = 0.0;
+    
+    void check(const std::string& name, bool ok, const std::string& message = "") {
+        lines.push_back({true, name, ok, message});
+    }
+    void note(const std::string& text) { lines.push_back({false, text, true, ""}); }
+};
+
 void Doctor::printCheckResult(const std::string& check, bool passed, const std::string& message) {
+    if (Events::enabled()) {
+        Events::check(check, passed, message);
+        return;
+    }
+    
     if (passed) {
         std::cout << "✓ " << check;
         if (!message.empty()) {
@@ -32,8 +407,27 @@ void Doctor::printCheckResult(const std::string& check, bool passed, const std::
     }
 }
 
-bool Doctor::checkInstallation() {
-    std::cout << "\n=== Installation Check ===" << std::endl;
+void Doctor::printReport(const Report& report) {
+    if (Events::enabled()) {
+        Events::emit("doctor_section", {{"name", report.title},
+                                        {"passed", report.passed},
+                                        {"duration_ms", report.ms}});
+    } else {
+        std::cout << "\n=== " << report.title << " === (" << formatMs(report.ms) << ")"
+                  << std::endl;
+    }
+    
+    for (const auto& line : report.lines) {
+        if (line.isCheck) {
+            printCheckResult(line.name, line.passed, line.message);
+        } else {
+            std::cout << line.name << std::endl;
+        }
+    }
+}
+
+bool Doctor::checkInstallation(Report& report) {
+    report.title = "Installation Check";
     
     // Get executable path
     std::string exePath;
@@ -52,20 +446,20 @@ bool Doctor::checkInstallation() {
         exePath = "unknown";
     }
 #endif
-    
-    printCheckResult("unipm binary found", true, exePath);
-    printCheckResult("Version", true, "1.0.0");
+
+    report.check("unipm binary found", true, exePath);
+    report.check("Version", true, "1.0.0");
     
     return true;
 }
 
-bool Doctor::checkPath() {
-    std::cout << "\n=== PATH Configuration ===" << std::endl;
+bool Doctor::checkPath(Report& report) {
+    report.title = "PATH Configuration";
     
     // Check if unipm is in PATH
     const char* pathEnv = std::getenv("PATH");
     if (!pathEnv) {
-        printCheckResult("PATH environment variable", false, "Not found");
+        report.check("PATH environment variable", false, "Not found");
         return false;
     }
     
@@ -77,98 +471,74 @@ bool Doctor::checkPath() {
         "/usr/bin",
         std::string(std::getenv("HOME") ? std::getenv("HOME") : "") + "/.local/bin"
     };
-    
+
 #ifdef _WIN32
     expectedPaths = {
         "C:\\Program Files\\unipm",
         std::string(std::getenv("LOCALAPPDATA") ? std::getenv("LOCALAPPDATA") : "") + "\\unipm"
     };
 #endif
-    
+
     bool foundInPath = false;
     for (const auto& dir : expectedPaths) {
         if (!dir.empty() && pathStr.find(dir) != std::string::npos) {
-            printCheckResult("PATH configured", true, "Found in " + dir);
+            report.check("PATH configured", true, "Found in " + dir);
             foundInPath = true;
             break;
         }
     }
     
     if (!foundInPath) {
-        printCheckResult("PATH configured", false, "unipm directory not in PATH");
-        std::cout << "  ℹ Add unipm directory to your PATH" << std::endl;
+        report.check("PATH configured", false, "unipm directory not in PATH");
+        report.note("  ℹ Add unipm directory to your PATH");
     }
     
     return foundInPath;
 }
 
-bool Doctor::checkPackageManagers() {
-    std::cout << "\n=== Package Managers ===" << std::endl;
-    
-    OSDetector osDetector;
-    OSInfo osInfo = osDetector.detect();
+bool Doctor::checkPackageManagers(Context& context, Report& report) {
+    report.title = "Package Managers";
     
-    std::cout << "  OS: " << osTypeToString(osInfo.type);
+    const OSInfo& osInfo = context.os();
+    std::string os = "  OS: " + osTypeToString(osInfo.type);
     if (osInfo.type == OSType::LINUX) {
-        std::cout << " (" << linuxDistroToString(osInfo.distro) << ")";
+        os += " (" + linuxDistroToString(osInfo.distro) + ")";
     }
-    std::cout << std::endl;
-    
-    PMDetector pmDetector;
-    
-    // Check for common package managers
-    std::vector<PackageManager> managers = {
-        PackageManager::APT,
-        PackageManager::PACMAN,
-        PackageManager::BREW,
-        PackageManager::DNF,
-        PackageManager::WINGET,
-        PackageManager::CHOCOLATEY
-    };
+    report.note(os);
     
-    int foundCount = 0;
+    const auto& managers = context.managers();
     for (const auto& pm : managers) {
-        if (pmDetector.isAvailable(pm)) {
-            std::string pmName = packageManagerToString(pm);
-            printCheckResult(pmName + " available", true);
-            foundCount++;
-        }
+        report.check(packageManagerToString(pm) + " available", true);
     }
     
-    if (foundCount == 0) {
-        printCheckResult("Package managers", false, "No package managers found");
+    if (managers.empty()) {
+        report.check("Package managers", false, "No package managers found");
         return false;
     }
     
-    printCheckResult("Total package managers found", true, std::to_string(foundCount));
+    report.check("Total package managers found", true, std::to_string(managers.size()));
     return true;
 }
 
-bool Doctor::checkDatabase() {
-    std::cout << "\n=== Package Database ===" << std::endl;
-    
-    auto config = std::make_shared<Config>();
-    
-    bool loaded = config->loadDefault();
-    if (!loaded) {
-        loaded = config->load("data/packages.json");
-    }
-    
-    if (loaded) {
-        // Count packages (simplified - would need to access internal data)
-        printCheckResult("Package database loaded", true);
-        printCheckResult("Database location", true, "Default location");
-    } else {
-        printCheckResult("Package database", false, "Failed to load");
-        std::cout << "  ℹ Package database not found at expected locations" << std::endl;
+bool Doctor::checkDatabase(Context& context, Report& report) {
+    report.title = "Package Database";
+    
+    std::string path;
+    double ms = 0.0;
+    if (!context.database(path, ms)) {
+        report.check("Package database", false, "Failed to load");
+        report.note("  ℹ Package database not found at expected locations");
         return false;
     }
     
+    report.check("Package database loaded", true,
+                 std::to_string(context.databasePackages()) + " packages in " + formatMs(ms));
+    report.check("Database location", true, path);
     return true;
 }
 
-bool Doctor::checkConfig() {
-    std::cout << "\n=== Configuration ===" << std::endl;
+bool Doctor::checkConfig(Report& report) {
+    report.title = "Configuration";
     
     // Check for user config file
     std::string configPath;
@@ -183,28 +553,59 @@ bool Doctor::checkConfig() {
         configPath = std::string(home) + "/.config/unipm/packages.json";
     }
 #endif
-    
+
     std::ifstream configFile(configPath);
     if (configFile.good()) {
-        printCheckResult("User config file", true, configPath);
+        report.check("User config file", true, configPath);
     } else {
-        printCheckResult("User config file", true, "Not found (using defaults)");
+        report.check("User config file", true, "Not found (using defaults)");
     }
     
     return true;
 }
 
-bool Doctor::checkNetwork() {
-    std::cout << "\n=== Network Connectivity ===" << std::endl;
-    
-    // Simple check - try to resolve a hostname
-    // This is a simplified check
-    printCheckResult("Network access", true, "Assumed available");
+bool Doctor::checkNetwork(Context& context, Report& report) {
+    report.title = "Network Connectivity";
+
+#ifdef _WIN32
+    (void)context;
+    report.check("Network access", true, "Not checked on Windows");
+    report.note("  ℹ To test package manager connectivity, try:");
+    report.note("    unipm update");
+    return true;
+#else
+    bool proxied = false;
+    std::vector<Endpoint> endpoints = downloadEndpoints(context, proxied);
+    if (endpoints.empty()) {
+        report.check("Network access", true, "No package repositories to reach");
+        return true;
+    }
     
-    std::cout << "  ℹ To test package manager connectivity, try:" << std::endl;
-    std::cout << "    unipm update" << std::endl;
+    std::vector<double> results(endpoints.size());
+    parallelFor(endpoints.size(), [&](size_t i) {
+        results[i] = connectMs(endpoints[i].host, endpoints[i].port, CONNECT_TIMEOUT_MS);
+    });
     
+    if (proxied) {
+        std::string proxy = "Proxy " + endpointName(endpoints[0]);
+        report.check("Network access", results[0] >= 0,
+                     proxy + (results[0] >= 0 ? " reachable" : " unreachable"));
+        return results[0] >= 0;
+    }
+    size_t reachable = 0;
+    for (double ms : results) {
+        reachable += ms >= 0 ? 1 : 0;
+    }
+    if (reachable == 0) {
+        report.check("Network access", false, "No package repository host reachable");
+        report.note("  ℹ Check your network or proxy; 'unipm doctor --perf' times each host");
+        return false;
+    }
+    report.check("Network access", true,
+                 std::to_string(reachable) + "/" + std::to_string(endpoints.size()) +
+                     " repository hosts reachable");
     return true;
+#endif
 }
 
 int Doctor::runDiagnostics() {
@@ -212,20 +613,39 @@ int Doctor::runDiagnostics() {
     std::cout << "  unipm doctor - System Diagnostics" << std::endl;
     std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << std::endl;
     
-    bool installOk = checkInstallation();
-    bool pathOk = checkPath();
-    bool pmOk = checkPackageManagers();
-    bool dbOk = checkDatabase();
-    bool configOk = checkConfig();
-    bool netOk = checkNetwork();
+    Context context;
+    const std::vector<std::function<bool(Report&)>> checks = {
+        checkInstallation,
+        checkPath,
+        [&context](Report& report) { return checkPackageManagers(context, report); },
+        [&context](Report& report) { return checkDatabase(context, report); },
+        checkConfig,
+        [&context](Report& report) { return checkNetwork(context, report); },
+    };
     
-    std::cout << "\n=== Summary ===" << std::endl;
+    // Every check at once; output is collected per check and printed in order
+    auto start = Clock::now();
+    std::vector<Report> reports(checks.size());
+    parallelFor(checks.size(), [&](size_t i) {
+        auto checkStart = Clock::now();
+        reports[i].passed = checks[i](reports[i]);
+        reports[i].ms = elapsedMs(checkStart);
+    }, checks.size());
+    double totalMs = elapsedMs(start);
+    
+    int passedChecks = 0;
+    for (const auto& report : reports) {
+        printReport(report);
+        passedChecks += report.passed ? 1 : 0;
+    }
     
-    int totalChecks = 6;
-    int passedChecks = (installOk ? 1 : 0) + (pathOk ? 1 : 0) + (pmOk ? 1 : 0) + 
-                       (dbOk ? 1 : 0) + (configOk ? 1 : 0) + (netOk ? 1 : 0);
+    std::cout << "\n=== Summary ===" << std::endl;
     
-    std::cout << "Checks passed: " << passedChecks << "/" << totalChecks << std::endl;
+    int totalChecks = static_cast<int>(reports.size());
+    std::cout << "Checks passed: " << passedChecks << "/" << totalChecks << " in "
+              << formatMs(totalMs) << std::endl;
+    Events::emit("doctor", {{"passed", passedChecks}, {"total", totalChecks},
+                            {"duration_ms", totalMs}});
     
     if (passedChecks == totalChecks) {
         std::cout << "\n✓ All checks passed! unipm is ready to use." << std::endl;
@@ -237,4 +657,228 @@ int Doctor::runDiagnostics() {
     }
 }
 
+bool Doctor::measureSpawn(Report& report) {
+    report.title = "Process Spawning";
+
+#ifdef _WIN32
+    report.note("  (not measured on Windows)");
+    return true;
+#else
+    // Every package manager operation and PM probe starts with this cost
+    std::vector<double> direct;
+    std::vector<double> shell;
+    for (int i = 0; i < 20; ++i) {
+        double ms = spawnMs({"true"});
+        if (ms >= 0) direct.push_back(ms);
+        ms = spawnMs({"sh", "-c", ":"});
+        if (ms >= 0) shell.push_back(ms);
+    }
+    if (direct.empty() || shell.empty()) {
+        report.check("Process spawn", false, "Could not spawn 'true' or 'sh'");
+        return false;
+    }
+    
+    double directMs = median(direct);
+    double shellMs = median(shell);
+    bool ok = true;
+    report.check("Process spawn", directMs <= SPAWN_BOUND_MS,
+                 formatMs(directMs) + " median (bound " + formatMs(SPAWN_BOUND_MS) + ")");
+    ok = ok && directMs <= SPAWN_BOUND_MS;
+    report.check("Shell spawn", shellMs <= SHELL_BOUND_MS,
+                 formatMs(shellMs) + " median (bound " + formatMs(SHELL_BOUND_MS) + ")");
+    ok = ok && shellMs <= SHELL_BOUND_MS;
+    if (!ok) {
+        report.note("  ℹ Slow spawns usually mean a loaded host, security agents or a slow $PATH");
+    }
+    return ok;
+#endif
+}
+
+bool Doctor::measureDatabase(Context& context, Report& report) {
+    report.title = "Package Database";
+    
+    std::string path;
+    double ms = 0.0;
+    if (!context.database(path, ms)) {
+        report.check("Database load", false, "No package database found");
+        return false;
+    }
+    
+    bool ok = ms <= DATABASE_BOUND_MS;
+    report.check("Database load", ok,
+                 formatMs(ms) + " for " + std::to_string(context.databasePackages()) +
+                     " packages (bound " + formatMs(DATABASE_BOUND_MS) + ")");
+    report.note("  " + path);
+    return ok;
+}
+
+bool Doctor::measureCacheIO(Report& report) {
+    report.title = "Cache Directory";
+    
+    // Indexes, inventory and history are all rewritten here, one file at a time
+    const std::string path = Cache::pathFor("doctor-probe.tmp");
+    if (!Cache::ensureDirectory()) {
+        report.check("Cache directory", false, "Cannot create " + Cache::getDirectory());
+        return false;
+    }
+    
+    const std::string data(4096, 'x');
+    std::vector<double> samples;
+    for (int i = 0; i < 10; ++i) {
+        auto start = Clock::now();
+        std::string readBack;
+        if (!Cache::writeAtomic(path, data) || !Cache::readFile(path, readBack) ||
+            readBack != data) {
+            std::remove(path.c_str());
+            report.check("Cache directory I/O", false, "Cannot write " + Cache::getDirectory());
+            return false;
+        }
+        samples.push_back(elapsedMs(start));
+    }
+    std::remove(path.c_str());
+    
+    double ms = median(samples);
+    bool ok = ms <= CACHE_IO_BOUND_MS;
+    report.check("Cache directory I/O", ok,
+                 formatMs(ms) + " per 4 KiB write and read (bound " +
+                     formatMs(CACHE_IO_BOUND_MS) + ")");
+    report.note("  " + Cache::getDirectory());
+    if (!ok) {
+        report.note("  ℹ A network or encrypted home directory? Set UNIPM_CACHE_DIR to local disk");
+    }
+    return ok;
+}
+
+bool Doctor::measureLocks(Context& context, Report& report) {
+    report.title = "Package Manager Locks";
+
+#ifdef _WIN32
+    (void)context;
+    report.note("  (not measured on Windows)");
+    return true;
+#else
+    bool ok = true;
+    size_t checked = 0;
+    std::vector<std::string> uninspectable;
+    for (PackageManager pm : context.managers()) {
+        auto adapter = AdapterFactory::create(pm);
+        if (!adapter) {
+            continue;
+        }
+        for (const auto& path : adapter->getLockPaths()) {
+            ++checked;
+            long holder = lockHolder(path);
+            if (holder == 0) {
+                continue;
+            }
+            if (holder == LOCK_UNINSPECTABLE) {
+                uninspectable.push_back(path);
+                continue;
+            }
+            ok = false;
+            std::string by = holder > 0 ? "held by PID " + std::to_string(holder) : "held";
+            std::string name = holder > 0 ? processName(holder) : "";
+            if (!name.empty()) {
+                by += " (" + name + ")";
+            }
+            report.check(packageManagerToString(pm) + " lock", false, path + " " + by);
+        }
+    }
+    
+    if (ok) {
+        std::string summary = std::to_string(checked - uninspectable.size()) + " free";
+        if (!uninspectable.empty()) {
+            summary += ", " + std::to_string(uninspectable.size()) +
+                       " not inspectable without root";
+        }
+        report.check("Package manager locks", true, checked == 0 ? "Nothing to check" : summary);
+    }
+    for (const auto& path : uninspectable) {
+        report.note("  ℹ " + path + ": cannot inspect without root");
+    }
+    if (!ok) {
+        report.note("  ℹ Installs will wait for or fail on these locks until they are released");
+    }
+    return ok;
+#endif
+}
+
+bool Doctor::measureMirrors(Context& context, Report& report) {
+    report.title = "Mirror Reachability";
+
+#ifdef _WIN32
+    (void)context;
+    report.note("  (not measured on Windows)");
+    return true;
+#else
+    bool proxied = false;
+    std::vector<Endpoint> endpoints = downloadEndpoints(context, proxied);
+    if (endpoints.empty()) {
+        report.check("Mirrors", true, "No package repositories to reach");
+        return true;
+    }
+    
+    // DNS lookup and TCP handshake, all hosts at once
+    std::vector<double> results(endpoints.size());
+    parallelFor(endpoints.size(), [&](size_t i) {
+        results[i] = connectMs(endpoints[i].host, endpoints[i].port, CONNECT_TIMEOUT_MS);
+    });
+    
+    bool ok = true;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        std::string name = (proxied ? "proxy " : "") + endpointName(endpoints[i]);
+        if (results[i] < 0) {
+            report.check(name, false, "unreachable within " + formatMs(CONNECT_TIMEOUT_MS));
+            ok = false;
+        } else {
+            bool fast = results[i] <= CONNECT_BOUND_MS;
+            report.check(name, fast,
+                         formatMs(results[i]) + " to connect (bound " +
+                             formatMs(CONNECT_BOUND_MS) + ")");
+            ok = ok && fast;
+        }
+    }
+    return ok;
+#endif
+}
+
+int Doctor::runPerformanceProfile() {
+    std::cout << "\n━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << std::endl;
+    std::cout << "  unipm doctor --perf - Performance Profile" << std::endl;
+    std::cout << "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" << std::endl;
+    
+    Context context;
+    const std::vector<std::function<bool(Report&)>> measurements = {
+        measureSpawn,
+        [&context](Report& report) { return measureDatabase(context, report); },
+        measureCacheIO,
+        [&context](Report& report) { return measureLocks(context, report); },
+        [&context](Report& report) { return measureMirrors(context, report); },
+    };
+    
+    // One after another, so the measurements don't compete for the CPU and disk
+    int flagged = 0;
+    for (const auto& measure : measurements) {
+        Report report;
+        auto start = Clock::now();
+        report.passed = measure(report);
+        report.ms = elapsedMs(start);
+        printReport(report);
+        for (const auto& line : report.lines) {
+            flagged += line.isCheck && !line.passed ? 1 : 0;
+        }
+    }
+    
+    std::cout << "\n=== Summary ===" << std::endl;
+    Events::emit("doctor_perf", {{"flagged", flagged}});
+    
+    if (flagged == 0) {
+        std::cout << "\n✓ Everything is within expected bounds." << std::endl;
+        return 0;
+    }
+    std::cout << "\n⚠ " << flagged << (flagged == 1 ? " measurement is" : " measurements are")
+              << " outside expected bounds. See above for details." << std::endl;
+    return 1;
+}
+
 } // namespace unipm
@@ -0,0 +1,162 @@
+#include "unipm/dpkg_status.h"
+#include "unipm/deb822.h"
+#include "unipm/trace.h"
+#include <cstdlib>
+
+namespace unipm {
+
+bool DpkgEntry::isInstalled() const {
+    // Status is "<want> <flag> <state>"; only fully installed packages count
+    size_t lastSpace = status.rfind(' ');
+    std::string_view state = (lastSpace == std::string_view::npos)
+                                 ? status
+                                 : status.substr(lastSpace + 1);
+    return state == "installed";
+}
+
+bool DpkgStatus::load(const std::string& path) {
+    UNIPM_TRACE_SCOPE("DpkgStatus::load", "index");
+    entries_.clear();
+    installed_.clear();
+
+    if (!file_.open(path)) {
+        return false;
+    }
+
+    parse(file_.view());
+    return true;
+}
+
+bool DpkgStatus::loadExtendedStates(const std::string& path) {
+    autoInstalled_.clear();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    std::string_view package;
+    std::string_view architecture;
+    bool isAuto = false;
+    deb822::parse(
+        file.view(),
+        [&](std::string_view key, std::string_view value) {
+            if (key == "Package") {
+                package = value;
+            } else if (key == "Architecture") {
+                architecture = value;
+            } else if (key == "Auto-Installed") {
+                isAuto = (value == "1");
+            }
+        },
+        [&]() {
+            if (isAuto && !package.empty()) {
+                autoInstalled_.insert(std::string(package) + ":" + std::string(architecture));
+            }
+            package = {};
+            architecture = {};
+            isAuto = false;
+        });
+
+    return true;
+}
+
+void DpkgStatus::parse(std::string_view contents) {
+    DpkgEntry current;
+
+    deb822::parse(
+        contents,
+        [&](std::string_view key, std::string_view value) {
+            // Compare on length first; most fields are irrelevant here
+            switch (key.size()) {
+                case 6:
+                    if (key == "Status") current.status = value;
+                    break;
+                case 7:
+                    if (key == "Package") current.name = value;
+                    else if (key == "Version") current.version = value;
+                    else if (key == "Section") current.section = value;
+                    break;
+                case 11:
+                    if (key == "Description") current.description = value;
+                    break;
+                case 12:
+                    if (key == "Architecture") current.architecture = value;
+                    break;
+                case 14:
+                    if (key == "Installed-Size") current.installedSize = value;
+                    break;
+                default:
+                    break;
+            }
+        },
+        [&]() {
+            if (!current.name.empty()) {
+                entries_.push_back(current);
+                if (current.isInstalled()) {
+                    // Multi-arch packages appear once per architecture; keep the first
+                    installed_.emplace(current.name, entries_.size() - 1);
+                }
+            }
+            current = DpkgEntry();
+        });
+}
+
+const DpkgEntry* DpkgStatus::find(std::string_view name) const {
+    // Accept "name:arch" as printed by apt and dpkg-query
+    auto it = installed_.find(name);
+    if (it == installed_.end()) {
+        size_t colon = name.find(':');
+        if (colon == std::string_view::npos) {
+            return nullptr;
+        }
+        it = installed_.find(name.substr(0, colon));
+        if (it == installed_.end()) {
+            return nullptr;
+        }
+    }
+    return &entries_[it->second];
+}
+
+bool DpkgStatus::isAutoInstalled(std::string_view name, std::string_view architecture) const {
+    if (autoInstalled_.empty()) {
+        return false;
+    }
+
+    std::string key(name);
+    key += ':';
+    // Old apt versions omit the architecture
+    if (autoInstalled_.count(key) > 0) {
+        return true;
+    }
+    key += architecture;
+    return autoInstalled_.count(key) > 0;
+}
+
+std::vector<InstalledPackage> DpkgStatus::installedPackages() const {
+    std::vector<InstalledPackage> packages;
+    packages.reserve(installed_.size());
+
+    for (const auto& entry : entries_) {
+        if (entry.isInstalled()) {
+            InstalledPackage pkg = toInstalledPackage(entry);
+            pkg.explicitlyInstalled = !isAutoInstalled(entry.name, entry.architecture);
+            packages.push_back(std::move(pkg));
+        }
+    }
+
+    return packages;
+}
+
+InstalledPackage DpkgStatus::toInstalledPackage(const DpkgEntry& entry) {
+    InstalledPackage pkg;
+    pkg.name = std::string(entry.name);
+    pkg.version = std::string(entry.version);
+    pkg.architecture = std::string(entry.architecture);
+    pkg.description = std::string(entry.description);
+    pkg.installedSize = std::strtoull(std::string(entry.installedSize).c_str(), nullptr, 10) * 1024;
+    pkg.packageManager = PackageManager::APT;
+    return pkg;
+}
+
+} // namespace unipm
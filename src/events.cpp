@@ -0,0 +1,211 @@
+#include "unipm/events.h"
+#include "unipm/history.h"
+#include "unipm/terminal.h"
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+
+using json = nlohmann::ordered_json;
+
+namespace unipm {
+
+bool Events::enabled_ = false;
+
+namespace {
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Turns each line written to std::cout into a "text" event
+class TextEventBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        line_.append(s, static_cast<size_t>(n));
+        size_t newline;
+        while ((newline = line_.find('\n')) != std::string::npos) {
+            std::string text = line_.substr(0, newline);
+            line_.erase(0, newline + 1);
+            if (!text.empty()) {
+                Events::emit("text", {{"text", text}});
+            }
+        }
+        return n;
+    }
+
+private:
+    std::mutex mutex_;
+    std::string line_;
+};
+
+json stepJson(const CommandStep& step) {
+    json env = json::object();
+    for (const auto& var : step.env) {
+        env[var.first] = var.second;
+    }
+    return {{"argv", step.argv},
+            {"env", env},
+            {"requires_root", step.requiresRoot},
+            {"lock", step.lockDomain},
+            {"depends_on_previous", step.dependsOnPrevious}};
+}
+
+} // namespace
+
+void Events::enable() {
+    enabled_ = true;
+    Terminal::instance().setFramed(true);
+
+    // Never destroyed: std::cout may be written to during exit
+    static TextEventBuffer* text = new TextEventBuffer();
+    std::cout.rdbuf(text);
+}
+
+void Events::emit(const std::string& type, json fields) {
+    if (!enabled_) {
+        return;
+    }
+    json event = {{"event", type}, {"ts", nowMs()}};
+    for (auto& field : fields.items()) {
+        event[field.key()] = std::move(field.value());
+    }
+    // PM output isn't always valid UTF-8
+    Terminal::instance().relay(event.dump(-1, ' ', false, json::error_handler_t::replace) + "\n");
+}
+
+void Events::message(const std::string& level, const std::string& text) {
+    emit("message", {{"level", level}, {"text", text}});
+}
+
+void Events::detection(const OSInfo& os, const PMInfo& pm) {
+    emit("detection", {{"os", osTypeToString(os.type)},
+                       {"distro", linuxDistroToString(os.distro)},
+                       {"os_version", os.version},
+                       {"pm", packageManagerToString(pm.type)},
+                       {"pm_path", pm.path},
+                       {"pm_version", pm.version}});
+}
+
+void Events::resolution(const ResolvedPackage& pkg) {
+    emit("resolution", {{"name", pkg.originalName},
+                        {"resolved", pkg.resolvedName},
+                        {"version", pkg.version},
+                        {"pm", packageManagerToString(pkg.packageManager)},
+                        {"confidence", pkg.confidence},
+                        {"available", pkg.available},
+                        {"suggestions", pkg.suggestions}});
+}
+
+void Events::plan(const CommandPlan& plan, bool dryRun) {
+    if (!enabled_) {
+        return;
+    }
+    json steps = json::array();
+    for (const auto& step : plan.steps) {
+        steps.push_back(stepJson(step));
+    }
+    emit("plan", {{"command", plan.toString()},
+                  {"requires_root", plan.requiresRoot()},
+                  {"dry_run", dryRun},
+                  {"steps", std::move(steps)}});
+}
+
+void Events::prompt(const std::string& message, bool defaultYes) {
+    emit("prompt", {{"text", message}, {"default", defaultYes}});
+    flush();  // An answer is expected on stdin
+}
+
+void Events::output(std::string_view chunk, const char* stream) {
+    emit("output", {{"stream", stream}, {"data", std::string(chunk)}});
+}
+
+void Events::result(const ExecutionResult& result, double seconds) {
+    auto usage = [](const ProcessUsage& u) {
+        json fields = {{"wall_s", u.wallSeconds},
+                       {"user_s", u.userSeconds},
+                       {"sys_s", u.systemSeconds},
+                       {"max_rss_kb", u.maxRssKb},
+                       {"in_blocks", u.blockReads},
+                       {"out_blocks", u.blockWrites},
+                       {"nvcsw", u.voluntarySwitches},
+                       {"nivcsw", u.involuntarySwitches}};
+        if (!u.command.empty()) {
+            fields["command"] = u.command;
+        }
+        return fields;
+    };
+    json processes = json::array();
+    for (const auto& process : result.processes) {
+        processes.push_back(usage(process));
+    }
+    emit("result", {{"success", result.success},
+                    {"exit_code", result.exitCode},
+                    {"timed_out", result.timedOut},
+                    {"duration_s", seconds},
+                    {"busy_s", result.busySeconds},
+                    {"usage", usage(result.usage)},
+                    {"processes", std::move(processes)}});
+    flush();
+}
+
+void Events::installed(const InstalledPackage& pkg) {
+    emit("installed", {{"name", pkg.name},
+                       {"version", pkg.version},
+                       {"arch", pkg.architecture},
+                       {"description", pkg.description},
+                       {"size", pkg.installedSize},
+                       {"explicit", pkg.explicitlyInstalled},
+                       {"pm", packageManagerToString(pkg.packageManager)}});
+}
+
+void Events::available(const AvailablePackage& pkg) {
+    emit("available", {{"name", pkg.name},
+                       {"version", pkg.version},
+                       {"section", pkg.section},
+                       {"description", pkg.description},
+                       {"size", pkg.size},
+                       {"pm", packageManagerToString(pkg.packageManager)}});
+}
+
+void Events::search(const SearchOutcome& outcome) {
+    emit("search", {{"pm", packageManagerToString(outcome.packageManager)},
+                    {"success", outcome.success},
+                    {"timed_out", outcome.timedOut},
+                    {"results", outcome.results.size()},
+                    {"duration_s", outcome.seconds}});
+}
+
+void Events::history(const HistoryRecord& record) {
+    emit("history", {{"time", record.timestampMs},
+                     {"action", record.action},
+                     {"pm", record.packageManager},
+                     {"packages", record.packages},
+                     {"command", record.command},
+                     {"duration_s", record.durationSeconds},
+                     {"exit_code", record.exitCode},
+                     {"success", record.success}});
+}
+
+void Events::check(const std::string& name, bool passed, const std::string& message) {
+    emit("check", {{"name", name}, {"passed", passed}, {"message", message}});
+}
+
+void Events::flush() {
+    if (enabled_) {
+        Terminal::instance().flush();
+    }
+}
+
+} // namespace unipm
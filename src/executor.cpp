@@ -2,21 +2,150 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
+#include <algorithm>
 #include <array>
 #include <iostream>
 
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
+
+extern char** environ;
 #endif
 
-#include "unipm/safety.h"
+#include "unipm/events.h"
+#include "unipm/history.h"
+#include "unipm/parallel.h"
+#include "unipm/terminal.h"
+#include "unipm/trace.h"
 
 namespace unipm {
 
+#ifdef _WIN32
+namespace {
+
+// Live output from a child, to the embedder's handler, as text or as events
+void relayOutput(const std::function<void(std::string_view)>& handler, std::string_view chunk,
+                 bool isStderr) {
+    if (handler) {
+        handler(chunk);
+    } else if (Events::enabled()) {
+        Events::output(chunk, isStderr ? "stderr" : "stdout");
+    } else if (isStderr) {
+        Terminal::instance().writeError(chunk);
+    } else {
+        Terminal::instance().relay(chunk);
+    }
+}
+
+} // namespace
+#else
+namespace {
+
+double toSeconds(const struct timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int64_t toKb(long maxRss) {
+#ifdef __APPLE__
+    return maxRss / 1024;  // Bytes on macOS
+#else
+    return maxRss;
+#endif
+}
+
+ProcessUsage toUsage(const struct rusage& usage) {
+    ProcessUsage result;
+    result.userSeconds = toSeconds(usage.ru_utime);
+    result.systemSeconds = toSeconds(usage.ru_stime);
+    result.maxRssKb = toKb(usage.ru_maxrss);
+    result.blockReads = usage.ru_inblock;
+    result.blockWrites = usage.ru_oublock;
+    result.voluntarySwitches = usage.ru_nvcsw;
+    result.involuntarySwitches = usage.ru_nivcsw;
+    return result;
+}
+
+} // namespace
+#endif
+
+// Wall clock and cumulative resource usage of waited-for children
+struct Executor::Usage {
+    int64_t timestampMs = 0;
+    std::chrono::steady_clock::time_point started;
+    double userSeconds = 0.0;
+    double systemSeconds = 0.0;
+    int64_t maxRssKb = 0;
+
+    static Usage sample() {
+        Usage usage;
+        usage.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+        usage.started = std::chrono::steady_clock::now();
+#ifndef _WIN32
+        struct rusage children;
+        if (getrusage(RUSAGE_CHILDREN, &children) == 0) {
+            usage.userSeconds = toSeconds(children.ru_utime);
+            usage.systemSeconds = toSeconds(children.ru_stime);
+            usage.maxRssKb = toKb(children.ru_maxrss);
+        }
+#endif
+        return usage;
+    }
+};
+
+void Executor::setHistoryContext(std::string action, PackageManager pm,
+                                 std::vector<std::string> packages) {
+    historyAction_ = std::move(action);
+    historyPm_ = pm;
+    historyPackages_ = std::move(packages);
+}
+
+void Executor::recordHistory(const ExecutionResult& result, const Usage& start) {
+    UNIPM_TRACE_SCOPE("Executor::recordHistory", "history");
+    Usage end = Usage::sample();
+
+    HistoryRecord record;
+    record.timestampMs = start.timestampMs;
+    record.action = historyAction_;
+    if (historyPm_ != PackageManager::UNKNOWN) {
+        record.packageManager = packageManagerToString(historyPm_);
+    }
+    record.packages = historyPackages_;
+    record.command = result.command;
+    record.durationSeconds = std::chrono::duration<double>(end.started - start.started).count();
+    record.exitCode = result.exitCode;
+    record.success = result.success;
+    if (!result.processes.empty()) {
+        record.userSeconds = result.usage.userSeconds;
+        record.systemSeconds = result.usage.systemSeconds;
+        record.maxRssKb = result.usage.maxRssKb;
+        record.blockReads = result.usage.blockReads;
+        record.blockWrites = result.usage.blockWrites;
+        record.voluntarySwitches = result.usage.voluntarySwitches;
+        record.involuntarySwitches = result.usage.involuntarySwitches;
+        record.processes = result.processes;
+    } else {
+        // Shell commands aren't waited for individually
+        record.userSeconds = end.userSeconds - start.userSeconds;
+        record.systemSeconds = end.systemSeconds - start.systemSeconds;
+        // The largest child reaped so far, which may predate this execution
+        record.maxRssKb = end.maxRssKb;
+    }
+    HistoryLog::instance().append(std::move(record));
+}
+
 ExecutionResult Executor::execute(const std::string& command, bool requiresRoot) {
     std::string finalCommand = command;
 
@@ -31,9 +160,7 @@ ExecutionResult Executor::execute(const std::string& command, bool requiresRoot)
     }
 #endif
 
-    // Log the operation
-    Safety::logOperation(finalCommand, false);
-
+    Usage start = Usage::sample();
     ExecutionResult result;
     result.command = finalCommand;
 
@@ -43,12 +170,158 @@ ExecutionResult Executor::execute(const std::string& command, bool requiresRoot)
     result = executeUnix(finalCommand);
 #endif
 
-    // Log success/failure
-    Safety::logOperation(finalCommand, result.success);
+    result.command = finalCommand;
+    if (result.processes.empty()) {
+        // popen() reaps the shell itself; all that's known is the change in
+        // the totals of every child
+        Usage end = Usage::sample();
+        result.usage.wallSeconds =
+            std::chrono::duration<double>(end.started - start.started).count();
+        result.usage.userSeconds = end.userSeconds - start.userSeconds;
+        result.usage.systemSeconds = end.systemSeconds - start.systemSeconds;
+    }
+    recordHistory(result, start);
+
+    return result;
+}
+
+ExecutionResult Executor::execute(const CommandPlan& plan) {
+    UNIPM_TRACE_SPAN(span, "Executor::execute", "exec");
+    UNIPM_TRACE_ARG(span, "steps", static_cast<int64_t>(plan.steps.size()));
+    const std::string description = plan.toString();
+    Usage start = Usage::sample();
+
+    ExecutionResult result;
+    result.success = true;
+    result.exitCode = 0;
+    result.command = description;
+
+    auto merge = [&result](const ExecutionResult& step) {
+        result.stdoutOutput += step.stdoutOutput;
+        result.stderrOutput += step.stderrOutput;
+        result.busySeconds += step.busySeconds;
+        result.usage.add(step.usage);
+        result.processes.insert(result.processes.end(), step.processes.begin(),
+                                step.processes.end());
+        if (!step.success && result.success) {
+            result.success = false;
+            result.exitCode = step.exitCode;
+        }
+    };
+
+#ifdef _WIN32
+    // cmd.exe handles quoting and PATHEXT lookup; run the steps in order
+    for (const auto& step : plan.steps) {
+        merge(executeWindows(step.toString()));
+        if (!result.success) break;
+    }
+#else
+    size_t next = 0;
+    while (next < plan.steps.size() && result.success) {
+        // A wave is a step plus the following steps allowed to overlap it
+        size_t end = next + 1;
+        std::vector<std::string> domains = {plan.steps[next].lockDomain};
+        while (end < plan.steps.size() && !plan.steps[end].dependsOnPrevious) {
+            const std::string& domain = plan.steps[end].lockDomain;
+            if (!domain.empty() && std::find(domains.begin(), domains.end(), domain) != domains.end()) {
+                break;
+            }
+            domains.push_back(domain);
+            end++;
+        }
+
+        // Resolve elevation and chunking up front; hasSudo() isn't thread-safe
+        const size_t count = end - next;
+        std::vector<std::vector<std::vector<std::string>>> invocations;
+        for (size_t i = next; i < end; ++i) {
+            invocations.push_back(expandStep(plan.steps[i]));
+        }
+
+        // A lone step streams its output; overlapping steps print theirs whole
+        const bool stream = count == 1;
+        std::vector<ExecutionResult> results(count);
+        parallelFor(
+            count,
+            [&](size_t k) {
+                ExecutionResult& stepResult = results[k];
+                stepResult.success = true;
+                stepResult.exitCode = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (const auto& argv : invocations[k]) {
+                    ExecutionResult run = spawn(argv, plan.steps[next + k].env, stream);
+                    stepResult.stdoutOutput += run.stdoutOutput;
+                    stepResult.stderrOutput += run.stderrOutput;
+                    stepResult.usage.add(run.usage);
+                    stepResult.processes.insert(stepResult.processes.end(),
+                                                run.processes.begin(), run.processes.end());
+                    if (!run.success) {
+                        stepResult.success = false;
+                        stepResult.exitCode = run.exitCode;
+                        break;
+                    }
+                }
+                stepResult.busySeconds =
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (!stream && outputHandler_) {
+                    // Handed over below, on the calling thread
+                } else if (!stream && Events::enabled()) {
+                    Events::output(stepResult.stdoutOutput);
+                } else if (!stream) {
+                    Terminal& terminal = Terminal::instance();
+                    terminal.write(stepResult.stdoutOutput);
+                    terminal.endGroup();
+                }
+            },
+            count);
+
+        for (const auto& stepResult : results) {
+            if (!stream && outputHandler_ && !stepResult.stdoutOutput.empty()) {
+                outputHandler_(stepResult.stdoutOutput);
+            }
+            merge(stepResult);
+        }
+        next = end;
+    }
+#endif
+
+    result.usage.wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start.started).count();
+    recordHistory(result, start);
+    return result;
+}
 
+ExecutionResult Executor::capture(const CommandStep& step, std::chrono::milliseconds timeout) {
+    ExecutionResult result;
+    result.success = true;
+    result.exitCode = 0;
+    result.command = step.toString();
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& argv : expandStep(step)) {
+        ExecutionResult run = spawn(argv, step.env, false, timeout);
+        result.stdoutOutput += run.stdoutOutput;
+        result.stderrOutput += run.stderrOutput;
+        result.usage.add(run.usage);
+        result.processes.insert(result.processes.end(), run.processes.begin(),
+                                run.processes.end());
+        if (!run.success) {
+            result.success = false;
+            result.exitCode = run.exitCode;
+            result.timedOut = run.timedOut;
+            break;
+        }
+    }
+    result.usage.wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     return result;
 }
 
+void Executor::preview(const CommandPlan& plan) {
+    for (const auto& step : plan.steps) {
+        preview(step.toString(), step.requiresRoot);
+    }
+}
+
 void Executor::preview(const std::string& command, bool requiresRoot) {
     std::string finalCommand = command;
 
@@ -67,7 +340,13 @@ bool Executor::hasSudo() {
 #ifdef _WIN32
     return false;
 #else
-    return system("which sudo >/dev/null 2>&1") == 0;
+    if (sudoState_ < 0) {
+        UNIPM_TRACE_SCOPE("sh: which sudo", "process");
+        UNIPM_TRACE_PROCESS_STARTED();
+        sudoState_ = system("which sudo >/dev/null 2>&1") == 0 ? 1 : 0;
+        UNIPM_TRACE_PROCESS_EXITED();
+    }
+    return sudoState_ == 1;
 #endif
 }
 
@@ -153,7 +432,7 @@ ExecutionResult Executor::executeWindows(const std::string& command) {
             if (bytesAvail > 0) {
                 if (ReadFile(hStdoutRead, buffer, std::min((DWORD)(sizeof(buffer) - 1), bytesAvail), &bytesRead, NULL) && bytesRead > 0) {
                     buffer[bytesRead] = '\0';
-                    std::cout << buffer << std::flush;
+                    relayOutput(outputHandler_, std::string_view(buffer, bytesRead), false);
                     result.stdoutOutput += buffer;
                 }
             }
@@ -163,7 +442,7 @@ ExecutionResult Executor::executeWindows(const std::string& command) {
             if (bytesAvail > 0) {
                 if (ReadFile(hStderrRead, buffer, std::min((DWORD)(sizeof(buffer) - 1), bytesAvail), &bytesRead, NULL) && bytesRead > 0) {
                     buffer[bytesRead] = '\0';
-                    std::cerr << buffer << std::flush;
+                    relayOutput(outputHandler_, std::string_view(buffer, bytesRead), true);
                     result.stderrOutput += buffer;
                 }
             }
@@ -174,16 +453,37 @@ ExecutionResult Executor::executeWindows(const std::string& command) {
         // Read any remaining output
         while (ReadFile(hStdoutRead, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
             buffer[bytesRead] = '\0';
-            std::cout << buffer << std::flush;
+            relayOutput(outputHandler_, std::string_view(buffer, bytesRead), false);
             result.stdoutOutput += buffer;
         }
 
         while (ReadFile(hStderrRead, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
             buffer[bytesRead] = '\0';
-            std::cerr << buffer << std::flush;
+            relayOutput(outputHandler_, std::string_view(buffer, bytesRead), true);
             result.stderrOutput += buffer;
         }
 
+        Terminal::instance().flush();
+
+        // cmd.exe's own CPU time and I/O; children outside a job object aren't counted
+        FILETIME created, exited, kernel, user;
+        if (GetProcessTimes(pi.hProcess, &created, &exited, &kernel, &user)) {
+            auto toSeconds = [](const FILETIME& time) {
+                return ((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) /
+                       1e7;
+            };
+            result.usage.wallSeconds = toSeconds(exited) - toSeconds(created);
+            result.usage.userSeconds = toSeconds(user);
+            result.usage.systemSeconds = toSeconds(kernel);
+        }
+        IO_COUNTERS io;
+        if (GetProcessIoCounters(pi.hProcess, &io)) {
+            result.usage.blockReads = static_cast<int64_t>(io.ReadOperationCount);
+            result.usage.blockWrites = static_cast<int64_t>(io.WriteOperationCount);
+        }
+        result.usage.command = command;
+        result.processes.push_back(result.usage);
+
         CloseHandle(pi.hProcess);
         CloseHandle(pi.hThread);
     } else {
@@ -195,6 +495,7 @@ ExecutionResult Executor::executeWindows(const std::string& command) {
 
     return result;
 #else
+    (void)command;  // Unused on non-Windows platforms
     ExecutionResult result;
     result.success = false;
     result.stderrOutput = "Windows execution not available on this platform";
@@ -209,15 +510,19 @@ ExecutionResult Executor::executeUnix(const std::string& command) {
 
     // Execute command and capture output
     std::string fullCommand = command + " 2>&1";
+    UNIPM_TRACE_SPAN(span, "sh", "process");
+    UNIPM_TRACE_RENAME(span, "sh: " + command);
     FILE* pipe = popen(fullCommand.c_str(), "r");
 
     if (!pipe) {
         result.stderrOutput = "Failed to execute command";
         return result;
     }
+    UNIPM_TRACE_PROCESS_STARTED();
 
     result.stdoutOutput = captureOutput(pipe);
     result.exitCode = pclose(pipe);
+    UNIPM_TRACE_PROCESS_EXITED();
 
     // pclose returns exit status in format that needs WEXITSTATUS macro
 #ifndef _WIN32
@@ -231,6 +536,265 @@ ExecutionResult Executor::executeUnix(const std::string& command) {
     return result;
 }
 
+std::vector<std::vector<std::string>> Executor::expandStep(const CommandStep& step) {
+    std::vector<std::string> prefix;
+#ifndef _WIN32
+    if (step.requiresRoot && !isAdmin() && hasSudo()) {
+        // sudo resets the environment; pass overrides through env(1)
+        prefix.push_back("sudo");
+        if (!step.env.empty()) {
+            prefix.push_back("env");
+            for (const auto& var : step.env) {
+                prefix.push_back(var.first + "=" + var.second);
+            }
+        }
+    }
+#endif
+
+    const size_t split = (step.operandIndex > 0 && step.operandIndex < step.argv.size())
+                             ? step.operandIndex
+                             : step.argv.size();
+    std::vector<std::string> fixed = prefix;
+    fixed.insert(fixed.end(), step.argv.begin(), step.argv.begin() + split);
+
+    if (split == step.argv.size()) {
+        return {fixed};
+    }
+
+    size_t limit = argumentLimit_;
+#ifndef _WIN32
+    if (limit == 0) {
+        // ARG_MAX covers argv and the environment together; keep some headroom
+        long argMax = sysconf(_SC_ARG_MAX);
+        limit = argMax > 0 ? static_cast<size_t>(argMax) : 128 * 1024;
+        for (char** e = environ; *e != nullptr; ++e) {
+            limit -= std::min(limit, std::strlen(*e) + 1 + sizeof(char*));
+        }
+        limit -= std::min(limit, static_cast<size_t>(4096));
+    }
+#else
+    if (limit == 0) {
+        limit = 32 * 1024;  // CreateProcess command-line limit
+    }
+#endif
+
+    auto cost = [](const std::string& arg) { return arg.size() + 1 + sizeof(char*); };
+    size_t fixedBytes = 0;
+    for (const auto& arg : fixed) {
+        fixedBytes += cost(arg);
+    }
+
+    std::vector<std::vector<std::string>> chunks;
+    std::vector<std::string> current = fixed;
+    size_t bytes = fixedBytes;
+    for (size_t i = split; i < step.argv.size(); ++i) {
+        const std::string& operand = step.argv[i];
+        // Always place at least one operand per invocation
+        if (current.size() > fixed.size() && bytes + cost(operand) > limit) {
+            chunks.push_back(std::move(current));
+            current = fixed;
+            bytes = fixedBytes;
+        }
+        current.push_back(operand);
+        bytes += cost(operand);
+    }
+    chunks.push_back(std::move(current));
+    return chunks;
+}
+
+ExecutionResult Executor::spawn(const std::vector<std::string>& argv,
+                                const std::vector<std::pair<std::string, std::string>>& env,
+                                bool stream, std::chrono::milliseconds timeout) {
+#ifdef _WIN32
+    (void)env;
+    (void)stream;
+    (void)timeout;
+    return executeWindows(CommandStep::query(argv).toString());
+#else
+    ExecutionResult result;
+    result.success = false;
+    result.exitCode = -1;
+
+    if (argv.empty()) {
+        result.stderrOutput = "Empty command";
+        return result;
+    }
+
+    // One span per child, named after the program, on the waiting thread's track
+    UNIPM_TRACE_SPAN(span, "spawn", "process");
+    UNIPM_TRACE_RENAME(span, argv[0] == "sudo" && argv.size() > 1 ? "sudo " + argv[1] : argv[0]);
+    UNIPM_TRACE_ARG(span, "argv", CommandStep::query(argv).toString());
+
+    // stdout and stderr share one pipe, as with "2>&1"
+    int fds[2];
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+#else
+    if (pipe(fds) != 0) {
+#endif
+        result.stderrOutput = "Failed to create pipe";
+        return result;
+    }
+#ifndef __linux__
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+    std::vector<char*> args;
+    for (const auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    // Environment overrides replace inherited variables of the same name
+    std::vector<std::string> envStrings;
+    std::vector<char*> envp;
+    char** envArg = environ;
+    if (!env.empty()) {
+        for (char** e = environ; *e != nullptr; ++e) {
+            bool overridden = false;
+            for (const auto& var : env) {
+                if (std::strncmp(*e, var.first.c_str(), var.first.size()) == 0 &&
+                    (*e)[var.first.size()] == '=') {
+                    overridden = true;
+                    break;
+                }
+            }
+            if (!overridden) envp.push_back(*e);
+        }
+        for (const auto& var : env) {
+            envStrings.push_back(var.first + "=" + var.second);
+        }
+        for (auto& entry : envStrings) {
+            envp.push_back(const_cast<char*>(entry.c_str()));
+        }
+        envp.push_back(nullptr);
+        envArg = envp.data();
+    }
+
+    // A child with a deadline gets its own process group so that anything
+    // it started can be killed along with it
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    if (timeout.count() > 0) {
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+
+    // Anything queued shows before the child can prompt on the terminal
+    if (stream) {
+        Terminal::instance().flush();
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    pid_t pid;
+    int rc = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), envArg);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+
+    if (rc != 0) {
+        close(fds[0]);
+        UNIPM_TRACE_ARG(span, "error", std::string(std::strerror(rc)));
+        result.exitCode = 127;
+        result.stderrOutput = argv[0] + ": " + std::strerror(rc);
+        if (outputHandler_) {
+            // Passed on like output of the child itself, as a shell would
+            result.stdoutOutput = result.stderrOutput + "\n";
+            if (stream) {
+                outputHandler_(result.stdoutOutput);
+            }
+        } else {
+            std::cerr << result.stderrOutput << std::endl;
+        }
+        return result;
+    }
+    UNIPM_TRACE_PROCESS_STARTED();
+    UNIPM_TRACE_ARG(span, "pid", static_cast<int64_t>(pid));
+
+    // Relayed output is drawn in frames; the poll wakes up for the next one
+    Terminal& terminal = Terminal::instance();
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    char buffer[4096];
+    while (true) {
+        int waitMs = -1;
+        if (timeout.count() > 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                kill(-pid, SIGKILL);
+                result.timedOut = true;
+                break;
+            }
+            waitMs = static_cast<int>(remaining.count());
+        }
+        if (stream) {
+            int frameMs = terminal.frameTimeoutMs();
+            if (frameMs >= 0 && (waitMs < 0 || frameMs < waitMs)) {
+                waitMs = frameMs;
+            }
+        }
+
+        if (waitMs >= 0) {
+            struct pollfd pfd = {fds[0], POLLIN, 0};
+            int ready = ::poll(&pfd, 1, waitMs);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready == 0) {
+                terminal.tick();
+                continue;  // The deadline is checked at the top
+            }
+        }
+
+        ssize_t n = read(fds[0], buffer, sizeof(buffer));
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        result.stdoutOutput.append(buffer, static_cast<size_t>(n));
+        if (stream && outputHandler_) {
+            outputHandler_(std::string_view(buffer, static_cast<size_t>(n)));
+        } else if (stream && Events::enabled()) {
+            Events::output(std::string_view(buffer, static_cast<size_t>(n)));
+        } else if (stream) {
+            terminal.relay(std::string_view(buffer, static_cast<size_t>(n)));
+        }
+    }
+    if (stream) {
+        terminal.flush();
+    }
+    close(fds[0]);
+
+    // wait4 also reports what the child's own waited-for children used
+    int status = 0;
+    struct rusage rusage {};
+    while (wait4(pid, &status, 0, &rusage) < 0 && errno == EINTR) {
+    }
+    UNIPM_TRACE_PROCESS_EXITED();
+    ProcessUsage usage = toUsage(rusage);
+    usage.command = CommandStep::query(argv).toString();
+    usage.wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    UNIPM_TRACE_ARG(span, "max_rss_kb", usage.maxRssKb);
+    result.usage = usage;
+    result.processes.push_back(std::move(usage));
+
+    if (WIFEXITED(status)) {
+        result.exitCode = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.exitCode = 128 + WTERMSIG(status);
+    }
+    result.success = (result.exitCode == 0) && !result.timedOut;
+    UNIPM_TRACE_ARG(span, "exit_code", static_cast<int64_t>(result.exitCode));
+    return result;
+#endif
+}
+
 std::string Executor::captureOutput(FILE* pipe) {
     std::array<char, 256> buffer;
     std::string result;
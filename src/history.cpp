@@ -0,0 +1,279 @@
+#include "unipm/history.h"
+#include "unipm/cache.h"
+#include <json.hpp>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <shlobj.h>
+#else
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#ifdef UNIPM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace unipm {
+
+std::string HistoryRecord::toJson() const {
+    json j;
+    j["ts"] = timestampMs;
+    j["action"] = action;
+    j["pm"] = packageManager;
+    j["packages"] = packages;
+    j["command"] = command;
+    j["duration_s"] = durationSeconds;
+    j["exit_code"] = exitCode;
+    j["success"] = success;
+    j["user_s"] = userSeconds;
+    j["sys_s"] = systemSeconds;
+    j["max_rss_kb"] = maxRssKb;
+    j["in_blocks"] = blockReads;
+    j["out_blocks"] = blockWrites;
+    j["nvcsw"] = voluntarySwitches;
+    j["nivcsw"] = involuntarySwitches;
+    if (!processes.empty()) {
+        json children = json::array();
+        for (const auto& usage : processes) {
+            children.push_back({{"command", usage.command},
+                                {"wall_s", usage.wallSeconds},
+                                {"user_s", usage.userSeconds},
+                                {"sys_s", usage.systemSeconds},
+                                {"max_rss_kb", usage.maxRssKb},
+                                {"in_blocks", usage.blockReads},
+                                {"out_blocks", usage.blockWrites},
+                                {"nvcsw", usage.voluntarySwitches},
+                                {"nivcsw", usage.involuntarySwitches}});
+        }
+        j["processes"] = std::move(children);
+    }
+    // Replace invalid UTF-8 in captured commands rather than throwing
+    return j.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+bool HistoryRecord::fromJson(const std::string& line, HistoryRecord& record) {
+    json j = json::parse(line, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) {
+        return false;
+    }
+
+    record = HistoryRecord();
+    record.timestampMs = j.value("ts", int64_t(0));
+    record.action = j.value("action", "");
+    record.packageManager = j.value("pm", "");
+    record.command = j.value("command", "");
+    record.durationSeconds = j.value("duration_s", 0.0);
+    record.exitCode = j.value("exit_code", 0);
+    record.success = j.value("success", false);
+    record.userSeconds = j.value("user_s", 0.0);
+    record.systemSeconds = j.value("sys_s", 0.0);
+    record.maxRssKb = j.value("max_rss_kb", int64_t(0));
+    record.blockReads = j.value("in_blocks", int64_t(0));
+    record.blockWrites = j.value("out_blocks", int64_t(0));
+    record.voluntarySwitches = j.value("nvcsw", int64_t(0));
+    record.involuntarySwitches = j.value("nivcsw", int64_t(0));
+    if (j.contains("processes") && j["processes"].is_array()) {
+        for (const auto& child : j["processes"]) {
+            if (!child.is_object()) {
+                continue;
+            }
+            ProcessUsage usage;
+            usage.command = child.value("command", "");
+            usage.wallSeconds = child.value("wall_s", 0.0);
+            usage.userSeconds = child.value("user_s", 0.0);
+            usage.systemSeconds = child.value("sys_s", 0.0);
+            usage.maxRssKb = child.value("max_rss_kb", int64_t(0));
+            usage.blockReads = child.value("in_blocks", int64_t(0));
+            usage.blockWrites = child.value("out_blocks", int64_t(0));
+            usage.voluntarySwitches = child.value("nvcsw", int64_t(0));
+            usage.involuntarySwitches = child.value("nivcsw", int64_t(0));
+            record.processes.push_back(std::move(usage));
+        }
+    }
+    if (j.contains("packages") && j["packages"].is_array()) {
+        for (const auto& pkg : j["packages"]) {
+            if (pkg.is_string()) {
+                record.packages.push_back(pkg.get<std::string>());
+            }
+        }
+    }
+    return true;
+}
+
+HistoryLog::HistoryLog(std::string path, uint64_t maxBytes)
+    : path_(std::move(path)), maxBytes_(maxBytes) {
+    writer_ = std::thread(&HistoryLog::run, this);
+}
+
+HistoryLog::~HistoryLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+}
+
+HistoryLog& HistoryLog::instance() {
+    static HistoryLog log;
+    return log;
+}
+
+std::string HistoryLog::defaultPath() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, path))) {
+        return std::string(path) + "\\unipm\\history.jsonl";
+    }
+    return "unipm_history.jsonl";
+#else
+    const char* home = getenv("HOME");
+    if (!home) {
+        struct passwd* pw = getpwuid(getuid());
+        home = pw ? pw->pw_dir : "/tmp";
+    }
+    return std::string(home) + "/.unipm/history.jsonl";
+#endif
+}
+
+std::string HistoryLog::rotatedPath(int n) const {
+#ifdef UNIPM_HAVE_ZLIB
+    return path_ + "." + std::to_string(n) + ".gz";
+#else
+    return path_ + "." + std::to_string(n);
+#endif
+}
+
+void HistoryLog::append(HistoryRecord record) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(record));
+    }
+    wake_.notify_one();
+}
+
+void HistoryLog::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_.wait(lock, [this]() { return queue_.empty() && !writing_; });
+}
+
+void HistoryLog::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;  // Stopping, and everything is written
+        }
+
+        std::deque<HistoryRecord> batch;
+        batch.swap(queue_);
+        writing_ = true;
+        lock.unlock();
+
+        for (const auto& record : batch) {
+            writeLine(record.toJson() + "\n");
+        }
+
+        lock.lock();
+        writing_ = false;
+        drained_.notify_all();
+    }
+}
+
+bool HistoryLog::writeLine(const std::string& line) {
+    size_t slash = path_.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        Cache::createDirectories(path_.substr(0, slash));
+    }
+    const std::string lockPath = path_ + ".lock";
+
+    // The lock file outlives rotations, so every process locks the same inode
+#ifdef _WIN32
+    HANDLE lockFile = CreateFileA(lockPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                  OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    OVERLAPPED region = {};
+    if (lockFile != INVALID_HANDLE_VALUE) {
+        LockFileEx(lockFile, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &region);
+    }
+#else
+    int lockFd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lockFd >= 0) {
+        flock(lockFd, LOCK_EX);
+    }
+#endif
+
+    FileStamp stamp = Cache::stat(path_);
+    if (maxBytes_ > 0 && stamp.exists && stamp.size + line.size() > maxBytes_) {
+        rotate();
+    }
+
+    bool written = false;
+#ifdef _WIN32
+    // FILE_APPEND_DATA alone makes every write land at the end of the file
+    HANDLE file = CreateFileA(path_.c_str(), FILE_APPEND_DATA,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        DWORD count = 0;
+        written = WriteFile(file, line.data(), static_cast<DWORD>(line.size()), &count, NULL) &&
+                  count == line.size();
+        CloseHandle(file);
+    }
+    if (lockFile != INVALID_HANDLE_VALUE) {
+        UnlockFileEx(lockFile, 0, MAXDWORD, MAXDWORD, &region);
+        CloseHandle(lockFile);
+    }
+#else
+    int fd = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        written = ::write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+        ::close(fd);
+    }
+    if (lockFd >= 0) {
+        flock(lockFd, LOCK_UN);
+        ::close(lockFd);
+    }
+#endif
+    return written;
+}
+
+// Called with the lock file held
+void HistoryLog::rotate() {
+    std::string source = path_;
+#ifdef UNIPM_HAVE_ZLIB
+    // Compress before shifting, so a failure leaves the older files alone
+    std::string data;
+    if (!Cache::readFile(path_, data)) {
+        return;
+    }
+    source = rotatedPath(1) + ".tmp";
+    gzFile gz = gzopen(source.c_str(), "wb");
+    if (!gz) {
+        return;
+    }
+    bool compressed = data.empty() ||
+                      gzwrite(gz, data.data(), static_cast<unsigned>(data.size())) ==
+                          static_cast<int>(data.size());
+    if (gzclose(gz) != Z_OK || !compressed) {
+        std::remove(source.c_str());
+        return;
+    }
+#endif
+
+    std::remove(rotatedPath(KEEP_ROTATED).c_str());
+    for (int n = KEEP_ROTATED - 1; n >= 1; --n) {
+        std::rename(rotatedPath(n).c_str(), rotatedPath(n + 1).c_str());
+    }
+    std::rename(source.c_str(), rotatedPath(1).c_str());
+    std::remove(path_.c_str());
+}
+
+} // namespace unipm
@@ -0,0 +1,353 @@
+#include "unipm/history_index.h"
+#include "unipm/blob_io.h"
+#include "unipm/cache.h"
+#include "unipm/mapped_file.h"
+#include "unipm/trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+
+namespace unipm {
+
+namespace {
+
+constexpr char MAGIC[8] = {'U', 'P', 'M', 'H', 'I', 'D', 'X', '1'};
+
+uint64_t fnv1a(std::string_view data) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Nearest-rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+bool isNumber(const std::string& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](unsigned char c) {
+        return std::isdigit(c) != 0;
+    });
+}
+
+} // namespace
+
+bool HistoryQuery::parseTime(const std::string& text, int64_t nowMs, int64_t& ms) {
+    if (text.empty()) {
+        return false;
+    }
+
+    // Relative: a count and a unit
+    char unit = text.back();
+    std::string count = text.substr(0, text.size() - 1);
+    if (isNumber(count)) {
+        int64_t seconds = 0;
+        switch (unit) {
+            case 'm': seconds = 60; break;
+            case 'h': seconds = 3600; break;
+            case 'd': seconds = 86400; break;
+            case 'w': seconds = 7 * 86400; break;
+            default: return false;
+        }
+        ms = nowMs - std::stoll(count) * seconds * 1000;
+        return true;
+    }
+
+    // Absolute, in local time
+    std::tm tm = {};
+    int matched = std::sscanf(text.c_str(), "%4d-%2d-%2d%*1[ T]%2d:%2d", &tm.tm_year, &tm.tm_mon,
+                              &tm.tm_mday, &tm.tm_hour, &tm.tm_min);
+    if (matched != 3 && matched != 5) {
+        return false;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    std::time_t seconds = std::mktime(&tm);
+    if (seconds == static_cast<std::time_t>(-1)) {
+        return false;
+    }
+    ms = static_cast<int64_t>(seconds) * 1000;
+    return true;
+}
+
+HistoryIndex::HistoryIndex(std::string logPath)
+    : logPath_(std::move(logPath)), indexPath_(logPath_ + INDEX_SUFFIX) {}
+
+void HistoryIndex::clear() {
+    indexedBytes_ = 0;
+    headLength_ = 0;
+    headHash_ = 0;
+    managers_.clear();
+    entries_.clear();
+    postings_.clear();
+}
+
+bool HistoryIndex::update() {
+    UNIPM_TRACE_SCOPE("HistoryIndex::update", "index");
+    MappedFile log;
+    if (!log.open(logPath_)) {
+        clear();
+        return false;
+    }
+    std::string_view data = log.view();
+
+    // Reuse the saved index only while it describes a prefix of this log
+    bool reusable = load() && indexedBytes_ <= data.size() && headLength_ <= data.size() &&
+                    fnv1a(data.substr(0, headLength_)) == headHash_;
+    if (!reusable) {
+        clear();
+    }
+
+    uint64_t before = indexedBytes_;
+    indexRecords(data);
+    if (indexedBytes_ != before || !reusable) {
+        save();
+    }
+    return true;
+}
+
+void HistoryIndex::indexRecords(std::string_view log) {
+    size_t pos = indexedBytes_;
+    while (pos < log.size()) {
+        size_t end = log.find('\n', pos);
+        if (end == std::string_view::npos) {
+            break;  // A record still being written
+        }
+
+        HistoryRecord record;
+        if (end > pos && HistoryRecord::fromJson(std::string(log.substr(pos, end - pos)), record)) {
+            Entry entry;
+            entry.offset = pos;
+            entry.length = static_cast<uint32_t>(end - pos);
+            entry.manager = managerId(record.packageManager);
+            entry.success = record.success ? 1 : 0;
+            entry.timestampMs = record.timestampMs;
+            entry.durationSeconds = record.durationSeconds;
+
+            uint32_t id = static_cast<uint32_t>(entries_.size());
+            entries_.push_back(entry);
+            for (const auto& pkg : record.packages) {
+                auto& list = postings_[pkg];
+                if (list.empty() || list.back() != id) {
+                    list.push_back(id);
+                }
+            }
+        }
+        pos = end + 1;
+    }
+
+    indexedBytes_ = pos;
+    if (headLength_ < HEAD_BYTES) {
+        headLength_ = std::min<uint64_t>(HEAD_BYTES, pos);
+        headHash_ = fnv1a(log.substr(0, headLength_));
+    }
+}
+
+uint16_t HistoryIndex::managerId(const std::string& name) {
+    auto it = std::find(managers_.begin(), managers_.end(), name);
+    if (it != managers_.end()) {
+        return static_cast<uint16_t>(it - managers_.begin());
+    }
+    managers_.push_back(name);
+    return static_cast<uint16_t>(managers_.size() - 1);
+}
+
+bool HistoryIndex::load() {
+    clear();
+    MappedFile file;
+    if (!file.open(indexPath_)) {
+        return false;
+    }
+
+    BlobReader reader(file.view());
+    std::string_view magic;
+    uint32_t managerCount = 0;
+    if (!reader.bytes(sizeof(MAGIC), magic) || magic != std::string_view(MAGIC, sizeof(MAGIC)) ||
+        !reader.get(indexedBytes_) || !reader.get(headLength_) || !reader.get(headHash_) ||
+        !reader.get(managerCount)) {
+        clear();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < managerCount; ++i) {
+        std::string_view name;
+        if (!reader.string16(name)) {
+            clear();
+            return false;
+        }
+        managers_.emplace_back(name);
+    }
+
+    uint32_t entryCount = 0;
+    if (!reader.get(entryCount)) {
+        clear();
+        return false;
+    }
+    entries_.reserve(entryCount);
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        Entry entry;
+        if (!reader.get(entry.offset) || !reader.get(entry.length) || !reader.get(entry.manager) ||
+            !reader.get(entry.success) || !reader.get(entry.timestampMs) ||
+            !reader.get(entry.durationSeconds) || entry.manager >= managers_.size()) {
+            clear();
+            return false;
+        }
+        entries_.push_back(entry);
+    }
+
+    uint32_t postingCount = 0;
+    if (!reader.get(postingCount)) {
+        clear();
+        return false;
+    }
+    for (uint32_t i = 0; i < postingCount; ++i) {
+        std::string_view name;
+        uint32_t count = 0;
+        if (!reader.string16(name) || !reader.get(count)) {
+            clear();
+            return false;
+        }
+        auto& list = postings_[std::string(name)];
+        list.resize(count);
+        for (uint32_t k = 0; k < count; ++k) {
+            if (!reader.get(list[k]) || list[k] >= entries_.size()) {
+                clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool HistoryIndex::save() const {
+    std::string blob(MAGIC, sizeof(MAGIC));
+    put<uint64_t>(blob, indexedBytes_);
+    put<uint64_t>(blob, headLength_);
+    put<uint64_t>(blob, headHash_);
+
+    put<uint32_t>(blob, static_cast<uint32_t>(managers_.size()));
+    for (const auto& name : managers_) {
+        putString16(blob, name);
+    }
+
+    put<uint32_t>(blob, static_cast<uint32_t>(entries_.size()));
+    for (const auto& entry : entries_) {
+        put(blob, entry.offset);
+        put(blob, entry.length);
+        put(blob, entry.manager);
+        put(blob, entry.success);
+        put(blob, entry.timestampMs);
+        put(blob, entry.durationSeconds);
+    }
+
+    put<uint32_t>(blob, static_cast<uint32_t>(postings_.size()));
+    for (const auto& posting : postings_) {
+        putString16(blob, posting.first);
+        put<uint32_t>(blob, static_cast<uint32_t>(posting.second.size()));
+        for (uint32_t id : posting.second) {
+            put(blob, id);
+        }
+    }
+
+    return Cache::writeAtomic(indexPath_, blob);
+}
+
+std::vector<uint32_t> HistoryIndex::select(const HistoryQuery& query) const {
+    std::vector<uint32_t> candidates;
+    if (!query.package.empty()) {
+        auto it = postings_.find(query.package);
+        if (it == postings_.end()) {
+            return {};
+        }
+        candidates = it->second;
+    } else {
+        candidates.resize(entries_.size());
+        for (uint32_t i = 0; i < entries_.size(); ++i) {
+            candidates[i] = i;
+        }
+    }
+
+    std::vector<uint32_t> selected;
+    for (uint32_t id : candidates) {
+        const Entry& entry = entries_[id];
+        if (!query.packageManager.empty() && managers_[entry.manager] != query.packageManager) {
+            continue;
+        }
+        if (entry.timestampMs < query.sinceMs || entry.timestampMs > query.untilMs) {
+            continue;
+        }
+        if ((query.outcome == HistoryQuery::Outcome::SUCCEEDED && !entry.success) ||
+            (query.outcome == HistoryQuery::Outcome::FAILED && entry.success)) {
+            continue;
+        }
+        selected.push_back(id);
+    }
+
+    if (query.limit > 0 && selected.size() > query.limit) {
+        selected.erase(selected.begin(), selected.end() - query.limit);
+    }
+    return selected;
+}
+
+std::vector<HistoryRecord> HistoryIndex::query(const HistoryQuery& query) const {
+    std::vector<uint32_t> selected = select(query);
+    std::vector<HistoryRecord> records;
+    if (selected.empty()) {
+        return records;
+    }
+
+    MappedFile log;
+    if (!log.open(logPath_)) {
+        return records;
+    }
+    std::string_view data = log.view();
+
+    records.reserve(selected.size());
+    for (uint32_t id : selected) {
+        const Entry& entry = entries_[id];
+        if (entry.offset + entry.length > data.size()) {
+            break;  // Log rotated underneath us
+        }
+        HistoryRecord record;
+        if (HistoryRecord::fromJson(std::string(data.substr(entry.offset, entry.length)), record)) {
+            records.push_back(std::move(record));
+        }
+    }
+    return records;
+}
+
+HistoryStats HistoryIndex::stats(const HistoryQuery& query) const {
+    HistoryStats stats;
+    std::map<std::string, std::vector<double>> durations;
+    for (uint32_t id : select(query)) {
+        const Entry& entry = entries_[id];
+        const std::string& manager = managers_[entry.manager];
+        HistoryStats::Manager& totals = stats.managers[manager];
+        totals.count++;
+        totals.totalSeconds += entry.durationSeconds;
+        if (!entry.success) {
+            totals.failed++;
+            stats.failed++;
+        }
+        stats.count++;
+        durations[manager].push_back(entry.durationSeconds);
+    }
+
+    for (auto& entry : durations) {
+        std::sort(entry.second.begin(), entry.second.end());
+        HistoryStats::Manager& totals = stats.managers[entry.first];
+        totals.p50Seconds = percentile(entry.second, 0.50);
+        totals.p95Seconds = percentile(entry.second, 0.95);
+    }
+    return stats;
+}
+
+} // namespace unipm
@@ -0,0 +1,69 @@
+#include "unipm/install_timings.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace unipm {
+
+// One line per package manager: <pm> <invocation s> <per-package s> <samples>
+bool InstallTimings::load() {
+    averages_.clear();
+
+    std::string data;
+    if (!Cache::readFile(path_, data)) {
+        return false;
+    }
+
+    std::istringstream in(data);
+    std::string name;
+    Average average;
+    while (in >> name >> average.invocation >> average.perPackage >> average.samples) {
+        PackageManager pm = stringToPackageManager(name);
+        if (pm != PackageManager::UNKNOWN && average.samples > 0) {
+            averages_[pm] = average;
+        }
+    }
+    return true;
+}
+
+bool InstallTimings::save() const {
+    std::ostringstream out;
+    for (const auto& entry : averages_) {
+        out << packageManagerToString(entry.first) << '\t' << entry.second.invocation << '\t'
+            << entry.second.perPackage << '\t' << entry.second.samples << '\n';
+    }
+
+    size_t slash = path_.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        Cache::createDirectories(path_.substr(0, slash));
+    }
+    return Cache::writeAtomic(path_, out.str());
+}
+
+void InstallTimings::record(PackageManager pm, double seconds, size_t packageCount) {
+    if (packageCount == 0 || seconds <= 0.0) {
+        return;
+    }
+
+    double perPackage = seconds / static_cast<double>(packageCount);
+    Average& average = averages_[pm];
+    if (average.samples == 0) {
+        average.invocation = seconds;
+        average.perPackage = perPackage;
+    } else {
+        average.invocation += SMOOTHING * (seconds - average.invocation);
+        average.perPackage += SMOOTHING * (perPackage - average.perPackage);
+    }
+    average.samples++;
+}
+
+double InstallTimings::invocationSeconds(PackageManager pm) const {
+    auto it = averages_.find(pm);
+    return it != averages_.end() ? it->second.invocation : -1.0;
+}
+
+double InstallTimings::perPackageSeconds(PackageManager pm) const {
+    auto it = averages_.find(pm);
+    return it != averages_.end() ? it->second.perPackage : -1.0;
+}
+
+} // namespace unipm
@@ -0,0 +1,419 @@
+#include "unipm/inventory.h"
+#include "unipm/adapter.h"
+#include "unipm/metrics.h"
+#include "unipm/trace.h"
+#include <cstdlib>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+namespace {
+
+constexpr const char* CACHE_MAGIC = "unipm-inventory\t1";
+
+std::vector<std::string> splitTabs(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    return fields;
+}
+
+// Keep fields on one line and free of the separator
+std::string sanitize(const std::string& value) {
+    std::string out = value;
+    for (char& c : out) {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return out;
+}
+
+} // namespace
+
+Inventory::Inventory(std::string cachePath) : cachePath_(std::move(cachePath)) {}
+
+Inventory::~Inventory() {
+#ifdef __linux__
+    if (watchFd_ >= 0) {
+        close(watchFd_);
+    }
+#endif
+}
+
+void Inventory::addSource(const PMInfo& info) {
+    addSource(info.type, AdapterFactory::create(info));
+}
+
+void Inventory::addSource(PackageManager pm, std::unique_ptr<PackageManagerAdapter> adapter) {
+    // Ownership is tracked in a 32-bit mask per package name
+    if (!adapter || sourceFor(pm) != nullptr || sources_.size() >= 32) {
+        return;
+    }
+
+    Source source;
+    source.pm = pm;
+    source.paths = adapter->getInstalledMetadataPaths();
+    source.adapter = std::move(adapter);
+    sources_.push_back(std::move(source));
+}
+
+size_t Inventory::refresh() {
+    UNIPM_TRACE_SCOPE("Inventory::refresh", "index");
+    if (!cacheRead_) {
+        loadCache();
+        cacheRead_ = true;
+    }
+
+    size_t reread = 0;
+    for (auto& source : sources_) {
+        // A watched source that saw no events is known to be current
+        if (source.loaded && !source.dirty && watchFd_ >= 0) {
+            Metrics::cacheLookup("inventory", true);
+            continue;
+        }
+
+        // Sources without metadata paths can't be validated; always re-read them
+        std::vector<FileStamp> stamps = stampPaths(source.paths);
+        if (source.loaded && !source.paths.empty() && stamps == source.stamps) {
+            source.dirty = false;
+            Metrics::cacheLookup("inventory", true);
+            continue;
+        }
+        Metrics::cacheLookup("inventory", false);
+
+        // Stamp before reading so a change during the read is caught next time
+        source.stamps = std::move(stamps);
+        reload(source);
+        source.dirty = false;
+        reread++;
+    }
+
+    if (reread > 0) {
+        rebuildOwners();
+        saveCache();
+    }
+    return reread;
+}
+
+bool Inventory::reload(Source& source) {
+    std::vector<InstalledPackage> packages;
+    source.loaded = source.adapter->readInstalled(packages);
+    source.packages = source.loaded ? std::move(packages) : std::vector<InstalledPackage>();
+    for (auto& pkg : source.packages) {
+        pkg.packageManager = source.pm;
+    }
+    index(source);
+    return source.loaded;
+}
+
+void Inventory::index(Source& source) {
+    source.byName.clear();
+    source.byName.reserve(source.packages.size());
+    for (size_t i = 0; i < source.packages.size(); ++i) {
+        // Multi-arch duplicates: keep the first, matching the native readers
+        source.byName.emplace(source.packages[i].name, i);
+    }
+}
+
+void Inventory::rebuildOwners() {
+    owners_.clear();
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        for (const auto& entry : sources_[i].byName) {
+            owners_[entry.first] |= (1u << i);
+        }
+    }
+}
+
+std::vector<FileStamp> Inventory::stampPaths(const std::vector<std::string>& paths) {
+    std::vector<FileStamp> stamps;
+    stamps.reserve(paths.size());
+    for (const auto& path : paths) {
+        stamps.push_back(Cache::stat(path));
+    }
+    return stamps;
+}
+
+Inventory::Source* Inventory::sourceFor(PackageManager pm) {
+    for (auto& source : sources_) {
+        if (source.pm == pm) {
+            return &source;
+        }
+    }
+    return nullptr;
+}
+
+const Inventory::Source* Inventory::sourceFor(PackageManager pm) const {
+    for (const auto& source : sources_) {
+        if (source.pm == pm) {
+            return &source;
+        }
+    }
+    return nullptr;
+}
+
+bool Inventory::isInstalled(const std::string& name) const {
+    return owners_.count(name) > 0;
+}
+
+bool Inventory::isInstalled(const std::string& name, PackageManager pm) const {
+    return find(name, pm) != nullptr;
+}
+
+const InstalledPackage* Inventory::find(const std::string& name, PackageManager pm) const {
+    const Source* source = sourceFor(pm);
+    if (!source) {
+        return nullptr;
+    }
+
+    auto it = source->byName.find(name);
+    if (it != source->byName.end()) {
+        return &source->packages[it->second];
+    }
+
+    // "name:arch" only matches an entry installed for that architecture
+    size_t colon = name.find(':');
+    if (colon != std::string::npos) {
+        it = source->byName.find(name.substr(0, colon));
+        if (it != source->byName.end() &&
+            source->packages[it->second].architecture == name.substr(colon + 1)) {
+            return &source->packages[it->second];
+        }
+    }
+    return nullptr;
+}
+
+std::vector<PackageManager> Inventory::managersFor(const std::string& name) const {
+    std::vector<PackageManager> managers;
+    auto it = owners_.find(name);
+    if (it == owners_.end()) {
+        return managers;
+    }
+
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        if (it->second & (1u << i)) {
+            managers.push_back(sources_[i].pm);
+        }
+    }
+    return managers;
+}
+
+bool Inventory::isTracked(PackageManager pm) const {
+    const Source* source = sourceFor(pm);
+    return source != nullptr && source->loaded;
+}
+
+const std::vector<InstalledPackage>& Inventory::packages(PackageManager pm) const {
+    static const std::vector<InstalledPackage> empty;
+    const Source* source = sourceFor(pm);
+    return source ? source->packages : empty;
+}
+
+// Cache format, one record per line with tab-separated fields:
+//   source  <pm> <path count>
+//   path    <path> <exists> <size> <mtime ns>
+//   pkg     <name> <version> <arch> <size> <explicit> <description>
+void Inventory::loadCache() {
+    if (cachePath_.empty()) {
+        return;
+    }
+
+    std::string data;
+    if (!Cache::readFile(cachePath_, data)) {
+        return;
+    }
+
+    std::istringstream in(data);
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_MAGIC) {
+        return;
+    }
+
+    Source* current = nullptr;
+    std::vector<std::string> paths;
+    std::vector<FileStamp> stamps;
+    std::vector<InstalledPackage> packages;
+
+    auto finish = [&]() {
+        // Only adopt a section recorded for the same metadata paths
+        if (current && !current->loaded && paths == current->paths) {
+            current->stamps = std::move(stamps);
+            current->packages = std::move(packages);
+            current->loaded = true;
+            index(*current);
+        }
+        current = nullptr;
+        paths.clear();
+        stamps.clear();
+        packages.clear();
+    };
+
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields = splitTabs(line);
+        if (fields[0] == "source" && fields.size() >= 2) {
+            finish();
+            current = sourceFor(stringToPackageManager(fields[1]));
+        } else if (fields[0] == "path" && fields.size() >= 5) {
+            paths.push_back(fields[1]);
+            FileStamp stamp;
+            stamp.exists = fields[2] == "1";
+            stamp.size = std::strtoull(fields[3].c_str(), nullptr, 10);
+            stamp.mtimeNs = std::strtoll(fields[4].c_str(), nullptr, 10);
+            stamps.push_back(stamp);
+        } else if (fields[0] == "pkg" && fields.size() >= 7 && current) {
+            InstalledPackage pkg;
+            pkg.name = fields[1];
+            pkg.version = fields[2];
+            pkg.architecture = fields[3];
+            pkg.installedSize = std::strtoull(fields[4].c_str(), nullptr, 10);
+            pkg.explicitlyInstalled = fields[5] == "1";
+            pkg.description = fields[6];
+            pkg.packageManager = current->pm;
+            packages.push_back(std::move(pkg));
+        }
+    }
+    finish();
+
+    rebuildOwners();
+}
+
+bool Inventory::readCachedNames(const std::string& cachePath, std::vector<std::string>& names) {
+    std::string data;
+    if (!Cache::readFile(cachePath, data)) {
+        return false;
+    }
+
+    std::istringstream in(data);
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_MAGIC) {
+        return false;
+    }
+    while (std::getline(in, line)) {
+        if (line.compare(0, 4, "pkg\t") == 0) {
+            names.push_back(line.substr(4, line.find('\t', 4) - 4));
+        }
+    }
+    return true;
+}
+
+bool Inventory::saveCache() const {
+    if (cachePath_.empty()) {
+        return false;
+    }
+
+    std::string out = CACHE_MAGIC;
+    out += '\n';
+    for (const auto& source : sources_) {
+        // Unvalidated sources are re-read every time; don't persist them
+        if (!source.loaded || source.paths.empty()) {
+            continue;
+        }
+
+        out += "source\t" + packageManagerToString(source.pm) + "\t" +
+               std::to_string(source.paths.size()) + "\n";
+        for (size_t i = 0; i < source.paths.size(); ++i) {
+            const FileStamp& stamp = source.stamps[i];
+            out += "path\t" + source.paths[i] + "\t" + (stamp.exists ? "1" : "0") + "\t" +
+                   std::to_string(stamp.size) + "\t" + std::to_string(stamp.mtimeNs) + "\n";
+        }
+        for (const auto& pkg : source.packages) {
+            out += "pkg\t" + sanitize(pkg.name) + "\t" + sanitize(pkg.version) + "\t" +
+                   sanitize(pkg.architecture) + "\t" + std::to_string(pkg.installedSize) + "\t" +
+                   (pkg.explicitlyInstalled ? "1" : "0") + "\t" + sanitize(pkg.description) +
+                   "\n";
+        }
+    }
+
+    size_t slash = cachePath_.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        Cache::createDirectories(cachePath_.substr(0, slash));
+    }
+    return Cache::writeAtomic(cachePath_, out);
+}
+
+bool Inventory::startWatching() {
+#ifdef __linux__
+    if (watchFd_ >= 0) {
+        return true;
+    }
+
+    watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd_ < 0) {
+        return false;
+    }
+
+    // One mask for every watch, since a directory may be added more than once
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+                          IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        for (const auto& path : sources_[i].paths) {
+            struct stat st;
+            std::string target = path;
+            std::string name;
+            if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+                // Files are replaced by rename; watch the parent and filter
+                size_t slash = path.find_last_of('/');
+                if (slash == std::string::npos) continue;
+                target = slash == 0 ? "/" : path.substr(0, slash);
+                name = path.substr(slash + 1);
+            }
+
+            int wd = inotify_add_watch(watchFd_, target.c_str(), mask);
+            if (wd >= 0) {
+                watches_.emplace(wd, Watch{i, name});
+            }
+        }
+    }
+
+    if (watches_.empty()) {
+        close(watchFd_);
+        watchFd_ = -1;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t Inventory::poll() {
+#ifdef __linux__
+    if (watchFd_ >= 0) {
+        alignas(struct inotify_event) char buffer[8192];
+        ssize_t len;
+        while ((len = ::read(watchFd_, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + len;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were lost; fall back to checking everything
+                    for (auto& source : sources_) source.dirty = true;
+                    continue;
+                }
+
+                std::string name = event->len > 0 ? event->name : "";
+                auto range = watches_.equal_range(event->wd);
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (it->second.name.empty() || it->second.name == name) {
+                        sources_[it->second.source].dirty = true;
+                    }
+                }
+            }
+        }
+    }
+#endif
+    return refresh();
+}
+
+} // namespace unipm
@@ -0,0 +1,106 @@
+#include "unipm/lockfile.h"
+#include "unipm/cache.h"
+#include <json.hpp>
+#include <sstream>
+
+using json = nlohmann::ordered_json;
+
+namespace unipm {
+
+bool Lockfile::load(std::string& error) {
+    managers_.clear();
+
+    std::string data;
+    if (!Cache::readFile(path_, data)) {
+        error = "Cannot read " + path_;
+        return false;
+    }
+
+    json root = json::parse(data, nullptr, false);
+    if (root.is_discarded() || !root.is_object() || !root.contains("managers") ||
+        !root["managers"].is_object()) {
+        error = path_ + " is not a unipm lockfile";
+        return false;
+    }
+    if (root.value("version", 0) != FORMAT_VERSION) {
+        error = path_ + " has an unsupported lockfile version";
+        return false;
+    }
+
+    for (auto& [key, value] : root["managers"].items()) {
+        PackageManager pm = stringToPackageManager(key);
+        if (pm == PackageManager::UNKNOWN || !value.is_object() || !value.contains("packages") ||
+            !value["packages"].is_array()) {
+            error = path_ + ": bad entry for '" + key + "'";
+            return false;
+        }
+
+        LockedManager entry;
+        entry.databaseHash = value.value("database", "");
+        for (const auto& pkg : value["packages"]) {
+            if (!pkg.is_object() || !pkg.contains("native") || !pkg["native"].is_string()) {
+                error = path_ + ": bad package entry for '" + key + "'";
+                return false;
+            }
+            LockedPackage locked;
+            locked.name = pkg.value("name", "");
+            locked.version = pkg.value("version", "");
+            locked.native = pkg["native"].get<std::string>();
+            entry.packages.push_back(std::move(locked));
+        }
+        managers_[pm] = std::move(entry);
+    }
+    return true;
+}
+
+bool Lockfile::save() const {
+    json managers = json::object();
+    for (const auto& entry : managers_) {
+        json packages = json::array();
+        for (const auto& pkg : entry.second.packages) {
+            packages.push_back(
+                {{"name", pkg.name}, {"version", pkg.version}, {"native", pkg.native}});
+        }
+        managers[packageManagerToString(entry.first)] = {
+            {"database", entry.second.databaseHash}, {"packages", std::move(packages)}};
+    }
+
+    json root = {{"version", FORMAT_VERSION}, {"managers", std::move(managers)}};
+    return Cache::writeAtomic(path_, root.dump(2) + "\n");
+}
+
+const LockedManager* Lockfile::find(PackageManager pm) const {
+    auto it = managers_.find(pm);
+    return it != managers_.end() ? &it->second : nullptr;
+}
+
+void Lockfile::set(PackageManager pm, LockedManager entry) {
+    managers_[pm] = std::move(entry);
+}
+
+bool Lockfile::readManifest(const std::string& path, std::vector<std::string>& packages,
+                            std::string& error) {
+    std::string data;
+    if (!Cache::readFile(path, data)) {
+        error = "Cannot read manifest " + path;
+        return false;
+    }
+
+    std::istringstream in(data);
+    std::string line;
+    while (std::getline(in, line)) {
+        // "node   lts" becomes "node lts", as it would be on the command line
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string word;
+        std::string entry;
+        while (words >> word) {
+            entry += (entry.empty() ? "" : " ") + word;
+        }
+        if (!entry.empty()) {
+            packages.push_back(entry);
+        }
+    }
+    return true;
+}
+
+} // namespace unipm
@@ -1,26 +1,186 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <vector>
 
 #include "unipm/adapter.h"
+#include "unipm/cache.h"
+#include "unipm/completion.h"
 #include "unipm/config.h"
+#include "unipm/daemon.h"
 #include "unipm/doctor.h"
+#include "unipm/events.h"
 #include "unipm/executor.h"
+#include "unipm/history_index.h"
+#include "unipm/install_timings.h"
+#include "unipm/inventory.h"
+#include "unipm/lockfile.h"
+#include "unipm/metrics.h"
+#include "unipm/metadata_freshness.h"
+#include "unipm/mirrors.h"
+#include "unipm/multi_search.h"
 #include "unipm/os_detector.h"
 #include "unipm/parser.h"
+#include "unipm/pipeline.h"
 #include "unipm/pm_detector.h"
 #include "unipm/resolver.h"
 #include "unipm/safety.h"
 #include "unipm/self_uninstall.h"
+#include "unipm/terminal.h"
+#include "unipm/trace.h"
 #include "unipm/types.h"
 #include "unipm/ui.h"
 
 using namespace unipm;
 
-int main(int argc, char* argv[]) {
+namespace {
+
+// Resolve "name [version]" requests to native names, warning about weak
+// matches. resolve maps a name and version to a ResolvedPackage. False when
+// unipm should stop, with the exit code in exitCode.
+bool resolveRequests(const Command& cmd, const std::vector<std::string>& requests,
+                     const std::function<ResolvedPackage(const std::string&, const std::string&)>&
+                         resolve,
+                     const PMInfo& pmInfo, std::vector<LockedPackage>& resolvedPackages,
+                     int& exitCode) {
+    UNIPM_TRACE_SCOPE("resolve", "phase");
+    PhaseTimer timer("resolve");
+    for (const auto& pkg : requests) {
+        // Split package and version (e.g., "node lts")
+        std::string packageName = pkg;
+        std::string version;
+        
+        size_t spacePos = pkg.find(' ');
+        if (spacePos != std::string::npos) {
+            packageName = pkg.substr(0, spacePos);
+            version = pkg.substr(spacePos + 1);
+        }
+        
+        // Validate package name
+        if (!Safety::isValidPackageName(packageName) ||
+            (!version.empty() && !Safety::isValidPackageName(version))) {
+            UI::printError("Invalid package name: " + pkg);
+            exitCode = 1;
+            return false;
+        }
+        
+        // Resolve package
+        ResolvedPackage resolved = resolve(packageName, version);
+        Metrics::resolution(resolved);
+        
+        if (cmd.verbose || Events::enabled()) {
+            UI::printResolution(resolved);
+        }
+        
+        // Warn if confidence is low
+        if (resolved.confidence < Metrics::LOW_CONFIDENCE && resolved.confidence > 0.0f) {
+            UI::printWarning("Low confidence match for '" + packageName + "' -> '" + resolved.resolvedName + "'");
+            
+            if (!resolved.suggestions.empty()) {
+                std::cout << "Did you mean:" << std::endl;
+                for (const auto& suggestion : resolved.suggestions) {
+                    std::cout << "  - " << suggestion << std::endl;
+                }
+                
+                if (!cmd.autoYes) {
+                    bool proceed = UI::confirm("Continue anyway?", false);
+                    Metrics::lowConfidencePrompt(proceed);
+                    if (!proceed) {
+                        Metrics::setOutcome("cancelled");
+                        exitCode = 0;
+                        return false;
+                    }
+                }
+            }
+        } else if (resolved.confidence == 0.0f) {
+            UI::printWarning("Package '" + packageName + "' not found in database, using as-is");
+        }
+        
+        if (!resolved.available) {
+            UI::printWarning("'" + resolved.resolvedName + "' was not found in the configured " + pmInfo.name + " repositories");
+        }
+        
+        resolvedPackages.push_back({packageName, version, resolved.resolvedName});
+    }
+    return true;
+}
+
+// Probe pm's mirrors and any --mirrors candidates, or reuse a recent ranking.
+// mirrors receives what was configured plus the candidates; cached says
+// whether the ranking was reused.
+std::vector<MirrorProbe> rankMirrors(Command& cmd, PackageManager pm, std::vector<Mirror>& mirrors,
+                                     bool& cached) {
+    UNIPM_TRACE_SCOPE("mirrors", "phase");
+    mirrors = MirrorList::read(pm);
+    
+    bool candidates = false;
+    if (cmd.options.count("mirrors") > 0) {
+        std::string list = cmd.options["mirrors"];
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t comma = std::min(list.find(',', start), list.size());
+            Mirror candidate = MirrorList::candidate(list.substr(start, comma - start), mirrors);
+            bool known = std::any_of(mirrors.begin(), mirrors.end(), [&candidate](const Mirror& m) {
+                return m.url == candidate.url;
+            });
+            if (!candidate.url.empty() && !known) {
+                mirrors.push_back(candidate);
+                candidates = true;
+            }
+            start = comma + 1;
+        }
+    }
+    
+    MirrorRanking ranking;
+    ranking.load();
+    cached = false;
+    if (!candidates && cmd.options.count("refresh") == 0) {
+        if (const auto* known = ranking.find(pm, MirrorRanking::DEFAULT_TTL_SECONDS)) {
+            cached = true;
+            return *known;
+        }
+    }
+    if (mirrors.empty()) {
+        return {};
+    }
+    
+    std::vector<MirrorProbe> probes = MirrorProber().rank(mirrors);
+    ranking.set(pm, probes);
+    ranking.save();
+    return probes;
+}
+
+// The whole command; main() wraps it in the --trace recording
+int run(int argc, char* argv[]) {
+    // Shell completion runs on every Tab press: answer before anything else starts
+    if (argc > 1 && std::strcmp(argv[1], "__complete") == 0) {
+        return Completion::run(argc, argv);
+    }
+    
+    // All output goes through one buffer, flushed per line group on a terminal
+    Terminal::instance().attachStandardStreams();
+    
     // Parse command-line arguments
+    UNIPM_TRACE_SPAN(parseSpan, "parse", "phase");
     Parser parser;
     Command cmd = parser.parse(argc, argv);
+    UNIPM_TRACE_END(parseSpan);
+    Metrics::setCommand(commandTypeToString(cmd.type));
+    
+    // Typed NDJSON events on stdout instead of formatted text
+    if (cmd.options.count("output") > 0) {
+        if (cmd.options["output"] == "ndjson") {
+            Events::enable();
+        } else if (cmd.options["output"] != "text") {
+            UI::printError("Unknown output format: " + cmd.options["output"]);
+            UI::printInfo("Use --output=text or --output=ndjson");
+            return 1;
+        }
+    }
     
     // Handle help and version commands immediately
     if (cmd.type == CommandType::HELP) {
@@ -35,9 +195,59 @@ int main(int argc, char* argv[]) {
     
     // Handle doctor command
     if (cmd.type == CommandType::DOCTOR) {
+        if (cmd.options.count("perf") > 0) {
+            return Doctor::runPerformanceProfile();
+        }
         return Doctor::runDiagnostics();
     }
     
+    // Query the operation log
+    if (cmd.type == CommandType::HISTORY) {
+        HistoryQuery query;
+        if (!cmd.packages.empty()) {
+            query.package = cmd.packages[0];
+        }
+        query.packageManager = cmd.forcePM;
+        if (cmd.options.count("failed") > 0) {
+            query.outcome = HistoryQuery::Outcome::FAILED;
+        } else if (cmd.options.count("succeeded") > 0) {
+            query.outcome = HistoryQuery::Outcome::SUCCEEDED;
+        }
+        
+        int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+        auto parseBound = [&cmd, nowMs](const std::string& name, int64_t& ms) {
+            if (cmd.options.count(name) == 0 ||
+                HistoryQuery::parseTime(cmd.options[name], nowMs, ms)) {
+                return true;
+            }
+            UI::printError("Invalid --" + name + " time: " + cmd.options[name]);
+            UI::printInfo("Use e.g. 12h, 7d, 2w or 2024-01-31 [14:00]");
+            return false;
+        };
+        if (!parseBound("since", query.sinceMs) || !parseBound("until", query.untilMs)) {
+            return 1;
+        }
+        
+        HistoryIndex index;
+        if (!index.update()) {
+            UI::printInfo("No history recorded yet");
+            return 0;
+        }
+        if (cmd.options.count("stats") > 0) {
+            UI::printHistoryStats(index.stats(query));
+        } else {
+            query.limit = 20;
+            if (cmd.options.count("limit") > 0) {
+                long limit = std::atol(cmd.options["limit"].c_str());
+                query.limit = limit > 0 ? static_cast<size_t>(limit) : 0;
+            }
+            UI::printHistory(index.query(query));
+        }
+        return 0;
+    }
+    
     // Handle self-uninstall command
     if (cmd.type == CommandType::SELF_UNINSTALL) {
         return SelfUninstaller::uninstall(cmd.autoYes);
@@ -51,13 +261,27 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // unipmd, when it's running, answers from what it keeps in memory; every
+    // lookup below falls back to doing the work here
+    DaemonClient daemon;
+    if (cmd.options.count("no-daemon") == 0 && !std::getenv("UNIPM_NO_DAEMON")) {
+        daemon.connect();
+    }
+    
     // Detect operating system
+    UNIPM_TRACE_SPAN(detectSpan, "detect", "phase");
     if (cmd.verbose) {
-        UI::printInfo("Detecting operating system...");
+        UI::printInfo(daemon.connected() ? "Asking unipmd about the system..."
+                                         : "Detecting operating system...");
     }
     
-    OSDetector osDetector;
-    OSInfo osInfo = osDetector.detect();
+    OSInfo osInfo;
+    PMInfo pmInfo;
+    bool detected = daemon.detect(cmd.forcePM, osInfo, pmInfo);
+    if (!detected) {
+        OSDetector osDetector;
+        osInfo = osDetector.detect();
+    }
     
     if (cmd.verbose) {
         std::cout << "  OS: " << osTypeToString(osInfo.type);
@@ -73,7 +297,10 @@ int main(int argc, char* argv[]) {
     }
     
     PMDetector pmDetector;
-    PMInfo pmInfo;
+    bool pmAvailable = true;
+    
+    // install --locked replays unipm.lock instead of resolving names
+    bool locked = cmd.type == CommandType::INSTALL && cmd.options.count("locked") > 0;
     
     // Check if user forced a specific package manager
     if (!cmd.forcePM.empty()) {
@@ -83,16 +310,24 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        if (!pmDetector.isAvailable(forcedPM)) {
+        if (detected ? pmInfo.type == forcedPM : pmDetector.isAvailable(forcedPM)) {
+            if (!detected) {
+                pmInfo = pmDetector.detect(forcedPM);
+            }
+        } else if (cmd.type == CommandType::LOCK) {
+            // Locking for another platform only needs the database
+            pmInfo.type = forcedPM;
+            pmInfo.name = packageManagerToString(forcedPM);
+            pmAvailable = false;
+        } else {
             UI::printError("Package manager not available: " + cmd.forcePM);
             return 1;
         }
-        
-        pmInfo.type = forcedPM;
-        pmInfo.name = packageManagerToString(forcedPM);
     } else {
         // Auto-detect default package manager
-        pmInfo = pmDetector.detectDefault(osInfo);
+        if (!detected) {
+            pmInfo = pmDetector.detectDefault(osInfo);
+        }
         
         if (pmInfo.type == PackageManager::UNKNOWN) {
             UI::printError("No package manager found on this system");
@@ -104,100 +339,391 @@ int main(int argc, char* argv[]) {
     if (cmd.verbose) {
         std::cout << "  Using: " << pmInfo.name << std::endl;
     }
+    Events::detection(osInfo, pmInfo);
+    Metrics::setPackageManager(pmInfo.type);
+    UNIPM_TRACE_END(detectSpan);
+    
+    if (cmd.type == CommandType::MIRRORS) {
+        std::vector<Mirror> mirrors;
+        bool cached = false;
+        std::vector<MirrorProbe> ranking = rankMirrors(cmd, pmInfo.type, mirrors, cached);
+        UI::printMirrorRanking(pmInfo.name, ranking, MirrorList::primary(mirrors), cached);
+        return 0;
+    }
     
     // Load configuration and package database
+    UNIPM_TRACE_SPAN(configSpan, "load_config", "phase");
     auto config = std::make_shared<Config>();
     
-    // Try to load from installation directory first
-    if (!config->loadDefault()) {
-        // Fallback: try loading from current directory
-        if (!config->load("data/packages.json")) {
-            UI::printWarning("Could not load package database");
-            UI::printInfo("Using package names as-is without translation");
+    // Check the lockfile before anything else: it must match this system
+    Lockfile lockfile(cmd.options.count("lockfile") > 0 ? cmd.options["lockfile"]
+                                                         : Lockfile::DEFAULT_PATH);
+    const LockedManager* lockedEntry = nullptr;
+    if (locked) {
+        if (!lockfile.load(error)) {
+            UI::printError(error);
+            UI::printInfo("Create it with 'unipm lock <packages>' or 'unipm lock --manifest=<file>'");
+            return 1;
+        }
+        lockedEntry = lockfile.find(pmInfo.type);
+        if (!lockedEntry) {
+            UI::printError(lockfile.path() + " has nothing locked for " + pmInfo.name);
+            UI::printInfo("Run 'unipm lock' on this system to add it");
+            return 1;
+        }
+        if (Config::hashDatabase(config->findDatabase()) != lockedEntry->databaseHash) {
+            UI::printError("The package database changed since " + lockfile.path() + " was written");
+            UI::printInfo("Run 'unipm lock' again to re-resolve");
+            return 1;
         }
     }
     
+    // unipmd has the database loaded already, unless it found a different
+    // one (e.g. data/packages.json in another directory); lock and
+    // search --all read it here
+    bool remoteDatabase = daemon.connected() && !locked && cmd.type != CommandType::LOCK &&
+                          !(cmd.type == CommandType::SEARCH && cmd.options.count("all") > 0);
+    if (remoteDatabase && !daemon.servesDatabase(config->findDatabase())) {
+        remoteDatabase = false;
+    }
+    bool databaseLoaded = false;
+    auto loadDatabase = [&config, &databaseLoaded]() {
+        if (databaseLoaded) {
+            return;
+        }
+        databaseLoaded = true;
+        // Try to load from installation directory first
+        if (!config->loadDefault()) {
+            // Fallback: try loading from current directory
+            if (!config->load("data/packages.json")) {
+                UI::printWarning("Could not load package database");
+                UI::printInfo("Using package names as-is without translation");
+            }
+        }
+    };
+    
+    // Locked installs need neither
+    if (!locked && !remoteDatabase) {
+        loadDatabase();
+    }
+    
     // Create resolver
     Resolver resolver(config);
+    UNIPM_TRACE_END(configSpan);
+    
+    // Install and info also check names against the repository index
+    bool checkAvailability = cmd.type == CommandType::INSTALL || cmd.type == CommandType::INFO;
+    auto resolve = [&](const std::string& name, const std::string& version) {
+        ResolvedPackage resolved;
+        if (remoteDatabase &&
+            daemon.resolve(name, version, pmInfo.type, checkAvailability, resolved)) {
+            return resolved;
+        }
+        loadDatabase();
+        return resolver.resolve(name, pmInfo.type, version);
+    };
+    
+    if (cmd.type == CommandType::LOCK) {
+        std::vector<std::string> requests = cmd.packages;
+        if (cmd.options.count("manifest") > 0 &&
+            !Lockfile::readManifest(cmd.options["manifest"], requests, error)) {
+            UI::printError(error);
+            return 1;
+        }
+        
+        // Only check the repositories when they belong to this system
+        std::unique_ptr<PackageManagerAdapter> lockAdapter;
+        if (pmAvailable) {
+            lockAdapter = AdapterFactory::create(pmInfo);
+        }
+        if (lockAdapter) {
+            resolver.setAvailabilityCheck([&lockAdapter](const std::string& name) {
+                return lockAdapter->checkAvailable(name) != Availability::MISSING;
+            });
+        }
+        
+        LockedManager entry;
+        int exitCode = 0;
+        if (!resolveRequests(cmd, requests, resolve, pmInfo, entry.packages, exitCode)) {
+            return exitCode;
+        }
+        entry.databaseHash = Config::hashDatabase(config->path());
+        
+        // Keep what other package managers locked
+        std::string loadError;
+        if (Cache::stat(lockfile.path()).exists && !lockfile.load(loadError)) {
+            UI::printError(loadError);
+            return 1;
+        }
+        size_t count = entry.packages.size();
+        lockfile.set(pmInfo.type, std::move(entry));
+        if (!lockfile.save()) {
+            UI::printError("Could not write " + lockfile.path());
+            return 1;
+        }
+        UI::printSuccess("Locked " + std::to_string(count) + (count == 1 ? " package" : " packages") +
+                         " for " + pmInfo.name + " in " + lockfile.path());
+        return 0;
+    }
+    
+    // Search every detected package manager at once
+    if (cmd.type == CommandType::SEARCH && cmd.options.count("all") > 0) {
+        std::chrono::milliseconds deadline = MultiSearch::DEFAULT_DEADLINE;
+        if (cmd.options.count("timeout") > 0) {
+            double seconds = std::atof(cmd.options["timeout"].c_str());
+            if (seconds > 0) {
+                deadline = std::chrono::milliseconds(static_cast<long long>(seconds * 1000));
+            }
+        }
+        
+        MultiSearch search(deadline);
+        for (const auto& info : pmDetector.detectAll()) {
+            auto pmAdapter = AdapterFactory::create(info);
+            if (!pmAdapter) {
+                continue;  // Detected, but no adapter (snap, flatpak, yum)
+            }
+            if (cmd.dryRun) {
+                UI::printPreview(pmAdapter->getSearchCommand(cmd.packages[0]), false);
+            }
+            search.add(std::move(pmAdapter));
+        }
+        if (cmd.dryRun) {
+            Metrics::setOutcome("dry_run");
+            return 0;
+        }
+        
+        SearchMerger merger(config);
+        auto outcomes = search.run(cmd.packages[0], [&merger](const SearchOutcome& outcome) {
+            UI::printSearchHits(outcome.packageManager, merger.add(outcome));
+        });
+        UI::printSearchSummary(outcomes, merger.duplicates());
+        
+        bool anySucceeded = false;
+        for (const auto& outcome : outcomes) {
+            anySucceeded = anySucceeded || outcome.success;
+        }
+        return anySucceeded ? 0 : 1;
+    }
     
     // Create adapter for the selected package manager
-    auto adapter = AdapterFactory::create(pmInfo.type);
+    auto adapter = AdapterFactory::create(pmInfo);
     if (!adapter) {
         UI::printError("Failed to create adapter for " + pmInfo.name);
         return 1;
     }
     
+    // Let the resolver confirm mapped names against the local repository index
+    if (checkAvailability) {
+        resolver.setAvailabilityCheck([&adapter](const std::string& name) {
+            return adapter->checkAvailable(name) != Availability::MISSING;
+        });
+    }
+    
+    // The installed-package inventory: unipmd's, or the cached one read here
+    Inventory inventory;
+    bool inventoryLoaded = false;
+    auto loadInventory = [&]() {
+        if (!inventoryLoaded) {
+            inventoryLoaded = true;
+            inventory.addSource(pmInfo);
+            inventory.refresh();
+        }
+    };
+    
+    // Installed entries for names (an empty name where absent); false when
+    // the installed set can't be read natively
+    auto findInstalled = [&](const std::vector<std::string>& names,
+                             std::vector<InstalledPackage>& found) {
+        bool tracked = false;
+        if (daemon.installed(names, pmInfo.type, tracked, found)) {
+            return tracked;
+        }
+        loadInventory();
+        found.clear();
+        for (const auto& name : names) {
+            const InstalledPackage* installed = inventory.find(name, pmInfo.type);
+            found.push_back(installed ? *installed : InstalledPackage());
+        }
+        return inventory.isTracked(pmInfo.type);
+    };
+    
+    // Answer list/info from the installed-package inventory when possible
+    if (!cmd.dryRun && cmd.type == CommandType::LIST) {
+        std::vector<InstalledPackage> packages;
+        bool tracked = false;
+        if (!daemon.list(pmInfo.type, tracked, packages)) {
+            loadInventory();
+            tracked = inventory.isTracked(pmInfo.type);
+            if (tracked) {
+                packages = inventory.packages(pmInfo.type);
+            }
+        }
+        if (tracked) {
+            UI::printInstalledPackages(std::move(packages));
+            return 0;
+        }
+    }
+    
+    std::vector<InstalledPackage> found;
+    if (!cmd.dryRun && cmd.type == CommandType::INFO && !cmd.packages.empty() &&
+        findInstalled({cmd.packages[0]}, found)) {
+        ResolvedPackage resolved = resolve(cmd.packages[0], "");
+        Metrics::resolution(resolved);
+        // An installed package with the literal name beats a fuzzy match
+        if (resolved.confidence >= 1.0f || found[0].name.empty()) {
+            findInstalled({resolved.resolvedName}, found);
+        }
+        if (!found[0].name.empty()) {
+            UI::printInstalledInfo(found[0]);
+            return 0;
+        }
+        // Not installed: the PM's repository metadata has the details
+    }
+    
+    if (!cmd.dryRun && cmd.type == CommandType::SEARCH && !cmd.packages.empty()) {
+        std::vector<AvailablePackage> results;
+        bool supported = false;
+        if (!daemon.search(cmd.packages[0], pmInfo.type, supported, results)) {
+            supported = adapter->searchAvailable(cmd.packages[0], results);
+        }
+        if (supported) {
+            UI::printSearchResults(results);
+            return 0;
+        }
+    }
+    
     // Process command
-    std::string command;
+    UNIPM_TRACE_SPAN(planSpan, "plan", "phase");
+    PhaseTimer planTimer("plan");
+    CommandPlan plan;
     std::vector<std::string> resolvedPackages;
     
+    size_t chunkSize = InstallPipeline::DEFAULT_CHUNK_SIZE;
+    if (cmd.options.count("chunk-size") > 0) {
+        long requested = std::atol(cmd.options["chunk-size"].c_str());
+        if (requested > 0) {
+            chunkSize = static_cast<size_t>(requested);
+        }
+    }
+    InstallPipeline pipeline(*adapter, chunkSize);
+    
+    MetadataFreshness freshness;
+    bool refreshMetadata = false;
+    
     switch (cmd.type) {
         case CommandType::INSTALL: {
-            // Resolve package names
-            for (const auto& pkg : cmd.packages) {
-                // Validate package name
-                if (!Safety::isValidPackageName(pkg)) {
-                    UI::printError("Invalid package name: " + pkg);
-                    return 1;
+            if (locked) {
+                // Named packages pick from the lockfile; none installs all of it
+                for (const auto& pkg : cmd.packages) {
+                    std::string packageName = pkg.substr(0, pkg.find(' '));
+                    bool found = false;
+                    for (const auto& entry : lockedEntry->packages) {
+                        if (entry.name == packageName) {
+                            resolvedPackages.push_back(entry.native);
+                            found = true;
+                        }
+                    }
+                    if (!found) {
+                        UI::printError("'" + packageName + "' is not in " + lockfile.path());
+                        return 1;
+                    }
                 }
-                
-                // Split package and version (e.g., "node lts")
-                std::string packageName = pkg;
-                std::string version;
-                
-                size_t spacePos = pkg.find(' ');
-                if (spacePos != std::string::npos) {
-                    packageName = pkg.substr(0, spacePos);
-                    version = pkg.substr(spacePos + 1);
+                if (cmd.packages.empty()) {
+                    for (const auto& entry : lockedEntry->packages) {
+                        resolvedPackages.push_back(entry.native);
+                    }
                 }
-                
-                // Resolve package
-                ResolvedPackage resolved = resolver.resolve(packageName, pmInfo.type, version);
-                
-                if (cmd.verbose) {
-                    UI::printResolution(resolved);
+            } else {
+                std::vector<LockedPackage> resolved;
+                int exitCode = 0;
+                if (!resolveRequests(cmd, cmd.packages, resolve, pmInfo, resolved, exitCode)) {
+                    return exitCode;
+                }
+                for (const auto& entry : resolved) {
+                    resolvedPackages.push_back(entry.native);
+                }
+            }
+            
+            // Leave out packages that are already installed, unless told not to
+            if (cmd.options.count("no-skip") == 0) {
+                auto checkStart = std::chrono::steady_clock::now();
+                std::vector<std::string> installedNames;
+                for (const auto& name : resolvedPackages) {
+                    // Taps don't change the installed formula name
+                    if (pmInfo.type == PackageManager::BREW) {
+                        installedNames.push_back(name.substr(name.find_last_of('/') + 1));
+                    } else {
+                        installedNames.push_back(name);
+                    }
                 }
+                findInstalled(installedNames, found);
                 
-                // Warn if confidence is low
-                if (resolved.confidence < 0.8f && resolved.confidence > 0.0f) {
-                    UI::printWarning("Low confidence match for '" + packageName + "' -> '" + resolved.resolvedName + "'");
-                    
-                    if (!resolved.suggestions.empty()) {
-                        std::cout << "Did you mean:" << std::endl;
-                        for (const auto& suggestion : resolved.suggestions) {
-                            std::cout << "  - " << suggestion << std::endl;
-                        }
-                        
-                        if (!cmd.autoYes) {
-                            if (!UI::confirm("Continue anyway?", false)) {
-                                return 0;
-                            }
-                        }
+                std::vector<std::string> pending;
+                std::vector<std::string> skipped;
+                for (size_t i = 0; i < resolvedPackages.size(); ++i) {
+                    if (!found[i].name.empty()) {
+                        skipped.push_back(resolvedPackages[i]);
+                    } else {
+                        pending.push_back(resolvedPackages[i]);
                     }
-                } else if (resolved.confidence == 0.0f) {
-                    UI::printWarning("Package '" + packageName + "' not found in database, using as-is");
                 }
+                double checkMs = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - checkStart).count();
                 
-                resolvedPackages.push_back(resolved.resolvedName);
+                if (!skipped.empty()) {
+                    InstallTimings timings;
+                    timings.load();
+                    // Skipping everything saves a whole invocation; otherwise a per-package share
+                    double saved = pending.empty()
+                                       ? timings.invocationSeconds(pmInfo.type)
+                                       : timings.perPackageSeconds(pmInfo.type) * skipped.size();
+                    UI::printSkippedPackages(skipped, checkMs, saved, pmInfo.name);
+                }
+                
+                if (pending.empty()) {
+                    UI::printSuccess("Nothing to install");
+                    return 0;
+                }
+                resolvedPackages = pending;
             }
             
-            command = adapter->getInstallCommand(resolvedPackages);
+            if (cmd.options.count("pipeline") > 0) {
+                plan = pipeline.plan(resolvedPackages);
+            } else {
+                plan = adapter->planInstall(resolvedPackages);
+            }
             break;
         }
         
         case CommandType::REMOVE: {
             // Resolve package names for removal
+            PhaseTimer resolveTimer("resolve");
             for (const auto& pkg : cmd.packages) {
-                ResolvedPackage resolved = resolver.resolve(pkg, pmInfo.type);
+                ResolvedPackage resolved = resolve(pkg, "");
+                Metrics::resolution(resolved);
                 resolvedPackages.push_back(resolved.resolvedName);
             }
+            resolveTimer.stop();
             
-            command = adapter->getRemoveCommand(resolvedPackages);
+            plan = adapter->planRemove(resolvedPackages);
             break;
         }
         
         case CommandType::UPDATE: {
-            command = adapter->getUpdateCommand();
+            // Skip the repository index refresh while the indexes are recent
+            int64_t ttl = MetadataFreshness::defaultTtl();
+            if (cmd.options.count("metadata-ttl") > 0) {
+                ttl = std::atoll(cmd.options["metadata-ttl"].c_str());
+            }
+            freshness.load();
+            int64_t age = freshness.ageSeconds(pmInfo.type, adapter->getRepositoryMetadataPaths());
+            bool forced = cmd.options.count("refresh") > 0;
+            refreshMetadata = forced || age < 0 || age >= ttl;
+            
+            if (cmd.verbose) {
+                UI::printMetadataFreshness(pmInfo.name, age, ttl, refreshMetadata, forced);
+            }
+            plan = refreshMetadata ? adapter->planUpdate() : adapter->planUpgrade();
             break;
         }
         
@@ -206,12 +732,12 @@ int main(int argc, char* argv[]) {
                 UI::printError("No search query specified");
                 return 1;
             }
-            command = adapter->getSearchCommand(cmd.packages[0]);
+            plan = adapter->planSearch(cmd.packages[0]);
             break;
         }
         
         case CommandType::LIST: {
-            command = adapter->getListCommand();
+            plan = adapter->planList();
             break;
         }
         
@@ -220,8 +746,9 @@ int main(int argc, char* argv[]) {
                 UI::printError("No package specified");
                 return 1;
             }
-            ResolvedPackage resolved = resolver.resolve(cmd.packages[0], pmInfo.type);
-            command = adapter->getInfoCommand(resolved.resolvedName);
+            ResolvedPackage resolved = resolve(cmd.packages[0], "");
+            Metrics::resolution(resolved);
+            plan = adapter->planInfo(resolved.resolvedName);
             break;
         }
         
@@ -230,16 +757,49 @@ int main(int argc, char* argv[]) {
             return 1;
     }
     
-    // Check if command requires root
-    bool requiresRoot = adapter->requiresRoot();
+    // Point this run at the fastest mirror; the system configuration is left alone
+    std::unique_ptr<MirrorOverride> mirrorOverride;
+    if (cmd.options.count("fastest-mirror") > 0 &&
+        (cmd.type == CommandType::INSTALL || cmd.type == CommandType::UPDATE)) {
+        if (!MirrorOverride::supported(pmInfo.type)) {
+            UI::printWarning("--fastest-mirror is not supported for " + pmInfo.name +
+                             "; 'unipm mirrors' ranks its mirrors");
+        } else {
+            std::vector<Mirror> mirrors;
+            bool cached = false;
+            std::vector<MirrorProbe> ranking = rankMirrors(cmd, pmInfo.type, mirrors, cached);
+            std::string primary = MirrorList::primary(mirrors);
+            std::string fastest = MirrorList::fastest(pmInfo.type, mirrors, ranking);
+            if (!primary.empty() && !fastest.empty() && fastest != primary) {
+                mirrorOverride = std::make_unique<MirrorOverride>(pmInfo.type, primary, fastest);
+                mirrorOverride->apply(plan);
+                UI::printInfo("Using the fastest mirror for this run: " + fastest);
+            } else if (cmd.verbose) {
+                UI::printInfo("The mirror in use is already the fastest");
+            }
+        }
+    }
+    
+    UNIPM_TRACE_END(planSpan);
+    planTimer.stop();
+    
+    // Only state-changing steps need root; queries run unprivileged
+    const std::string command = plan.toString();
+    bool requiresRoot = plan.requiresRoot();
     
     // Dry-run mode
     if (cmd.dryRun) {
-        UI::printPreview(command, requiresRoot);
+        Metrics::setOutcome("dry_run");
+        if (Events::enabled()) {
+            Events::plan(plan, true);
+        } else {
+            UI::printPreview(command, requiresRoot);
+        }
         return 0;
     }
     
     // Confirmation prompt (unless --yes is specified)
+    UNIPM_TRACE_SPAN(confirmSpan, "confirm", "phase");
     if (!cmd.autoYes && cmd.type == CommandType::INSTALL) {
         std::string packageList;
         for (size_t i = 0; i < resolvedPackages.size(); ++i) {
@@ -250,6 +810,7 @@ int main(int argc, char* argv[]) {
         std::string prompt = "Install " + packageList + " using " + pmInfo.name + "?";
         if (!UI::confirm(prompt, true)) {
             UI::printInfo("Installation cancelled");
+            Metrics::setOutcome("cancelled");
             return 0;
         }
     } else if (!cmd.autoYes && cmd.type == CommandType::REMOVE) {
@@ -262,9 +823,11 @@ int main(int argc, char* argv[]) {
         std::string prompt = "Remove " + packageList + " using " + pmInfo.name + "?";
         if (!UI::confirm(prompt, false)) {
             UI::printInfo("Removal cancelled");
+            Metrics::setOutcome("cancelled");
             return 0;
         }
     }
+    UNIPM_TRACE_END(confirmSpan);
     
     // Execute command
     if (!cmd.autoYes) {
@@ -275,11 +838,59 @@ int main(int argc, char* argv[]) {
     }
     std::cout << std::endl;  // Add spacing
     
+    Events::plan(plan, false);
+    
+    if (pipeline.pipelined() && !pipeline.prepare()) {
+        UI::printError("Could not create staging directories for the pipelined install");
+        return 1;
+    }
+    if (mirrorOverride && !mirrorOverride->prepare()) {
+        UI::printError("Could not write the mirror configuration for this run");
+        return 1;
+    }
+    
+    UNIPM_TRACE_SPAN(executeSpan, "execute", "phase");
     Executor executor;
-    ExecutionResult result = executor.execute(command, requiresRoot);
+    executor.setHistoryContext(commandTypeToString(cmd.type), pmInfo.type,
+                               resolvedPackages.empty() ? cmd.packages : resolvedPackages);
+    auto executeStart = std::chrono::steady_clock::now();
+    ExecutionResult result = executor.execute(plan);
+    double executeSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - executeStart).count();
+    Metrics::observe("execute", executeSeconds);
+    
+    if (pipeline.pipelined()) {
+        executor.capture(pipeline.cleanupStep());
+    }
+    if (mirrorOverride) {
+        executor.capture(mirrorOverride->cleanupStep(requiresRoot));
+    }
+    UNIPM_TRACE_END(executeSpan);
+    
+    // Remember how long installs take, to estimate what skipping one saves
+    if (cmd.type == CommandType::INSTALL && result.success) {
+        InstallTimings timings;
+        timings.load();
+        timings.record(pmInfo.type, executeSeconds, resolvedPackages.size());
+        timings.save();
+    }
+    
+    // Redirected apt refreshed its scratch lists, not the system's
+    bool systemRefreshed = !(mirrorOverride && pmInfo.type == PackageManager::APT);
+    if (refreshMetadata && result.success && systemRefreshed) {
+        freshness.markRefreshed(pmInfo.type);
+        freshness.save();
+    }
     
     // Display result - just show success/failure, output already streamed
+    Events::result(result, executeSeconds);
     std::cout << std::endl;  // Add spacing
+    if (result.success && pipeline.pipelined()) {
+        UI::printPipelineSummary(pipeline.chunkCount(), executeSeconds, result.busySeconds);
+    }
+    if (cmd.verbose) {
+        UI::printProcessUsage(result);
+    }
     if (result.success) {
         UI::printSuccess("Installation completed successfully");
     } else {
@@ -288,3 +899,49 @@ int main(int argc, char* argv[]) {
     
     return result.success ? 0 : result.exitCode;
 }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // --trace=<file> records the whole run, argument parsing included
+    std::string tracePath;
+    std::string metricsDir = Metrics::defaultDirectory();
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+            tracePath = argv[i] + 8;
+        } else if (std::strncmp(argv[i], "--metrics-dir=", 14) == 0) {
+            metricsDir = argv[i] + 14;
+        }
+    }
+    
+#ifdef UNIPM_ENABLE_TRACING
+    if (!tracePath.empty()) {
+        Trace::start(tracePath);
+    }
+    int exitCode = 0;
+    {
+        UNIPM_TRACE_SPAN(span, "unipm", "main");
+        std::string args;
+        for (int i = 1; i < argc; ++i) {
+            args += (i > 1 ? " " : "") + std::string(argv[i]);
+        }
+        UNIPM_TRACE_ARG(span, "args", args);
+        exitCode = run(argc, argv);
+        UNIPM_TRACE_ARG(span, "exit_code", static_cast<int64_t>(exitCode));
+    }
+    if (!tracePath.empty() && !Trace::finish()) {
+        std::cerr << "unipm: could not write trace file " << tracePath << std::endl;
+    }
+#else
+    if (!tracePath.empty()) {
+        std::cerr << "unipm: this build has tracing disabled; --trace is ignored" << std::endl;
+    }
+    int exitCode = run(argc, argv);
+#endif
+    
+    // Cumulative totals for node-exporter's textfile collector
+    if (!metricsDir.empty() && !Metrics::write(metricsDir, exitCode)) {
+        std::cerr << "unipm: could not write metrics to " << metricsDir << std::endl;
+    }
+    return exitCode;
+}
@@ -0,0 +1,106 @@
+#include "unipm/mapped_file.h"
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mapped_ = other.mapped_;
+        open_ = other.open_;
+        size_ = other.size_;
+        buffer_ = std::move(other.buffer_);
+        data_ = mapped_ ? other.data_ : buffer_.data();
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.open_ = false;
+        other.mapped_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+        // mmap rejects zero-length mappings; an empty file is still valid
+        ::close(fd);
+        data_ = "";
+        open_ = true;
+        return true;
+    }
+
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+
+    // Metadata files are parsed front to back exactly once
+    madvise(addr, size_, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char*>(addr);
+    mapped_ = true;
+    open_ = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    buffer_ = contents.str();
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    open_ = true;
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped_ && data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    mapped_ = false;
+    buffer_.clear();
+}
+
+} // namespace unipm
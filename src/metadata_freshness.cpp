@@ -0,0 +1,90 @@
+#include "unipm/metadata_freshness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+
+namespace unipm {
+
+namespace {
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+// One line per package manager: <pm> <unix seconds of the last refresh>
+bool MetadataFreshness::load() {
+    refreshedAt_.clear();
+
+    std::string data;
+    if (!Cache::readFile(path_, data)) {
+        return false;
+    }
+
+    std::istringstream in(data);
+    std::string name;
+    int64_t seconds;
+    while (in >> name >> seconds) {
+        PackageManager pm = stringToPackageManager(name);
+        if (pm != PackageManager::UNKNOWN) {
+            refreshedAt_[pm] = seconds;
+        }
+    }
+    return true;
+}
+
+bool MetadataFreshness::save() const {
+    std::ostringstream out;
+    for (const auto& entry : refreshedAt_) {
+        out << packageManagerToString(entry.first) << '\t' << entry.second << '\n';
+    }
+
+    size_t slash = path_.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        Cache::createDirectories(path_.substr(0, slash));
+    }
+    return Cache::writeAtomic(path_, out.str());
+}
+
+int64_t MetadataFreshness::ageSeconds(PackageManager pm,
+                                      const std::vector<std::string>& metadataPaths) const {
+    int64_t newest = -1;
+    auto it = refreshedAt_.find(pm);
+    if (it != refreshedAt_.end()) {
+        newest = it->second;
+    }
+    for (const auto& path : metadataPaths) {
+        FileStamp stamp = Cache::stat(path);
+        if (stamp.exists) {
+            newest = std::max<int64_t>(newest, stamp.mtimeNs / 1000000000LL);
+        }
+    }
+
+    if (newest < 0) {
+        return -1;
+    }
+    // A clock set backwards makes everything look brand new; treat as age 0
+    return std::max<int64_t>(0, nowSeconds() - newest);
+}
+
+void MetadataFreshness::markRefreshed(PackageManager pm) {
+    refreshedAt_[pm] = nowSeconds();
+}
+
+int64_t MetadataFreshness::defaultTtl() {
+    const char* value = std::getenv("UNIPM_METADATA_TTL");
+    if (value && *value) {
+        char* end = nullptr;
+        long long ttl = std::strtoll(value, &end, 10);
+        if (end && *end == '\0' && ttl >= 0) {
+            return ttl;
+        }
+    }
+    return DEFAULT_TTL_SECONDS;
+}
+
+} // namespace unipm
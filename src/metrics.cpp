@@ -0,0 +1,375 @@
+#include "unipm/metrics.h"
+#include "unipm/cache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+namespace {
+
+struct Family {
+    const char* name;
+    const char* type;
+    const char* help;
+};
+
+// Every family unipm writes, in file order
+const Family FAMILIES[] = {
+    {"unipm_operations_total", "counter", "Runs by command, package manager and outcome."},
+    {"unipm_phase_duration_seconds", "histogram",
+     "Time spent resolving names, planning and executing, by package manager."},
+    {"unipm_resolutions_total", "counter",
+     "Package name resolutions by match: exact, fuzzy or passthrough."},
+    {"unipm_low_confidence_matches_total", "counter",
+     "Fuzzy matches below the confidence unipm warns about."},
+    {"unipm_low_confidence_prompts_total", "counter",
+     "Low-confidence matches the user was asked about, by answer."},
+    {"unipm_cache_lookups_total", "counter", "Lookups in unipm's caches by cache and result."},
+    {"unipm_last_run_timestamp_seconds", "gauge", "When unipm last finished a run."},
+    {"unipm_last_success_timestamp_seconds", "gauge",
+     "When unipm last finished a run successfully."},
+};
+
+// What this process recorded since the last write or reset
+struct Run {
+    std::mutex mutex;
+    std::string command;
+    PackageManager pm = PackageManager::UNKNOWN;
+    std::string outcome;
+    std::vector<std::pair<std::string, double>> observations;
+    std::map<std::string, int64_t> resolutions;
+    int64_t lowConfidence = 0;
+    std::map<std::string, int64_t> prompts;
+    std::map<std::pair<std::string, bool>, int64_t> lookups;
+};
+
+Run& current() {
+    static Run run;
+    return run;
+}
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+std::string escapeLabel(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string series(const std::string& name, const Labels& labels) {
+    if (labels.empty()) {
+        return name;
+    }
+    std::string out = name + "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        out += (i > 0 ? "," : "") + labels[i].first + "=\"" + escapeLabel(labels[i].second) + "\"";
+    }
+    return out + "}";
+}
+
+std::string formatValue(double value) {
+    char buffer[32];
+    if (value == static_cast<double>(static_cast<int64_t>(value)) && value < 1e15 &&
+        value > -1e15) {
+        std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+    }
+    return buffer;
+}
+
+// The samples of a textfile, in file order; new series go to the end
+class Samples {
+public:
+    void parse(const std::string& text) {
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find('\n', pos);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string line = text.substr(pos, end - pos);
+            pos = end + 1;
+
+            size_t space = line.rfind(' ');
+            if (line.compare(0, 6, "unipm_") != 0 || space == std::string::npos) {
+                continue;  // Comments, blank lines and anything not ours
+            }
+            set(line.substr(0, space), std::strtod(line.c_str() + space + 1, nullptr));
+        }
+    }
+
+    void add(const std::string& key, double value) { slot(key) += value; }
+    void set(const std::string& key, double value) { slot(key) = value; }
+
+    // Count one observation into a histogram, creating its series in order
+    void observe(const std::string& name, Labels labels, double value) {
+        for (double bound : Metrics::BUCKETS) {
+            Labels bucket = labels;
+            bucket.emplace_back("le", formatValue(bound));
+            add(series(name + "_bucket", bucket), value <= bound ? 1 : 0);
+        }
+        Labels inf = labels;
+        inf.emplace_back("le", "+Inf");
+        add(series(name + "_bucket", inf), 1);
+        add(series(name + "_sum", labels), value);
+        add(series(name + "_count", labels), 1);
+    }
+
+    std::string render() const {
+        std::string out;
+        for (const Family& family : FAMILIES) {
+            std::string header = std::string("# HELP ") + family.name + " " + family.help + "\n" +
+                                 "# TYPE " + family.name + " " + family.type + "\n";
+            bool any = false;
+            for (const auto& sample : samples_) {
+                if (!belongsTo(sample.first, family)) {
+                    continue;
+                }
+                if (!any) {
+                    out += header;
+                    any = true;
+                }
+                out += sample.first + " " + formatValue(sample.second) + "\n";
+            }
+        }
+        return out;
+    }
+
+private:
+    double& slot(const std::string& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            it = index_.emplace(key, samples_.size()).first;
+            samples_.emplace_back(key, 0.0);
+        }
+        return samples_[it->second].second;
+    }
+
+    static bool belongsTo(const std::string& key, const Family& family) {
+        std::string name = key.substr(0, key.find('{'));
+        if (name == family.name) {
+            return true;
+        }
+        if (std::string(family.type) != "histogram") {
+            return false;
+        }
+        const std::string base = family.name;
+        return name == base + "_bucket" || name == base + "_sum" || name == base + "_count";
+    }
+
+    std::vector<std::pair<std::string, double>> samples_;
+    std::unordered_map<std::string, size_t> index_;
+};
+
+// Exclusive lock on a file for the lifetime of the object
+class FileLock {
+public:
+    explicit FileLock(const std::string& path) {
+#ifdef _WIN32
+        handle_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (handle_ != INVALID_HANDLE_VALUE) {
+            LockFileEx(handle_, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &region_);
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ >= 0) {
+            flock(fd_, LOCK_EX);
+        }
+#endif
+    }
+
+    ~FileLock() {
+#ifdef _WIN32
+        if (handle_ != INVALID_HANDLE_VALUE) {
+            UnlockFileEx(handle_, 0, MAXDWORD, MAXDWORD, &region_);
+            CloseHandle(handle_);
+        }
+#else
+        if (fd_ >= 0) {
+            flock(fd_, LOCK_UN);
+            ::close(fd_);
+        }
+#endif
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+#ifdef _WIN32
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+    OVERLAPPED region_ = {};
+#else
+    int fd_ = -1;
+#endif
+};
+
+void clear(Run& run) {
+    run.command.clear();
+    run.pm = PackageManager::UNKNOWN;
+    run.outcome.clear();
+    run.observations.clear();
+    run.resolutions.clear();
+    run.lowConfidence = 0;
+    run.prompts.clear();
+    run.lookups.clear();
+}
+
+} // namespace
+
+std::string Metrics::defaultDirectory() {
+    const char* dir = std::getenv("UNIPM_METRICS_DIR");
+    return dir ? dir : "";
+}
+
+void Metrics::setCommand(const std::string& command) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.command = command;
+}
+
+void Metrics::setPackageManager(PackageManager pm) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.pm = pm;
+}
+
+void Metrics::setOutcome(const std::string& outcome) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.outcome = outcome;
+}
+
+void Metrics::observe(const std::string& phase, double seconds) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.observations.emplace_back(phase, seconds);
+}
+
+void Metrics::resolution(const ResolvedPackage& resolved) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    if (resolved.confidence >= 1.0f) {
+        run.resolutions["exact"]++;
+    } else if (resolved.confidence > 0.0f) {
+        run.resolutions["fuzzy"]++;
+        if (resolved.confidence < LOW_CONFIDENCE) {
+            run.lowConfidence++;
+        }
+    } else {
+        run.resolutions["passthrough"]++;
+    }
+}
+
+void Metrics::lowConfidencePrompt(bool continued) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.prompts[continued ? "continue" : "abort"]++;
+}
+
+void Metrics::cacheLookup(const char* cache, bool hit) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.lookups[{cache, hit}]++;
+}
+
+bool Metrics::write(const std::string& dir, int exitCode) {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    if (run.command.empty()) {
+        return true;
+    }
+    Cache::createDirectories(dir);
+
+    // Read, add and replace under the lock, so concurrent runs both count
+    FileLock fileLock(dir + "/.unipm.prom.lock");
+    const std::string path = dir + "/" + FILE_NAME;
+    Samples samples;
+    std::string text;
+    if (Cache::readFile(path, text)) {
+        samples.parse(text);
+    }
+
+    const std::string pm = packageManagerToString(run.pm);
+    const std::string outcome =
+        !run.outcome.empty() ? run.outcome : (exitCode == 0 ? "success" : "failure");
+    samples.add(series("unipm_operations_total",
+                       {{"command", run.command}, {"pm", pm}, {"outcome", outcome}}),
+                1);
+    for (const auto& observation : run.observations) {
+        samples.observe("unipm_phase_duration_seconds",
+                        {{"phase", observation.first}, {"pm", pm}}, observation.second);
+    }
+    for (const auto& entry : run.resolutions) {
+        samples.add(series("unipm_resolutions_total", {{"match", entry.first}}),
+                    static_cast<double>(entry.second));
+    }
+    if (run.lowConfidence > 0) {
+        samples.add("unipm_low_confidence_matches_total", static_cast<double>(run.lowConfidence));
+    }
+    for (const auto& entry : run.prompts) {
+        samples.add(series("unipm_low_confidence_prompts_total", {{"answer", entry.first}}),
+                    static_cast<double>(entry.second));
+    }
+    for (const auto& entry : run.lookups) {
+        samples.add(series("unipm_cache_lookups_total",
+                           {{"cache", entry.first.first},
+                            {"result", entry.first.second ? "hit" : "miss"}}),
+                    static_cast<double>(entry.second));
+    }
+
+    double now = std::chrono::duration<double>(
+                     std::chrono::system_clock::now().time_since_epoch()).count();
+    samples.set("unipm_last_run_timestamp_seconds", now);
+    if (outcome == "success") {
+        samples.set("unipm_last_success_timestamp_seconds", now);
+    }
+
+    if (!Cache::writeAtomic(path, samples.render())) {
+        return false;
+    }
+    clear(run);
+    return true;
+}
+
+void Metrics::reset() {
+    Run& run = current();
+    std::lock_guard<std::mutex> lock(run.mutex);
+    clear(run);
+}
+
+void PhaseTimer::stop() {
+    if (!stopped_) {
+        stopped_ = true;
+        Metrics::observe(phase_, std::chrono::duration<double>(
+                                     std::chrono::steady_clock::now() - start_).count());
+    }
+}
+
+} // namespace unipm
@@ -0,0 +1,946 @@
+#include "unipm/mirrors.h"
+#include "unipm/deb822.h"
+#include "unipm/metrics.h"
+#include "unipm/parallel.h"
+#include "unipm/trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double MIB = 1024.0 * 1024.0;
+
+// Fewer body bytes than this can't be timed meaningfully; latency only
+constexpr size_t MIN_THROUGHPUT_BYTES = 16 * 1024;
+
+// Probes are mostly waiting on the network, so every mirror gets a thread
+constexpr size_t MAX_PROBE_THREADS = 32;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+bool startsWith(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool endsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return std::string(text);
+}
+
+std::vector<std::string> splitWords(std::string_view text, const char* separators = " \t") {
+    std::vector<std::string> words;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t start = text.find_first_not_of(separators, pos);
+        if (start == std::string_view::npos) {
+            break;
+        }
+        size_t end = text.find_first_of(separators, start);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        words.emplace_back(text.substr(start, end - start));
+        pos = end;
+    }
+    return words;
+}
+
+std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+std::string stripSlashes(std::string url) {
+    while (url.size() > 1 && url.back() == '/') {
+        url.pop_back();
+    }
+    return url;
+}
+
+void replaceAll(std::string& text, const std::string& from, const std::string& to) {
+    for (size_t pos = text.find(from); pos != std::string::npos;
+         pos = text.find(from, pos + to.size())) {
+        text.replace(pos, from.size(), to);
+    }
+}
+
+// Regular files in dir whose names end in suffix, sorted
+std::vector<std::string> listFiles(const std::string& dir, const std::string& suffix) {
+    std::vector<std::string> names;
+#ifndef _WIN32
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return names;
+    }
+    while (struct dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (name[0] != '.' && endsWith(name, suffix)) {
+            names.push_back(name);
+        }
+    }
+    closedir(handle);
+    std::sort(names.begin(), names.end());
+#else
+    (void)dir;
+    (void)suffix;
+#endif
+    return names;
+}
+
+// Mirrors collected while reading configuration, with how many entries use each
+class MirrorSet {
+public:
+    void add(std::string url, std::string probePath, bool configured) {
+        url = stripSlashes(std::move(url));
+        // Only HTTP mirrors can be probed or swapped; not file:, cdrom: or mirror+
+        if (!startsWith(url, "http://") && !startsWith(url, "https://")) {
+            return;
+        }
+        for (size_t i = 0; i < mirrors_.size(); ++i) {
+            if (mirrors_[i].url == url) {
+                mirrors_[i].configured = mirrors_[i].configured || configured;
+                uses_[i] += configured ? 1 : 0;
+                return;
+            }
+        }
+        mirrors_.push_back({std::move(url), std::move(probePath), configured});
+        uses_.push_back(configured ? 1 : 0);
+    }
+
+    // Mirrors in use first, the most used of those first
+    std::vector<Mirror> sorted() const {
+        std::vector<size_t> order(mirrors_.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            if (mirrors_[a].configured != mirrors_[b].configured) {
+                return mirrors_[a].configured;
+            }
+            return uses_[a] > uses_[b];
+        });
+
+        std::vector<Mirror> result;
+        for (size_t i : order) {
+            result.push_back(mirrors_[i]);
+        }
+        return result;
+    }
+
+private:
+    std::vector<Mirror> mirrors_;
+    std::vector<int> uses_;
+};
+
+// apt fetches dists/<suite>/InRelease, or <suite>InRelease for flat repositories
+std::string aptProbePath(const std::string& suite) {
+    if (endsWith(suite, "/")) {
+        return (suite == "./" || suite == "/" ? std::string() : suite) + "InRelease";
+    }
+    return "dists/" + suite + "/InRelease";
+}
+
+// deb [options] uri suite [component...]
+void readAptOneLine(const std::string& text, MirrorSet& mirrors) {
+    for (const auto& raw : splitLines(text)) {
+        std::vector<std::string> words = splitWords(raw.substr(0, raw.find('#')));
+        if (words.empty() || (words[0] != "deb" && words[0] != "deb-src")) {
+            continue;
+        }
+        size_t i = 1;
+        if (i < words.size() && startsWith(words[i], "[")) {
+            while (i < words.size() && !endsWith(words[i], "]")) {
+                ++i;
+            }
+            ++i;
+        }
+        if (i + 1 < words.size()) {
+            mirrors.add(words[i], aptProbePath(words[i + 1]), true);
+        }
+    }
+}
+
+void readAptDeb822(const std::string& text, MirrorSet& mirrors) {
+    std::vector<std::string> uris;
+    std::vector<std::string> suites;
+    bool enabled = true;
+    deb822::parse(
+        text,
+        [&](std::string_view key, std::string_view value) {
+            if (key == "URIs") {
+                uris = splitWords(value);
+            } else if (key == "Suites") {
+                suites = splitWords(value);
+            } else if (key == "Enabled") {
+                enabled = value != "no";
+            }
+        },
+        [&]() {
+            // One use per suite, as if each were a one-line entry
+            for (const auto& uri : uris) {
+                for (size_t i = 0; enabled && i < suites.size(); ++i) {
+                    mirrors.add(uri, aptProbePath(suites[i]), true);
+                }
+            }
+            uris.clear();
+            suites.clear();
+            enabled = true;
+        });
+}
+
+std::vector<Mirror> readApt(const std::string& root) {
+    MirrorSet mirrors;
+    std::string text;
+    if (Cache::readFile(root + "/etc/apt/sources.list", text)) {
+        readAptOneLine(text, mirrors);
+    }
+
+    const std::string parts = root + "/etc/apt/sources.list.d";
+    for (const auto& name : listFiles(parts, ".list")) {
+        if (Cache::readFile(parts + "/" + name, text)) {
+            readAptOneLine(text, mirrors);
+        }
+    }
+    for (const auto& name : listFiles(parts, ".sources")) {
+        if (Cache::readFile(parts + "/" + name, text)) {
+            readAptDeb822(text, mirrors);
+        }
+    }
+    return mirrors.sorted();
+}
+
+// The value of a `key = value` line, with leading #s marking a disabled entry
+bool parseSetting(const std::string& line, const std::string& key, std::string& value,
+                  bool& commented) {
+    std::string text = trim(line);
+    commented = false;
+    while (!text.empty() && text[0] == '#') {
+        commented = true;
+        text = trim(std::string_view(text).substr(1));
+    }
+    if (!startsWith(text, key)) {
+        return false;
+    }
+    std::string rest = trim(std::string_view(text).substr(key.size()));
+    if (rest.empty() || rest[0] != '=') {
+        return false;
+    }
+    value = trim(std::string_view(rest).substr(1));
+    return !value.empty();
+}
+
+// pacman tries Server lines in order; commented-out ones are the usual alternatives
+std::vector<Mirror> readPacman(const std::string& root) {
+    MirrorSet mirrors;
+    std::string text;
+    if (Cache::readFile(root + "/etc/pacman.d/mirrorlist", text)) {
+        for (const auto& line : splitLines(text)) {
+            std::string value;
+            bool commented;
+            if (parseSetting(line, "Server", value, commented)) {
+                mirrors.add(value, "core.db", !commented);
+            }
+        }
+    }
+    return mirrors.sorted();
+}
+
+// baseurl of every enabled [repo] section
+std::vector<Mirror> readDnf(const std::string& root) {
+    MirrorSet mirrors;
+    const std::string dir = root + "/etc/yum.repos.d";
+    for (const auto& name : listFiles(dir, ".repo")) {
+        std::string text;
+        if (!Cache::readFile(dir + "/" + name, text)) {
+            continue;
+        }
+
+        std::vector<std::pair<std::string, bool>> urls;
+        bool enabled = true;
+        auto flush = [&]() {
+            if (enabled) {
+                for (const auto& [url, configured] : urls) {
+                    mirrors.add(url, "repodata/repomd.xml", configured);
+                }
+            }
+            urls.clear();
+            enabled = true;
+        };
+
+        for (const auto& line : splitLines(text)) {
+            std::string value;
+            bool commented;
+            if (startsWith(trim(line), "[")) {
+                flush();
+            } else if (parseSetting(line, "enabled", value, commented) && !commented) {
+                enabled = value != "0";
+            } else if (parseSetting(line, "baseurl", value, commented)) {
+                for (const auto& url : splitWords(value, " \t,")) {
+                    urls.emplace_back(url, !commented);
+                }
+            }
+        }
+        flush();
+    }
+    return mirrors.sorted();
+}
+
+std::string machine() {
+#ifndef _WIN32
+    struct utsname buffer;
+    if (uname(&buffer) == 0) {
+        return buffer.machine;
+    }
+#endif
+    return "x86_64";
+}
+
+std::string releaseVersion(const std::string& root) {
+    std::string text;
+    if (Cache::readFile(root + "/etc/os-release", text)) {
+        for (const auto& line : splitLines(text)) {
+            if (startsWith(line, "VERSION_ID=")) {
+                std::string value = line.substr(11);
+                value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+                return value;
+            }
+        }
+    }
+    return "";
+}
+
+struct Url {
+    std::string scheme;
+    std::string host;
+    std::string port;
+    std::string path;
+};
+
+bool parseUrl(const std::string& text, Url& url) {
+    size_t schemeEnd = text.find("://");
+    if (schemeEnd == std::string::npos) {
+        return false;
+    }
+    url.scheme = text.substr(0, schemeEnd);
+    size_t hostStart = schemeEnd + 3;
+    size_t pathStart = text.find('/', hostStart);
+    std::string authority = text.substr(hostStart, pathStart - hostStart);
+    url.path = pathStart == std::string::npos ? "/" : text.substr(pathStart);
+    url.port = url.scheme == "https" ? "443" : "80";
+
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+        url.port = authority.substr(colon + 1);
+        authority.resize(colon);
+    }
+    if (authority.size() > 2 && authority.front() == '[' && authority.back() == ']') {
+        authority = authority.substr(1, authority.size() - 2);
+    }
+    url.host = authority;
+    return !url.host.empty();
+}
+
+#ifndef _WIN32
+// Connected non-blocking socket, or -1 with probe.error set
+int connectTo(const Url& url, Clock::time_point deadline, MirrorProbe& probe) {
+    auto start = Clock::now();
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &addresses) != 0) {
+        probe.error = "cannot resolve " + url.host;
+        return -1;
+    }
+
+    int connected = -1;
+    for (addrinfo* ai = addresses; ai && connected < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc != 0 && errno == EINPROGRESS) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - Clock::now());
+            pollfd pfd{fd, POLLOUT, 0};
+            if (remaining.count() > 0 && poll(&pfd, 1, static_cast<int>(remaining.count())) == 1) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+                rc = error == 0 ? 0 : -1;
+            }
+        }
+        if (rc == 0) {
+            connected = fd;
+        } else {
+            close(fd);
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (connected < 0) {
+        probe.error = Clock::now() >= deadline ? "connect timed out" : "connection refused";
+        return -1;
+    }
+    probe.connectMs = elapsedMs(start);
+    return connected;
+}
+
+bool sendAll(int fd, const std::string& data, Clock::time_point deadline) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false;
+        }
+        auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        pollfd pfd{fd, POLLOUT, 0};
+        if (remaining.count() <= 0 || poll(&pfd, 1, static_cast<int>(remaining.count())) != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One ranged GET over plain HTTP, timed from the socket up
+void probeHttp(const Url& url, std::chrono::milliseconds timeout, MirrorProbe& probe) {
+    const Clock::time_point deadline = Clock::now() + timeout;
+    int fd = connectTo(url, deadline, probe);
+    if (fd < 0) {
+        return;
+    }
+
+    bool defaultPort = url.port == "80";
+    std::string host = url.host.find(':') != std::string::npos ? "[" + url.host + "]" : url.host;
+    std::string request = "GET " + url.path + " HTTP/1.1\r\n" +
+                          "Host: " + host + (defaultPort ? "" : ":" + url.port) + "\r\n" +
+                          "Range: bytes=0-" + std::to_string(MirrorProber::PROBE_BYTES - 1) +
+                          "\r\n" + "User-Agent: unipm\r\nConnection: close\r\n\r\n";
+    auto sentAt = Clock::now();
+    if (!sendAll(fd, request, deadline)) {
+        close(fd);
+        probe.error = "request failed";
+        return;
+    }
+
+    std::string header;
+    int status = 0;
+    size_t bodyBytes = 0;
+    Clock::time_point firstByteAt;
+    Clock::time_point lastByteAt;
+    char buffer[16384];
+    bool timedOut = false;
+    while (bodyBytes < MirrorProber::PROBE_BYTES) {
+        auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        pollfd pfd{fd, POLLIN, 0};
+        if (remaining.count() <= 0 || poll(&pfd, 1, static_cast<int>(remaining.count())) != 1) {
+            timedOut = true;
+            break;
+        }
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        lastByteAt = Clock::now();
+        if (probe.firstByteMs < 0) {
+            firstByteAt = lastByteAt;
+            probe.firstByteMs =
+                std::chrono::duration<double, std::milli>(firstByteAt - sentAt).count();
+        }
+        if (status == 0) {
+            header.append(buffer, static_cast<size_t>(n));
+            size_t end = header.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                if (header.size() > sizeof(buffer)) {
+                    break;
+                }
+                continue;
+            }
+            // HTTP/1.1 206 Partial Content
+            size_t space = header.find(' ');
+            status = space == std::string::npos ? -1 : std::atoi(header.c_str() + space + 1);
+            if (status < 200 || status >= 300) {
+                break;
+            }
+            bodyBytes = header.size() - (end + 4);
+        } else {
+            bodyBytes += static_cast<size_t>(n);
+        }
+    }
+    close(fd);
+
+    if (status <= 0) {
+        probe.error = timedOut ? "timed out" : "no HTTP response";
+        return;
+    }
+    if (status >= 400) {
+        probe.error = "HTTP " + std::to_string(status);
+        return;
+    }
+
+    // A redirect still answers for the mirror's latency
+    probe.reachable = true;
+    double seconds = std::chrono::duration<double>(lastByteAt - firstByteAt).count();
+    if (status < 300 && bodyBytes >= MIN_THROUGHPUT_BYTES) {
+        probe.bytesPerSecond = static_cast<double>(bodyBytes) / std::max(seconds, 1e-6);
+    }
+}
+
+// https through curl; false when curl isn't installed
+bool probeCurl(const std::string& url, std::chrono::milliseconds timeout, MirrorProbe& probe) {
+    char seconds[32];
+    std::snprintf(seconds, sizeof(seconds), "%.3f", timeout.count() / 1000.0);
+    std::string command = "curl -s -o /dev/null -r 0-" +
+                          std::to_string(MirrorProber::PROBE_BYTES - 1) + " --max-time " +
+                          seconds +
+                          " -w '%{http_code} %{time_connect} %{time_starttransfer} "
+                          "%{time_total} %{size_download}' " +
+                          shellQuote(url) + " 2>/dev/null";
+    UNIPM_TRACE_SPAN(span, "curl", "process");
+    UNIPM_TRACE_ARG(span, "url", url);
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return false;
+    }
+    UNIPM_TRACE_PROCESS_STARTED();
+    char buffer[256] = {};
+    size_t n = std::fread(buffer, 1, sizeof(buffer) - 1, pipe);
+    buffer[n] = '\0';
+    int status = pclose(pipe);
+    UNIPM_TRACE_PROCESS_EXITED();
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        return false;
+    }
+
+    int code = 0;
+    double connect = 0.0;
+    double firstByte = 0.0;
+    double total = 0.0;
+    double size = 0.0;
+    if (std::sscanf(buffer, "%d %lf %lf %lf %lf", &code, &connect, &firstByte, &total, &size) !=
+            5 ||
+        code == 0) {
+        probe.error = WIFEXITED(status) && WEXITSTATUS(status) == 28 ? "timed out" : "no response";
+        return true;
+    }
+    if (code >= 400) {
+        probe.error = "HTTP " + std::to_string(code);
+        return true;
+    }
+
+    // The TLS handshake counts towards the first byte, as it would for the PM
+    probe.reachable = true;
+    probe.connectMs = connect * 1000.0;
+    probe.firstByteMs = (firstByte - connect) * 1000.0;
+    if (code < 300 && size >= MIN_THROUGHPUT_BYTES) {
+        probe.bytesPerSecond = size / std::max(total - firstByte, 1e-6);
+    }
+    return true;
+}
+#endif
+
+// Keep tabs and newlines out of the cache file's fields
+std::string sanitize(std::string text) {
+    std::replace_if(
+        text.begin(), text.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; },
+        ' ');
+    return text;
+}
+
+bool isUrlChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || std::strchr("+-._~:/%@", c) != nullptr;
+}
+
+} // namespace
+
+double MirrorProbe::cost() const {
+    if (!reachable) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (bytesPerSecond > 0) {
+        return std::max(firstByteMs, 0.0) + MIB / bytesPerSecond * 1000.0;
+    }
+    return firstByteMs >= 0 ? firstByteMs : connectMs;
+}
+
+MirrorProber::MirrorProber(std::chrono::milliseconds timeout, std::string root)
+    : timeout_(timeout), root_(std::move(root)) {}
+
+std::string MirrorProber::probeUrl(const Mirror& mirror) const {
+    std::string url = mirror.url;
+    if (url.find('$') != std::string::npos) {
+        replaceAll(url, "$basearch", machine());
+        replaceAll(url, "$arch", machine());
+        replaceAll(url, "$repo", "core");
+        replaceAll(url, "$releasever", releaseVersion(root_));
+    }
+    if (!mirror.probePath.empty()) {
+        url = stripSlashes(url) + "/" + mirror.probePath;
+    }
+    return url;
+}
+
+MirrorProbe MirrorProber::probe(const Mirror& mirror) const {
+    MirrorProbe probe;
+    probe.url = mirror.url;
+
+#ifdef _WIN32
+    probe.error = "not supported on Windows";
+#else
+    std::string target = probeUrl(mirror);
+    Url url;
+    if (!parseUrl(target, url) || (url.scheme != "http" && url.scheme != "https")) {
+        probe.error = "unsupported URL";
+    } else if (url.scheme == "http") {
+        probeHttp(url, timeout_, probe);
+    } else if (!probeCurl(target, timeout_, probe)) {
+        // Without curl only the TCP connect can be timed
+        int fd = connectTo(url, Clock::now() + timeout_, probe);
+        if (fd >= 0) {
+            close(fd);
+            probe.reachable = true;
+        }
+    }
+#endif
+    return probe;
+}
+
+std::vector<MirrorProbe> MirrorProber::rank(const std::vector<Mirror>& mirrors) const {
+    UNIPM_TRACE_SPAN(span, "MirrorProber::rank", "mirrors");
+    UNIPM_TRACE_ARG(span, "mirrors", static_cast<int64_t>(mirrors.size()));
+    std::vector<MirrorProbe> probes(mirrors.size());
+    parallelFor(
+        mirrors.size(), [&](size_t i) { probes[i] = probe(mirrors[i]); },
+        std::min(mirrors.size(), MAX_PROBE_THREADS));
+
+    // Measured throughput beats latency alone; unreachable mirrors go last
+    auto group = [](const MirrorProbe& p) { return !p.reachable ? 2 : p.bytesPerSecond > 0 ? 0 : 1; };
+    std::stable_sort(probes.begin(), probes.end(),
+                     [&group](const MirrorProbe& a, const MirrorProbe& b) {
+                         if (group(a) != group(b)) {
+                             return group(a) < group(b);
+                         }
+                         return a.cost() < b.cost();
+                     });
+    return probes;
+}
+
+std::vector<Mirror> MirrorList::read(PackageManager pm, const std::string& root) {
+    switch (pm) {
+        case PackageManager::APT: return readApt(root);
+        case PackageManager::PACMAN: return readPacman(root);
+        case PackageManager::DNF:
+        case PackageManager::YUM: return readDnf(root);
+        default: return {};
+    }
+}
+
+std::string MirrorList::primary(const std::vector<Mirror>& mirrors) {
+    // read() puts the mirrors in use first, the most used first
+    return !mirrors.empty() && mirrors.front().configured ? mirrors.front().url : "";
+}
+
+Mirror MirrorList::candidate(const std::string& url, const std::vector<Mirror>& mirrors) {
+    return {stripSlashes(url), mirrors.empty() ? "" : mirrors.front().probePath, false};
+}
+
+std::string MirrorList::fastest(PackageManager pm, const std::vector<Mirror>& mirrors,
+                                const std::vector<MirrorProbe>& ranking) {
+    const std::string current = primary(mirrors);
+    for (const auto& probe : ranking) {
+        if (!probe.reachable) {
+            break;
+        }
+        bool otherRepository =
+            pm != PackageManager::PACMAN && probe.url != current &&
+            std::any_of(mirrors.begin(), mirrors.end(), [&probe](const Mirror& mirror) {
+                return mirror.configured && mirror.url == probe.url;
+            });
+        if (!otherRepository) {
+            return probe.url;
+        }
+    }
+    return "";
+}
+
+// One line per probe: <pm> <probed at> <reachable> <connect ms> <first byte ms>
+// <bytes/s> <url> <error>, tab-separated, in rank order
+bool MirrorRanking::load() {
+    rankings_.clear();
+
+    std::string data;
+    if (!Cache::readFile(path_, data)) {
+        return false;
+    }
+
+    for (const auto& line : splitLines(data)) {
+        std::vector<std::string> fields;
+        std::istringstream in(line);
+        std::string field;
+        while (std::getline(in, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 7) {
+            continue;
+        }
+        PackageManager pm = stringToPackageManager(fields[0]);
+        if (pm == PackageManager::UNKNOWN) {
+            continue;
+        }
+
+        MirrorProbe probe;
+        probe.reachable = fields[2] == "1";
+        probe.connectMs = std::atof(fields[3].c_str());
+        probe.firstByteMs = std::atof(fields[4].c_str());
+        probe.bytesPerSecond = std::atof(fields[5].c_str());
+        probe.url = fields[6];
+        probe.error = fields.size() > 7 ? fields[7] : "";
+
+        auto& entry = rankings_[pm];
+        entry.first = std::atoll(fields[1].c_str());
+        entry.second.push_back(std::move(probe));
+    }
+    return true;
+}
+
+bool MirrorRanking::save() const {
+    std::ostringstream out;
+    for (const auto& [pm, entry] : rankings_) {
+        for (const auto& probe : entry.second) {
+            out << packageManagerToString(pm) << '\t' << entry.first << '\t'
+                << (probe.reachable ? 1 : 0) << '\t' << probe.connectMs << '\t'
+                << probe.firstByteMs << '\t' << probe.bytesPerSecond << '\t'
+                << sanitize(probe.url) << '\t' << sanitize(probe.error) << '\n';
+        }
+    }
+
+    size_t slash = path_.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        Cache::createDirectories(path_.substr(0, slash));
+    }
+    return Cache::writeAtomic(path_, out.str());
+}
+
+const std::vector<MirrorProbe>* MirrorRanking::find(PackageManager pm, int64_t ttlSeconds) const {
+    auto it = rankings_.find(pm);
+    if (it == rankings_.end() || it->second.second.empty()) {
+        Metrics::cacheLookup("mirror_ranking", false);
+        return nullptr;
+    }
+    int64_t age = nowSeconds() - it->second.first;
+    bool fresh = age >= 0 && age < ttlSeconds;
+    Metrics::cacheLookup("mirror_ranking", fresh);
+    return fresh ? &it->second.second : nullptr;
+}
+
+void MirrorRanking::set(PackageManager pm, std::vector<MirrorProbe> ranking) {
+    rankings_[pm] = {nowSeconds(), std::move(ranking)};
+}
+
+MirrorOverride::MirrorOverride(PackageManager pm, std::string from, std::string to,
+                               std::string dir, std::string root)
+    : pm_(pm),
+      from_(stripSlashes(std::move(from))),
+      to_(stripSlashes(std::move(to))),
+      dir_(std::move(dir)),
+      root_(std::move(root)) {}
+
+bool MirrorOverride::supported(PackageManager pm) {
+    return pm == PackageManager::APT || pm == PackageManager::PACMAN;
+}
+
+std::string MirrorOverride::defaultDirectory() {
+    return Cache::pathFor("mirror-" + std::to_string(getpid()));
+}
+
+std::string MirrorOverride::rewrite(const std::string& text, const std::string& from,
+                                    const std::string& to) {
+    const std::string source = stripSlashes(from);
+    const std::string target = stripSlashes(to);
+    if (source.empty()) {
+        return text;
+    }
+
+    std::string out;
+    size_t copied = 0;
+    for (size_t pos = text.find(source); pos != std::string::npos;
+         pos = text.find(source, pos + 1)) {
+        size_t after = pos + source.size();
+        bool startsUrl = pos == 0 || !isUrlChar(text[pos - 1]);
+        bool endsUrl = after == text.size() || !isUrlChar(text[after]) || text[after] == '/';
+        if (pos < copied || !startsUrl || !endsUrl) {
+            continue;
+        }
+        out.append(text, copied, pos - copied);
+        out += target;
+        copied = after;
+    }
+    out.append(text, copied, std::string::npos);
+    return out;
+}
+
+bool MirrorOverride::prepare() const {
+    if (!Cache::createDirectories(dir_)) {
+        return false;
+    }
+
+    std::string text;
+    if (pm_ == PackageManager::APT) {
+        const std::string etc = root_ + "/etc/apt";
+        if (!Cache::readFile(etc + "/sources.list", text)) {
+            text.clear();
+        }
+        if (!Cache::writeAtomic(dir_ + "/sources.list", rewrite(text, from_, to_)) ||
+            !Cache::createDirectories(dir_ + "/sources.list.d") ||
+            !Cache::createDirectories(dir_ + "/lists/partial")) {
+            return false;
+        }
+        for (const char* suffix : {".list", ".sources"}) {
+            for (const auto& name : listFiles(etc + "/sources.list.d", suffix)) {
+                if (Cache::readFile(etc + "/sources.list.d/" + name, text) &&
+                    !Cache::writeAtomic(dir_ + "/sources.list.d/" + name,
+                                        rewrite(text, from_, to_))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    if (pm_ == PackageManager::PACMAN) {
+        const std::string mirrorlist = "/etc/pacman.d/mirrorlist";
+        if (!Cache::readFile(root_ + "/etc/pacman.conf", text)) {
+            return false;
+        }
+        std::string conf;
+        for (const auto& line : splitLines(text)) {
+            std::string value;
+            bool commented;
+            if (parseSetting(line, "Include", value, commented) && !commented &&
+                value == mirrorlist) {
+                conf += "Include = " + dir_ + "/mirrorlist\n";
+            } else {
+                conf += line + "\n";
+            }
+        }
+
+        // pacman tries servers in order, so the fastest goes first and the
+        // configured ones stay behind it as fallbacks
+        std::string servers;
+        if (!Cache::readFile(root_ + mirrorlist, servers)) {
+            servers.clear();
+        }
+        return Cache::writeAtomic(dir_ + "/pacman.conf", conf) &&
+               Cache::writeAtomic(dir_ + "/mirrorlist", "Server = " + to_ + "\n" + servers);
+    }
+    return false;
+}
+
+void MirrorOverride::apply(CommandPlan& plan) const {
+    std::vector<std::string> options;
+    std::vector<std::string> binaries;
+    if (pm_ == PackageManager::APT) {
+        options = {"-o", "Dir::Etc::SourceList=" + dir_ + "/sources.list",
+                   "-o", "Dir::Etc::SourceParts=" + dir_ + "/sources.list.d",
+                   "-o", "Dir::State::Lists=" + dir_ + "/lists/"};
+        binaries = {"apt", "apt-get"};
+    } else if (pm_ == PackageManager::PACMAN) {
+        options = {"--config", dir_ + "/pacman.conf"};
+        binaries = {"pacman"};
+    } else {
+        return;
+    }
+
+    bool applied = false;
+    bool updates = false;
+    for (auto& step : plan.steps) {
+        if (step.argv.empty() ||
+            std::find(binaries.begin(), binaries.end(), step.argv[0]) == binaries.end()) {
+            continue;
+        }
+        step.argv.insert(step.argv.begin() + 1, options.begin(), options.end());
+        if (step.operandIndex > 0) {
+            step.operandIndex += options.size();
+        }
+        applied = true;
+        updates = updates || (step.argv.size() > options.size() + 1 &&
+                              step.argv[options.size() + 1] == "update");
+    }
+
+    // The scratch lists start out empty
+    if (pm_ == PackageManager::APT && applied && !updates) {
+        std::vector<std::string> argv = {"apt"};
+        argv.insert(argv.end(), options.begin(), options.end());
+        argv.push_back("update");
+        plan.steps.insert(plan.steps.begin(),
+                          CommandStep::mutation(std::move(argv), "apt-lists:" + dir_, true));
+    }
+}
+
+CommandStep MirrorOverride::cleanupStep(bool requiresRoot) const {
+    return CommandStep::mutation({"rm", "-rf", dir_}, "", requiresRoot);
+}
+
+} // namespace unipm
@@ -0,0 +1,126 @@
+#include "unipm/multi_search.h"
+#include "unipm/executor.h"
+#include "unipm/trace.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace unipm {
+
+void MultiSearch::add(std::unique_ptr<PackageManagerAdapter> adapter) {
+    if (adapter) {
+        adapters_.push_back(std::move(adapter));
+    }
+}
+
+std::vector<SearchOutcome> MultiSearch::run(
+    const std::string& query, const std::function<void(const SearchOutcome&)>& onOutcome) {
+    UNIPM_TRACE_SPAN(span, "MultiSearch::run", "search");
+    UNIPM_TRACE_ARG(span, "query", query);
+    std::vector<SearchOutcome> outcomes(adapters_.size());
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<size_t> finished;
+
+    std::vector<std::thread> workers;
+    workers.reserve(adapters_.size());
+    for (size_t i = 0; i < adapters_.size(); ++i) {
+        workers.emplace_back([&, i]() {
+            SearchOutcome outcome = searchOne(*adapters_[i], query);
+            std::lock_guard<std::mutex> lock(mutex);
+            outcomes[i] = std::move(outcome);
+            finished.push_back(i);
+            ready.notify_one();
+        });
+    }
+
+    // Report each manager as soon as it answers
+    for (size_t reported = 0; reported < adapters_.size(); ++reported) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&]() { return !finished.empty(); });
+            index = finished.front();
+            finished.pop_front();
+        }
+        if (onOutcome) {
+            onOutcome(outcomes[index]);
+        }
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return outcomes;
+}
+
+SearchOutcome MultiSearch::searchOne(PackageManagerAdapter& adapter, const std::string& query) {
+    UNIPM_TRACE_SPAN(span, "MultiSearch::searchOne", "search");
+    UNIPM_TRACE_RENAME(span, "search: " + adapter.getName());
+    SearchOutcome outcome;
+    outcome.packageManager = adapter.getType();
+    auto start = std::chrono::steady_clock::now();
+
+    if (adapter.searchAvailable(query, outcome.results)) {
+        outcome.success = true;
+    } else {
+        // Only the query step runs; searches never need root or a lock
+        CommandPlan plan = adapter.planSearch(query);
+        Executor executor;
+        ExecutionResult result;
+        result.success = !plan.empty();
+        for (const auto& step : plan.steps) {
+            result = executor.capture(step, deadline_);
+            if (!result.success) break;
+        }
+
+        outcome.timedOut = result.timedOut;
+        // Some managers exit non-zero when nothing matches
+        outcome.success = !result.timedOut &&
+                          adapter.parseSearchOutput(result.stdoutOutput, outcome.results);
+    }
+
+    for (auto& pkg : outcome.results) {
+        pkg.packageManager = outcome.packageManager;
+    }
+    outcome.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return outcome;
+}
+
+std::string SearchMerger::canonicalName(const AvailablePackage& pkg) const {
+    std::string canonical;
+    if (config_) {
+        canonical = config_->getCanonicalName(pkg.name, pkg.packageManager);
+    }
+    return canonical.empty() ? pkg.name : canonical;
+}
+
+std::vector<AvailablePackage> SearchMerger::add(const SearchOutcome& outcome) {
+    std::vector<AvailablePackage> fresh;
+    for (const auto& pkg : outcome.results) {
+        auto& managers = sources_[canonicalName(pkg)];
+        if (std::find(managers.begin(), managers.end(), pkg.packageManager) != managers.end()) {
+            continue;  // Same package listed twice by one manager (e.g. multi-arch)
+        }
+        managers.push_back(pkg.packageManager);
+        if (managers.size() == 1) {
+            fresh.push_back(pkg);
+        }
+    }
+    return fresh;
+}
+
+std::map<std::string, std::vector<PackageManager>> SearchMerger::duplicates() const {
+    std::map<std::string, std::vector<PackageManager>> result;
+    for (const auto& entry : sources_) {
+        if (entry.second.size() > 1) {
+            result.insert(entry);
+        }
+    }
+    return result;
+}
+
+} // namespace unipm
@@ -1,4 +1,5 @@
 #include "unipm/os_detector.h"
+#include "unipm/trace.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -13,6 +14,7 @@
 namespace unipm {
 
 OSInfo OSDetector::detect() {
+    UNIPM_TRACE_SCOPE("OSDetector::detect", "detect");
 #ifdef _WIN32
     return detectWindows();
 #elif __APPLE__
@@ -147,17 +149,22 @@ OSInfo OSDetector::detectFromLSBRelease() {
     info.distro = LinuxDistro::UNKNOWN;
     
     // Try to execute lsb_release -a
-    FILE* pipe = popen("lsb_release -is 2>/dev/null", "r");
-    if (!pipe) {
-        return info;
-    }
-    
-    char buffer[128];
     std::string result;
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
+    {
+        UNIPM_TRACE_SCOPE("sh: lsb_release -is", "process");
+        FILE* pipe = popen("lsb_release -is 2>/dev/null", "r");
+        if (!pipe) {
+            return info;
+        }
+        UNIPM_TRACE_PROCESS_STARTED();
+        
+        char buffer[128];
+        while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+            result += buffer;
+        }
+        pclose(pipe);
+        UNIPM_TRACE_PROCESS_EXITED();
     }
-    pclose(pipe);
     
     // Trim whitespace
     result.erase(result.find_last_not_of(" \n\r\t") + 1);
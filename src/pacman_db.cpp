@@ -0,0 +1,193 @@
+#include "unipm/pacman_db.h"
+#include "unipm/parallel.h"
+#include "unipm/trace.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+namespace {
+
+#ifndef _WIN32
+// Read a whole (small) file relative to an open directory
+bool readAt(int dirfd, const std::string& relPath, std::string& out) {
+    int fd = openat(dirfd, relPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    // desc files are a few hundred bytes; one read usually gets everything
+    char buffer[8192];
+    out.clear();
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        out.append(buffer, static_cast<size_t>(n));
+    }
+    close(fd);
+    return n == 0;
+}
+
+bool isDirectory(int dirfd, const struct dirent* entry) {
+#ifdef _DIRENT_HAVE_D_TYPE
+    if (entry->d_type == DT_DIR) return true;
+    if (entry->d_type != DT_UNKNOWN) return false;
+#endif
+    struct stat st;
+    return fstatat(dirfd, entry->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+}
+
+// List package directories, optionally only those that could be "<name>-<ver>-<rel>"
+bool listPackageDirs(const std::string& path, const std::string& name,
+                     std::vector<std::string>& dirs) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return false;
+    }
+
+    int dirfd = ::dirfd(dir);
+    const std::string prefix = name.empty() ? "" : name + "-";
+
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        if (!prefix.empty() && std::strncmp(entry->d_name, prefix.c_str(), prefix.size()) != 0) {
+            continue;
+        }
+        if (isDirectory(dirfd, entry)) {
+            dirs.emplace_back(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+    return true;
+}
+#endif
+
+} // namespace
+
+bool PacmanLocalDB::parseDesc(std::string_view text, InstalledPackage& pkg) {
+    pkg.packageManager = PackageManager::PACMAN;
+    pkg.explicitlyInstalled = true;  // %REASON% is omitted for explicit installs
+
+    std::string_view section;
+    bool firstValue = false;
+    size_t pos = 0;
+
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        if (line.empty()) {
+            section = {};
+            continue;
+        }
+
+        if (line.size() > 2 && line.front() == '%' && line.back() == '%') {
+            section = line;
+            firstValue = true;
+            continue;
+        }
+
+        // Multi-valued sections (%DEPENDS%, %LICENSE%) only need their first line
+        if (!firstValue) continue;
+        firstValue = false;
+
+        if (section == "%NAME%") {
+            pkg.name = std::string(line);
+        } else if (section == "%VERSION%") {
+            pkg.version = std::string(line);
+        } else if (section == "%DESC%") {
+            pkg.description = std::string(line);
+        } else if (section == "%ARCH%") {
+            pkg.architecture = std::string(line);
+        } else if (section == "%SIZE%") {
+            pkg.installedSize = std::strtoull(std::string(line).c_str(), nullptr, 10);
+        } else if (section == "%REASON%") {
+            pkg.explicitlyInstalled = (line != "1");
+        }
+    }
+
+    return !pkg.name.empty();
+}
+
+bool PacmanLocalDB::load(const std::string& path) {
+    UNIPM_TRACE_SCOPE("PacmanLocalDB::load", "index");
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    std::vector<std::string> dirs;
+    if (!listPackageDirs(path, "", dirs)) {
+        return false;
+    }
+    return readEntries(path, dirs);
+#endif
+}
+
+bool PacmanLocalDB::loadPackage(const std::string& name, const std::string& path) {
+#ifdef _WIN32
+    (void)name;
+    (void)path;
+    return false;
+#else
+    std::vector<std::string> dirs;
+    if (!listPackageDirs(path, name, dirs)) {
+        return false;
+    }
+    return readEntries(path, dirs);
+#endif
+}
+
+bool PacmanLocalDB::readEntries(const std::string& path, const std::vector<std::string>& dirs) {
+    packages_.clear();
+    index_.clear();
+
+#ifdef _WIN32
+    (void)path;
+    (void)dirs;
+    return false;
+#else
+    int dirfd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) {
+        return false;
+    }
+
+    // One task per package directory; openat() avoids re-resolving the
+    // database path for every file
+    std::vector<InstalledPackage> results(dirs.size());
+    std::vector<char> valid(dirs.size(), 0);
+
+    parallelFor(dirs.size(), [&](size_t i) {
+        std::string contents;
+        if (readAt(dirfd, dirs[i] + "/desc", contents)) {
+            valid[i] = parseDesc(contents, results[i]) ? 1 : 0;
+        }
+    });
+
+    close(dirfd);
+
+    packages_.reserve(dirs.size());
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        if (valid[i]) {
+            index_.emplace(results[i].name, packages_.size());
+            packages_.push_back(std::move(results[i]));
+        }
+    }
+    return true;
+#endif
+}
+
+const InstalledPackage* PacmanLocalDB::find(const std::string& name) const {
+    auto it = index_.find(name);
+    return it != index_.end() ? &packages_[it->second] : nullptr;
+}
+
+} // namespace unipm
@@ -0,0 +1,49 @@
+#include "unipm/parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace unipm {
+
+size_t defaultConcurrency() {
+    // Metadata reads are mostly waiting on the disk, so oversubscribe a little
+    unsigned int hw = std::thread::hardware_concurrency();
+    return std::max<size_t>(2, static_cast<size_t>(hw) * 2);
+}
+
+void parallelFor(size_t count, const std::function<void(size_t)>& fn, size_t maxThreads) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t threads = maxThreads ? maxThreads : defaultConcurrency();
+    threads = std::min(threads, count);
+
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();  // The calling thread takes a share too
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+} // namespace unipm
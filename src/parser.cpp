@@ -26,17 +26,18 @@ Command Parser::parse(int argc, char* argv[]) {
     // First argument is the command
     cmd.type = parseCommandType(args[0]);
     
-    if (cmd.type == CommandType::HELP || cmd.type == CommandType::VERSION || 
-        cmd.type == CommandType::DOCTOR) {
+    if (cmd.type == CommandType::HELP || cmd.type == CommandType::VERSION) {
         return cmd;
     }
     
-    // Parse flags and packages
-    size_t index = 1;
-    parseFlags(args, cmd, index);
-    
-    // Remaining arguments are package names
-    cmd.packages = parsePackages(args, index);
+    // Flags may appear before or after package names
+    for (size_t index = 1; index < args.size(); ++index) {
+        if (isFlag(args[index])) {
+            parseFlag(args, cmd, index);
+        } else {
+            cmd.packages.push_back(args[index]);
+        }
+    }
     
     return cmd;
 }
@@ -44,6 +45,18 @@ Command Parser::parse(int argc, char* argv[]) {
 bool Parser::validate(const Command& cmd, std::string& error) {
     switch (cmd.type) {
         case CommandType::INSTALL:
+            // --locked installs what the lockfile holds
+            if (cmd.packages.empty() && cmd.options.count("locked") == 0) {
+                error = "No package specified for install";
+                return false;
+            }
+            break;
+        case CommandType::LOCK:
+            if (cmd.packages.empty() && cmd.options.count("manifest") == 0) {
+                error = "No packages or --manifest specified for lock";
+                return false;
+            }
+            break;
         case CommandType::REMOVE:
         case CommandType::SEARCH:
         case CommandType::INFO:
@@ -57,6 +70,8 @@ bool Parser::validate(const Command& cmd, std::string& error) {
         case CommandType::HELP:
         case CommandType::VERSION:
         case CommandType::DOCTOR:
+        case CommandType::HISTORY:
+        case CommandType::MIRRORS:
         case CommandType::SELF_UNINSTALL:
             // These don't require packages
             break;
@@ -78,39 +93,38 @@ CommandType Parser::parseCommandType(const std::string& cmd) {
     if (lower == "help" || lower == "--help" || lower == "-h") return CommandType::HELP;
     if (lower == "version" || lower == "--version" || lower == "-v") return CommandType::VERSION;
     if (lower == "doctor" || lower == "dr") return CommandType::DOCTOR;
+    if (lower == "history") return CommandType::HISTORY;
+    if (lower == "lock") return CommandType::LOCK;
+    if (lower == "mirrors") return CommandType::MIRRORS;
     
     return CommandType::HELP;
 }
 
-void Parser::parseFlags(const std::vector<std::string>& args, Command& cmd, size_t& index) {
-    while (index < args.size() && isFlag(args[index])) {
-        std::string flag = args[index];
-        
-        if (flag == "--dry-run" || flag == "-n") {
-            cmd.dryRun = true;
-        } else if (flag == "--yes" || flag == "-y") {
-            cmd.autoYes = true;
-        } else if (flag == "--verbose" || flag == "-V") {
-            cmd.verbose = true;
-        } else if (flag.find("--pm=") == 0) {
-            cmd.forcePM = flag.substr(5);
-        } else if (flag == "--pm" && index + 1 < args.size()) {
-            index++;
-            cmd.forcePM = args[index];
-        }
-        
+void Parser::parseFlag(const std::vector<std::string>& args, Command& cmd, size_t& index) {
+    const std::string& flag = args[index];
+    
+    if (flag == "--dry-run" || flag == "-n") {
+        cmd.dryRun = true;
+    } else if (flag == "--yes" || flag == "-y") {
+        cmd.autoYes = true;
+    } else if (flag == "--verbose" || flag == "-V") {
+        cmd.verbose = true;
+    } else if (flag.find("--pm=") == 0) {
+        cmd.forcePM = flag.substr(5);
+    } else if (flag == "--pm" && index + 1 < args.size()) {
         index++;
-    }
-}
-
-std::vector<std::string> Parser::parsePackages(const std::vector<std::string>& args, size_t startIndex) {
-    std::vector<std::string> packages;
-    for (size_t i = startIndex; i < args.size(); ++i) {
-        if (!isFlag(args[i])) {
-            packages.push_back(args[i]);
+        cmd.forcePM = args[index];
+    } else if (flag == "-a") {
+        cmd.options["all"] = "true";
+    } else if (flag.size() > 2 && flag.compare(0, 2, "--") == 0) {
+        // Command-specific options: --name or --name=value
+        size_t eq = flag.find('=');
+        if (eq == std::string::npos) {
+            cmd.options[flag.substr(2)] = "true";
+        } else {
+            cmd.options[flag.substr(2, eq - 2)] = flag.substr(eq + 1);
         }
     }
-    return packages;
 }
 
 bool Parser::isFlag(const std::string& arg) {
@@ -0,0 +1,106 @@
+#include "unipm/pipeline.h"
+#include "unipm/cache.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace unipm {
+
+namespace {
+
+// Would a step of a wait for a step of b anyway?
+bool sharesLock(const CommandPlan& a, const CommandPlan& b) {
+    for (const auto& x : a.steps) {
+        for (const auto& y : b.steps) {
+            if (!x.lockDomain.empty() && x.lockDomain == y.lockDomain) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+InstallPipeline::InstallPipeline(PackageManagerAdapter& adapter, size_t chunkSize,
+                                 std::string stagingRoot)
+    : adapter_(adapter), chunkSize_(chunkSize), stagingRoot_(std::move(stagingRoot)) {}
+
+std::string InstallPipeline::defaultStagingRoot() {
+    return Cache::pathFor("pipeline-" + std::to_string(getpid()));
+}
+
+std::string InstallPipeline::stagingDir(size_t chunk) const {
+    if (stagingRoot_.empty()) {
+        return "";
+    }
+    return stagingRoot_ + "/chunk-" + std::to_string(chunk);
+}
+
+CommandPlan InstallPipeline::plan(const std::vector<std::string>& packages) {
+    chunks_ = 1;
+    if (chunkSize_ == 0 || packages.size() <= chunkSize_) {
+        return adapter_.planInstall(packages);
+    }
+
+    std::vector<std::vector<std::string>> groups;
+    for (size_t i = 0; i < packages.size(); i += chunkSize_) {
+        size_t end = std::min(packages.size(), i + chunkSize_);
+        groups.emplace_back(packages.begin() + i, packages.begin() + end);
+    }
+
+    CommandPlan result = adapter_.planDownload(groups[0], stagingDir(0));
+    if (result.empty()) {
+        return adapter_.planInstall(packages);
+    }
+
+    // When the next download has to wait for the install anyway (pacman -Sw
+    // takes the database lock), chunking only adds a dependency resolution
+    // per chunk to what one plain install does
+    if (sharesLock(adapter_.planInstallStaged(groups[0], stagingDir(0)),
+                   adapter_.planDownload(groups[1], stagingDir(1)))) {
+        return adapter_.planInstall(packages);
+    }
+
+    for (size_t k = 0; k < groups.size(); ++k) {
+        CommandPlan install = adapter_.planInstallStaged(groups[k], stagingDir(k));
+        result.steps.insert(result.steps.end(), install.steps.begin(), install.steps.end());
+
+        if (k + 1 < groups.size()) {
+            // The next download only has to wait for this chunk's download,
+            // which the install above already waited for
+            CommandPlan download = adapter_.planDownload(groups[k + 1], stagingDir(k + 1));
+            if (!download.empty()) {
+                download.steps.front().dependsOnPrevious = false;
+            }
+            result.steps.insert(result.steps.end(), download.steps.begin(), download.steps.end());
+        }
+    }
+
+    chunks_ = groups.size();
+    return result;
+}
+
+bool InstallPipeline::prepare() const {
+    if (stagingRoot_.empty()) {
+        return true;
+    }
+    for (size_t k = 0; k < chunks_; ++k) {
+        // apt refuses an archive directory without its partial/ subdirectory
+        if (!Cache::createDirectories(stagingDir(k) + "/partial")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CommandStep InstallPipeline::cleanupStep() const {
+    return CommandStep::mutation({"rm", "-rf", stagingRoot_}, "", adapter_.requiresRoot());
+}
+
+} // namespace unipm
@@ -1,4 +1,6 @@
 #include "unipm/pm_detector.h"
+#include "unipm/brew_cellar.h"
+#include "unipm/trace.h"
 #include <cstdlib>
 #include <cstdio>
 #include <algorithm>
@@ -13,6 +15,7 @@
 namespace unipm {
 
 std::vector<PMInfo> PMDetector::detectAll() {
+    UNIPM_TRACE_SCOPE("PMDetector::detectAll", "detect");
     std::vector<PMInfo> pms;
     
     // Try to detect each package manager
@@ -47,6 +50,7 @@ std::vector<PMInfo> PMDetector::detectAll() {
 }
 
 PMInfo PMDetector::detectDefault(const OSInfo& osInfo) {
+    UNIPM_TRACE_SCOPE("PMDetector::detectDefault", "detect");
     // Priority based on OS
     if (osInfo.type == OSType::LINUX) {
         switch (osInfo.distro) {
@@ -99,14 +103,38 @@ bool PMDetector::isAvailable(PackageManager pm) {
     }
 }
 
+PMInfo PMDetector::detect(PackageManager pm) {
+    UNIPM_TRACE_SCOPE("PMDetector::detect", "detect");
+    switch (pm) {
+        case PackageManager::APT: return detectAPT();
+        case PackageManager::PACMAN: return detectPacman();
+        case PackageManager::BREW: return detectBrew();
+        case PackageManager::DNF: return detectDNF();
+        case PackageManager::YUM: return detectYUM();
+        case PackageManager::WINGET: return detectWinget();
+        case PackageManager::CHOCOLATEY: return detectChocolatey();
+        case PackageManager::SNAP: return detectSnap();
+        case PackageManager::FLATPAK: return detectFlatpak();
+        default: {
+            PMInfo unknown;
+            unknown.type = PackageManager::UNKNOWN;
+            return unknown;
+        }
+    }
+}
+
 bool PMDetector::checkBinary(const std::string& name) {
 #ifdef _WIN32
     std::string command = "where " + name + " >nul 2>&1";
-    return system(command.c_str()) == 0;
 #else
     std::string command = "which " + name + " >/dev/null 2>&1";
-    return system(command.c_str()) == 0;
 #endif
+    UNIPM_TRACE_SPAN(span, "sh", "process");
+    UNIPM_TRACE_RENAME(span, "sh: " + command);
+    UNIPM_TRACE_PROCESS_STARTED();
+    bool found = system(command.c_str()) == 0;
+    UNIPM_TRACE_PROCESS_EXITED();
+    return found;
 }
 
 std::string PMDetector::getBinaryPath(const std::string& name) {
@@ -116,8 +144,11 @@ std::string PMDetector::getBinaryPath(const std::string& name) {
     std::string command = "which " + name;
 #endif
     
+    UNIPM_TRACE_SPAN(span, "sh", "process");
+    UNIPM_TRACE_RENAME(span, "sh: " + command);
     FILE* pipe = popen(command.c_str(), "r");
     if (!pipe) return "";
+    UNIPM_TRACE_PROCESS_STARTED();
     
     char buffer[256];
     std::string result;
@@ -128,6 +159,7 @@ std::string PMDetector::getBinaryPath(const std::string& name) {
         result.erase(std::remove(result.begin(), result.end(), '\r'), result.end());
     }
     pclose(pipe);
+    UNIPM_TRACE_PROCESS_EXITED();
     
     return result;
 }
@@ -162,8 +194,11 @@ std::string PMDetector::getVersion(PackageManager pm, const std::string& path) {
             return "";
     }
     
+    UNIPM_TRACE_SPAN(span, "sh", "process");
+    UNIPM_TRACE_RENAME(span, "sh: " + command);
     FILE* pipe = popen(command.c_str(), "r");
     if (!pipe) return "";
+    UNIPM_TRACE_PROCESS_STARTED();
     
     char buffer[256];
     std::string result;
@@ -172,6 +207,7 @@ std::string PMDetector::getVersion(PackageManager pm, const std::string& path) {
         result.erase(std::remove(result.begin(), result.end(), '\n'), result.end());
     }
     pclose(pipe);
+    UNIPM_TRACE_PROCESS_EXITED();
     
     return result;
 }
@@ -215,6 +251,13 @@ PMInfo PMDetector::detectBrew() {
     info.name = "brew";
     info.path = getBinaryPath("brew");
     info.version = getVersion(PackageManager::BREW, info.path);
+    
+    // HOMEBREW_PREFIX wins; otherwise the prefix the binary lives in
+    const char* envPrefix = std::getenv("HOMEBREW_PREFIX");
+    info.prefix = (envPrefix && *envPrefix) ? envPrefix : BrewCellar::prefixFromBinary(info.path);
+    if (info.prefix.empty()) {
+        info.prefix = BrewCellar::findPrefix();
+    }
     return info;
 }
 
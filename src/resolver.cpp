@@ -1,74 +1,114 @@
 #include "unipm/resolver.h"
+#include "unipm/trace.h"
 #include <algorithm>
 #include <vector>
 
 namespace unipm {
 
-Resolver::Resolver(std::shared_ptr<Config> config) : config_(config) {}
+Resolver::Resolver(std::shared_ptr<Config> config) : database_(config->handle()) {}
+
+Resolver::Resolver(std::shared_ptr<DatabaseHandle> database) : database_(std::move(database)) {}
 
 ResolvedPackage Resolver::resolve(const std::string& packageName,
                                    PackageManager pm,
                                    const std::string& version) {
+    UNIPM_TRACE_SPAN(span, "Resolver::resolve", "resolve");
+    UNIPM_TRACE_ARG(span, "package", packageName);
     ResolvedPackage result;
     result.originalName = packageName;
     result.packageManager = pm;
     result.version = version;
     result.confidence = 0.0f;
     
+    // One version for the whole lookup, whatever gets published meanwhile
+    const std::shared_ptr<const PackageDatabase> database = database_->current();
+    
     // Check if package exists exactly
-    if (config_->hasPackage(packageName)) {
+    if (database->hasPackage(packageName)) {
         if (!version.empty()) {
             // Try to get version-specific mapping
-            PackageInfo info = config_->getPackageInfo(packageName);
+            PackageInfo info = database->getPackageInfo(packageName);
             auto versionIt = info.versionMappings.find(version);
             if (versionIt != info.versionMappings.end()) {
                 auto pmIt = versionIt->second.find(pm);
                 if (pmIt != versionIt->second.end()) {
                     result.resolvedName = pmIt->second;
                     result.confidence = 1.0f;
+                    result.available = !isAvailable_ || isAvailable_(result.resolvedName);
                     return result;
                 }
             }
         }
         
         // Get standard mapping
-        result.resolvedName = config_->getMapping(packageName, pm);
+        result.resolvedName = database->getMapping(packageName, pm);
+        result.confidence = 1.0f;
+        result.available = !isAvailable_ || isAvailable_(result.resolvedName);
+        return result;
+    }
+    
+    // Not in the database, but the repositories carry this exact name
+    if (isAvailable_ && isAvailable_(packageName)) {
+        result.resolvedName = packageName;
         result.confidence = 1.0f;
         return result;
     }
     
     // Fuzzy match to find suggestions
-    auto suggestions = getSuggestions(packageName, 5);
+    auto suggestions = getSuggestions(*database, packageName, 5);
     result.suggestions = suggestions;
     
     if (!suggestions.empty()) {
-        // Use best match
+        // Use the best match the repositories actually carry
         std::string bestMatch = suggestions[0];
-        result.resolvedName = config_->getMapping(bestMatch, pm);
+        if (isAvailable_) {
+            auto it = std::find_if(suggestions.begin(), suggestions.end(),
+                                   [&](const std::string& s) {
+                                       return isAvailable_(database->getMapping(s, pm));
+                                   });
+            if (it != suggestions.end()) {
+                bestMatch = *it;
+            } else {
+                result.available = false;
+            }
+        }
+        result.resolvedName = database->getMapping(bestMatch, pm);
         result.confidence = fuzzyMatch(packageName, bestMatch);
     } else {
         // No match found, use as-is
         result.resolvedName = packageName;
         result.confidence = 0.0f;
+        result.available = !isAvailable_ || isAvailable_(result.resolvedName);
     }
     
     return result;
 }
 
+void Resolver::setAvailabilityCheck(std::function<bool(const std::string&)> check) {
+    isAvailable_ = std::move(check);
+}
+
 std::vector<std::string> Resolver::getSuggestions(const std::string& packageName, size_t maxResults) {
+    return getSuggestions(*database_->current(), packageName, maxResults);
+}
+
+std::vector<std::string> Resolver::getSuggestions(const PackageDatabase& database,
+                                                  const std::string& packageName,
+                                                  size_t maxResults) {
+    UNIPM_TRACE_SCOPE("Resolver::fuzzyMatch", "resolve");
     std::vector<std::pair<std::string, float>> scored;
     
     std::string normalizedInput = normalize(packageName);
     
     // Score all packages
-    for (const std::string& pkg : config_->getAllPackageNames()) {
+    for (const std::string& pkg : database.getAllPackageNames()) {
         float score = fuzzyMatch(normalizedInput, normalize(pkg));
         if (score > 0.3f) {  // Threshold for relevance
             scored.push_back({pkg, score});
         }
         
         // Also check aliases
-        PackageInfo info = config_->getPackageInfo(pkg);
+        PackageInfo info = database.getPackageInfo(pkg);
         for (const std::string& alias : info.aliases) {
             float aliasScore = fuzzyMatch(normalizedInput, normalize(alias));
             if (aliasScore > 0.3f) {
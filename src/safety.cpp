@@ -1,17 +1,8 @@
 #include "unipm/safety.h"
-#include <fstream>
+#include "unipm/history.h"
 #include <algorithm>
 #include <cctype>
-#include <ctime>
-
-#ifdef _WIN32
-#include <windows.h>
-#include <shlobj.h>
-#else
-#include <unistd.h>
-#include <sys/types.h>
-#include <pwd.h>
-#endif
+#include <chrono>
 
 namespace unipm {
 
@@ -70,40 +61,17 @@ std::string Safety::escapeShell(const std::string& input) {
 }
 
 void Safety::logOperation(const std::string& command, bool success) {
-    std::string historyPath = getHistoryPath();
-    
-    std::ofstream file(historyPath, std::ios::app);
-    if (!file.is_open()) {
-        return;
-    }
-    
-    // Get current timestamp
-    time_t now = time(nullptr);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    file << "[" << timestamp << "] ";
-    file << (success ? "SUCCESS" : "ATTEMPT") << ": ";
-    file << command << std::endl;
-    
-    file.close();
+    HistoryRecord record;
+    record.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+    record.command = command;
+    record.success = success;
+    HistoryLog::instance().append(std::move(record));
 }
 
 std::string Safety::getHistoryPath() {
-#ifdef _WIN32
-    char path[MAX_PATH];
-    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, path))) {
-        return std::string(path) + "\\unipm\\history.log";
-    }
-    return "unipm_history.log";
-#else
-    const char* home = getenv("HOME");
-    if (!home) {
-        struct passwd* pw = getpwuid(getuid());
-        home = pw->pw_dir;
-    }
-    return std::string(home) + "/.unipm/history.log";
-#endif
+    return HistoryLog::defaultPath();
 }
 
 bool Safety::containsDangerousChars(const std::string& input) {
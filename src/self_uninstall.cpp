@@ -1,4 +1,5 @@
 #include "unipm/self_uninstall.h"
+#include "unipm/cache.h"
 #include "unipm/ui.h"
 #include <iostream>
 #include <fstream>
@@ -57,18 +58,7 @@ std::string SelfUninstaller::getConfigDirectory() {
 }
 
 std::string SelfUninstaller::getCacheDirectory() {
-#ifdef _WIN32
-    const char* localappdata = std::getenv("LOCALAPPDATA");
-    if (localappdata) {
-        return std::string(localappdata) + "\\unipm\\cache";
-    }
-#else
-    const char* home = std::getenv("HOME");
-    if (home) {
-        return std::string(home) + "/.cache/unipm";
-    }
-#endif
-    return "";
+    return Cache::getDirectory();
 }
 
 bool SelfUninstaller::removeBinary() {
@@ -0,0 +1,280 @@
+#include "unipm/terminal.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#define ISATTY _isatty
+#define FILENO _fileno
+#else
+#include <cerrno>
+#include <unistd.h>
+#define ISATTY isatty
+#define FILENO fileno
+#endif
+
+namespace unipm {
+
+namespace {
+
+constexpr std::chrono::milliseconds FRAME_INTERVAL(1000 / Terminal::FRAME_RATE);
+
+TerminalCapabilities detectCapabilities() {
+    TerminalCapabilities caps;
+    caps.stdoutTty = ISATTY(FILENO(stdout)) != 0;
+    caps.stderrTty = ISATTY(FILENO(stderr)) != 0;
+
+    // https://no-color.org: any non-empty value turns colors off
+    const char* noColor = std::getenv("NO_COLOR");
+    const char* term = std::getenv("TERM");
+    bool color = caps.stdoutTty && !(noColor && *noColor) &&
+                 !(term && std::strcmp(term, "dumb") == 0);
+
+#ifdef _WIN32
+    // Enable virtual terminal processing on Windows 10+
+    if (color) {
+        HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD dwMode = 0;
+        color = hOut != INVALID_HANDLE_VALUE && GetConsoleMode(hOut, &dwMode) &&
+                SetConsoleMode(hOut, dwMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+    }
+#endif
+
+    caps.color = color;
+    return caps;
+}
+
+// One write for the whole buffer, short of partial writes
+void writeAll(FILE* stream, std::string_view data) {
+#ifdef _WIN32
+    std::fwrite(data.data(), 1, data.size(), stream);
+    std::fflush(stream);
+#else
+    int fd = FILENO(stream);
+    while (!data.empty()) {
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+#endif
+}
+
+// Printable ASCII only, so its width on screen is its length
+bool isPlain(std::string_view segment) {
+    for (unsigned char c : segment) {
+        if (c < 0x20 || c > 0x7e) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One line without its newline: segments separated by '\r' all start at
+// column 0, so a plain segment is hidden once later ones are as wide
+void appendCollapsedLine(std::string& out, std::string_view line, bool lineStart) {
+    std::vector<std::string_view> segments;
+    size_t pos = 0;
+    while (true) {
+        size_t cr = line.find('\r', pos);
+        if (cr == std::string_view::npos) {
+            segments.push_back(line.substr(pos));
+            break;
+        }
+        segments.push_back(line.substr(pos, cr - pos));
+        pos = cr + 1;
+    }
+
+    std::vector<bool> keep(segments.size(), true);
+    size_t covered = 0;  // Columns drawn over by later segments, at least
+    for (size_t i = segments.size() - 1; i-- > 0;) {
+        const size_t next = i + 1;
+        if (isPlain(segments[next])) {
+            covered = std::max(covered, segments[next].size());
+        }
+        // The first segment may continue a line begun in an earlier frame
+        bool atColumnZero = i > 0 || lineStart;
+        if (atColumnZero && isPlain(segments[i]) && segments[i].size() <= covered) {
+            keep[i] = false;
+        }
+    }
+
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (!keep[i]) {
+            continue;
+        }
+        if (i > 0) {
+            out += '\r';
+        }
+        out.append(segments[i].data(), segments[i].size());
+    }
+}
+
+} // namespace
+
+// Routes a standard stream into the terminal; unbuffered, so every
+// insertion goes straight to Terminal and its ordering
+class Terminal::StreamBuffer : public std::streambuf {
+public:
+    StreamBuffer(Terminal& terminal, bool error) : terminal_(terminal), error_(error) {}
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            char ch = traits_type::to_char_type(c);
+            put(std::string_view(&ch, 1));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        put(std::string_view(s, static_cast<size_t>(n)));
+        return n;
+    }
+
+    // std::endl and std::flush end a line group
+    int sync() override {
+        if (!error_) {
+            terminal_.endGroup();
+        }
+        return 0;
+    }
+
+private:
+    Terminal& terminal_;
+    bool error_;
+
+    void put(std::string_view text) {
+        if (error_) {
+            terminal_.writeError(text);
+        } else {
+            terminal_.write(text);
+        }
+    }
+};
+
+Terminal& Terminal::instance() {
+    static Terminal terminal;
+    return terminal;
+}
+
+Terminal::Terminal()
+    : caps_(detectCapabilities()),
+      framed_(caps_.stdoutTty),
+      out_(new StreamBuffer(*this, false)),
+      err_(new StreamBuffer(*this, true)) {}
+
+Terminal::~Terminal() {
+    if (savedOut_) {
+        std::cout.rdbuf(savedOut_);
+        std::cerr.rdbuf(savedErr_);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+void Terminal::attachStandardStreams() {
+    if (!savedOut_) {
+        savedOut_ = std::cout.rdbuf(out_.get());
+        savedErr_ = std::cerr.rdbuf(err_.get());
+    }
+}
+
+void Terminal::setFramed(bool framed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    framed_ = framed;
+}
+
+void Terminal::write(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.append(text.data(), text.size());
+    if (pending_.size() >= BUFFER_LIMIT) {
+        flushLocked();
+    }
+}
+
+void Terminal::endGroup() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (caps_.stdoutTty) {
+        flushLocked();
+    }
+}
+
+void Terminal::writeError(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+    writeAll(stderr, text);
+}
+
+void Terminal::relay(std::string_view output) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.append(output.data(), output.size());
+    relayPending_ = true;
+    if (pending_.size() >= BUFFER_LIMIT ||
+        (framed_ && std::chrono::steady_clock::now() - lastFrame_ >= FRAME_INTERVAL)) {
+        flushLocked();
+    }
+}
+
+int Terminal::frameTimeoutMs() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!relayPending_ || !framed_) {
+        return -1;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        lastFrame_ + FRAME_INTERVAL - std::chrono::steady_clock::now());
+    return remaining.count() > 0 ? static_cast<int>(remaining.count()) : 0;
+}
+
+void Terminal::tick() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (relayPending_ && framed_ &&
+        std::chrono::steady_clock::now() - lastFrame_ >= FRAME_INTERVAL) {
+        flushLocked();
+    }
+}
+
+void Terminal::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+void Terminal::flushLocked() {
+    if (pending_.empty()) {
+        return;
+    }
+    if (relayPending_ && caps_.stdoutTty && pending_.find('\r') != std::string::npos) {
+        pending_ = collapseRedraws(pending_, lineStart_);
+    }
+    writeAll(stdout, pending_);
+    lineStart_ = pending_.back() == '\n';
+    pending_.clear();
+    relayPending_ = false;
+    lastFrame_ = std::chrono::steady_clock::now();
+}
+
+std::string Terminal::collapseRedraws(std::string_view text, bool lineStart) {
+    std::string out;
+    out.reserve(text.size());
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t newline = text.find('\n', pos);
+        size_t end = newline == std::string_view::npos ? text.size() : newline;
+        appendCollapsedLine(out, text.substr(pos, end - pos), lineStart || pos > 0);
+        if (newline == std::string_view::npos) {
+            break;
+        }
+        out += '\n';
+        pos = newline + 1;
+    }
+    return out;
+}
+
+} // namespace unipm
@@ -0,0 +1,192 @@
+#include "unipm/trace.h"
+#include "unipm/cache.h"
+#include <json.hpp>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace unipm {
+
+std::atomic<bool> Trace::enabled_{false};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Recording state, touched only while a trace is being recorded
+struct Recorder {
+    std::mutex mutex;
+    std::string path;
+    // Clock ticks at start(); atomic because spans read it without the lock
+    std::atomic<Clock::rep> origin{0};
+    std::vector<std::string> events;  // Serialized as they finish
+    int64_t running = 0;
+    int64_t started = 0;
+    std::atomic<int> nextThread{0};
+};
+
+Recorder& recorder() {
+    static Recorder instance;
+    return instance;
+}
+
+// Small sequential ids read better than hashed std::thread::ids
+int threadId() {
+    thread_local int id = recorder().nextThread.fetch_add(1);
+    return id;
+}
+
+// Names and args come from argv and package names; never throw on bad UTF-8
+std::string quote(const std::string& text) {
+    return json(text).dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+std::string processId() {
+    return std::to_string(getpid());
+}
+
+void counterEvent(Recorder& r, int64_t ts) {
+    r.events.push_back("{\"name\":\"subprocesses\",\"ph\":\"C\",\"ts\":" + std::to_string(ts) +
+                       ",\"pid\":" + processId() + ",\"args\":{\"running\":" +
+                       std::to_string(r.running) + ",\"total\":" + std::to_string(r.started) +
+                       "}}");
+}
+
+} // namespace
+
+void Trace::start(const std::string& path) {
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.path = path;
+    r.origin.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    r.events.clear();
+    r.running = 0;
+    r.started = 0;
+    threadId();  // The starting thread is track 0
+    // Release: whoever sees the trace enabled also sees its origin
+    enabled_.store(true, std::memory_order_release);
+}
+
+int64_t Trace::now() {
+    Clock::duration origin(recorder().origin.load(std::memory_order_relaxed));
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch() -
+                                                                 origin)
+        .count();
+}
+
+void Trace::complete(const std::string& name, const char* category, int64_t startUs,
+                     int64_t durationUs, const std::string& argsJson) {
+    if (!enabled()) {
+        return;
+    }
+    std::string event = "{\"name\":" + quote(name) + ",\"cat\":" + quote(category) +
+                        ",\"ph\":\"X\",\"ts\":" + std::to_string(startUs) +
+                        ",\"dur\":" + std::to_string(durationUs) + ",\"pid\":" + processId() +
+                        ",\"tid\":" + std::to_string(threadId());
+    if (!argsJson.empty()) {
+        event += ",\"args\":{" + argsJson + "}";
+    }
+    event += "}";
+
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.events.push_back(std::move(event));
+}
+
+void Trace::processStarted() {
+    if (!enabled()) {
+        return;
+    }
+    Recorder& r = recorder();
+    int64_t ts = now();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.running++;
+    r.started++;
+    counterEvent(r, ts);
+}
+
+void Trace::processExited() {
+    if (!enabled()) {
+        return;
+    }
+    Recorder& r = recorder();
+    int64_t ts = now();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.running--;
+    counterEvent(r, ts);
+}
+
+int64_t Trace::processCount() {
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.started;
+}
+
+bool Trace::finish() {
+    if (!enabled()) {
+        return false;
+    }
+    enabled_.store(false, std::memory_order_release);
+
+    Recorder& r = recorder();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::string out = "{\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + processId() +
+           ",\"args\":{\"name\":\"unipm\"}}";
+    for (const auto& event : r.events) {
+        out += ",\n";
+        out += event;
+    }
+    out += "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"subprocesses\":" +
+           std::to_string(r.started) + "}}\n";
+    r.events.clear();
+    return Cache::writeAtomic(r.path, out);
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+    : name_(name), category_(category) {
+    if (Trace::enabled()) {
+        start_ = Trace::now();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    end();
+}
+
+void TraceSpan::end() {
+    if (start_ >= 0) {
+        Trace::complete(dynamicName_.empty() ? std::string(name_) : dynamicName_, category_,
+                        start_, Trace::now() - start_, args_);
+        start_ = -1;
+    }
+}
+
+void TraceSpan::rename(const std::string& name) {
+    if (start_ >= 0) {
+        dynamicName_ = name;
+    }
+}
+
+void TraceSpan::arg(const char* key, const std::string& value) {
+    if (start_ >= 0) {
+        args_ += (args_.empty() ? "" : ",") + quote(key) + ":" + quote(value);
+    }
+}
+
+void TraceSpan::arg(const char* key, int64_t value) {
+    if (start_ >= 0) {
+        args_ += (args_.empty() ? "" : ",") + quote(key) + ":" + std::to_string(value);
+    }
+}
+
+} // namespace unipm
@@ -1,4 +1,5 @@
 #include "unipm/types.h"
+#include <algorithm>
 
 namespace unipm {
 
@@ -54,6 +55,9 @@ std::string commandTypeToString(CommandType cmd) {
         case CommandType::HELP: return "help";
         case CommandType::VERSION: return "version";
         case CommandType::DOCTOR: return "doctor";
+        case CommandType::HISTORY: return "history";
+        case CommandType::LOCK: return "lock";
+        case CommandType::MIRRORS: return "mirrors";
         case CommandType::SELF_UNINSTALL: return "uninstall --self";
     }
     return "unknown";
@@ -72,4 +76,14 @@ PackageManager stringToPackageManager(const std::string& str) {
     return PackageManager::UNKNOWN;
 }
 
+void ProcessUsage::add(const ProcessUsage& other) {
+    userSeconds += other.userSeconds;
+    systemSeconds += other.systemSeconds;
+    maxRssKb = std::max(maxRssKb, other.maxRssKb);
+    blockReads += other.blockReads;
+    blockWrites += other.blockWrites;
+    voluntarySwitches += other.voluntarySwitches;
+    involuntarySwitches += other.involuntarySwitches;
+}
+
 } // namespace unipm
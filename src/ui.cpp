@@ -1,17 +1,14 @@
 #include "unipm/ui.h"
+#include "unipm/events.h"
+#include "unipm/history_index.h"
+#include "unipm/mirrors.h"
+#include "unipm/terminal.h"
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
-
-#ifdef _WIN32
-#include <windows.h>
-#include <io.h>
-#define ISATTY _isatty
-#define FILENO _fileno
-#else
-#include <unistd.h>
-#define ISATTY isatty
-#define FILENO fileno
-#endif
+#include <ctime>
 
 namespace unipm {
 
@@ -24,34 +21,78 @@ const std::string UI::BLUE = "\033[34m";
 const std::string UI::CYAN = "\033[36m";
 const std::string UI::BOLD = "\033[1m";
 
+namespace {
+
+// One line group: a single write on a terminal, buffered otherwise
+void emit(const std::string& text) {
+    if (Events::enabled()) {
+        // Output without an event of its own goes out as "text" events
+        std::cout << text;
+        return;
+    }
+    Terminal& terminal = Terminal::instance();
+    terminal.write(text);
+    terminal.endGroup();
+}
+
+} // namespace
+
 void UI::printInfo(const std::string& message) {
-    std::cout << colorize("ℹ " + message, CYAN) << std::endl;
+    if (Events::enabled()) {
+        Events::message("info", message);
+        return;
+    }
+    emit(colorize("ℹ " + message, CYAN) + "\n");
 }
 
 void UI::printSuccess(const std::string& message) {
-    std::cout << colorize("✓ " + message, GREEN) << std::endl;
+    if (Events::enabled()) {
+        Events::message("success", message);
+        return;
+    }
+    emit(colorize("✓ " + message, GREEN) + "\n");
 }
 
 void UI::printWarning(const std::string& message) {
-    std::cout << colorize("⚠ " + message, YELLOW) << std::endl;
+    if (Events::enabled()) {
+        Events::message("warning", message);
+        return;
+    }
+    emit(colorize("⚠ " + message, YELLOW) + "\n");
 }
 
 void UI::printError(const std::string& message) {
-    std::cerr << colorize("✗ " + message, RED) << std::endl;
+    if (Events::enabled()) {
+        Events::message("error", message);
+        return;
+    }
+    Terminal::instance().writeError(colorize("✗ " + message, RED) + "\n");
 }
 
 void UI::printPreview(const std::string& command, bool requiresRoot) {
-    std::cout << colorize("Preview:", BOLD) << std::endl;
-    std::cout << "  " << colorize(command, YELLOW) << std::endl;
+    if (Events::enabled()) {
+        Events::emit("plan",
+                     {{"command", command}, {"requires_root", requiresRoot}, {"dry_run", true}});
+        return;
+    }
+    std::ostringstream out;
+    out << colorize("Preview:", BOLD) << '\n';
+    out << "  " << colorize(command, YELLOW) << '\n';
     if (requiresRoot) {
-        std::cout << colorize("  (requires elevated privileges)", YELLOW) << std::endl;
+        out << colorize("  (requires elevated privileges)", YELLOW) << '\n';
     }
+    emit(out.str());
 }
 
 bool UI::confirm(const std::string& message, bool defaultYes) {
-    std::string prompt = message + (defaultYes ? " [Y/n]: " : " [y/N]: ");
-    std::cout << colorize(prompt, CYAN);
-    std::cout.flush();  // Ensure prompt is displayed before reading input
+    if (Events::enabled()) {
+        Events::prompt(message, defaultYes);
+    } else {
+        std::string prompt = message + (defaultYes ? " [Y/n]: " : " [y/N]: ");
+        Terminal& terminal = Terminal::instance();
+        terminal.write(colorize(prompt, CYAN));
+        terminal.flush();  // Ensure prompt is displayed before reading input
+    }
     
     std::string response;
     if (!std::getline(std::cin, response)) {
@@ -68,66 +109,110 @@ bool UI::confirm(const std::string& message, bool defaultYes) {
 }
 
 void UI::printResolution(const ResolvedPackage& pkg) {
-    std::cout << colorize("Package Resolution:", BOLD) << std::endl;
-    std::cout << "  Original: " << pkg.originalName << std::endl;
-    std::cout << "  Resolved: " << pkg.resolvedName << std::endl;
-    std::cout << "  Package Manager: " << packageManagerToString(pkg.packageManager) << std::endl;
+    if (Events::enabled()) {
+        Events::resolution(pkg);
+        return;
+    }
+    std::ostringstream out;
+    out << colorize("Package Resolution:", BOLD) << '\n';
+    out << "  Original: " << pkg.originalName << '\n';
+    out << "  Resolved: " << pkg.resolvedName << '\n';
+    out << "  Package Manager: " << packageManagerToString(pkg.packageManager) << '\n';
     
     if (!pkg.version.empty()) {
-        std::cout << "  Version: " << pkg.version << std::endl;
+        out << "  Version: " << pkg.version << '\n';
     }
     
-    std::cout << "  Confidence: " << (pkg.confidence * 100) << "%" << std::endl;
+    out << "  Confidence: " << (pkg.confidence * 100) << "%" << '\n';
     
     if (pkg.confidence < 1.0f && !pkg.suggestions.empty()) {
-        std::cout << colorize("  Suggestions:", YELLOW) << std::endl;
+        out << colorize("  Suggestions:", YELLOW) << '\n';
         for (const auto& suggestion : pkg.suggestions) {
-            std::cout << "    - " << suggestion << std::endl;
+            out << "    - " << suggestion << '\n';
         }
     }
+    emit(out.str());
 }
 
 void UI::printHelp() {
-    std::cout << colorize("unipm - Universal Package Manager", BOLD) << std::endl;
-    std::cout << std::endl;
-    std::cout << "Usage:" << std::endl;
-    std::cout << "  unipm <command> [options] [packages...]" << std::endl;
-    std::cout << std::endl;
-    std::cout << colorize("Commands:", BOLD) << std::endl;
-    std::cout << "  install, i        Install package(s)" << std::endl;
-    std::cout << "  remove, rm        Remove package(s)" << std::endl;
-    std::cout << "  update, upgrade   Update all packages" << std::endl;
-    std::cout << "  search, find      Search for packages" << std::endl;
-    std::cout << "  list, ls          List installed packages" << std::endl;
-    std::cout << "  info, show        Show package information" << std::endl;
-    std::cout << "  doctor            Run system diagnostics" << std::endl;
-    std::cout << "  help              Show this help message" << std::endl;
-    std::cout << "  version           Show version information" << std::endl;
-    std::cout << std::endl;
-    std::cout << colorize("Self-Management:", BOLD) << std::endl;
-    std::cout << "  uninstall --self  Uninstall unipm from your system" << std::endl;
-    std::cout << std::endl;
-    std::cout << colorize("Options:", BOLD) << std::endl;
-    std::cout << "  --dry-run, -n     Preview command without executing" << std::endl;
-    std::cout << "  --yes, -y         Skip confirmation prompts" << std::endl;
-    std::cout << "  --verbose, -V     Show detailed output" << std::endl;
-    std::cout << "  --pm=<manager>    Force specific package manager" << std::endl;
-    std::cout << std::endl;
-    std::cout << colorize("Examples:", BOLD) << std::endl;
-    std::cout << "  unipm install docker" << std::endl;
-    std::cout << "  unipm install node lts" << std::endl;
-    std::cout << "  unipm install vscode --yes" << std::endl;
-    std::cout << "  unipm remove nginx --dry-run" << std::endl;
-    std::cout << "  unipm search postgres" << std::endl;
-    std::cout << "  unipm update" << std::endl;
+    std::ostringstream out;
+    out << colorize("unipm - Universal Package Manager", BOLD) << '\n';
+    out << '\n';
+    out << "Usage:" << '\n';
+    out << "  unipm <command> [options] [packages...]" << '\n';
+    out << '\n';
+    out << colorize("Commands:", BOLD) << '\n';
+    out << "  install, i        Install package(s)" << '\n';
+    out << "  remove, rm        Remove package(s)" << '\n';
+    out << "  update, upgrade   Update all packages" << '\n';
+    out << "  search, find      Search for packages" << '\n';
+    out << "  list, ls          List installed packages" << '\n';
+    out << "  info, show        Show package information" << '\n';
+    out << "  doctor [--perf]   Run system diagnostics, or profile what makes unipm slow" << '\n';
+    out << "  history [pkg]     Show past operations and how long they took" << '\n';
+    out << "  lock [pkgs]       Resolve packages once and record them in unipm.lock" << '\n';
+    out << "  mirrors           Rank the package manager's mirrors by measured speed" << '\n';
+    out << "  help              Show this help message" << '\n';
+    out << "  version           Show version information" << '\n';
+    out << '\n';
+    out << colorize("Self-Management:", BOLD) << '\n';
+    out << "  uninstall --self  Uninstall unipm from your system" << '\n';
+    out << '\n';
+    out << colorize("Options:", BOLD) << '\n';
+    out << "  --dry-run, -n     Preview command without executing" << '\n';
+    out << "  --yes, -y         Skip confirmation prompts" << '\n';
+    out << "  --verbose, -V     Show detailed output" << '\n';
+    out << "  --pm=<manager>    Force specific package manager" << '\n';
+    out << "  --all, -a         Search with every detected package manager" << '\n';
+    out << "  --timeout=<sec>   Per-manager deadline for search --all (default 10)" << '\n';
+    out << "  --no-skip         Don't leave out packages that are already installed" << '\n';
+    out << "  --refresh         Refresh repository metadata on update even if recent" << '\n';
+    out << "  --metadata-ttl=N  Seconds before update refreshes metadata (default 3600)" << '\n';
+    out << "  --since, --until  Time range for history: 12h, 7d, 2w or YYYY-MM-DD" << '\n';
+    out << "  --failed          Only failed operations in history (or --succeeded)" << '\n';
+    out << "  --stats           History counts and p50/p95 durations per manager" << '\n';
+    out << "  --limit=<n>       Newest history records to show (default 20, 0 for all)" << '\n';
+    out << "  --pipeline        Overlap downloads and installs for long package lists" << '\n';
+    out << "                    (apt, dnf, brew; pacman's lock allows no overlap)" << '\n';
+    out << "  --chunk-size=<n>  Packages per pipelined chunk (default 8)" << '\n';
+    out << "  --output=ndjson   Emit typed JSON events, one per line, for automation" << '\n';
+    out << "  --manifest=<file> Packages to lock, one \"name [version]\" per line" << '\n';
+    out << "  --locked          Install exactly what unipm.lock records" << '\n';
+    out << "  --lockfile=<path> Lockfile for lock and --locked (default unipm.lock)" << '\n';
+    out << "  --fastest-mirror  Use the fastest mirror for this install or update (apt, pacman)" << '\n';
+    out << "  --mirrors=<urls>  Extra candidate mirrors to probe, comma-separated" << '\n';
+    out << "  --trace=<file>    Write a Chrome trace-event timeline of the run" << '\n';
+    out << "  --metrics-dir=<d> Add this run to Prometheus metrics in <d>/unipm.prom" << '\n';
+    out << "  --no-daemon       Don't ask a running unipmd; detect and load everything here" << '\n';
+    out << '\n';
+    out << colorize("Examples:", BOLD) << '\n';
+    out << "  unipm install docker" << '\n';
+    out << "  unipm install node lts" << '\n';
+    out << "  unipm install vscode --yes" << '\n';
+    out << "  unipm remove nginx --dry-run" << '\n';
+    out << "  unipm search postgres" << '\n';
+    out << "  unipm search ripgrep --all" << '\n';
+    out << "  unipm update" << '\n';
+    out << "  unipm history nginx --since=30d" << '\n';
+    out << "  unipm lock --manifest=packages.txt && unipm install --locked" << '\n';
+    out << "  unipm update --fastest-mirror" << '\n';
+    out << "  unipm install ripgrep --trace=run.json" << '\n';
+    emit(out.str());
 }
 
 void UI::printVersion() {
-    std::cout << colorize("unipm version 1.0.0", BOLD) << std::endl;
-    std::cout << "Universal Package Manager" << std::endl;
+    std::ostringstream out;
+    out << colorize("unipm version 1.0.0", BOLD) << '\n';
+    out << "Universal Package Manager" << '\n';
+    emit(out.str());
 }
 
 void UI::printResult(const ExecutionResult& result) {
+    if (Events::enabled()) {
+        Events::result(result, result.busySeconds);
+        return;
+    }
+    
     if (result.success) {
         printSuccess("Command executed successfully");
     } else {
@@ -135,34 +220,392 @@ void UI::printResult(const ExecutionResult& result) {
     }
     
     if (!result.stdoutOutput.empty()) {
-        std::cout << result.stdoutOutput;
+        emit(result.stdoutOutput);
     }
     
     if (!result.stderrOutput.empty() && !result.success) {
-        std::cerr << colorize("Error output:", RED) << std::endl;
-        std::cerr << result.stderrOutput;
+        Terminal::instance().writeError(colorize("Error output:", RED) + "\n" + result.stderrOutput);
     }
 }
 
-bool UI::supportsColor() {
-#ifdef _WIN32
-    // Enable virtual terminal processing on Windows 10+
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (hOut == INVALID_HANDLE_VALUE) {
-        return false;
+void UI::printInstalledPackages(std::vector<InstalledPackage> packages) {
+    if (Events::enabled()) {
+        for (const auto& pkg : packages) {
+            Events::installed(pkg);
+        }
+        return;
     }
     
-    DWORD dwMode = 0;
-    if (!GetConsoleMode(hOut, &dwMode)) {
-        return false;
+    std::sort(packages.begin(), packages.end(),
+              [](const InstalledPackage& a, const InstalledPackage& b) { return a.name < b.name; });
+    
+    size_t width = 0;
+    for (const auto& pkg : packages) {
+        width = std::max(width, pkg.name.size());
     }
     
-    dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    return SetConsoleMode(hOut, dwMode) != 0;
+    // Build the listing in one buffer; thousands of lines are common
+    std::string out;
+    for (const auto& pkg : packages) {
+        out += pkg.name;
+        out.append(width - pkg.name.size() + 2, ' ');
+        out += pkg.version;
+        if (!pkg.architecture.empty()) {
+            out += "  " + pkg.architecture;
+        }
+        if (!pkg.explicitlyInstalled) {
+            out += "  (dependency)";
+        }
+        out += '\n';
+    }
+    out += colorize(std::to_string(packages.size()) + " packages installed", BOLD) + "\n";
+    emit(out);
+}
+
+void UI::printInstalledInfo(const InstalledPackage& pkg) {
+    if (Events::enabled()) {
+        Events::installed(pkg);
+        return;
+    }
+    std::ostringstream out;
+    out << colorize(pkg.name, BOLD) << '\n';
+    out << "  Installed: yes";
+    if (!pkg.explicitlyInstalled) {
+        out << " (as a dependency)";
+    }
+    out << '\n';
+    out << "  Version: " << pkg.version << '\n';
+    if (!pkg.architecture.empty()) {
+        out << "  Architecture: " << pkg.architecture << '\n';
+    }
+    if (pkg.installedSize > 0) {
+        out << "  Installed-Size: " << (pkg.installedSize / 1024) << " KiB" << '\n';
+    }
+    if (!pkg.description.empty()) {
+        out << "  Description: " << pkg.description << '\n';
+    }
+    out << "  Package Manager: " << packageManagerToString(pkg.packageManager) << '\n';
+    emit(out.str());
+}
+
+void UI::printSearchResults(const std::vector<AvailablePackage>& results) {
+    if (Events::enabled()) {
+        for (const auto& pkg : results) {
+            Events::available(pkg);
+        }
+        return;
+    }
+    
+    std::string out;
+    for (const auto& pkg : results) {
+        out += colorize(pkg.name, GREEN) + " " + pkg.version;
+        if (!pkg.section.empty()) {
+            out += " [" + pkg.section + "]";
+        }
+        out += "\n";
+        if (!pkg.description.empty()) {
+            out += "  " + pkg.description + "\n";
+        }
+    }
+    out += colorize(std::to_string(results.size()) + " packages found", BOLD) + "\n";
+    emit(out);
+}
+
+void UI::printSkippedPackages(const std::vector<std::string>& skipped, double checkMs,
+                              double savedSeconds, const std::string& pmName) {
+    std::string names;
+    for (size_t i = 0; i < skipped.size(); ++i) {
+        if (i > 0) names += ", ";
+        names += skipped[i];
+    }
+
+    char timing[128];
+    if (savedSeconds >= 0.0) {
+        std::snprintf(timing, sizeof(timing),
+                      "checked in %.1f ms, saves ~%.1fs based on recent %s installs", checkMs,
+                      savedSeconds, pmName.c_str());
+    } else {
+        std::snprintf(timing, sizeof(timing), "checked in %.1f ms", checkMs);
+    }
+
+    std::string count = std::to_string(skipped.size()) +
+                        (skipped.size() == 1 ? " package is" : " packages are");
+    printInfo("Skipping " + names + ": " + count + " already installed (" + timing + ")");
+    emit(colorize("  Use --no-skip to pass them to the package manager anyway", CYAN) + "\n");
+}
+
+void UI::printPipelineSummary(size_t chunks, double wallSeconds, double busySeconds) {
+    // The steps ran overlapped, so their summed run time only estimates an
+    // unpipelined install: contention stretched each of them
+    char summary[160];
+    std::snprintf(summary, sizeof(summary),
+                  "Pipelined %zu chunks in %.1fs (summed step time %.1fs, an estimate of the "
+                  "unpipelined time)",
+                  chunks, wallSeconds, busySeconds);
+    printInfo(summary);
+}
+
+namespace {
+
+std::string usageRow(const ProcessUsage& usage, const std::string& label) {
+    char row[128];
+    std::snprintf(row, sizeof(row), "%8.2fs %7.2fs %7.2fs %7.1f MB %8lld %8lld %8lld %8lld  ",
+                  usage.wallSeconds, usage.userSeconds, usage.systemSeconds,
+                  usage.maxRssKb / 1024.0, static_cast<long long>(usage.blockReads),
+                  static_cast<long long>(usage.blockWrites),
+                  static_cast<long long>(usage.voluntarySwitches),
+                  static_cast<long long>(usage.involuntarySwitches));
+    return row + label + "\n";
+}
+
+} // namespace
+
+void UI::printProcessUsage(const ExecutionResult& result) {
+    // The result event carries the same figures
+    if (Events::enabled() || result.processes.empty()) {
+        return;
+    }
+    
+    std::string out = colorize("     wall     user      sys    max RSS   blk in  blk out   "
+                               "vol cs invol cs  command",
+                               BOLD) +
+                      "\n";
+    for (const auto& usage : result.processes) {
+        out += usageRow(usage, usage.command);
+    }
+    if (result.processes.size() > 1) {
+        out += usageRow(result.usage, colorize("total", BOLD));
+    }
+    emit(out);
+}
+
+namespace {
+
+std::string formatAge(int64_t seconds) {
+    if (seconds < 120) {
+        return std::to_string(seconds) + "s";
+    }
+    if (seconds < 2 * 3600) {
+        return std::to_string(seconds / 60) + "m";
+    }
+    if (seconds < 2 * 86400) {
+        return std::to_string(seconds / 3600) + "h";
+    }
+    return std::to_string(seconds / 86400) + "d";
+}
+
+} // namespace
+
+void UI::printMetadataFreshness(const std::string& pmName, int64_t ageSeconds, int64_t ttlSeconds,
+                                bool refresh, bool forced) {
+    std::string age = ageSeconds < 0 ? "age unknown"
+                                     : "refreshed " + formatAge(ageSeconds) + " ago";
+    std::string decision;
+    if (forced) {
+        decision = "refreshing (--refresh)";
+    } else if (refresh) {
+        decision = "refreshing";
+    } else {
+        decision = "skipping the refresh (TTL " + formatAge(ttlSeconds) + ", use --refresh to force)";
+    }
+    printInfo(pmName + " repository metadata " + age + ": " + decision);
+}
+
+void UI::printSearchHits(PackageManager pm, const std::vector<AvailablePackage>& hits) {
+    if (Events::enabled()) {
+        for (AvailablePackage pkg : hits) {
+            pkg.packageManager = pm;
+            Events::available(pkg);
+        }
+        return;
+    }
+    
+    const std::string tag = colorize("[" + packageManagerToString(pm) + "]", CYAN);
+    std::string out;
+    for (const auto& pkg : hits) {
+        out += tag + " " + colorize(pkg.name, GREEN);
+        if (!pkg.version.empty()) {
+            out += " " + pkg.version;
+        }
+        if (!pkg.description.empty()) {
+            out += " - " + pkg.description;
+        }
+        out += "\n";
+    }
+    emit(out);
+}
+
+void UI::printSearchSummary(const std::vector<SearchOutcome>& outcomes,
+                            const std::map<std::string, std::vector<PackageManager>>& shared) {
+    if (Events::enabled()) {
+        for (const auto& outcome : outcomes) {
+            Events::search(outcome);
+        }
+        return;
+    }
+    
+    std::string out;
+    if (!shared.empty()) {
+        out += "\n" + colorize("Available from several package managers:", BOLD) + "\n";
+        for (const auto& entry : shared) {
+            out += "  " + entry.first + ":";
+            for (PackageManager pm : entry.second) {
+                out += " " + packageManagerToString(pm);
+            }
+            out += "\n";
+        }
+    }
+
+    out += "\n";
+    for (const auto& outcome : outcomes) {
+        char seconds[32];
+        std::snprintf(seconds, sizeof(seconds), "%.2fs", outcome.seconds);
+        std::string line = packageManagerToString(outcome.packageManager) + ": ";
+        if (outcome.timedOut) {
+            line = colorize(line + "timed out after " + seconds, YELLOW);
+        } else if (!outcome.success) {
+            line = colorize(line + "search failed (" + seconds + ")", RED);
+        } else {
+            line += std::to_string(outcome.results.size()) + " results (" + seconds + ")";
+        }
+        out += "  " + line + "\n";
+    }
+    emit(out);
+}
+
+void UI::printHistory(const std::vector<HistoryRecord>& records) {
+    if (Events::enabled()) {
+        for (const auto& record : records) {
+            Events::history(record);
+        }
+        return;
+    }
+    
+    if (records.empty()) {
+        printInfo("No matching history records");
+        return;
+    }
+
+    std::string out;
+    for (const auto& record : records) {
+        std::time_t seconds = static_cast<std::time_t>(record.timestampMs / 1000);
+        std::tm local = {};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
 #else
-    // Check if stdout is a terminal
-    return ISATTY(FILENO(stdout)) != 0;
+        localtime_r(&seconds, &local);
 #endif
+        char when[32];
+        std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M", &local);
+
+        std::string packages;
+        for (size_t i = 0; i < record.packages.size(); ++i) {
+            if (i > 0) packages += ", ";
+            packages += record.packages[i];
+        }
+
+        char line[96];
+        std::snprintf(line, sizeof(line), "%s  %-8s %-7s %7.1fs  ", when,
+                      record.action.empty() ? "-" : record.action.c_str(),
+                      record.packageManager.empty() ? "-" : record.packageManager.c_str(),
+                      record.durationSeconds);
+        out += line;
+        out += record.success ? colorize("ok", GREEN)
+                              : colorize("exit " + std::to_string(record.exitCode), RED);
+        out += "  " + (packages.empty() ? record.command : packages) + "\n";
+    }
+    emit(out);
+}
+
+void UI::printHistoryStats(const HistoryStats& stats) {
+    if (Events::enabled()) {
+        for (const auto& entry : stats.managers) {
+            Events::emit("history_stats", {{"pm", entry.first},
+                                           {"runs", entry.second.count},
+                                           {"failed", entry.second.failed},
+                                           {"p50_s", entry.second.p50Seconds},
+                                           {"p95_s", entry.second.p95Seconds},
+                                           {"total_s", entry.second.totalSeconds}});
+        }
+        return;
+    }
+    
+    if (stats.count == 0) {
+        printInfo("No matching history records");
+        return;
+    }
+
+    std::string out = colorize("Package manager   runs  failed      p50      p95    total", BOLD) + "\n";
+    for (const auto& entry : stats.managers) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-16s %5zu  %6zu  %6.1fs  %6.1fs  %6.0fs\n",
+                      entry.first.empty() ? "-" : entry.first.c_str(), entry.second.count,
+                      entry.second.failed, entry.second.p50Seconds, entry.second.p95Seconds,
+                      entry.second.totalSeconds);
+        out += line;
+    }
+    out += std::to_string(stats.count) + (stats.count == 1 ? " run, " : " runs, ") +
+           std::to_string(stats.failed) + " failed\n";
+    emit(out);
+}
+
+void UI::printMirrorRanking(const std::string& pmName, const std::vector<MirrorProbe>& ranking,
+                            const std::string& primary, bool cached) {
+    if (Events::enabled()) {
+        for (size_t i = 0; i < ranking.size(); ++i) {
+            const MirrorProbe& probe = ranking[i];
+            Events::emit("mirror", {{"pm", pmName},
+                                    {"rank", i + 1},
+                                    {"url", probe.url},
+                                    {"reachable", probe.reachable},
+                                    {"connect_ms", probe.connectMs},
+                                    {"first_byte_ms", probe.firstByteMs},
+                                    {"bytes_per_s", probe.bytesPerSecond},
+                                    {"in_use", probe.url == primary},
+                                    {"cached", cached},
+                                    {"error", probe.error}});
+        }
+        return;
+    }
+    
+    if (ranking.empty()) {
+        printInfo("No HTTP mirrors configured for " + pmName);
+        return;
+    }
+
+    std::string out = colorize("  #  first byte   throughput  mirror", BOLD) + "\n";
+    for (size_t i = 0; i < ranking.size(); ++i) {
+        const MirrorProbe& probe = ranking[i];
+        char latency[32] = "-";
+        char throughput[32] = "-";
+        if (probe.firstByteMs >= 0) {
+            std::snprintf(latency, sizeof(latency), "%.0f ms", probe.firstByteMs);
+        } else if (probe.reachable) {
+            std::snprintf(latency, sizeof(latency), "~%.0f ms", probe.connectMs);
+        }
+        if (probe.bytesPerSecond > 0) {
+            std::snprintf(throughput, sizeof(throughput), "%.1f MB/s", probe.bytesPerSecond / 1e6);
+        }
+        char line[96];
+        std::snprintf(line, sizeof(line), "%3zu  %10s  %11s  ", i + 1, latency, throughput);
+        out += line + probe.url;
+        if (probe.url == primary) {
+            out += colorize(" (in use)", CYAN);
+        }
+        if (!probe.reachable) {
+            out += colorize(" " + probe.error, RED);
+        }
+        out += "\n";
+    }
+    if (cached) {
+        out += "Probed earlier; --refresh probes again\n";
+    }
+    emit(out);
+}
+
+bool UI::supportsColor() {
+    // Detected once per process; see Terminal
+    return Terminal::instance().capabilities().color && !Events::enabled();
 }
 
 std::string UI::colorize(const std::string& text, const std::string& color) {
@@ -0,0 +1,78 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "unipm/daemon.h"
+
+using namespace unipm;
+
+namespace {
+
+Daemon* running = nullptr;
+
+extern "C" void onSignal(int) {
+    if (running) {
+        running->stop();
+    }
+}
+
+void printUsage() {
+    std::cerr << "Usage: unipmd [--socket=<path>] [--database=<file>] [--threads=<n>]" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Keeps unipm's package database, host detection, repository indexes and" << std::endl;
+    std::cerr << "installed-package inventories in memory; unipm asks it instead of loading" << std::endl;
+    std::cerr << "them itself while it runs. Stop it with SIGINT or SIGTERM." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  --socket=<path>   Socket to listen on (default " << Daemon::socketPath() << ")"
+              << std::endl;
+    std::cerr << "  --database=<file> Package database to serve (default: the one unipm loads)"
+              << std::endl;
+    std::cerr << "  --threads=<n>     Worker threads (default: one per core, at least 2)"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string socketPath = Daemon::socketPath();
+    std::string database;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--socket=", 9) == 0) {
+            socketPath = argv[i] + 9;
+        } else if (std::strncmp(argv[i], "--database=", 11) == 0) {
+            database = argv[i] + 11;
+        } else if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+            long n = std::atol(argv[i] + 10);
+            threads = n > 0 ? static_cast<size_t>(n) : 0;
+        } else {
+            printUsage();
+            return std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0 ? 0 : 2;
+        }
+    }
+
+    Daemon daemon(socketPath, database, threads);
+    std::string error;
+    if (!daemon.start(error)) {
+        std::cerr << "unipmd: " << error << std::endl;
+        return 1;
+    }
+
+    running = &daemon;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);  // A client that hangs up mustn't take the daemon down
+#endif
+
+    std::string served = daemon.databasePath();
+    std::cerr << "unipmd: serving " << (served.empty() ? "no package database" : served) << " on "
+              << socketPath << std::endl;
+    daemon.run();
+    running = nullptr;
+    std::cerr << "unipmd: stopped" << std::endl;
+    return 0;
+}
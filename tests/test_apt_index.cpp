@@ -0,0 +1,101 @@
+#include "../include/unipm/apt_index.h"
+#include "../include/unipm/cache.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace unipm;
+
+int main() {
+    std::cout << "Testing APT package-list index..." << std::endl;
+    
+    // dpkg version ordering
+    assert(AptIndex::compareVersions("1.22.1-9", "1.22.1-9+deb12u1") < 0);
+    assert(AptIndex::compareVersions("1.0~rc1", "1.0") < 0);
+    assert(AptIndex::compareVersions("1:0.9", "2.0") > 0);
+    assert(AptIndex::compareVersions("1.10", "1.9") > 0);
+    assert(AptIndex::compareVersions("2.36-9", "2.36-9") == 0);
+    std::cout << "  ✓ Version comparison passed" << std::endl;
+    
+#ifdef _WIN32
+    std::cout << "  (index tests skipped on Windows)" << std::endl;
+#else
+    const std::string fixtures = std::string(UNIPM_TEST_FIXTURES_DIR) + "/apt/lists";
+    const std::string work = "/tmp/unipm_test_apt_index_" + std::to_string(getpid());
+    const std::string lists = work + "/lists";
+    const std::string cachePath = work + "/cache/apt-index.bin";
+    bool created = Cache::createDirectories(lists);
+    assert(created);
+    
+    const char* files[] = {
+        "deb.debian.org_debian_dists_bookworm_main_binary-amd64_Packages",
+        "security.debian.org_debian-security_dists_bookworm-security_main_binary-amd64_Packages",
+    };
+    for (const char* file : files) {
+        std::string data;
+        bool read = Cache::readFile(fixtures + "/" + file, data);
+        assert(read);
+        bool written = Cache::writeAtomic(lists + "/" + file, data);
+        assert(written);
+    }
+    
+    AptIndex index;
+    bool loaded = index.load(work + "/missing", "");
+    assert(!loaded);
+    loaded = index.load(lists, cachePath);
+    assert(loaded);
+    assert(!index.loadedFromCache());
+    assert(index.size() == 4);
+    
+    // Candidate is the highest version across all lists
+    assert(index.candidateVersion("nginx") == "1.22.1-9+deb12u1");
+    assert(index.candidateVersion("docker.io") == "20.10.24+dfsg1-1");
+    assert(index.isAvailable("python3"));
+    assert(!index.isAvailable("python"));
+    assert(index.find("nginx")->section == "httpd");
+    assert(index.find("nginx")->size == 523500);
+    std::cout << "  ✓ Availability and candidate queries passed" << std::endl;
+    
+    auto results = index.search("NGINX");
+    assert(results.size() == 2);
+    assert(results[0]->name == "nginx");  // Exact match ranks first
+    assert(results[1]->name == "nginx-common");
+    assert(index.search("container runtime").size() == 1);
+    assert(index.search("nginx", 1).size() == 1);
+    std::cout << "  ✓ Search passed" << std::endl;
+    
+    // Second load comes from the cache
+    AptIndex cached;
+    loaded = cached.load(lists, cachePath);
+    assert(loaded);
+    assert(cached.loadedFromCache());
+    assert(cached.size() == 4);
+    assert(cached.candidateVersion("nginx") == "1.22.1-9+deb12u1");
+    
+    // Changing a list invalidates the cache
+    std::string data;
+    bool read = Cache::readFile(lists + "/" + files[1], data);
+    assert(read);
+    data += "\nPackage: redis-server\nVersion: 5:7.0.15-1~deb12u1\nSection: database\n";
+    bool written = Cache::writeAtomic(lists + "/" + files[1], data);
+    assert(written);
+    
+    AptIndex rebuilt;
+    loaded = rebuilt.load(lists, cachePath);
+    assert(loaded);
+    assert(!rebuilt.loadedFromCache());
+    assert(rebuilt.isAvailable("redis-server"));
+    std::cout << "  ✓ Cache reuse and invalidation passed" << std::endl;
+    
+    std::system(("rm -rf '" + work + "'").c_str());
+#endif
+    
+    std::cout << "✓ APT index test passed!" << std::endl;
+    
+    return 0;
+}
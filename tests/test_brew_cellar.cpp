@@ -0,0 +1,63 @@
+#include "../include/unipm/brew_cellar.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+using namespace unipm;
+
+int main() {
+    std::cout << "Testing Homebrew cellar reader..." << std::endl;
+    
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    const std::string prefix = std::string(UNIPM_TEST_FIXTURES_DIR) + "/brew";
+    
+    // Prefix detection from the binary location
+    assert(BrewCellar::prefixFromBinary("/opt/homebrew/bin/brew") == "/opt/homebrew");
+    assert(BrewCellar::prefixFromBinary("/home/linuxbrew/.linuxbrew/bin/brew") ==
+           "/home/linuxbrew/.linuxbrew");
+    assert(BrewCellar::prefixFromBinary("brew").empty());
+    std::cout << "  ✓ Prefix detection passed" << std::endl;
+    
+    BrewCellar cellar;
+    bool loaded = cellar.load(prefix + "/missing");
+    assert(!loaded);
+    loaded = cellar.load(prefix);
+    assert(loaded);
+    assert(cellar.packages().size() == 4);  // 3 formulae + 1 cask
+    
+    const InstalledPackage* wget = cellar.find("wget");
+    assert(wget != nullptr);
+    assert(wget->version == "1.21.4");
+    assert(wget->explicitlyInstalled);
+    
+    // The linked keg wins over the newest one
+    const InstalledPackage* openssl = cellar.find("openssl@3");
+    assert(openssl != nullptr);
+    assert(openssl->version == "3.1.4");
+    assert(!openssl->explicitlyInstalled);
+    
+    // Unlinked kegs are compared as versions, not strings
+    assert(cellar.find("node")->version == "10.1.0");
+    
+    const InstalledPackage* firefox = cellar.find("firefox");
+    assert(firefox != nullptr);
+    assert(firefox->version == "120.0");
+    std::cout << "  ✓ Cellar and Caskroom enumeration passed" << std::endl;
+    
+    BrewCellar single;
+    loaded = single.loadPackage(prefix, "homebrew/core/wget");
+    assert(loaded);
+    assert(single.isInstalled("wget"));
+    assert(!single.isInstalled("node"));
+    loaded = single.loadPackage(prefix, "vim");
+    assert(loaded);
+    assert(!single.isInstalled("vim"));
+    std::cout << "  ✓ Single-package lookup passed" << std::endl;
+#endif
+    
+    std::cout << "✓ Homebrew cellar test passed!" << std::endl;
+    
+    return 0;
+}
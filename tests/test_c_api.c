@@ -0,0 +1,320 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "../include/unipm/unipm.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Relative to the test working directory (the build tree) */
+static const char* DATABASE = "unipm_test_c_api.json";
+static const char* BIN_DIR = "unipm_test_c_api_bin";
+static const char* STDERR_FILE = "unipm_test_c_api_stderr.txt";
+
+static void writeFile(const char* path, const char* contents) {
+    FILE* file = fopen(path, "w");
+    assert(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void writeDatabase(const char* ripgrep) {
+    char contents[512];
+    snprintf(contents, sizeof(contents),
+             "{\"packages\": {"
+             "\"ripgrep\": {\"aliases\": [\"rg\"], \"apt\": \"%s\", \"pacman\": \"ripgrep\"},"
+             "\"docker\": {\"apt\": \"docker.io\", \"brew\": \"docker\"},"
+             "\"node\": {\"apt\": \"nodejs\", \"versions\": {\"lts\": {\"apt\": \"nodejs-lts\"}}}"
+             "}}",
+             ripgrep);
+    writeFile(DATABASE, contents);
+}
+
+static void testDatabase(void) {
+    unipm_db* db = NULL;
+    unipm_status status;
+    printf("Testing database...\n");
+
+    assert(unipm_api_version() == UNIPM_API_VERSION);
+    status = unipm_db_open("unipm_test_c_api_missing.json", &db);
+    assert(status == UNIPM_ERROR_NOT_FOUND);
+    assert(db == NULL);
+    assert(strlen(unipm_last_error()) > 0);
+    status = unipm_db_open(DATABASE, NULL);
+    assert(status == UNIPM_ERROR_INVALID_ARGUMENT);
+
+    status = unipm_db_open(DATABASE, &db);
+
+    assert(status == UNIPM_OK);
+    assert(strcmp(unipm_last_error(), "") == 0);
+    assert(strcmp(unipm_db_path(db), DATABASE) == 0);
+    assert(unipm_db_package_count(db) == 3);
+    unipm_db_close(db);
+
+    printf("✓ Database passed\n");
+}
+
+static void testResolve(unipm_db* db) {
+    unipm_resolutions* out = NULL;
+    unipm_status status;
+    const unipm_resolution* r;
+    const char* names[] = {"rg", "dockr", "zzzzzzzz", "node"};
+    printf("Testing resolve...\n");
+
+    status = unipm_resolve(db, "apt", "rg", NULL, 0, &out);
+
+    assert(status == UNIPM_OK);
+    assert(unipm_resolutions_count(out) == 1);
+    r = unipm_resolutions_get(out, 0);
+    assert(strcmp(r->original_name, "rg") == 0);
+    assert(strcmp(r->resolved_name, "ripgrep-apt") == 0);
+    assert(r->confidence == 1.0f);
+    assert(unipm_resolutions_get(out, 1) == NULL);
+    unipm_resolutions_free(out);
+
+    status = unipm_resolve(db, "apt", "node", "lts", 0, &out);
+
+    assert(status == UNIPM_OK);
+    assert(strcmp(unipm_resolutions_get(out, 0)->resolved_name, "nodejs-lts") == 0);
+    assert(strcmp(unipm_resolutions_get(out, 0)->version, "lts") == 0);
+    unipm_resolutions_free(out);
+
+    /* Batches keep the order of the names */
+    status = unipm_resolve_batch(db, "apt", names, 4, 0, &out);
+    assert(status == UNIPM_OK);
+    assert(unipm_resolutions_count(out) == 4);
+    assert(strcmp(unipm_resolutions_get(out, 0)->resolved_name, "ripgrep-apt") == 0);
+    r = unipm_resolutions_get(out, 1);
+    assert(strcmp(r->resolved_name, "docker.io") == 0);
+    assert(r->confidence > 0.0f && r->confidence < 1.0f);
+    assert(r->suggestion_count > 0 && strcmp(r->suggestions[0], "docker") == 0);
+    r = unipm_resolutions_get(out, 2);
+    assert(strcmp(r->resolved_name, "zzzzzzzz") == 0 && r->confidence == 0.0f);
+    assert(strcmp(unipm_resolutions_get(out, 3)->resolved_name, "nodejs") == 0);
+    unipm_resolutions_free(out);
+
+    /* Exact lookups skip fuzzy matching */
+    status = unipm_resolve(db, "apt", "dockr", NULL, UNIPM_RESOLVE_EXACT, &out);
+    assert(status == UNIPM_OK);
+    r = unipm_resolutions_get(out, 0);
+    assert(strcmp(r->resolved_name, "dockr") == 0);
+    assert(r->confidence == 0.0f && r->suggestion_count == 0);
+    unipm_resolutions_free(out);
+
+    status = unipm_resolve_batch(db, "apt", NULL, 0, 0, &out);
+
+    assert(status == UNIPM_OK);
+    assert(unipm_resolutions_count(out) == 0);
+    unipm_resolutions_free(out);
+
+    status = unipm_resolve(db, "portage", "rg", NULL, 0, &out);
+
+    assert(status == UNIPM_ERROR_UNSUPPORTED);
+    assert(strstr(unipm_last_error(), "portage"));
+    status = unipm_resolve(db, NULL, "rg", NULL, 0, &out);
+    assert(status == UNIPM_ERROR_INVALID_ARGUMENT);
+    status = unipm_resolve(db, "apt", NULL, NULL, 0, &out);
+    assert(status == UNIPM_ERROR_INVALID_ARGUMENT);
+
+    printf("✓ Resolve passed\n");
+}
+
+static void testSuggest(unipm_db* db) {
+    unipm_strings* out = NULL;
+    unipm_status status;
+    printf("Testing suggestions...\n");
+
+    status = unipm_suggest(db, "ripgrap", 2, &out);
+
+    assert(status == UNIPM_OK);
+    assert(unipm_strings_count(out) >= 1 && unipm_strings_count(out) <= 2);
+    assert(strcmp(unipm_strings_get(out, 0), "ripgrep") == 0);
+    assert(unipm_strings_get(out, 5) == NULL);
+    unipm_strings_free(out);
+
+    printf("✓ Suggestions passed\n");
+}
+
+static void testReload(unipm_db* db) {
+    unipm_resolutions* out = NULL;
+    unipm_status status;
+    printf("Testing reload...\n");
+
+    writeDatabase("ripgrep-reloaded");
+    status = unipm_db_reload(db, NULL);
+    assert(status == UNIPM_OK);
+    status = unipm_resolve(db, "apt", "rg", NULL, 0, &out);
+    assert(status == UNIPM_OK);
+    assert(strcmp(unipm_resolutions_get(out, 0)->resolved_name, "ripgrep-reloaded") == 0);
+    unipm_resolutions_free(out);
+
+    /* A broken file leaves the loaded version in place */
+    writeFile(DATABASE, "{\"packages\": {");
+    status = unipm_db_reload(db, NULL);
+    assert(status == UNIPM_ERROR_PARSE);
+    status = unipm_resolve(db, "apt", "rg", NULL, 0, &out);
+    assert(status == UNIPM_OK);
+    assert(strcmp(unipm_resolutions_get(out, 0)->resolved_name, "ripgrep-reloaded") == 0);
+    unipm_resolutions_free(out);
+
+    printf("✓ Reload passed\n");
+}
+
+static void testPlans(void) {
+    unipm_plan* plan = NULL;
+    unipm_status status;
+    const char* const* argv;
+    const char* packages[] = {"docker.io", "ripgrep"};
+    printf("Testing plans...\n");
+
+    status = unipm_plan_create("apt", UNIPM_OP_INSTALL, packages, 2, &plan);
+
+    assert(status == UNIPM_OK);
+    assert(unipm_plan_step_count(plan) == 1);
+    assert(unipm_plan_requires_root(plan));
+    assert(strcmp(unipm_plan_string(plan), "apt install -y docker.io ripgrep") == 0);
+    argv = unipm_plan_step_argv(plan, 0);
+    assert(strcmp(argv[0], "apt") == 0 && strcmp(argv[3], "docker.io") == 0);
+    assert(argv[5] == NULL);
+    assert(unipm_plan_step_argv(plan, 1) == NULL);
+    unipm_plan_free(plan);
+
+    status = unipm_plan_create("brew", UNIPM_OP_LIST, NULL, 0, &plan);
+
+    assert(status == UNIPM_OK);
+    assert(!unipm_plan_requires_root(plan));
+    unipm_plan_free(plan);
+
+    status = unipm_plan_create("apt", UNIPM_OP_INSTALL, NULL, 0, &plan);
+    assert(status == UNIPM_ERROR_INVALID_ARGUMENT);
+    status = unipm_plan_create("snap", UNIPM_OP_LIST, NULL, 0, &plan);
+    assert(status == UNIPM_ERROR_UNSUPPORTED);
+    status = unipm_plan_create("apt", (unipm_operation)42, packages, 1, &plan);
+    assert(status == UNIPM_ERROR_UNSUPPORTED);
+
+    printf("✓ Plans passed\n");
+}
+
+#ifndef _WIN32
+struct Output {
+    char text[256];
+    size_t size;
+};
+
+static void collect(const char* data, size_t size, void* userdata) {
+    struct Output* output = (struct Output*)userdata;
+    assert(output->size + size < sizeof(output->text));
+    memcpy(output->text + output->size, data, size);
+    output->size += size;
+    output->text[output->size] = '\0';
+}
+
+static void testExecute(void) {
+    unipm_plan* plan = NULL;
+    struct Output output;
+    int exitCode = -1;
+    const char* query[] = {"ripgrep"};
+    char path[4096];
+    char script[256];
+    int savedStderr;
+    FILE* captured;
+    struct stat st;
+    int statted;
+    unipm_status status;
+    printf("Testing execute...\n");
+
+    /* A fake apt first on PATH: it echoes its arguments, and fails for "missing" */
+    mkdir(BIN_DIR, 0755);
+    snprintf(script, sizeof(script), "%s/apt", BIN_DIR);
+    writeFile(script, "#!/bin/sh\n"
+                      "echo \"fake apt $*\"\n"
+                      "[ \"$2\" != missing ]\n");
+    chmod(script, 0755);
+    snprintf(path, sizeof(path), "%s:%s", BIN_DIR, getenv("PATH") ? getenv("PATH") : "");
+    setenv("PATH", path, 1);
+
+    status = unipm_plan_create("apt", UNIPM_OP_SEARCH, query, 1, &plan);
+
+    assert(status == UNIPM_OK);
+    memset(&output, 0, sizeof(output));
+    status = unipm_plan_execute(plan, collect, &output, &exitCode);
+    assert(status == UNIPM_OK);
+    assert(exitCode == 0);
+    assert(strstr(output.text, "fake apt search ripgrep"));
+
+    /* Handles are reusable */
+    output.size = 0;
+    status = unipm_plan_execute(plan, collect, &output, NULL);
+    assert(status == UNIPM_OK);
+    assert(strstr(output.text, "fake apt search ripgrep"));
+    unipm_plan_free(plan);
+
+    query[0] = "missing";
+    status = unipm_plan_create("apt", UNIPM_OP_SEARCH, query, 1, &plan);
+    assert(status == UNIPM_OK);
+    status = unipm_plan_execute(plan, NULL, NULL, &exitCode);
+    assert(status == UNIPM_ERROR_EXECUTION);
+    assert(exitCode == 1);
+    unipm_plan_free(plan);
+
+    /* A program that can't be started is reported to the caller, not on stderr */
+    setenv("PATH", BIN_DIR, 1);
+    status = unipm_plan_create("pacman", UNIPM_OP_SEARCH, query, 1, &plan);
+    assert(status == UNIPM_OK);
+    memset(&output, 0, sizeof(output));
+    fflush(stderr);
+    savedStderr = dup(STDERR_FILENO);
+    captured = fopen(STDERR_FILE, "w");
+    assert(savedStderr >= 0 && captured);
+    dup2(fileno(captured), STDERR_FILENO);
+    status = unipm_plan_execute(plan, collect, &output, &exitCode);
+    assert(status == UNIPM_ERROR_EXECUTION);
+    fflush(stderr);
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStderr);
+    fclose(captured);
+    statted = stat(STDERR_FILE, &st);
+    assert(statted == 0 && st.st_size == 0);
+    assert(exitCode == 127);
+    assert(strstr(output.text, "pacman: "));
+    assert(strstr(unipm_last_error(), "pacman: "));
+    unipm_plan_free(plan);
+    setenv("PATH", path, 1);
+
+    remove(STDERR_FILE);
+    remove(script);
+    rmdir(BIN_DIR);
+    printf("✓ Execute passed\n");
+}
+#endif
+
+int main(void) {
+    unipm_db* db = NULL;
+    unipm_status status;
+    printf("Running C API tests...\n\n");
+
+    writeDatabase("ripgrep-apt");
+    testDatabase();
+
+    status = unipm_db_open(DATABASE, &db);
+
+    assert(status == UNIPM_OK);
+    testResolve(db);
+    testSuggest(db);
+    testReload(db);
+    unipm_db_close(db);
+
+    testPlans();
+#ifndef _WIN32
+    testExecute();
+#endif
+
+    remove(DATABASE);
+    printf("\n✓ All C API tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "../include/unipm/adapter.h"
+#include "../include/unipm/command.h"
+#include "../include/unipm/executor.h"
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+using namespace unipm;
+
+namespace {
+
+size_t countLines(const std::string& text) {
+    size_t lines = 0;
+    for (char c : text) {
+        if (c == '\n') lines++;
+    }
+    return lines;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+void testAdapterPlans() {
+    std::cout << "Testing adapter command plans..." << std::endl;
+
+    APTAdapter apt;
+    CommandPlan install = apt.planInstall({"vim", "git"});
+    assert(install.steps.size() == 1);
+    assert(install.steps[0].argv.size() == 5);
+    assert(install.steps[0].operandIndex == 3);
+    assert(install.steps[0].requiresRoot);
+    assert(install.steps[0].lockDomain == "dpkg");
+    assert(apt.getInstallCommand({"vim", "git"}) == "apt install -y vim git");
+
+    // The compound update no longer needs a shell
+    CommandPlan update = apt.planUpdate();
+    assert(update.steps.size() == 2);
+    assert(update.steps[1].dependsOnPrevious);
+    assert(apt.getUpdateCommand() == "apt update && apt upgrade -y");
+    assert(apt.planUpgrade().toString() == "apt upgrade -y");
+
+    // Queries don't need root or a lock
+    CommandPlan search = apt.planSearch("web server");
+    assert(!search.requiresRoot());
+    assert(search.steps[0].lockDomain.empty());
+    assert(search.steps[0].argv.back() == "web server");
+
+    BrewAdapter brew("/opt/homebrew");
+    assert(brew.getUpdateCommand() == "brew update && HOMEBREW_NO_AUTO_UPDATE=1 brew upgrade");
+
+    WingetAdapter winget;
+    assert(winget.planInstall({"Git.Git", "Microsoft.VisualStudioCode"}).steps.size() == 2);
+
+    std::cout << "✓ Adapter command plans passed" << std::endl;
+}
+
+void testQuoting() {
+    std::cout << "Testing shell quoting..." << std::endl;
+
+    assert(shellQuote("nodejs") == "nodejs");
+    assert(shellQuote("python3.11") == "python3.11");
+#ifndef _WIN32
+    assert(shellQuote("") == "''");
+    assert(shellQuote("a b") == "'a b'");
+    assert(shellQuote("it's") == "'it'\\''s'");
+    assert(shellQuote("$(reboot)") == "'$(reboot)'");
+#endif
+
+    std::cout << "✓ Shell quoting passed" << std::endl;
+}
+
+void testExecutor() {
+    std::cout << "Testing plan execution..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    Executor executor;
+
+    // Arguments are passed verbatim, without a shell
+    CommandPlan literal = {CommandStep::query({"printf", "%s\\n", "$HOME; echo injected"})};
+    ExecutionResult result = executor.execute(literal);
+    assert(result.success);
+    assert(result.stdoutOutput == "$HOME; echo injected\n");
+
+    // Environment overrides reach the child
+    CommandStep envStep = CommandStep::query({"sh", "-c", "echo $UNIPM_PLAN_TEST"});
+    envStep.withEnv("UNIPM_PLAN_TEST", "42");
+    result = executor.execute(CommandPlan{envStep});
+    assert(result.stdoutOutput == "42\n");
+
+    // Operands are split across invocations under the argument limit
+    std::vector<std::string> operands;
+    for (int i = 0; i < 200; ++i) {
+        operands.push_back("package-" + std::to_string(i));
+    }
+    CommandStep chunked = CommandStep::query({"sh", "-c", "echo $#", "sh"});
+    chunked.withOperands(operands);
+    executor.setArgumentLimit(1024);
+    result = executor.execute(CommandPlan{chunked});
+    executor.setArgumentLimit(0);
+    assert(result.success);
+    assert(countLines(result.stdoutOutput) > 1);
+    size_t total = 0;
+    size_t pos = 0;
+    while (pos < result.stdoutOutput.size()) {
+        size_t eol = result.stdoutOutput.find('\n', pos);
+        total += std::stoul(result.stdoutOutput.substr(pos, eol - pos));
+        pos = eol + 1;
+    }
+    assert(total == operands.size());
+
+    // Independent steps overlap; steps sharing a lock domain don't
+    CommandStep sleepA = CommandStep::query({"sleep", "0.3"});
+    CommandStep sleepB = CommandStep::query({"sleep", "0.3"});
+    sleepB.dependsOnPrevious = false;
+
+    auto start = std::chrono::steady_clock::now();
+    bool succeeded = executor.execute(CommandPlan{sleepA, sleepB}).success;
+    assert(succeeded);
+    assert(secondsSince(start) < 0.55);
+
+    sleepA.lockDomain = "test";
+    sleepB.lockDomain = "test";
+    start = std::chrono::steady_clock::now();
+    succeeded = executor.execute(CommandPlan{sleepA, sleepB}).success;
+    assert(succeeded);
+    assert(secondsSince(start) >= 0.6);
+
+    // A failing step stops the plan and reports its exit code
+    CommandPlan failing = {CommandStep::query({"sh", "-c", "exit 3"}),
+                           CommandStep::query({"sh", "-c", "echo unreachable"})};
+    result = executor.execute(failing);
+    assert(!result.success);
+    assert(result.exitCode == 3);
+    assert(result.stdoutOutput.empty());
+
+    result = executor.execute(CommandPlan{CommandStep::query({"unipm-no-such-binary"})});
+    assert(!result.success);
+    assert(result.exitCode == 127);
+
+    std::cout << "✓ Plan execution passed" << std::endl;
+#endif
+}
+
+void testProcessUsage() {
+    std::cout << "Testing per-process resource usage..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    Executor executor;
+
+    // The busy loop runs in a grandchild, which the child waits for
+    const std::string busyLoop = "sh -c 'i=0; while [ $i -lt 100000 ]; do i=$((i+1)); done'";
+    CommandPlan plan = {CommandStep::query({"sh", "-c", busyLoop}),
+                        CommandStep::query({"sleep", "0.2"})};
+    ExecutionResult result = executor.execute(plan);
+    assert(result.success);
+    assert(result.processes.size() == 2);
+
+    const ProcessUsage& busy = result.processes[0];
+    const ProcessUsage& sleeper = result.processes[1];
+    assert(busy.command.rfind("sh -c ", 0) == 0);
+    assert(sleeper.command == "sleep 0.2");
+    assert(busy.userSeconds + busy.systemSeconds > 0.02);
+    assert(busy.maxRssKb > 0 && sleeper.maxRssKb > 0);
+    assert(sleeper.wallSeconds >= 0.2);
+    assert(sleeper.userSeconds + sleeper.systemSeconds < busy.userSeconds + busy.systemSeconds);
+    assert(sleeper.voluntarySwitches >= 1);
+
+    // Totals add up the children; wall time is the whole plan's
+    assert(result.usage.command.empty());
+    assert(std::abs(result.usage.userSeconds - (busy.userSeconds + sleeper.userSeconds)) < 1e-9);
+    assert(result.usage.maxRssKb == std::max(busy.maxRssKb, sleeper.maxRssKb));
+    assert(result.usage.voluntarySwitches ==
+           busy.voluntarySwitches + sleeper.voluntarySwitches);
+    assert(result.usage.wallSeconds >= busy.wallSeconds + sleeper.wallSeconds);
+
+    result = executor.capture(CommandStep::query({"true"}));
+    assert(result.processes.size() == 1 && result.processes[0].command == "true");
+
+    // Nothing ran, so nothing was measured
+    result = executor.capture(CommandStep::query({"unipm-no-such-binary"}));
+    assert(result.processes.empty());
+
+    std::cout << "✓ Per-process resource usage passed" << std::endl;
+#endif
+}
+
+int main() {
+    std::cout << "Running command plan tests...\n" << std::endl;
+
+    testAdapterPlans();
+    testQuoting();
+    testExecutor();
+    testProcessUsage();
+
+    std::cout << "\n✓ All command plan tests passed!" << std::endl;
+    return 0;
+}
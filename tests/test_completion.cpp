@@ -0,0 +1,192 @@
+#include "../include/unipm/completion.h"
+#include "../include/unipm/cache.h"
+#include "../include/unipm/parser.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace unipm;
+
+// Relative to the test working directory (the build tree)
+const std::string INDEX_PATH = "unipm_test_completion.idx";
+const std::string DATABASE_PATH = "unipm_test_completion_db.json";
+const std::string INVENTORY_PATH = "unipm_test_completion_inventory.tsv";
+
+CompletionSources testSources() {
+    CompletionSources sources;
+    sources.database = DATABASE_PATH;
+    sources.aptIndex = "unipm_test_completion_missing_apt.bin";
+    sources.inventory = INVENTORY_PATH;
+    return sources;
+}
+
+void writeSources() {
+    bool written = Cache::writeAtomic(DATABASE_PATH, R"({
+  "packages": {
+    "docker": {"aliases": ["docker-ce", "docker.io"], "apt": "docker.io"},
+    "node": {"aliases": ["nodejs", "node.js", "has space"], "apt": "nodejs"},
+    "python": {"aliases": ["python3"]}
+  }
+})");
+    assert(written);
+    written = Cache::writeAtomic(INVENTORY_PATH,
+                                 "unipm-inventory\t1\n"
+                                 "source\tapt\t1\n"
+                                 "path\t/var/lib/dpkg/status\t1\t10\t20\n"
+                                 "pkg\tdocker-compose\t2.0\tamd64\t1\t1\tCompose\n"
+                                 "pkg\tnodejs\t18\tamd64\t1\t1\tNode\n");
+    assert(written);
+}
+
+std::vector<std::string> complete(const CompletionIndex& index, const std::string& prefix,
+                                  size_t limit = 100) {
+    std::vector<std::string> out;
+    for (std::string_view name : index.complete(prefix, limit)) {
+        out.emplace_back(name);
+    }
+    return out;
+}
+
+void testBuildAndSearch() {
+    std::cout << "Testing completion index..." << std::endl;
+
+    std::remove(INDEX_PATH.c_str());
+    writeSources();
+
+    CompletionIndex index(INDEX_PATH);
+    bool loaded = index.load(testSources());
+    assert(loaded);
+    assert(!index.loadedFromCache());
+    // Names, aliases and installed names, deduplicated; "has space" left out
+    assert(index.size() == 9);
+
+    const std::vector<std::string> docker = {"docker", "docker-ce", "docker-compose",
+                                             "docker.io"};
+    assert(complete(index, "dock") == docker);
+    assert(complete(index, "docker-c") == std::vector<std::string>({"docker-ce",
+                                                                    "docker-compose"}));
+    assert(complete(index, "node") == std::vector<std::string>({"node", "node.js", "nodejs"}));
+    assert(complete(index, "zzz").empty());
+    assert(complete(index, "").size() == 9);
+    assert(complete(index, "", 3).size() == 3);
+
+    // A second load maps the file as written
+    CompletionIndex cached(INDEX_PATH);
+    loaded = cached.load(testSources());
+    assert(loaded);
+    assert(cached.loadedFromCache());
+    assert(complete(cached, "dock") == docker);
+
+    std::cout << "✓ Completion index passed" << std::endl;
+}
+
+void testStaleIndex() {
+    std::cout << "Testing stale completion index..." << std::endl;
+
+    writeSources();
+    CompletionIndex index(INDEX_PATH);
+    bool loaded = index.load(testSources());
+    assert(loaded);
+
+    // Any change to a source rebuilds the index
+    bool written = Cache::writeAtomic(DATABASE_PATH,
+                                      R"({"packages": {"ripgrep": {"aliases": ["rg"]}}})");
+    assert(written);
+    CompletionIndex rebuilt(INDEX_PATH);
+    loaded = rebuilt.load(testSources());
+    assert(loaded);
+    assert(!rebuilt.loadedFromCache());
+    assert(complete(rebuilt, "r") == std::vector<std::string>({"rg", "ripgrep"}));
+
+    // A source appearing counts as a change too
+    CompletionSources sources = testSources();
+    sources.aptIndex = INVENTORY_PATH + ".new";
+    written = Cache::writeAtomic(sources.aptIndex, "not an apt index");
+    assert(written);
+    CompletionIndex withApt(INDEX_PATH);
+    loaded = withApt.load(sources);
+    assert(loaded);
+    assert(!withApt.loadedFromCache());
+    std::remove(sources.aptIndex.c_str());
+
+    // Garbage in place of the index is rebuilt, not trusted
+    written = Cache::writeAtomic(INDEX_PATH, "UPMCIDX1 but truncated");
+    assert(written);
+    CompletionIndex repaired(INDEX_PATH);
+    loaded = repaired.load(testSources());
+    assert(loaded);
+    assert(!repaired.loadedFromCache());
+    assert(complete(repaired, "rip") == std::vector<std::string>({"ripgrep"}));
+
+    std::cout << "✓ Stale completion index passed" << std::endl;
+}
+
+void testCandidates() {
+    std::cout << "Testing completion candidates..." << std::endl;
+
+    writeSources();
+    CompletionIndex index(INDEX_PATH);
+    const CompletionSources sources = testSources();
+    auto candidates = [&](const std::vector<std::string>& words) {
+        return Completion::candidates(words, index, sources);
+    };
+
+    assert(candidates({"h"}) == std::vector<std::string>({"history", "help"}));
+    assert(candidates({"install", "--pi"}) == std::vector<std::string>({"--pipeline"}));
+    assert(candidates({"install", "--pm=p"}) == std::vector<std::string>({"--pm=pacman"}));
+    assert(candidates({"search", "--output=n"}) == std::vector<std::string>({"--output=ndjson"}));
+    assert(candidates({"install", "--chunk-size="}).empty());
+    assert(candidates({"install", "docker", "pyth"}) ==
+           std::vector<std::string>({"python", "python3"}));
+    assert(candidates({"rm", "nodej"}) == std::vector<std::string>({"nodejs"}));
+
+    // Every spelling the parser takes for a command with package arguments
+    // completes package names; the others complete nothing
+    const std::vector<std::string> words = {"install", "i",      "remove",  "rm",   "uninstall",
+                                            "search",  "find",   "info",    "show", "lock",
+                                            "history", "update", "upgrade", "list", "ls",
+                                            "doctor",  "dr",     "mirrors"};
+    for (const auto& word : words) {
+        std::vector<std::string> args = {"unipm", word, "node"};
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(&arg[0]);
+        }
+        Command cmd = Parser().parse(static_cast<int>(argv.size()), argv.data());
+        bool takesPackages = cmd.type == CommandType::INSTALL ||
+                             cmd.type == CommandType::REMOVE || cmd.type == CommandType::SEARCH ||
+                             cmd.type == CommandType::INFO || cmd.type == CommandType::LOCK ||
+                             cmd.type == CommandType::HISTORY;
+        std::vector<std::string> found = candidates({word, "nodej"});
+        if (takesPackages) {
+            assert(cmd.packages == std::vector<std::string>({"node"}));
+            assert(found == std::vector<std::string>({"nodejs"}));
+        } else {
+            assert(found.empty());
+        }
+    }
+
+    // Commands without package arguments don't touch the index
+    std::remove(INDEX_PATH.c_str());
+    std::vector<std::string> found = candidates({"update", "py"});
+    assert(found.empty());
+    assert(!Cache::stat(INDEX_PATH).exists);
+
+    std::remove(INDEX_PATH.c_str());
+    std::remove(DATABASE_PATH.c_str());
+    std::remove(INVENTORY_PATH.c_str());
+    std::cout << "✓ Completion candidates passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running completion tests...\n" << std::endl;
+
+    testBuildAndSearch();
+    testStaleIndex();
+    testCandidates();
+
+    std::cout << "\n✓ All completion tests passed!" << std::endl;
+    return 0;
+}
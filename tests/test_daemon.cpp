@@ -0,0 +1,224 @@
+#include "../include/unipm/daemon.h"
+#include "../include/unipm/cache.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+using namespace unipm;
+
+// Relative to the test working directory (the build tree)
+const std::string SOCKET = "unipm_test_daemon.sock";
+const std::string DATABASE = "unipm_test_daemon.json";
+const std::string CACHE = "unipm_test_daemon_cache";
+
+void writeDatabase(const std::string& ripgrep) {
+    bool written = Cache::writeAtomic(DATABASE, "{\"packages\": {"
+                                                "\"ripgrep\": {\"aliases\": [\"rg\"], \"apt\": \"" +
+                                                    ripgrep + "\", \"pacman\": \"ripgrep\"},"
+                                                "\"docker\": {\"apt\": \"docker.io\"}}}");
+    assert(written);
+}
+
+ResolvedPackage resolve(DaemonClient& client, const std::string& name) {
+    ResolvedPackage resolved;
+    bool answered = client.resolve(name, "", PackageManager::APT, false, resolved);
+    assert(answered);
+    return resolved;
+}
+
+void testRequests(Daemon& daemon) {
+    std::cout << "Testing requests..." << std::endl;
+
+    DaemonClient client(SOCKET);
+    bool connected = client.connect();
+    assert(connected);
+    assert(client.servesDatabase(DATABASE));
+    assert(client.database().front() == '/');
+    assert(!client.servesDatabase("data/packages.json"));
+    assert(!client.servesDatabase(""));
+
+    OSInfo os;
+    PMInfo pm;
+    bool detected = client.detect("", os, pm);
+    assert(detected);
+    detected = client.detect("winget", os, pm);
+    assert(detected);
+    assert(pm.type == PackageManager::UNKNOWN);
+
+    ResolvedPackage exact = resolve(client, "rg");
+    assert(exact.resolvedName == "ripgrep-apt" && exact.confidence == 1.0f);
+    ResolvedPackage fuzzy = resolve(client, "dockr");
+    assert(fuzzy.resolvedName == "docker.io");
+    assert(fuzzy.confidence > 0.0f && fuzzy.confidence < 1.0f);
+    ResolvedPackage unknown = resolve(client, "zzzzzzzz");
+    assert(unknown.resolvedName == "zzzzzzzz" && unknown.confidence == 0.0f);
+
+    // Bad requests get errors, and the connection stays usable
+    nlohmann::json response;
+    bool answered = client.call({{"op", "frobnicate"}}, response);
+    assert(!answered);
+    assert(response.contains("error"));
+    assert(client.connected());
+    nlohmann::json handled = daemon.handle({{"op", "resolve"}});
+    assert(handled.contains("error"));
+    ResolvedPackage again = resolve(client, "rg");
+    assert(again.resolvedName == "ripgrep-apt");
+
+    // Only the owner may use the socket
+    struct stat st;
+    int statted = ::stat(SOCKET.c_str(), &st);
+    assert(statted == 0);
+    assert((st.st_mode & 0777) == 0600);
+
+    std::cout << "✓ Requests passed" << std::endl;
+}
+
+void testConcurrentClients() {
+    std::cout << "Testing concurrent clients..." << std::endl;
+
+    std::vector<std::thread> threads;
+    std::vector<int> correct(8, 0);
+    for (size_t i = 0; i < correct.size(); ++i) {
+        threads.emplace_back([&correct, i] {
+            DaemonClient client(SOCKET);
+            if (!client.connect()) {
+                return;
+            }
+            for (int j = 0; j < 200; ++j) {
+                ResolvedPackage resolved;
+                if (client.resolve(j % 2 ? "rg" : "docker", "", PackageManager::APT, false,
+                                   resolved) &&
+                    resolved.resolvedName == (j % 2 ? "ripgrep-apt" : "docker.io")) {
+                    correct[i]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int count : correct) {
+        assert(count == 200);
+    }
+
+    std::cout << "✓ Concurrent clients passed" << std::endl;
+}
+
+void testIdleClients() {
+    std::cout << "Testing idle clients..." << std::endl;
+
+    // More clients sitting connected than the daemon has workers, the way
+    // unipm stays connected through a confirmation prompt
+    std::vector<std::unique_ptr<DaemonClient>> idle;
+    for (int i = 0; i < 6; ++i) {
+        idle.push_back(std::make_unique<DaemonClient>(SOCKET));
+        bool connected = idle.back()->connect();
+        assert(connected);
+        resolve(*idle.back(), "rg");
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    DaemonClient client(SOCKET);
+    bool connected = client.connect();
+    assert(connected);
+    ResolvedPackage rg = resolve(client, "rg");
+    assert(rg.resolvedName == "ripgrep-apt");
+    assert(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+
+    // The idle ones are still served
+    for (auto& other : idle) {
+        ResolvedPackage docker = resolve(*other, "docker");
+        assert(docker.resolvedName == "docker.io");
+    }
+
+    std::cout << "✓ Idle clients passed" << std::endl;
+}
+
+void testDatabaseReload() {
+    std::cout << "Testing database reload..." << std::endl;
+
+    DaemonClient client(SOCKET);
+    bool connected = client.connect();
+    assert(connected);
+    writeDatabase("ripgrep-reloaded");
+
+    // Picked up by watching the file; allow for the stat fallback's interval
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (resolve(client, "rg").resolvedName != "ripgrep-reloaded") {
+        assert(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    // A broken file keeps the last good database
+    bool written = Cache::writeAtomic(DATABASE, "{\"packages\": {");
+    assert(written);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    ResolvedPackage rg = resolve(client, "rg");
+    assert(rg.resolvedName == "ripgrep-reloaded");
+
+    std::cout << "✓ Database reload passed" << std::endl;
+}
+
+void testStartAndStop(Daemon& daemon, std::thread& server) {
+    std::cout << "Testing start and stop..." << std::endl;
+
+    // One daemon per socket
+    Daemon second(SOCKET, DATABASE, 1);
+    std::string error;
+    bool started = second.start(error);
+    assert(!started);
+    assert(error.find("already running") != std::string::npos);
+
+    DaemonClient client(SOCKET);
+    bool connected = client.connect();
+    assert(connected);
+    daemon.stop();
+    server.join();
+
+    // Clients notice and stay disconnected
+    ResolvedPackage resolved;
+    bool answered = client.resolve("rg", "", PackageManager::APT, false, resolved);
+    assert(!answered);
+    assert(!client.connected());
+    assert(!Cache::stat(SOCKET).exists);
+    connected = DaemonClient(SOCKET).connect();
+    assert(!connected);
+    connected = DaemonClient("").connect();
+    assert(!connected);
+
+    std::cout << "✓ Start and stop passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running daemon tests...\n" << std::endl;
+
+    // The daemon caches inventories; keep them out of the real cache
+    setenv("UNIPM_CACHE_DIR", CACHE.c_str(), 1);
+    std::remove(SOCKET.c_str());
+    writeDatabase("ripgrep-apt");
+
+    Daemon daemon(SOCKET, DATABASE, 4);
+    std::string error;
+    bool started = daemon.start(error);
+    assert(started);
+    std::thread server([&daemon] { daemon.run(); });
+
+    testRequests(daemon);
+    testConcurrentClients();
+    testIdleClients();
+    testDatabaseReload();
+    testStartAndStop(daemon, server);
+
+    std::remove(DATABASE.c_str());
+    std::system(("rm -rf " + CACHE).c_str());
+    std::cout << "\n✓ All daemon tests passed!" << std::endl;
+    return 0;
+}
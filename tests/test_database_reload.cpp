@@ -0,0 +1,190 @@
+#include "../include/unipm/config.h"
+#include "../include/unipm/resolver.h"
+#include "../include/unipm/cache.h"
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace unipm;
+
+// Relative to the test working directory (the build tree)
+const int GENERATIONS = 4;
+const std::string BROKEN = "unipm_test_reload_broken.json";
+const std::string USER = "unipm_test_reload_user.json";
+
+std::string databaseFile(int generation) {
+    return "unipm_test_reload_" + std::to_string(generation) + ".json";
+}
+
+// Every mapping carries the generation, so a lookup that mixed two
+// versions shows up as mismatched suffixes
+void writeDatabases() {
+    for (int g = 0; g < GENERATIONS; ++g) {
+        std::string n = std::to_string(g);
+        std::string packages;
+        for (int i = 0; i < 50; ++i) {
+            packages += "\"filler" + std::to_string(i) + "\": {\"apt\": \"filler-" + n + "\"},";
+        }
+        bool written = Cache::writeAtomic(
+            databaseFile(g), "{\"packages\": {" + packages +
+                                 "\"ripgrep\": {\"aliases\": [\"rg\"], \"apt\": \"ripgrep-" + n +
+                                 "\"}, \"docker\": {\"apt\": \"docker-" + n + "\"}}}");
+        assert(written);
+    }
+    bool written = Cache::writeAtomic(BROKEN, "{\"packages\": {");
+    assert(written);
+    written = Cache::writeAtomic(USER, "{\"packages\": {\"docker\": {\"apt\": \"docker-user\"}}}");
+    assert(written);
+}
+
+// Generation a mapping came from, or -1
+int generationOf(const std::string& mapped, const std::string& prefix) {
+    if (mapped.compare(0, prefix.size(), prefix) != 0 || mapped.size() != prefix.size() + 1) {
+        return -1;
+    }
+    return mapped.back() - '0';
+}
+
+void testSnapshots() {
+    std::cout << "Testing snapshots..." << std::endl;
+
+    Config config;
+    assert(config.snapshot()->getAllPackageNames().empty());
+    assert(config.path().empty());
+
+    bool loaded = config.load(databaseFile(0));
+    assert(loaded);
+    std::shared_ptr<const PackageDatabase> first = config.snapshot();
+    assert(first->path() == databaseFile(0));
+    assert(first->getMapping("rg", PackageManager::APT) == "ripgrep-0");
+    assert(first->getCanonicalName("docker-0", PackageManager::APT) == "docker");
+
+    // A reload leaves versions already taken alone
+    loaded = config.load(databaseFile(1));
+    assert(loaded);
+    assert(config.getMapping("rg", PackageManager::APT) == "ripgrep-1");
+    assert(first->getMapping("rg", PackageManager::APT) == "ripgrep-0");
+
+    // Failures publish nothing
+    loaded = config.load(BROKEN);
+    assert(!loaded);
+    loaded = config.load("unipm_test_reload_missing.json");
+    assert(!loaded);
+    assert(config.path() == databaseFile(1));
+
+    // Merging publishes a new version over the same file
+    std::shared_ptr<const PackageDatabase> beforeMerge = config.snapshot();
+    config.mergeUserConfig(USER);
+    assert(config.getMapping("docker", PackageManager::APT) == "docker-user");
+    assert(config.getMapping("rg", PackageManager::APT) == "ripgrep-1");
+    assert(config.path() == databaseFile(1));
+    assert(beforeMerge->getMapping("docker", PackageManager::APT) == "docker-1");
+
+    std::cout << "✓ Snapshots passed" << std::endl;
+}
+
+void testResolvesDuringReloads() {
+    std::cout << "Testing resolves during reloads..." << std::endl;
+
+    auto config = std::make_shared<Config>();
+    bool loaded = config->load(databaseFile(0));
+    assert(loaded);
+    Resolver resolver(config);
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    std::vector<int> lookups(4, 0);
+    std::vector<int> mismatches(4, 0);
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        readers.emplace_back([&, i] {
+            // Resolvers are cheap; a reader may share one or use its own
+            Resolver own(config->handle());
+            Resolver& r = i % 2 ? own : resolver;
+            while (!done) {
+                int rg = generationOf(r.resolve("rg", PackageManager::APT).resolvedName,
+                                      "ripgrep-");
+                int fuzzy = generationOf(r.resolve("dockr", PackageManager::APT).resolvedName,
+                                         "docker-");
+
+                // One version throughout a lookup made with a snapshot
+                std::shared_ptr<const PackageDatabase> database = config->snapshot();
+                int a = generationOf(database->getMapping("ripgrep", PackageManager::APT),
+                                     "ripgrep-");
+                int b = generationOf(database->getMapping("docker", PackageManager::APT),
+                                     "docker-");
+                if (rg < 0 || fuzzy < 0 || a < 0 || a != b) {
+                    mismatches[i]++;
+                }
+                lookups[i]++;
+            }
+        });
+    }
+
+    // Reload continuously, the broken file included, while they resolve
+    const int reloads = 400;
+    for (int n = 1; n <= reloads; ++n) {
+        if (n % 10 == 0) {
+            bool reloaded = config->load(BROKEN);
+            assert(!reloaded);
+        } else {
+            bool reloaded = config->load(databaseFile(n % GENERATIONS));
+            assert(reloaded);
+        }
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        assert(mismatches[i] == 0);
+        assert(lookups[i] > 0);
+    }
+    std::cout << "  " << reloads << " reloads, " << lookups[0] + lookups[1] + lookups[2] +
+                 lookups[3] << " lookups" << std::endl;
+
+    std::cout << "✓ Resolves during reloads passed" << std::endl;
+}
+
+void testPublish() {
+    std::cout << "Testing publish..." << std::endl;
+
+    // Embedders can build versions themselves and publish them to a handle
+    Config loader;
+    bool loaded = loader.load(databaseFile(2));
+    assert(loaded);
+    auto handle = std::make_shared<DatabaseHandle>(loader.snapshot());
+    Resolver resolver(handle);
+    assert(resolver.resolve("rg", PackageManager::APT).resolvedName == "ripgrep-2");
+
+    handle->publish(std::make_shared<const PackageDatabase>(
+        json::parse("{\"packages\": {\"ripgrep\": {\"aliases\": [\"rg\"], \"apt\": \"rg-x\"}}}")));
+    assert(resolver.resolve("rg", PackageManager::APT).resolvedName == "rg-x");
+    assert(resolver.getSuggestions("dockr").empty());
+    assert(handle->current()->path().empty());
+
+    std::cout << "✓ Publish passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running database reload tests...\n" << std::endl;
+
+    writeDatabases();
+    testSnapshots();
+    testResolvesDuringReloads();
+    testPublish();
+
+    for (int g = 0; g < GENERATIONS; ++g) {
+        std::remove(databaseFile(g).c_str());
+    }
+    std::remove(BROKEN.c_str());
+    std::remove(USER.c_str());
+    std::cout << "\n✓ All database reload tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "../include/unipm/dpkg_status.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+using namespace unipm;
+
+int main() {
+    std::cout << "Testing dpkg status reader..." << std::endl;
+    
+    const std::string fixtures = UNIPM_TEST_FIXTURES_DIR;
+    
+    DpkgStatus status;
+    bool loaded = status.load(fixtures + "/dpkg/missing");
+    assert(!loaded);
+    loaded = status.load(fixtures + "/dpkg/status");
+    assert(loaded);
+    
+    // Every stanza is parsed, including the unterminated last one
+    assert(status.entries().size() == 6);
+    std::cout << "  ✓ Parsed " << status.entries().size() << " stanzas" << std::endl;
+    
+    // Installed-state and version queries
+    assert(status.isInstalled("bash"));
+    assert(status.isInstalled("docker.io"));
+    assert(status.isInstalled("containerd"));
+    assert(!status.isInstalled("nginx"));  // config-files only
+    assert(!status.isInstalled("vim"));
+    assert(status.find("docker.io")->version == "20.10.24+dfsg1-1+b3");
+    assert(status.find("libc6:i386") != nullptr);
+    std::cout << "  ✓ Installed-state queries passed" << std::endl;
+    
+    // Multi-line descriptions keep only the synopsis
+    assert(status.find("bash")->description == "GNU Bourne Again SHell");
+    
+    loaded = status.loadExtendedStates(fixtures + "/dpkg/extended_states");
+    assert(loaded);
+    assert(status.isAutoInstalled("containerd", "amd64"));
+    assert(status.isAutoInstalled("libc6", "i386"));
+    assert(!status.isAutoInstalled("libc6", "amd64"));
+    
+    auto installed = status.installedPackages();
+    assert(installed.size() == 5);
+    for (const auto& pkg : installed) {
+        assert(pkg.packageManager == PackageManager::APT);
+        if (pkg.name == "docker.io") {
+            assert(pkg.installedSize == 104312ULL * 1024);
+            assert(pkg.explicitlyInstalled);
+        }
+        if (pkg.name == "containerd") {
+            assert(!pkg.explicitlyInstalled);
+        }
+    }
+    std::cout << "  ✓ Installed package conversion passed" << std::endl;
+    
+    std::cout << "✓ dpkg status test passed!" << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "../include/unipm/events.h"
+#include "../include/unipm/cache.h"
+#include "../include/unipm/executor.h"
+#include "../include/unipm/terminal.h"
+#include "../include/unipm/ui.h"
+#include <json.hpp>
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace unipm;
+using json = nlohmann::json;
+
+void testEventStream() {
+    std::cout << "Testing NDJSON event stream..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    // Relative to the test working directory (the build tree)
+    const std::string path = "unipm_test_events.ndjson";
+    std::cout.flush();
+    int saved = dup(STDOUT_FILENO);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(saved >= 0 && fd >= 0);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    Terminal::instance().attachStandardStreams();
+    Events::enable();
+
+    UI::printInfo("Detecting package managers...");
+    std::cout << "  Using: apt" << std::endl;
+    std::cout << std::endl;  // Blank lines don't become events
+
+    ResolvedPackage resolved;
+    resolved.originalName = "docker";
+    resolved.resolvedName = "docker.io";
+    resolved.packageManager = PackageManager::APT;
+    resolved.confidence = 0.9f;
+    resolved.suggestions = {"docker-ce"};
+    UI::printResolution(resolved);
+
+    CommandPlan plan = {CommandStep::query({"sh", "-c", "echo one; echo two >&2; exit 3"})};
+    Events::plan(plan, false);
+    Executor executor;
+    ExecutionResult result = executor.execute(plan);
+    assert(!result.success);
+    Events::result(result, 0.5);
+    UI::printError("Installation failed");
+
+    Terminal::instance().flush();
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    std::string data;
+    bool read = Cache::readFile(path, data);
+    assert(read);
+    std::remove(path.c_str());
+
+    // Every line is a JSON object with a type and a timestamp
+    std::vector<json> events;
+    std::istringstream lines(data);
+    std::string line;
+    while (std::getline(lines, line)) {
+        json event = json::parse(line, nullptr, false);
+        assert(!event.is_discarded() && event.is_object());
+        assert(event.contains("event") && event["ts"].get<int64_t>() > 0);
+        events.push_back(event);
+    }
+
+    std::vector<std::string> types;
+    std::string output;
+    for (const auto& event : events) {
+        const std::string type = event["event"];
+        if (type == "output") {
+            output += event["data"].get<std::string>();
+        } else {
+            types.push_back(type);
+        }
+    }
+    const std::vector<std::string> expected = {"message", "text", "resolution", "plan",
+                                               "result", "message"};
+    assert(types == expected);
+
+    assert(events[0]["level"] == "info");
+    assert(events[1]["text"] == "  Using: apt");
+    assert(events[2]["resolved"] == "docker.io");
+    assert(events[2]["suggestions"][0] == "docker-ce");
+    assert(events[3]["steps"][0]["argv"][0] == "sh");
+    assert(events[3]["requires_root"] == false);
+    assert(output == "one\ntwo\n");
+
+    const json& last = events.back();
+    assert(last["level"] == "error");
+    const json& resultEvent = events[events.size() - 2];
+    assert(resultEvent["exit_code"] == 3 && resultEvent["success"] == false);
+    assert(resultEvent["duration_s"] == 0.5);
+#endif
+
+    std::cout << "✓ NDJSON event stream passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running event output tests...\n" << std::endl;
+
+    testEventStream();
+
+    std::cout << "\n✓ All event output tests passed!" << std::endl;
+    return 0;
+}
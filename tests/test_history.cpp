@@ -0,0 +1,232 @@
+#include "../include/unipm/history.h"
+#include "../include/unipm/cache.h"
+#include "../include/unipm/executor.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace unipm;
+
+namespace {
+
+std::vector<HistoryRecord> readLog(const std::string& path) {
+    std::vector<HistoryRecord> records;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        HistoryRecord record;
+        bool parsed = HistoryRecord::fromJson(line, record);
+        assert(parsed);
+        records.push_back(record);
+    }
+    return records;
+}
+
+void removeLog(const HistoryLog& log) {
+    std::remove(log.path().c_str());
+    std::remove((log.path() + ".lock").c_str());
+    for (int n = 1; n <= HistoryLog::KEEP_ROTATED + 1; ++n) {
+        std::remove(log.rotatedPath(n).c_str());
+    }
+}
+
+} // namespace
+
+void testRecordFormat() {
+    std::cout << "Testing history record format..." << std::endl;
+
+    HistoryRecord record;
+    record.timestampMs = 1700000000123;
+    record.action = "install";
+    record.packageManager = "apt";
+    record.packages = {"git", "curl"};
+    record.command = "apt install -y git curl";
+    record.durationSeconds = 2.5;
+    record.exitCode = 0;
+    record.success = true;
+    record.userSeconds = 0.75;
+    record.maxRssKb = 40960;
+    record.blockReads = 12;
+    record.involuntarySwitches = 7;
+    ProcessUsage child;
+    child.command = "apt install -y git curl";
+    child.wallSeconds = 2.4;
+    child.voluntarySwitches = 300;
+    record.processes.push_back(child);
+
+    std::string line = record.toJson();
+    assert(line.find('\n') == std::string::npos);
+
+    HistoryRecord parsed;
+    bool valid = HistoryRecord::fromJson(line, parsed);
+    assert(valid);
+    assert(parsed.timestampMs == record.timestampMs);
+    assert(parsed.packages == record.packages);
+    assert(parsed.command == record.command);
+    assert(parsed.success && parsed.userSeconds == 0.75 && parsed.maxRssKb == 40960);
+    assert(parsed.blockReads == 12 && parsed.involuntarySwitches == 7);
+    assert(parsed.processes.size() == 1);
+    assert(parsed.processes[0].command == child.command);
+    assert(parsed.processes[0].wallSeconds == 2.4);
+    assert(parsed.processes[0].voluntarySwitches == 300);
+
+    valid = HistoryRecord::fromJson("[SUCCESS] apt install", parsed);
+    assert(!valid);
+
+    std::cout << "✓ History record format passed" << std::endl;
+}
+
+void testRotation() {
+    std::cout << "Testing history rotation..." << std::endl;
+
+    // Relative to the test working directory (the build tree)
+    HistoryLog log("unipm_test_history/rotate.jsonl", 2048);
+    removeLog(log);
+
+    for (int i = 0; i < 100; ++i) {
+        HistoryRecord record;
+        record.timestampMs = i;
+        record.command = "apt install -y package-" + std::to_string(i);
+        log.append(record);
+    }
+    log.flush();
+
+    // Every file stays under the limit, and only KEEP_ROTATED are kept
+    assert(Cache::stat(log.path()).size <= 2048);
+    for (int n = 1; n <= HistoryLog::KEEP_ROTATED; ++n) {
+        assert(Cache::stat(log.rotatedPath(n)).exists);
+    }
+    assert(!Cache::stat(log.rotatedPath(HistoryLog::KEEP_ROTATED + 1)).exists);
+
+    // The current file ends with the newest records, in order
+    auto records = readLog(log.path());
+    assert(!records.empty());
+    assert(records.back().timestampMs == 99);
+    for (size_t i = 1; i < records.size(); ++i) {
+        assert(records[i].timestampMs == records[i - 1].timestampMs + 1);
+    }
+
+    removeLog(log);
+    std::cout << "✓ History rotation passed" << std::endl;
+}
+
+void testConcurrentProcesses() {
+    std::cout << "Testing concurrent writers..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    const std::string path = "unipm_test_history/concurrent.jsonl";
+    const int processes = 4;
+    const int perProcess = 200;
+    {
+        HistoryLog cleanup(path);
+        removeLog(cleanup);
+    }
+
+    std::vector<pid_t> children;
+    for (int p = 0; p < processes; ++p) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            HistoryLog log(path, 0);
+            for (int i = 0; i < perProcess; ++i) {
+                HistoryRecord record;
+                record.timestampMs = p * 1000 + i;
+                // Long enough that a torn write would be obvious
+                record.command = std::string(2000, static_cast<char>('a' + p));
+                log.append(record);
+            }
+            log.flush();
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    // readLog() asserts that every line parses
+    auto records = readLog(path);
+    assert(records.size() == static_cast<size_t>(processes * perProcess));
+    std::set<int64_t> seen;
+    for (const auto& record : records) {
+        char expected = static_cast<char>('a' + record.timestampMs / 1000);
+        assert(record.command == std::string(2000, expected));
+        seen.insert(record.timestampMs);
+    }
+    assert(seen.size() == records.size());
+
+    HistoryLog cleanup(path);
+    removeLog(cleanup);
+    std::cout << "✓ Concurrent writers passed" << std::endl;
+#endif
+}
+
+void testExecutorRecords() {
+    std::cout << "Testing executor history records..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    // The process-wide log lives under $HOME; point it into the build tree
+    char cwd[4096];
+    const char* found = getcwd(cwd, sizeof(cwd));
+    assert(found);
+    const std::string home = std::string(cwd) + "/unipm_test_history/home";
+    setenv("HOME", home.c_str(), 1);
+    HistoryLog& log = HistoryLog::instance();
+    assert(log.path() == home + "/.unipm/history.jsonl");
+    removeLog(log);
+
+    Executor executor;
+    executor.setHistoryContext("install", PackageManager::APT, {"demo"});
+    const std::string busyLoop = "i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done";
+    CommandPlan plan = {CommandStep::query({"sh", "-c", busyLoop}),
+                        CommandStep::query({"sh", "-c", "exit 3"})};
+    ExecutionResult result = executor.execute(plan);
+    assert(!result.success);
+    log.flush();
+
+    auto records = readLog(log.path());
+    assert(records.size() == 1);
+    const HistoryRecord& record = records[0];
+    assert(record.action == "install" && record.packageManager == "apt");
+    assert(record.packages.size() == 1 && record.packages[0] == "demo");
+    assert(record.exitCode == 3 && !record.success);
+    assert(record.command.find("exit 3") != std::string::npos);
+    assert(record.durationSeconds > 0.0);
+    assert(record.userSeconds + record.systemSeconds > 0.0);
+    assert(record.maxRssKb > 0);
+    assert(record.processes.size() == 2);
+    assert(record.processes[1].command == "sh -c 'exit 3'");
+    assert(record.processes[0].userSeconds + record.processes[0].systemSeconds > 0.0);
+
+    removeLog(log);
+    std::cout << "✓ Executor history records passed" << std::endl;
+#endif
+}
+
+int main() {
+    std::cout << "Running history log tests...\n" << std::endl;
+
+    testRecordFormat();
+    testRotation();
+    testConcurrentProcesses();
+    testExecutorRecords();
+
+    std::cout << "\n✓ All history log tests passed!" << std::endl;
+    return 0;
+}
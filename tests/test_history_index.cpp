@@ -0,0 +1,203 @@
+#include "../include/unipm/history_index.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace unipm;
+
+namespace {
+
+// Relative to the test working directory (the build tree)
+const std::string LOG = "unipm_test_history_index.jsonl";
+
+HistoryRecord makeRecord(int64_t ts, const std::string& pm, std::vector<std::string> packages,
+                         double seconds, bool success) {
+    HistoryRecord record;
+    record.timestampMs = ts;
+    record.action = "install";
+    record.packageManager = pm;
+    record.packages = std::move(packages);
+    record.command = pm + " install";
+    record.durationSeconds = seconds;
+    record.success = success;
+    record.exitCode = success ? 0 : 100;
+    return record;
+}
+
+void appendRecords(const std::vector<HistoryRecord>& records) {
+    HistoryLog log(LOG, 0);
+    for (const auto& record : records) {
+        log.append(record);
+    }
+}
+
+void removeFiles() {
+    std::remove(LOG.c_str());
+    std::remove((LOG + ".lock").c_str());
+    std::remove((LOG + HistoryIndex::INDEX_SUFFIX).c_str());
+}
+
+} // namespace
+
+void testQueries() {
+    std::cout << "Testing history queries..." << std::endl;
+    removeFiles();
+
+    HistoryIndex missing(LOG);
+    bool updated = missing.update();
+    assert(!updated);
+
+    appendRecords({
+        makeRecord(1000, "apt", {"nginx"}, 12.0, true),
+        makeRecord(2000, "apt", {"git", "curl"}, 4.0, true),
+        makeRecord(3000, "brew", {"nginx"}, 30.0, false),
+        makeRecord(4000, "apt", {"nginx", "git"}, 8.0, true),
+    });
+
+    HistoryIndex index(LOG);
+    updated = index.update();
+    assert(updated);
+    assert(index.size() == 4);
+
+    HistoryQuery query;
+    query.package = "nginx";
+    auto records = index.query(query);
+    assert(records.size() == 3);
+    assert(records[0].timestampMs == 1000 && records[2].timestampMs == 4000);
+
+    query.packageManager = "apt";
+    assert(index.query(query).size() == 2);
+
+    query = HistoryQuery();
+    query.outcome = HistoryQuery::Outcome::FAILED;
+    records = index.query(query);
+    assert(records.size() == 1 && records[0].packageManager == "brew");
+    assert(records[0].exitCode == 100);
+
+    query = HistoryQuery();
+    query.sinceMs = 2000;
+    query.untilMs = 3000;
+    assert(index.query(query).size() == 2);
+
+    query = HistoryQuery();
+    query.limit = 2;
+    records = index.query(query);
+    assert(records.size() == 2 && records[0].timestampMs == 3000);
+
+    query = HistoryQuery();
+    query.package = "unknown";
+    assert(index.query(query).empty());
+
+    std::cout << "✓ History queries passed" << std::endl;
+}
+
+void testStats() {
+    std::cout << "Testing history stats..." << std::endl;
+
+    HistoryIndex index(LOG);
+    bool updated = index.update();
+    assert(updated);
+
+    HistoryStats stats = index.stats(HistoryQuery());
+    assert(stats.count == 4 && stats.failed == 1);
+    const auto& apt = stats.managers["apt"];
+    assert(apt.count == 3 && apt.failed == 0);
+    assert(apt.p50Seconds == 8.0);
+    assert(apt.p95Seconds == 12.0);
+    assert(apt.totalSeconds == 24.0);
+    assert(stats.managers["brew"].p50Seconds == 30.0);
+
+    std::cout << "✓ History stats passed" << std::endl;
+}
+
+void testIncrementalAndRotation() {
+    std::cout << "Testing incremental indexing..." << std::endl;
+
+    // A torn final line is left for the next update
+    {
+        std::ofstream(LOG, std::ios::app) << "{\"ts\": 5000, \"pm\": \"apt\"";
+    }
+    HistoryIndex index(LOG);
+    bool updated = index.update();
+    assert(updated);
+    assert(index.size() == 4);
+    {
+        std::ofstream(LOG, std::ios::app) << ", \"packages\": [\"vim\"], \"success\": true}\n";
+    }
+    appendRecords({makeRecord(6000, "dnf", {"vim"}, 2.0, true)});
+
+    HistoryIndex reloaded(LOG);
+    updated = reloaded.update();
+    assert(updated);
+    assert(reloaded.size() == 6);
+    HistoryQuery query;
+    query.package = "vim";
+    auto records = reloaded.query(query);
+    assert(records.size() == 2 && records[1].packageManager == "dnf");
+
+    // A new log after rotation is indexed from scratch
+    std::remove(LOG.c_str());
+    appendRecords({makeRecord(7000, "pacman", {"htop"}, 1.0, true)});
+    HistoryIndex rotated(LOG);
+    updated = rotated.update();
+    assert(updated);
+    assert(rotated.size() == 1);
+    query.package = "htop";
+    assert(rotated.query(query).size() == 1);
+
+    // A corrupt index is rebuilt
+    std::ofstream(LOG + HistoryIndex::INDEX_SUFFIX) << "garbage";
+    HistoryIndex rebuilt(LOG);
+    updated = rebuilt.update();
+    assert(updated);
+    assert(rebuilt.size() == 1);
+
+    removeFiles();
+    std::cout << "✓ Incremental indexing passed" << std::endl;
+}
+
+void testTimeParsing() {
+    std::cout << "Testing history time ranges..." << std::endl;
+
+    const int64_t now = 1700000000000;
+    int64_t ms = 0;
+    bool parsed = HistoryQuery::parseTime("30m", now, ms);
+    assert(parsed && ms == now - 30 * 60 * 1000);
+    parsed = HistoryQuery::parseTime("7d", now, ms);
+    assert(parsed && ms == now - 7LL * 86400 * 1000);
+    parsed = HistoryQuery::parseTime("2w", now, ms);
+    assert(parsed && ms == now - 14LL * 86400 * 1000);
+
+    int64_t day = 0, later = 0;
+    parsed = HistoryQuery::parseTime("2024-01-31", now, day);
+    assert(parsed);
+    parsed = HistoryQuery::parseTime("2024-01-31 14:30", now, later);
+    assert(parsed);
+    assert(later - day == (14 * 60 + 30) * 60 * 1000LL);
+    parsed = HistoryQuery::parseTime("2024-01-31T14:30", now, ms);
+    assert(parsed && ms == later);
+
+    parsed = HistoryQuery::parseTime("", now, ms);
+    assert(!parsed);
+    parsed = HistoryQuery::parseTime("5y", now, ms);
+    assert(!parsed);
+    parsed = HistoryQuery::parseTime("yesterday", now, ms);
+    assert(!parsed);
+
+    std::cout << "✓ History time ranges passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running history index tests...\n" << std::endl;
+
+    testQueries();
+    testStats();
+    testIncrementalAndRotation();
+    testTimeParsing();
+
+    std::cout << "\n✓ All history index tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "../include/unipm/install_timings.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+using namespace unipm;
+
+int main() {
+    std::cout << "Testing install timing history..." << std::endl;
+    
+    // Relative to the test working directory (the build tree)
+    const std::string path = "unipm_test_install_timings.tsv";
+    std::remove(path.c_str());
+    
+    InstallTimings timings(path);
+    bool loaded = timings.load();
+    assert(!loaded);
+    assert(timings.invocationSeconds(PackageManager::APT) < 0);
+    
+    // The first sample seeds the average; later ones are smoothed in
+    timings.record(PackageManager::APT, 10.0, 2);
+    assert(timings.invocationSeconds(PackageManager::APT) == 10.0);
+    assert(timings.perPackageSeconds(PackageManager::APT) == 5.0);
+    
+    timings.record(PackageManager::APT, 20.0, 1);
+    assert(std::fabs(timings.invocationSeconds(PackageManager::APT) - 13.0) < 1e-9);
+    assert(std::fabs(timings.perPackageSeconds(PackageManager::APT) - 9.5) < 1e-9);
+    
+    // Empty installs carry no information
+    timings.record(PackageManager::BREW, 3.0, 0);
+    assert(timings.invocationSeconds(PackageManager::BREW) < 0);
+    
+    bool saved = timings.save();
+    assert(saved);
+    InstallTimings reloaded(path);
+    loaded = reloaded.load();
+    assert(loaded);
+    assert(std::fabs(reloaded.invocationSeconds(PackageManager::APT) - 13.0) < 1e-9);
+    assert(reloaded.invocationSeconds(PackageManager::BREW) < 0);
+    std::remove(path.c_str());
+    
+    std::cout << "✓ install timing test passed!" << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "../include/unipm/inventory.h"
+#include "../include/unipm/adapter.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace unipm;
+
+namespace {
+
+// Reads "name version" lines from a file and counts how often it is read
+class FakeAdapter : public PackageManagerAdapter {
+public:
+    FakeAdapter(PackageManager type, std::string path, int* reads)
+        : type_(type), path_(std::move(path)), reads_(reads) {}
+
+    PackageManager getType() const override { return type_; }
+    std::string getName() const override { return packageManagerToString(type_); }
+    CommandPlan planInstall(const std::vector<std::string>&) override { return {}; }
+    CommandPlan planRemove(const std::vector<std::string>&) override { return {}; }
+    CommandPlan planUpdate() override { return {}; }
+    CommandPlan planSearch(const std::string&) override { return {}; }
+    CommandPlan planList() override { return {}; }
+    CommandPlan planInfo(const std::string&) override { return {}; }
+    bool requiresRoot() override { return false; }
+
+    bool readInstalled(std::vector<InstalledPackage>& packages) override {
+        ++*reads_;
+        std::ifstream in(path_);
+        if (!in.is_open()) {
+            return false;
+        }
+        std::string name, version;
+        while (in >> name >> version) {
+            InstalledPackage pkg;
+            pkg.name = name;
+            pkg.version = version;
+            pkg.architecture = "amd64";
+            pkg.description = "fake\tpackage";  // Separators must survive the cache
+            packages.push_back(pkg);
+        }
+        return true;
+    }
+
+    std::vector<std::string> getInstalledMetadataPaths() override { return {path_}; }
+
+private:
+    PackageManager type_;
+    std::string path_;
+    int* reads_;
+};
+
+void writeFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::trunc);
+    out << contents;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "Testing installed-package inventory..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+
+    const std::string dir = "/tmp/unipm_test_inventory_" + std::to_string(getpid());
+    bool created = Cache::createDirectories(dir);
+    assert(created);
+    const std::string aptFile = dir + "/apt-installed";
+    const std::string brewFile = dir + "/brew-installed";
+    const std::string cachePath = dir + "/inventory.tsv";
+
+    writeFile(aptFile, "curl 7.88\ngit 2.39\n");
+    writeFile(brewFile, "git 2.44\nripgrep 14.1\n");
+
+    int aptReads = 0;
+    int brewReads = 0;
+
+    {
+        Inventory inventory(cachePath);
+        inventory.addSource(PackageManager::APT,
+                            std::make_unique<FakeAdapter>(PackageManager::APT, aptFile, &aptReads));
+        inventory.addSource(PackageManager::BREW,
+                            std::make_unique<FakeAdapter>(PackageManager::BREW, brewFile, &brewReads));
+
+        size_t reread = inventory.refresh();
+        assert(reread == 2);
+        assert(inventory.isTracked(PackageManager::APT));
+        assert(inventory.isInstalled("curl"));
+        assert(inventory.isInstalled("ripgrep", PackageManager::BREW));
+        assert(!inventory.isInstalled("ripgrep", PackageManager::APT));
+        assert(!inventory.isInstalled("vim"));
+        assert(inventory.managersFor("git").size() == 2);
+        assert(inventory.find("git", PackageManager::BREW)->version == "2.44");
+
+        // Architecture-qualified names must match the installed architecture
+        assert(inventory.isInstalled("curl:amd64", PackageManager::APT));
+        assert(!inventory.isInstalled("curl:i386", PackageManager::APT));
+
+        // Nothing changed: nothing is re-read
+        reread = inventory.refresh();
+        assert(reread == 0);
+        assert(aptReads == 1 && brewReads == 1);
+    }
+    std::cout << "  ✓ Cross-PM lookups passed" << std::endl;
+
+    // A new process reuses the persisted inventory
+    {
+        Inventory inventory(cachePath);
+        inventory.addSource(PackageManager::APT,
+                            std::make_unique<FakeAdapter>(PackageManager::APT, aptFile, &aptReads));
+        inventory.addSource(PackageManager::BREW,
+                            std::make_unique<FakeAdapter>(PackageManager::BREW, brewFile, &brewReads));
+
+        size_t reread = inventory.refresh();
+        assert(reread == 0);
+        assert(aptReads == 1 && brewReads == 1);
+        assert(inventory.isInstalled("curl", PackageManager::APT));
+        assert(inventory.find("curl", PackageManager::APT)->description == "fake package");
+        assert(inventory.managersFor("git").size() == 2);
+
+        // Only the source whose metadata changed is re-read
+        writeFile(aptFile, "curl 7.88\ngit 2.39\nvim 9.0\n");
+        reread = inventory.refresh();
+        assert(reread == 1);
+        assert(aptReads == 2 && brewReads == 1);
+        assert(inventory.isInstalled("vim", PackageManager::APT));
+    }
+    std::cout << "  ✓ Incremental refresh from cache passed" << std::endl;
+
+#ifdef __linux__
+    {
+        Inventory inventory(cachePath);
+        inventory.addSource(PackageManager::APT,
+                            std::make_unique<FakeAdapter>(PackageManager::APT, aptFile, &aptReads));
+        inventory.addSource(PackageManager::BREW,
+                            std::make_unique<FakeAdapter>(PackageManager::BREW, brewFile, &brewReads));
+        inventory.refresh();
+        bool watching = inventory.startWatching();
+        assert(watching);
+        size_t changed = inventory.poll();
+        assert(changed == 0);
+
+        // Replace the file the way package managers do: write and rename
+        writeFile(brewFile + ".new", "git 2.44\n");
+        int renamed = std::rename((brewFile + ".new").c_str(), brewFile.c_str());
+        assert(renamed == 0);
+
+        struct pollfd pfd = {inventory.watchDescriptor(), POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 1000);
+        assert(ready == 1);
+        changed = inventory.poll();
+        assert(changed == 1);
+        assert(!inventory.isInstalled("ripgrep"));
+        assert(inventory.isInstalled("vim"));
+    }
+    std::cout << "  ✓ Change watching passed" << std::endl;
+#endif
+
+    std::remove(aptFile.c_str());
+    std::remove(brewFile.c_str());
+    std::remove(cachePath.c_str());
+    rmdir(dir.c_str());
+
+#endif
+
+    std::cout << "✓ inventory test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "../include/unipm/lockfile.h"
+#include "../include/unipm/cache.h"
+#include "../include/unipm/config.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace unipm;
+
+// Relative to the test working directory (the build tree)
+const std::string LOCK_PATH = "unipm_test.lock";
+const std::string MANIFEST_PATH = "unipm_test_manifest.txt";
+
+void testReadManifest() {
+    std::cout << "Testing manifest parsing..." << std::endl;
+
+    bool written = Cache::writeAtomic(MANIFEST_PATH,
+                                      "# tools\ngit\nnode   lts  # runtime\n\n   \ndocker\r\n");
+    assert(written);
+    std::vector<std::string> packages;
+    std::string error;
+    bool read = Lockfile::readManifest(MANIFEST_PATH, packages, error);
+    assert(read);
+    const std::vector<std::string> expected = {"git", "node lts", "docker"};
+    assert(packages == expected);
+
+    packages.clear();
+    read = Lockfile::readManifest("unipm_test_missing_manifest.txt", packages, error);
+    assert(!read);
+    assert(!error.empty() && packages.empty());
+
+    std::remove(MANIFEST_PATH.c_str());
+    std::cout << "✓ Manifest parsing passed" << std::endl;
+}
+
+void testRoundTrip() {
+    std::cout << "Testing lockfile save and load..." << std::endl;
+
+    std::remove(LOCK_PATH.c_str());
+    Lockfile lockfile(LOCK_PATH);
+    LockedManager apt;
+    apt.databaseHash = "fnv1a64:0123456789abcdef";
+    apt.packages.push_back({"node", "lts", "nodejs"});
+    apt.packages.push_back({"docker", "", "docker.io"});
+    lockfile.set(PackageManager::APT, apt);
+    bool saved = lockfile.save();
+    assert(saved);
+
+    // A second platform adds its own section and keeps the first
+    Lockfile other(LOCK_PATH);
+    std::string error;
+    bool read = other.load(error);
+    assert(read);
+    other.set(PackageManager::BREW, {"fnv1a64:fedcba9876543210", {{"node", "", "node"}}});
+    saved = other.save();
+    assert(saved);
+
+    Lockfile loaded(LOCK_PATH);
+    read = loaded.load(error);
+    assert(read);
+    const LockedManager* entry = loaded.find(PackageManager::APT);
+    assert(entry && entry->databaseHash == apt.databaseHash);
+    assert(entry->packages.size() == 2);
+    assert(entry->packages[0].name == "node" && entry->packages[0].version == "lts");
+    assert(entry->packages[0].native == "nodejs");
+    assert(entry->packages[1].native == "docker.io");
+    assert(loaded.find(PackageManager::BREW)->packages[0].native == "node");
+    assert(loaded.find(PackageManager::PACMAN) == nullptr);
+
+    std::remove(LOCK_PATH.c_str());
+    std::cout << "✓ Lockfile save and load passed" << std::endl;
+}
+
+void testBadLockfiles() {
+    std::cout << "Testing malformed lockfiles..." << std::endl;
+
+    std::string error;
+    Lockfile lockfile(LOCK_PATH);
+    std::remove(LOCK_PATH.c_str());
+    bool loaded = lockfile.load(error);
+    assert(!loaded);
+
+    const std::vector<std::string> bad = {
+        "not json",
+        "[]",
+        "{\"version\":1}",
+        "{\"version\":2,\"managers\":{}}",
+        "{\"version\":1,\"managers\":{\"nosuchpm\":{\"packages\":[]}}}",
+        "{\"version\":1,\"managers\":{\"apt\":{\"packages\":[{\"name\":\"git\"}]}}}",
+    };
+    for (const auto& content : bad) {
+        bool written = Cache::writeAtomic(LOCK_PATH, content);
+        assert(written);
+        error.clear();
+        loaded = lockfile.load(error);
+        assert(!loaded);
+        assert(!error.empty());
+        assert(lockfile.find(PackageManager::APT) == nullptr);
+    }
+
+    std::remove(LOCK_PATH.c_str());
+    std::cout << "✓ Malformed lockfiles passed" << std::endl;
+}
+
+void testHashDatabase() {
+    std::cout << "Testing database hash..." << std::endl;
+
+    const std::string path = "unipm_test_database.json";
+    bool written = Cache::writeAtomic(path, "{\"packages\":{}}");
+    assert(written);
+    std::string first = Config::hashDatabase(path);
+    assert(first.rfind("fnv1a64:", 0) == 0 && first.size() == 8 + 16);
+    assert(Config::hashDatabase(path) == first);
+
+    // Any edit, even whitespace, changes the hash
+    written = Cache::writeAtomic(path, "{\"packages\":{}} ");
+    assert(written);
+    assert(Config::hashDatabase(path) != first);
+
+    std::remove(path.c_str());
+    assert(Config::hashDatabase(path).empty());
+    assert(Config::hashDatabase("").empty());
+
+    std::cout << "✓ Database hash passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running lockfile tests...\n" << std::endl;
+
+    testReadManifest();
+    testRoundTrip();
+    testBadLockfiles();
+    testHashDatabase();
+
+    std::cout << "\n✓ All lockfile tests passed!" << std::endl;
+    return 0;
+}
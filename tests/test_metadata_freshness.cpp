@@ -0,0 +1,62 @@
+#include "../include/unipm/metadata_freshness.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+using namespace unipm;
+
+int main() {
+    std::cout << "Testing repository metadata freshness..." << std::endl;
+    
+    // Relative to the test working directory (the build tree)
+    const std::string path = "unipm_test_metadata_refresh.tsv";
+    const std::string listFile = "unipm_test_metadata_list";
+    std::remove(path.c_str());
+    std::remove(listFile.c_str());
+    
+    MetadataFreshness freshness(path);
+    bool loaded = freshness.load();
+    assert(!loaded);
+    assert(freshness.ageSeconds(PackageManager::APT, {listFile}) < 0);
+    
+    // A freshly written index file counts as a refresh
+    std::ofstream(listFile) << "Package: demo\n";
+    int64_t age = freshness.ageSeconds(PackageManager::APT, {listFile, "/nonexistent/unipm"});
+    assert(age >= 0 && age < 5);
+    
+    // So does unipm's own stamp, even without index files
+    assert(freshness.ageSeconds(PackageManager::PACMAN, {}) < 0);
+    freshness.markRefreshed(PackageManager::PACMAN);
+    bool saved = freshness.save();
+    assert(saved);
+    
+    MetadataFreshness reloaded(path);
+    loaded = reloaded.load();
+    assert(loaded);
+    age = reloaded.ageSeconds(PackageManager::PACMAN, {});
+    assert(age >= 0 && age < 5);
+    assert(reloaded.ageSeconds(PackageManager::DNF, {}) < 0);
+    
+    // An old stamp is reported as old
+    std::ofstream(path) << "dnf\t1000\n";
+    loaded = reloaded.load();
+    assert(loaded);
+    assert(reloaded.ageSeconds(PackageManager::DNF, {}) > 365 * 86400);
+    
+#ifndef _WIN32
+    setenv("UNIPM_METADATA_TTL", "120", 1);
+    assert(MetadataFreshness::defaultTtl() == 120);
+    setenv("UNIPM_METADATA_TTL", "soon", 1);
+    assert(MetadataFreshness::defaultTtl() == MetadataFreshness::DEFAULT_TTL_SECONDS);
+    unsetenv("UNIPM_METADATA_TTL");
+#endif
+    
+    std::remove(path.c_str());
+    std::remove(listFile.c_str());
+    
+    std::cout << "✓ Repository metadata freshness passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "../include/unipm/metrics.h"
+#include "../include/unipm/cache.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace unipm;
+
+// Relative to the test working directory (the build tree)
+const std::string DIR = "unipm_test_metrics";
+const std::string FILE_PATH = DIR + "/" + Metrics::FILE_NAME;
+
+// Samples of the textfile by series; counts HELP lines per family in help
+std::map<std::string, double> readSamples(std::map<std::string, int>* help = nullptr) {
+    std::string text;
+    bool read = Cache::readFile(FILE_PATH, text);
+    assert(read);
+    std::map<std::string, double> samples;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("# HELP ", 0) == 0) {
+            if (help) {
+                std::string name = line.substr(7, line.find(' ', 7) - 7);
+                (*help)[name]++;
+            }
+            continue;
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t space = line.rfind(' ');
+        assert(space != std::string::npos);
+        assert(samples.count(line.substr(0, space)) == 0);
+        samples[line.substr(0, space)] = std::atof(line.c_str() + space + 1);
+    }
+    return samples;
+}
+
+ResolvedPackage resolution(float confidence) {
+    ResolvedPackage resolved;
+    resolved.packageManager = PackageManager::APT;
+    resolved.confidence = confidence;
+    return resolved;
+}
+
+void testAccumulates() {
+    std::cout << "Testing cumulative metrics..." << std::endl;
+
+    std::system(("rm -rf " + DIR).c_str());
+    Metrics::reset();
+
+    Metrics::setCommand("install");
+    Metrics::setPackageManager(PackageManager::APT);
+    Metrics::observe("resolve", 0.02);
+    Metrics::observe("execute", 3.0);
+    Metrics::resolution(resolution(1.0f));
+    Metrics::resolution(resolution(0.9f));
+    Metrics::resolution(resolution(0.5f));
+    Metrics::resolution(resolution(0.0f));
+    Metrics::lowConfidencePrompt(true);
+    Metrics::cacheLookup("apt_index", true);
+    Metrics::cacheLookup("inventory", false);
+    bool written = Metrics::write(DIR, 0);
+    assert(written);
+
+    auto samples = readSamples();
+    assert(samples["unipm_operations_total{command=\"install\",pm=\"apt\",outcome=\"success\"}"] ==
+           1);
+    assert(samples["unipm_resolutions_total{match=\"exact\"}"] == 1);
+    assert(samples["unipm_resolutions_total{match=\"fuzzy\"}"] == 2);
+    assert(samples["unipm_resolutions_total{match=\"passthrough\"}"] == 1);
+    assert(samples["unipm_low_confidence_matches_total"] == 1);
+    assert(samples["unipm_low_confidence_prompts_total{answer=\"continue\"}"] == 1);
+    assert(samples["unipm_cache_lookups_total{cache=\"apt_index\",result=\"hit\"}"] == 1);
+    assert(samples["unipm_cache_lookups_total{cache=\"inventory\",result=\"miss\"}"] == 1);
+    assert(samples.count("unipm_last_success_timestamp_seconds") == 1);
+
+    const std::string resolve = "unipm_phase_duration_seconds_bucket{phase=\"resolve\",pm=\"apt\",";
+    assert(samples[resolve + "le=\"0.01\"}"] == 0);
+    assert(samples[resolve + "le=\"0.025\"}"] == 1);
+    assert(samples[resolve + "le=\"+Inf\"}"] == 1);
+    assert(samples["unipm_phase_duration_seconds_sum{phase=\"execute\",pm=\"apt\"}"] == 3.0);
+
+    // write() starts over, so a second run adds only itself
+    double lastSuccess = samples["unipm_last_success_timestamp_seconds"];
+    Metrics::setCommand("install");
+    Metrics::setPackageManager(PackageManager::APT);
+    Metrics::observe("resolve", 0.005);
+    Metrics::observe("resolve", 120);
+    written = Metrics::write(DIR, 100);
+    assert(written);
+
+    std::map<std::string, int> help;
+    samples = readSamples(&help);
+    assert(samples["unipm_operations_total{command=\"install\",pm=\"apt\",outcome=\"success\"}"] ==
+           1);
+    assert(samples["unipm_operations_total{command=\"install\",pm=\"apt\",outcome=\"failure\"}"] ==
+           1);
+    assert(samples["unipm_resolutions_total{match=\"exact\"}"] == 1);
+    assert(samples[resolve + "le=\"0.005\"}"] == 1);
+    assert(samples[resolve + "le=\"0.025\"}"] == 2);
+    assert(samples[resolve + "le=\"300\"}"] == 3);
+    assert(samples[resolve + "le=\"+Inf\"}"] == 3);
+    assert(samples["unipm_phase_duration_seconds_count{phase=\"resolve\",pm=\"apt\"}"] == 3);
+    assert(samples["unipm_last_success_timestamp_seconds"] == lastSuccess);
+    for (const auto& entry : help) {
+        assert(entry.second == 1);
+    }
+    assert(help.count("unipm_phase_duration_seconds") == 1);
+
+    std::system(("rm -rf " + DIR).c_str());
+    std::cout << "✓ Cumulative metrics passed" << std::endl;
+}
+
+void testOutcomesAndLabels() {
+    std::cout << "Testing outcomes and label escaping..." << std::endl;
+
+    std::system(("rm -rf " + DIR).c_str());
+    Metrics::reset();
+
+    // Nothing recorded: nothing written
+    bool written = Metrics::write(DIR, 0);
+    assert(written);
+    assert(!Cache::stat(FILE_PATH).exists);
+
+    for (int i = 0; i < 2; ++i) {
+        Metrics::setCommand("odd \"name\"\\");
+        Metrics::setOutcome("cancelled");
+        written = Metrics::write(DIR, 0);
+        assert(written);
+    }
+    auto samples = readSamples();
+    assert(samples["unipm_operations_total{command=\"odd \\\"name\\\"\\\\\",pm=\"unknown\","
+                   "outcome=\"cancelled\"}"] == 2);
+    assert(samples.count("unipm_last_run_timestamp_seconds") == 1);
+    assert(samples.count("unipm_last_success_timestamp_seconds") == 0);
+
+    // reset() drops what was recorded
+    Metrics::setCommand("remove");
+    Metrics::reset();
+    written = Metrics::write(DIR, 0);
+    assert(written);
+    assert(readSamples().size() == samples.size());
+
+    std::system(("rm -rf " + DIR).c_str());
+    std::cout << "✓ Outcomes and label escaping passed" << std::endl;
+}
+
+void testConcurrentWriters() {
+    std::cout << "Testing concurrent writers..." << std::endl;
+
+    std::system(("rm -rf " + DIR).c_str());
+    Metrics::reset();
+
+    // Separate processes, as separate unipm runs would be
+    const int children = 8;
+    const int runs = 25;
+    for (int i = 0; i < children; ++i) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            bool ok = true;
+            for (int j = 0; j < runs; ++j) {
+                Metrics::setCommand("update");
+                Metrics::observe("execute", 0.1);
+                ok = Metrics::write(DIR, 0) && ok;
+            }
+            _exit(ok ? 0 : 1);
+        }
+    }
+    for (int i = 0; i < children; ++i) {
+        int status = 0;
+        wait(&status);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    auto samples = readSamples();
+    assert(samples["unipm_operations_total{command=\"update\",pm=\"unknown\",outcome=\"success\"}"] ==
+           children * runs);
+    assert(samples["unipm_phase_duration_seconds_count{phase=\"execute\",pm=\"unknown\"}"] ==
+           children * runs);
+
+    std::system(("rm -rf " + DIR).c_str());
+    std::cout << "✓ Concurrent writers passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running metrics tests...\n" << std::endl;
+
+    testAccumulates();
+    testOutcomesAndLabels();
+    testConcurrentWriters();
+
+    std::cout << "\n✓ All metrics tests passed!" << std::endl;
+    return 0;
+}
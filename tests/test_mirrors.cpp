@@ -0,0 +1,418 @@
+#include "../include/unipm/mirrors.h"
+#include "../include/unipm/cache.h"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace unipm;
+
+// Relative to the test working directory (the build tree)
+const std::string ROOT = "unipm_test_mirrors_root";
+const std::string OVERRIDE_DIR = "unipm_test_mirror_override";
+
+/**
+ * A mirror on 127.0.0.1: waits delayMs before answering, then sends
+ * bodyBytes in chunks of chunkBytes, pausing chunkDelayMs between them
+ */
+class FakeMirror {
+public:
+    FakeMirror(int delayMs, size_t bodyBytes, int status = 206, size_t chunkBytes = 0,
+               int chunkDelayMs = 0)
+        : delayMs_(delayMs), bodyBytes_(bodyBytes), status_(status),
+          chunkBytes_(chunkBytes ? chunkBytes : bodyBytes), chunkDelayMs_(chunkDelayMs) {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int bound = bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        assert(bound == 0);
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        int listening = listen(fd_, 8);
+        assert(listening == 0);
+        thread_ = std::thread([this]() { serve(); });
+    }
+
+    ~FakeMirror() {
+        stopping_ = true;
+        shutdown(fd_, SHUT_RDWR);
+        close(fd_);
+        thread_.join();
+    }
+
+    std::string url(const std::string& path = "/debian") const {
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    const std::string& lastRequest() const { return request_; }
+
+private:
+    int fd_;
+    int port_ = 0;
+    int delayMs_;
+    size_t bodyBytes_;
+    int status_;
+    size_t chunkBytes_;
+    int chunkDelayMs_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+    std::string request_;
+
+    void serve() {
+        while (!stopping_) {
+            int client = accept(fd_, nullptr, nullptr);
+            if (client < 0) {
+                return;
+            }
+            std::string request;
+            char buffer[4096];
+            while (request.find("\r\n\r\n") == std::string::npos) {
+                ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+                if (n <= 0) break;
+                request.append(buffer, static_cast<size_t>(n));
+            }
+            request_ = request;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_));
+            size_t body = status_ < 300 ? bodyBytes_ : 0;
+            std::string header = "HTTP/1.1 " + std::to_string(status_) + " Fake\r\n" +
+                                 "Content-Length: " + std::to_string(body) +
+                                 "\r\nConnection: close\r\n\r\n";
+            send(client, header.data(), header.size(), MSG_NOSIGNAL);
+            const std::string chunk(chunkBytes_, 'x');
+            for (size_t sent = 0; sent < body; sent += chunkBytes_) {
+                if (sent > 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(chunkDelayMs_));
+                }
+                send(client, chunk.data(), std::min(chunkBytes_, body - sent), MSG_NOSIGNAL);
+            }
+            close(client);
+        }
+    }
+};
+
+// A port nothing listens on
+int closedPort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+void writeFile(const std::string& path, const std::string& text) {
+    Cache::createDirectories(path.substr(0, path.find_last_of('/')));
+    bool written = Cache::writeAtomic(path, text);
+    assert(written);
+}
+
+void testRanking() {
+    std::cout << "Testing mirror probing and ranking..." << std::endl;
+
+    FakeMirror fast(0, 64 * 1024);
+    FakeMirror slow(150, 64 * 1024);
+    // Answers at once but trickles the body: about 400 KB/s
+    FakeMirror throttled(0, 64 * 1024, 206, 8 * 1024, 20);
+    FakeMirror missing(0, 0, 404);
+    const std::string closed = "http://127.0.0.1:" + std::to_string(closedPort()) + "/debian";
+
+    std::vector<Mirror> mirrors = {
+        {missing.url(), "dists/stable/InRelease", true},
+        {throttled.url(), "dists/stable/InRelease", true},
+        {closed, "dists/stable/InRelease", false},
+        {slow.url(), "dists/stable/InRelease", false},
+        {fast.url(), "dists/stable/InRelease", false},
+    };
+
+    MirrorProber prober(std::chrono::milliseconds(2000));
+    std::vector<MirrorProbe> ranking = prober.rank(mirrors);
+    assert(ranking.size() == 5);
+
+    // Latency decides between fast transfers; throughput sinks a trickle
+    assert(ranking[0].url == fast.url());
+    assert(ranking[1].url == slow.url());
+    assert(ranking[2].url == throttled.url());
+    assert(ranking[0].reachable && ranking[0].bytesPerSecond > 0);
+    assert(ranking[1].firstByteMs >= 140);
+    assert(ranking[2].bytesPerSecond > 0 && ranking[2].bytesPerSecond < ranking[0].bytesPerSecond);
+    assert(ranking[0].cost() < ranking[1].cost() && ranking[1].cost() < ranking[2].cost());
+
+    for (size_t i = 3; i < ranking.size(); ++i) {
+        assert(!ranking[i].reachable);
+        if (ranking[i].url == missing.url()) {
+            assert(ranking[i].error == "HTTP 404");
+        } else {
+            assert(ranking[i].url == closed && !ranking[i].error.empty());
+        }
+    }
+
+    // A small ranged GET of the probe file
+    const std::string& request = fast.lastRequest();
+    assert(request.rfind("GET /debian/dists/stable/InRelease HTTP/1.1\r\n", 0) == 0);
+    assert(request.find("Range: bytes=0-") != std::string::npos);
+
+    std::cout << "✓ Mirror probing and ranking passed" << std::endl;
+}
+
+void testConcurrentProbes() {
+    std::cout << "Testing that mirrors are probed concurrently..." << std::endl;
+
+    FakeMirror a(300, 1024);
+    FakeMirror b(300, 1024);
+    FakeMirror c(300, 1024);
+    std::vector<Mirror> mirrors = {{a.url(), "", true}, {b.url(), "", true}, {c.url(), "", true}};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<MirrorProbe> ranking = MirrorProber().rank(mirrors);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                    .count();
+
+    assert(ranking.size() == 3);
+    for (const auto& probe : ranking) {
+        // Too small a body to time: ranked by latency alone
+        assert(probe.reachable && probe.bytesPerSecond == 0 && probe.firstByteMs >= 290);
+    }
+    assert(ms < 800);
+
+    std::cout << "✓ Concurrent probes passed" << std::endl;
+}
+
+void testReadMirrorLists() {
+    std::cout << "Testing mirror lists from PM configuration..." << std::endl;
+
+    writeFile(ROOT + "/etc/apt/sources.list",
+              "# Debian\n"
+              "deb http://deb.debian.org/debian bookworm main\n"
+              "deb-src http://deb.debian.org/debian bookworm main\n"
+              "deb http://deb.debian.org/debian-security bookworm-security main\n"
+              "deb [arch=amd64 signed-by=/usr/share/keyrings/docker.gpg] "
+              "https://download.docker.com/linux/debian bookworm stable\n"
+              "deb cdrom:[Debian 12]/ bookworm main\n");
+    writeFile(ROOT + "/etc/apt/sources.list.d/extra.sources",
+              "Types: deb\nURIs: http://deb.debian.org/debian/\nSuites: bookworm-updates\n"
+              "Components: main\n\n"
+              "Types: deb\nURIs: http://disabled.example/debian\nSuites: sid\nEnabled: no\n");
+    writeFile(ROOT + "/etc/apt/sources.list.d/flat.list", "deb http://repo.example/flat ./\n");
+
+    std::vector<Mirror> apt = MirrorList::read(PackageManager::APT, ROOT);
+    assert(apt.size() == 4);
+    assert(MirrorList::primary(apt) == "http://deb.debian.org/debian");
+    assert(apt[0].probePath == "dists/bookworm/InRelease");
+    for (const auto& mirror : apt) {
+        assert(mirror.configured);
+        assert(mirror.url.find("cdrom") == std::string::npos);
+        assert(mirror.url.find("disabled") == std::string::npos);
+        if (mirror.url == "https://download.docker.com/linux/debian") {
+            assert(mirror.probePath == "dists/bookworm/InRelease");
+        } else if (mirror.url == "http://repo.example/flat") {
+            assert(mirror.probePath == "InRelease");
+        }
+    }
+
+    Mirror candidate = MirrorList::candidate("http://fast.example/debian/", apt);
+    assert(candidate.url == "http://fast.example/debian" && !candidate.configured);
+    assert(candidate.probePath == "dists/bookworm/InRelease");
+
+    // Another configured apt repository is not a mirror of the primary one
+    MirrorProbe security{"http://deb.debian.org/debian-security", true, 1, 2, 0, ""};
+    MirrorProbe fast{candidate.url, true, 5, 10, 0, ""};
+    MirrorProbe down{"http://down.example/debian", false, -1, -1, 0, "timed out"};
+    assert(MirrorList::fastest(PackageManager::APT, apt, {security, fast}) == candidate.url);
+    assert(MirrorList::fastest(PackageManager::APT, apt, {security, down}).empty());
+
+    writeFile(ROOT + "/etc/pacman.d/mirrorlist",
+              "## Germany\n"
+              "#Server = https://slow.example/archlinux/$repo/os/$arch\n"
+              "Server = https://fast.example/archlinux/$repo/os/$arch\n"
+              "Server = http://other.example/arch/$repo/os/$arch\n");
+    std::vector<Mirror> pacman = MirrorList::read(PackageManager::PACMAN, ROOT);
+    assert(pacman.size() == 3);
+    assert(MirrorList::primary(pacman) == "https://fast.example/archlinux/$repo/os/$arch");
+    assert(pacman[2].url == "https://slow.example/archlinux/$repo/os/$arch");
+    assert(!pacman[2].configured);
+    MirrorProbe other{pacman[1].url, true, 1, 2, 0, ""};
+    assert(MirrorList::fastest(PackageManager::PACMAN, pacman, {other}) == pacman[1].url);
+    std::string url = MirrorProber().probeUrl(pacman[0]);
+    assert(url.find("/archlinux/core/os/") != std::string::npos);
+    assert(url.size() > 8 && url.compare(url.size() - 8, 8, "/core.db") == 0);
+
+    writeFile(ROOT + "/etc/os-release", "NAME=\"Fedora Linux\"\nVERSION_ID=40\n");
+    writeFile(ROOT + "/etc/yum.repos.d/fedora.repo",
+              "[fedora]\nname=Fedora\n"
+              "#baseurl=http://candidate.example/fedora/$releasever/\n"
+              "baseurl=http://dl.example/fedora/$releasever/Everything/$basearch/os/\n"
+              "enabled=1\n\n"
+              "[fedora-debuginfo]\nbaseurl=http://off.example/debug/\nenabled=0\n");
+    std::vector<Mirror> dnf = MirrorList::read(PackageManager::DNF, ROOT);
+    assert(dnf.size() == 2);
+    assert(dnf[0].configured && !dnf[1].configured);
+    url = MirrorProber(MirrorProber::DEFAULT_TIMEOUT, ROOT).probeUrl(dnf[0]);
+    assert(url.rfind("http://dl.example/fedora/40/Everything/", 0) == 0);
+    assert(url.find('$') == std::string::npos);
+    assert(url.find("/os/repodata/repomd.xml") != std::string::npos);
+
+    assert(MirrorList::read(PackageManager::BREW, ROOT).empty());
+    assert(MirrorList::primary({}).empty());
+
+    std::cout << "✓ Mirror lists passed" << std::endl;
+}
+
+void testRewrite() {
+    std::cout << "Testing mirror URL rewriting..." << std::endl;
+
+    const std::string text = "deb http://a.example/x/ stable\n"
+                             "deb http://a.example/xy stable\n"
+                             "URIs: mirror+http://a.example/x\n"
+                             "deb [signed-by=/k.gpg] http://a.example/x stable\n";
+    const std::string expected = "deb http://b.example/y/ stable\n"
+                                 "deb http://a.example/xy stable\n"
+                                 "URIs: mirror+http://a.example/x\n"
+                                 "deb [signed-by=/k.gpg] http://b.example/y stable\n";
+    assert(MirrorOverride::rewrite(text, "http://a.example/x/", "http://b.example/y") == expected);
+    assert(MirrorOverride::rewrite(text, "", "http://b.example") == text);
+
+    std::cout << "✓ Mirror URL rewriting passed" << std::endl;
+}
+
+void testOverride() {
+    std::cout << "Testing per-run mirror override..." << std::endl;
+
+    // testReadMirrorLists wrote the fake configuration
+    MirrorOverride apt(PackageManager::APT, "http://deb.debian.org/debian",
+                       "http://fast.example/debian", OVERRIDE_DIR, ROOT);
+    bool prepared = apt.prepare();
+    assert(prepared);
+
+    std::string text;
+    bool read = Cache::readFile(OVERRIDE_DIR + "/sources.list", text);
+    assert(read);
+    assert(text.find("deb http://fast.example/debian bookworm main") != std::string::npos);
+    assert(text.find("http://deb.debian.org/debian-security") != std::string::npos);
+    read = Cache::readFile(OVERRIDE_DIR + "/sources.list.d/extra.sources", text);
+    assert(read);
+    assert(text.find("URIs: http://fast.example/debian/") != std::string::npos);
+    read = Cache::readFile(OVERRIDE_DIR + "/sources.list.d/flat.list", text);
+    assert(read);
+    assert(Cache::stat(OVERRIDE_DIR + "/lists/partial").exists);
+
+    // The scratch lists need an update before the install
+    CommandPlan install = {
+        CommandStep::mutation({"apt", "install", "-y"}, "dpkg", true).withOperands({"nginx"})};
+    apt.apply(install);
+    assert(install.steps.size() == 2);
+    const CommandStep& update = install.steps[0];
+    assert(update.argv.front() == "apt" && update.argv.back() == "update");
+    assert(update.lockDomain == "apt-lists:" + OVERRIDE_DIR);
+    const CommandStep& step = install.steps[1];
+    assert(step.argv[1] == "-o");
+    assert(step.argv[2] == "Dir::Etc::SourceList=" + OVERRIDE_DIR + "/sources.list");
+    assert(step.argv[step.operandIndex] == "nginx");
+    assert(step.lockDomain == "dpkg");
+
+    CommandPlan upgrade = {CommandStep::mutation({"apt", "update"}, "apt-lists", true),
+                           CommandStep::mutation({"apt", "upgrade", "-y"}, "dpkg", true)};
+    apt.apply(upgrade);
+    assert(upgrade.steps.size() == 2 && upgrade.steps[0].argv.back() == "update");
+
+    CommandStep cleanup = apt.cleanupStep(true);
+    assert(cleanup.argv == std::vector<std::string>({"rm", "-rf", OVERRIDE_DIR}));
+    assert(cleanup.requiresRoot);
+
+    writeFile(ROOT + "/etc/pacman.conf",
+              "[options]\nHoldPkg = pacman glibc\n\n[core]\n"
+              "Include = /etc/pacman.d/mirrorlist\n\n[extra]\n"
+              "Include = /etc/pacman.d/mirrorlist\n");
+    MirrorOverride pacman(PackageManager::PACMAN, "https://fast.example/archlinux/$repo/os/$arch",
+                          "https://slow.example/archlinux/$repo/os/$arch", OVERRIDE_DIR, ROOT);
+    prepared = pacman.prepare();
+    assert(prepared);
+    read = Cache::readFile(OVERRIDE_DIR + "/pacman.conf", text);
+    assert(read);
+    assert(text.find("/etc/pacman.d/mirrorlist") == std::string::npos);
+    assert(text.find("Include = " + OVERRIDE_DIR + "/mirrorlist") != std::string::npos);
+    assert(text.find("HoldPkg = pacman glibc") != std::string::npos);
+    read = Cache::readFile(OVERRIDE_DIR + "/mirrorlist", text);
+    assert(read);
+    assert(text.rfind("Server = https://slow.example/archlinux/$repo/os/$arch\n", 0) == 0);
+
+    CommandPlan sync = {CommandStep::mutation({"pacman", "-S", "--noconfirm"}, "pacman", true)
+                            .withOperands({"ripgrep"})};
+    pacman.apply(sync);
+    assert(sync.steps.size() == 1);
+    assert(sync.steps[0].argv[1] == "--config");
+    assert(sync.steps[0].argv[sync.steps[0].operandIndex] == "ripgrep");
+
+    assert(MirrorOverride::supported(PackageManager::APT));
+    assert(!MirrorOverride::supported(PackageManager::BREW));
+
+    std::system(("rm -rf " + ROOT + " " + OVERRIDE_DIR).c_str());
+    std::cout << "✓ Per-run mirror override passed" << std::endl;
+}
+
+void testRankingCache() {
+    std::cout << "Testing mirror ranking cache..." << std::endl;
+
+    const std::string path = "unipm_test_mirrors.tsv";
+    std::remove(path.c_str());
+
+    MirrorRanking ranking(path);
+    bool read = ranking.load();
+    assert(!read);
+    MirrorProbe fast;
+    fast.url = "https://fast.example/archlinux/$repo/os/$arch";
+    fast.reachable = true;
+    fast.connectMs = 12.5;
+    fast.firstByteMs = 30;
+    fast.bytesPerSecond = 5e6;
+    MirrorProbe down;
+    down.url = "http://down.example/debian";
+    down.error = "timed\tout";
+    ranking.set(PackageManager::PACMAN, {fast, down});
+    bool saved = ranking.save();
+    assert(saved);
+
+    MirrorRanking loaded(path);
+    read = loaded.load();
+    assert(read);
+    const std::vector<MirrorProbe>* probes = loaded.find(PackageManager::PACMAN, 3600);
+    assert(probes && probes->size() == 2);
+    assert((*probes)[0].url == fast.url && (*probes)[0].reachable);
+    assert((*probes)[0].connectMs == 12.5 && (*probes)[0].bytesPerSecond == 5e6);
+    assert(!(*probes)[1].reachable && (*probes)[1].error == "timed out");
+
+    assert(!loaded.find(PackageManager::PACMAN, 0));
+    assert(!loaded.find(PackageManager::APT, 3600));
+
+    std::remove(path.c_str());
+    std::cout << "✓ Mirror ranking cache passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running mirror tests...\n" << std::endl;
+
+    testRanking();
+    testConcurrentProbes();
+    testReadMirrorLists();
+    testRewrite();
+    testOverride();
+    testRankingCache();
+
+    std::cout << "\n✓ All mirror tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "../include/unipm/multi_search.h"
+#include "../include/unipm/parser.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace unipm;
+
+namespace {
+
+const std::string FIXTURES = std::string(UNIPM_TEST_FIXTURES_DIR) + "/search/";
+
+std::string readFixture(const std::string& name) {
+    std::ifstream file(FIXTURES + name);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Searches by running a shell snippet, to exercise deadlines and ordering
+class ScriptedAdapter : public PackageManagerAdapter {
+public:
+    ScriptedAdapter(PackageManager type, std::string script)
+        : type_(type), script_(std::move(script)) {}
+
+    PackageManager getType() const override { return type_; }
+    std::string getName() const override { return packageManagerToString(type_); }
+    CommandPlan planInstall(const std::vector<std::string>&) override { return {}; }
+    CommandPlan planRemove(const std::vector<std::string>&) override { return {}; }
+    CommandPlan planUpdate() override { return {}; }
+    CommandPlan planSearch(const std::string&) override {
+        return {CommandStep::query({"sh", "-c", script_})};
+    }
+    CommandPlan planList() override { return {}; }
+    CommandPlan planInfo(const std::string&) override { return {}; }
+    bool requiresRoot() override { return false; }
+
+    bool parseSearchOutput(const std::string& output,
+                           std::vector<AvailablePackage>& results) override {
+        std::istringstream lines(output);
+        std::string name;
+        while (lines >> name) {
+            AvailablePackage pkg;
+            pkg.name = name;
+            results.push_back(pkg);
+        }
+        return true;
+    }
+
+private:
+    PackageManager type_;
+    std::string script_;
+};
+
+} // namespace
+
+void testOutputParsers() {
+    std::cout << "Testing search output parsers..." << std::endl;
+
+    std::vector<AvailablePackage> results;
+    APTAdapter apt;
+    bool parsed = apt.parseSearchOutput(readFixture("apt.txt"), results);
+    assert(parsed);
+    assert(results.size() == 2);
+    assert(results[0].name == "nodejs");
+    assert(results[0].version == "18.19.0+dfsg-6~deb12u1");
+    assert(results[0].description == "evented I/O for V8 javascript - runtime executable");
+
+    results.clear();
+    PacmanAdapter pacman;
+    parsed = pacman.parseSearchOutput(readFixture("pacman.txt"), results);
+    assert(parsed);
+    assert(results.size() == 2);
+    assert(results[0].name == "nodejs");
+    assert(results[0].section == "extra");
+    assert(results[1].description == "Evented I/O for V8 javascript (LTS release: Iron)");
+
+    results.clear();
+    DNFAdapter dnf;
+    parsed = dnf.parseSearchOutput(readFixture("dnf.txt"), results);
+    assert(parsed);
+    assert(results.size() == 2);
+    assert(results[0].name == "ripgrep");
+    assert(results[1].name == "ripgrep-doc");
+
+    results.clear();
+    BrewAdapter brew("/opt/homebrew");
+    parsed = brew.parseSearchOutput(readFixture("brew.txt"), results);
+    assert(parsed);
+    assert(results.size() == 4);
+    assert(results[2].name == "node@18");
+    assert(results[3].name == "nodebox" && results[3].section == "cask");
+
+    results.clear();
+    WingetAdapter winget;
+    parsed = winget.parseSearchOutput(readFixture("winget.txt"), results);
+    assert(parsed);
+    assert(results.size() == 2);
+    assert(results[0].name == "OpenJS.NodeJS");
+    assert(results[0].version == "21.6.1");
+    assert(results[1].description == "Node.js LTS");
+
+    results.clear();
+    ChocolateyAdapter choco;
+    parsed = choco.parseSearchOutput(readFixture("choco.txt"), results);
+    assert(parsed);
+    assert(results.size() == 2);
+    assert(results[1].name == "nodejs-lts" && results[1].version == "20.11.0");
+
+    std::cout << "✓ Search output parsers passed" << std::endl;
+}
+
+void testMerger() {
+    std::cout << "Testing cross-PM dedupe..." << std::endl;
+
+    auto config = std::make_shared<Config>();
+    bool loaded = config->load(FIXTURES + "packages.json");
+    assert(loaded);
+    assert(config->getCanonicalName("nodejs", PackageManager::APT) == "node");
+    assert(config->getCanonicalName("nodejs", PackageManager::BREW).empty());
+
+    SearchOutcome aptOutcome;
+    aptOutcome.packageManager = PackageManager::APT;
+    AvailablePackage nodejs;
+    nodejs.name = "nodejs";
+    nodejs.packageManager = PackageManager::APT;
+    aptOutcome.results = {nodejs, nodejs};
+
+    SearchOutcome brewOutcome;
+    brewOutcome.packageManager = PackageManager::BREW;
+    AvailablePackage node;
+    node.name = "node";
+    node.packageManager = PackageManager::BREW;
+    AvailablePackage yarn;
+    yarn.name = "yarn";
+    yarn.packageManager = PackageManager::BREW;
+    brewOutcome.results = {node, yarn};
+
+    SearchMerger merger(config);
+    auto fresh = merger.add(aptOutcome);
+    assert(fresh.size() == 1);
+    fresh = merger.add(brewOutcome);
+    assert(fresh.size() == 1 && fresh[0].name == "yarn");
+
+    auto shared = merger.duplicates();
+    assert(shared.size() == 1);
+    assert(shared["node"].size() == 2);
+
+    std::cout << "✓ Cross-PM dedupe passed" << std::endl;
+}
+
+void testFanOut() {
+    std::cout << "Testing concurrent fan-out..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    MultiSearch search(std::chrono::milliseconds(500));
+    search.add(std::make_unique<ScriptedAdapter>(PackageManager::APT, "sleep 0.3; echo slow"));
+    search.add(std::make_unique<ScriptedAdapter>(PackageManager::BREW, "echo fast"));
+    search.add(std::make_unique<ScriptedAdapter>(PackageManager::DNF, "sleep 5; echo hung"));
+    search.add(std::make_unique<ScriptedAdapter>(PackageManager::PACMAN, "sleep 0.3; echo other"));
+
+    std::vector<PackageManager> order;
+    auto start = std::chrono::steady_clock::now();
+    auto outcomes = search.run("anything", [&order](const SearchOutcome& outcome) {
+        order.push_back(outcome.packageManager);
+    });
+    double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Bounded by the deadline, not by the sum of the searches
+    assert(elapsed < 1.5);
+    assert(order.size() == 4);
+    assert(order.front() == PackageManager::BREW);
+    assert(order.back() == PackageManager::DNF);
+
+    assert(outcomes[0].success && outcomes[0].results[0].name == "slow");
+    assert(outcomes[2].timedOut && !outcomes[2].success);
+    assert(outcomes[2].results.empty());
+
+    std::cout << "✓ Concurrent fan-out passed" << std::endl;
+#endif
+}
+
+void testFlagsAfterPackages() {
+    std::cout << "Testing flag parsing..." << std::endl;
+
+    const char* argv[] = {"unipm", "search", "ripgrep", "--all", "--timeout=3", "-n"};
+    Parser parser;
+    Command cmd = parser.parse(6, const_cast<char**>(argv));
+    assert(cmd.type == CommandType::SEARCH);
+    assert(cmd.packages.size() == 1 && cmd.packages[0] == "ripgrep");
+    assert(cmd.options["all"] == "true");
+    assert(cmd.options["timeout"] == "3");
+    assert(cmd.dryRun);
+
+    std::cout << "✓ Flag parsing passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running multi-PM search tests...\n" << std::endl;
+
+    testOutputParsers();
+    testMerger();
+    testFanOut();
+    testFlagsAfterPackages();
+
+    std::cout << "\n✓ All multi-PM search tests passed!" << std::endl;
+    return 0;
+}
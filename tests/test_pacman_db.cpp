@@ -0,0 +1,54 @@
+#include "../include/unipm/pacman_db.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+using namespace unipm;
+
+int main() {
+    std::cout << "Testing pacman local database reader..." << std::endl;
+    
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    
+    const std::string local = std::string(UNIPM_TEST_FIXTURES_DIR) + "/pacman/local";
+    
+    PacmanLocalDB db;
+    bool loaded = db.load(local + "/missing");
+    assert(!loaded);
+    loaded = db.load(local);
+    assert(loaded);
+    
+    // Directories without a desc file are skipped
+    assert(db.packages().size() == 4);
+    std::cout << "  ✓ Read " << db.packages().size() << " package directories" << std::endl;
+    
+    const InstalledPackage* bash = db.find("bash");
+    assert(bash != nullptr);
+    assert(bash->version == "5.2.015-1");
+    assert(bash->installedSize == 9459222);
+    assert(bash->architecture == "x86_64");
+    assert(bash->explicitlyInstalled);
+    
+    const InstalledPackage* glibc = db.find("glibc");
+    assert(glibc != nullptr);
+    assert(!glibc->explicitlyInstalled);  // %REASON% 1
+    assert(!db.isInstalled("broken"));
+    assert(!db.isInstalled("vim"));
+    std::cout << "  ✓ Installed index queries passed" << std::endl;
+    
+    // Single-package lookup only reads matching directories
+    PacmanLocalDB single;
+    loaded = single.loadPackage("python", local);
+    assert(loaded);
+    assert(single.packages().size() == 2);  // python and python-requests
+    assert(single.find("python")->version == "3.11.5-1");
+    assert(!single.isInstalled("bash"));
+    std::cout << "  ✓ Single-package lookup passed" << std::endl;
+#endif
+    
+    std::cout << "✓ pacman database test passed!" << std::endl;
+    
+    return 0;
+}
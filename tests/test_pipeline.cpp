@@ -0,0 +1,220 @@
+#include "../include/unipm/pipeline.h"
+#include "../include/unipm/cache.h"
+#include "../include/unipm/executor.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace unipm;
+
+namespace {
+
+std::vector<std::string> packageNames(size_t count) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; ++i) {
+        names.push_back("pkg" + std::to_string(i));
+    }
+    return names;
+}
+
+// "Downloads" by copying from a local mirror directory, and "installs" by
+// checking the staged files are there; both take a fixed delay per package.
+// The plain install downloads everything, then installs it
+class MirrorAdapter : public PackageManagerAdapter {
+public:
+    explicit MirrorAdapter(std::string mirror) : mirror_(std::move(mirror)) {}
+
+    PackageManager getType() const override { return PackageManager::APT; }
+    std::string getName() const override { return "mirror"; }
+    CommandPlan planInstall(const std::vector<std::string>& packages) override {
+        CommandPlan plan = planDownload(packages, mirror_ + ".plain");
+        plan.steps.push_back(planInstallStaged(packages, mirror_ + ".plain").steps[0]);
+        return plan;
+    }
+    CommandPlan planRemove(const std::vector<std::string>&) override { return {}; }
+    CommandPlan planUpdate() override { return {}; }
+    CommandPlan planSearch(const std::string&) override { return {}; }
+    CommandPlan planList() override { return {}; }
+    CommandPlan planInfo(const std::string&) override { return {}; }
+    bool requiresRoot() override { return false; }
+
+    CommandPlan planDownload(const std::vector<std::string>& packages,
+                             const std::string& stagingDir) override {
+        std::vector<std::string> argv = {
+            "sh", "-c",
+            "mkdir -p \"$0\"; for p; do sleep 0.15; cp \"" + mirror_ +
+                "/$p.pkg\" \"$0\" || exit 1; done",
+            stagingDir};
+        return {CommandStep::mutation(argv, "download:" + stagingDir, false)
+                    .withOperands(packages)};
+    }
+
+    CommandPlan planInstallStaged(const std::vector<std::string>& packages,
+                                  const std::string& stagingDir) override {
+        std::vector<std::string> argv = {
+            "sh", "-c", "for p; do sleep 0.15; test -f \"$0/$p.pkg\" || exit 1; done", stagingDir};
+        return {CommandStep::mutation(argv, "install", false).withOperands(packages)};
+    }
+
+private:
+    std::string mirror_;
+};
+
+} // namespace
+
+void testAptPlan() {
+    std::cout << "Testing apt pipelined plan..." << std::endl;
+
+    APTAdapter apt;
+    InstallPipeline pipeline(apt, 8, "/tmp/stage");
+
+    // Short lists aren't worth pipelining
+    CommandPlan plain = pipeline.plan(packageNames(8));
+    assert(!pipeline.pipelined());
+    assert(plain.toString() == apt.planInstall(packageNames(8)).toString());
+
+    CommandPlan plan = pipeline.plan(packageNames(20));
+    assert(pipeline.pipelined());
+    assert(pipeline.chunkCount() == 3);
+
+    // download 0, install 0 | download 1, install 1 | download 2, install 2
+    assert(plan.steps.size() == 6);
+    const bool expectedDepends[] = {true, true, false, true, false, true};
+    for (size_t i = 0; i < plan.steps.size(); ++i) {
+        assert(plan.steps[i].dependsOnPrevious == expectedDepends[i]);
+        assert(plan.steps[i].requiresRoot);
+    }
+
+    const CommandStep& download = plan.steps[2];
+    assert(download.toString().find("--download-only") != std::string::npos);
+    assert(download.toString().find("Dir::Cache::Archives=/tmp/stage/chunk-1/") !=
+           std::string::npos);
+    assert(download.lockDomain != "dpkg");
+
+    const CommandStep& install = plan.steps[1];
+    assert(install.lockDomain == "dpkg");
+    assert(install.toString().find("Dir::Cache::Archives=/tmp/stage/chunk-0/") !=
+           std::string::npos);
+    assert(install.toString().find("pkg7") != std::string::npos);
+    assert(install.toString().find("pkg8") == std::string::npos);
+
+    // Without a staging directory downloads would wait on the dpkg lock, so
+    // it is the plain install
+    InstallPipeline shared(apt, 8, "");
+    CommandPlan sharedPlan = shared.plan(packageNames(20));
+    assert(!shared.pipelined());
+    assert(sharedPlan.toString() == apt.planInstall(packageNames(20)).toString());
+
+    std::cout << "✓ apt pipelined plan passed" << std::endl;
+}
+
+void testLockedAndUnsupported() {
+    std::cout << "Testing lock-bound and unsupported managers..." << std::endl;
+
+    // pacman -Sw takes the database lock, so downloads can never overlap
+    // installs; one pacman -S beats chunks run one after another
+    PacmanAdapter pacman;
+    InstallPipeline pacmanPipeline(pacman, 4, "");
+    CommandPlan plan = pacmanPipeline.plan(packageNames(10));
+    assert(!pacmanPipeline.pipelined());
+    assert(plan.toString() == pacman.planInstall(packageNames(10)).toString());
+
+    DNFAdapter dnf;
+    InstallPipeline dnfPipeline(dnf, 4, "");
+    plan = dnfPipeline.plan(packageNames(10));
+    assert(plan.steps[0].toString().find("--downloadonly") != std::string::npos);
+    assert(plan.steps[2].lockDomain != plan.steps[1].lockDomain);
+
+    // winget can't download without installing
+    WingetAdapter winget;
+    InstallPipeline wingetPipeline(winget, 4, "");
+    plan = wingetPipeline.plan(packageNames(10));
+    assert(!wingetPipeline.pipelined());
+    assert(plan.toString() == winget.planInstall(packageNames(10)).toString());
+
+    std::cout << "✓ Lock-bound and unsupported managers passed" << std::endl;
+}
+
+void testOverlapAgainstMirror() {
+    std::cout << "Testing pipelined install against a local mirror..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    // Relative to the test working directory (the build tree)
+    const std::string mirror = "unipm_test_pipeline_mirror";
+    const std::string staging = "unipm_test_pipeline_staging";
+    Executor executor;
+    const std::string plain = mirror + ".plain";
+    executor.capture(CommandStep::query({"rm", "-rf", mirror, plain, staging}));
+
+    const auto names = packageNames(6);
+    bool created = Cache::createDirectories(mirror);
+    assert(created);
+    for (const auto& name : names) {
+        std::ofstream(mirror + "/" + name + ".pkg") << name;
+    }
+
+    MirrorAdapter adapter(mirror);
+
+    // The baseline: the same packages without pipelining
+    InstallPipeline unpipelined(adapter, 0, staging);
+    CommandPlan plainPlan = unpipelined.plan(names);
+    assert(!unpipelined.pipelined());
+    auto start = std::chrono::steady_clock::now();
+    bool plainInstalled = executor.execute(plainPlan).success;
+    double baseline =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    assert(plainInstalled);
+
+    InstallPipeline pipeline(adapter, 2, staging);
+    CommandPlan plan = pipeline.plan(names);
+    assert(pipeline.chunkCount() == 3);
+    bool prepared = pipeline.prepare();
+    assert(prepared);
+
+    start = std::chrono::steady_clock::now();
+    ExecutionResult result = executor.execute(plan);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    assert(result.success);
+
+    // Six packages downloaded and installed at 0.15s each take 1.8s back to
+    // back; pipelined in chunks of two, four 0.3s waves take 1.2s
+    assert(baseline >= 1.7);
+    assert(result.busySeconds >= 1.7);
+    assert(wall < baseline - 0.4);
+    std::cout << "  pipelined " << wall << "s vs " << baseline << "s unpipelined (steps summed to "
+              << result.busySeconds << "s)" << std::endl;
+
+    assert(Cache::stat(staging + "/chunk-2/pkg5.pkg").exists);
+    bool cleaned = executor.capture(pipeline.cleanupStep()).success;
+    assert(cleaned);
+    assert(!Cache::stat(staging).exists);
+
+    // A chunk missing from the mirror stops the pipeline
+    executor.capture(CommandStep::query({"rm", "-f", mirror + "/pkg3.pkg"}));
+    plan = pipeline.plan(names);
+    prepared = pipeline.prepare();
+    assert(prepared);
+    bool installed = executor.execute(plan).success;
+    assert(!installed);
+    executor.capture(pipeline.cleanupStep());
+    executor.capture(CommandStep::query({"rm", "-rf", mirror, plain}));
+
+    std::cout << "✓ Pipelined install against a local mirror passed" << std::endl;
+#endif
+}
+
+int main() {
+    std::cout << "Running install pipeline tests...\n" << std::endl;
+
+    testAptPlan();
+    testLockedAndUnsupported();
+    testOverlapAgainstMirror();
+
+    std::cout << "\n✓ All install pipeline tests passed!" << std::endl;
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <cassert>
 #include <memory>
+#include <string>
 
 using namespace unipm;
 
@@ -30,6 +31,17 @@ int main() {
     assert(!suggestions.empty());
     std::cout << "  ✓ Fuzzy matching test passed (dokcer -> " << suggestions[0] << ")" << std::endl;
     
+    // Repository availability check
+    resolver.setAvailabilityCheck([](const std::string& name) {
+        return name == "docker.io" || name == "coreutils";
+    });
+    assert(resolver.resolve("docker", PackageManager::APT).available);
+    assert(!resolver.resolve("git", PackageManager::APT).available);
+    auto native = resolver.resolve("coreutils", PackageManager::APT);
+    assert(native.resolvedName == "coreutils");
+    assert(native.confidence == 1.0f);
+    std::cout << "  ✓ Availability check test passed" << std::endl;
+    
     std::cout << "✓ Resolver test passed!" << std::endl;
     
     return 0;
@@ -0,0 +1,105 @@
+#include "../include/unipm/terminal.h"
+#include "../include/unipm/cache.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace unipm;
+
+void testCollapseRedraws() {
+    std::cout << "Testing progress redraw collapsing..." << std::endl;
+
+    // Later frames as wide as earlier ones hide them
+    assert(Terminal::collapseRedraws("\r 10%\r 50%\r100%\n", true) == "\r100%\n");
+    assert(Terminal::collapseRedraws("Get:1\r[#   ]\r[##  ]\r[### ]", true) == "\r[### ]");
+
+    // A shorter frame leaves part of the earlier one on screen
+    assert(Terminal::collapseRedraws("\rlonger frame\rshort", true) == "\rlonger frame\rshort");
+
+    // The first segment may continue a line from an earlier frame
+    assert(Terminal::collapseRedraws("abc\rxyzw", false) == "abc\rxyzw");
+    assert(Terminal::collapseRedraws("abc\rxyzw", true) == "\rxyzw");
+
+    // Only the line being redrawn is touched
+    assert(Terminal::collapseRedraws("one\ntwo\rTWO\nthree", false) == "one\n\rTWO\nthree");
+
+    // Escape sequences and non-ASCII text aren't measured
+    assert(Terminal::collapseRedraws("\r\033[1Aab\rxyz", true) == "\r\033[1Aab\rxyz");
+    assert(Terminal::collapseRedraws("\rab\r\xc3\xa9\xc3\xa9", true) == "\rab\r\xc3\xa9\xc3\xa9");
+
+    // Nothing to do without carriage returns
+    assert(Terminal::collapseRedraws("plain\ntext\n", true) == "plain\ntext\n");
+
+    std::cout << "✓ Progress redraw collapsing passed" << std::endl;
+}
+
+void testBufferedWhenNotATerminal() {
+    std::cout << "Testing buffered output to a file..." << std::endl;
+
+#ifdef _WIN32
+    std::cout << "  (skipped on Windows)" << std::endl;
+#else
+    // Relative to the test working directory (the build tree)
+    const std::string path = "unipm_test_terminal.out";
+    std::cout.flush();
+    int saved = dup(STDOUT_FILENO);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(saved >= 0 && fd >= 0);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    // Capabilities are detected on first use, with stdout now a file
+    Terminal& terminal = Terminal::instance();
+    assert(!terminal.capabilities().stdoutTty);
+    assert(!terminal.capabilities().color);
+
+    terminal.write("first\n");
+    terminal.endGroup();
+    terminal.relay("\r 50%\r100%\n");
+    assert(terminal.frameTimeoutMs() == -1);
+    assert(Cache::stat(path).size == 0);
+
+    // Redraws reach a file verbatim
+    terminal.flush();
+    std::string data;
+    bool read = Cache::readFile(path, data);
+    assert(read);
+    assert(data == "first\n\r 50%\r100%\n");
+
+    // A full buffer goes out on its own
+    terminal.write(std::string(Terminal::BUFFER_LIMIT, 'x'));
+    assert(Cache::stat(path).size == data.size() + Terminal::BUFFER_LIMIT);
+
+    // Routed std::cout keeps its place ahead of stderr output
+    terminal.attachStandardStreams();
+    std::cout << "queued" << std::endl;
+    assert(Cache::stat(path).size == data.size() + Terminal::BUFFER_LIMIT);
+    terminal.writeError("");
+    read = Cache::readFile(path, data);
+    assert(read);
+    assert(data.size() >= 7 && data.compare(data.size() - 7, 7, "queued\n") == 0);
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    std::remove(path.c_str());
+#endif
+
+    std::cout << "✓ Buffered output to a file passed" << std::endl;
+}
+
+int main() {
+    std::cout << "Running terminal tests...\n" << std::endl;
+
+    testCollapseRedraws();
+    testBufferedWhenNotATerminal();
+
+    std::cout << "\n✓ All terminal tests passed!" << std::endl;
+    Terminal::instance().flush();
+    return 0;
+}
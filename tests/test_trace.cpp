@@ -0,0 +1,241 @@
+#include "../include/unipm/trace.h"
+#include "../include/unipm/cache.h"
+#include "../include/unipm/command.h"
+#include "../include/unipm/executor.h"
+#include <json.hpp>
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace unipm;
+using json = nlohmann::json;
+
+#ifdef UNIPM_ENABLE_TRACING
+
+// Relative to the test working directory (the build tree)
+const std::string TRACE_FILE = "unipm_test_trace.json";
+
+json readTrace() {
+    std::string text;
+    bool read = Cache::readFile(TRACE_FILE, text);
+    assert(read);
+    return json::parse(text);
+}
+
+// Complete events named name
+std::vector<json> spans(const json& trace, const std::string& name) {
+    std::vector<json> found;
+    for (const auto& event : trace["traceEvents"]) {
+        if (event["ph"] == "X" && event["name"] == name) {
+            found.push_back(event);
+        }
+    }
+    return found;
+}
+
+void testNestedSpans() {
+    std::cout << "Testing nested spans..." << std::endl;
+
+    Trace::start(TRACE_FILE);
+    {
+        UNIPM_TRACE_SPAN(outer, "outer", "test");
+        UNIPM_TRACE_ARG(outer, "package", std::string("say \"hi\"\n"));
+        UNIPM_TRACE_ARG(outer, "count", static_cast<int64_t>(3));
+        {
+            UNIPM_TRACE_SCOPE("inner", "test");
+        }
+        UNIPM_TRACE_SPAN(renamed, "placeholder", "test");
+        UNIPM_TRACE_RENAME(renamed, "renamed " + std::to_string(7));
+        UNIPM_TRACE_END(renamed);
+        UNIPM_TRACE_END(renamed);  // A second end records nothing
+    }
+    bool finished = Trace::finish();
+    assert(finished);
+    finished = Trace::finish();
+    assert(!finished);  // Nothing is being recorded any more
+
+    json trace = readTrace();
+    assert(trace["displayTimeUnit"] == "ms");
+    assert(trace["traceEvents"][0]["ph"] == "M");
+
+    auto outer = spans(trace, "outer");
+    auto inner = spans(trace, "inner");
+    assert(outer.size() == 1 && inner.size() == 1);
+    assert(outer[0]["cat"] == "test");
+    assert(outer[0]["args"]["package"] == "say \"hi\"\n");
+    assert(outer[0]["args"]["count"] == 3);
+    assert(inner[0].count("args") == 0);
+
+    // The inner span lies within the outer one
+    int64_t outerStart = outer[0]["ts"];
+    int64_t outerEnd = outerStart + outer[0]["dur"].get<int64_t>();
+    int64_t innerStart = inner[0]["ts"];
+    assert(innerStart >= outerStart);
+    assert(innerStart + inner[0]["dur"].get<int64_t>() <= outerEnd);
+    assert(inner[0]["tid"] == outer[0]["tid"]);
+
+    assert(spans(trace, "renamed 7").size() == 1);
+    assert(spans(trace, "placeholder").empty());
+
+    std::remove(TRACE_FILE.c_str());
+    std::cout << "✓ Nested spans passed" << std::endl;
+}
+
+void testNothingRecordedWhenIdle() {
+    std::cout << "Testing idle spans..." << std::endl;
+
+    {
+        UNIPM_TRACE_SPAN(span, "before", "test");
+        assert(!span.active());
+    }
+    Trace::start(TRACE_FILE);
+    bool finished = Trace::finish();
+    assert(finished);
+
+    // Spans that opened before start() stay unrecorded after it
+    UNIPM_TRACE_SPAN(early, "early", "test");
+    Trace::start(TRACE_FILE);
+    UNIPM_TRACE_END(early);
+    finished = Trace::finish();
+    assert(finished);
+
+    json trace = readTrace();
+    assert(trace["traceEvents"].size() == 1);
+    assert(trace["otherData"]["subprocesses"] == 0);
+
+    std::remove(TRACE_FILE.c_str());
+    std::cout << "✓ Idle spans passed" << std::endl;
+}
+
+void testThreads() {
+    std::cout << "Testing spans from several threads..." << std::endl;
+
+    Trace::start(TRACE_FILE);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([] {
+            for (int j = 0; j < 50; ++j) {
+                UNIPM_TRACE_SCOPE("work", "test");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    bool finished = Trace::finish();
+    assert(finished);
+
+    json trace = readTrace();
+    auto work = spans(trace, "work");
+    assert(work.size() == 200);
+    std::vector<int> tracks;
+    for (const auto& span : work) {
+        int tid = span["tid"];
+        if (std::find(tracks.begin(), tracks.end(), tid) == tracks.end()) {
+            tracks.push_back(tid);
+        }
+    }
+    assert(tracks.size() == 4);
+
+    std::remove(TRACE_FILE.c_str());
+    std::cout << "✓ Threaded spans passed" << std::endl;
+}
+
+void testStartWhileSpansRun() {
+    std::cout << "Testing start while spans run..." << std::endl;
+
+    // Spans already running when the trace starts stay unrecorded; those
+    // that begin after it must see its origin (run under TSan to check)
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&done] {
+            while (!done) {
+                UNIPM_TRACE_SCOPE("busy", "test");
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    Trace::start(TRACE_FILE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    bool finished = Trace::finish();
+    assert(finished);
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    json trace = readTrace();
+    auto busy = spans(trace, "busy");
+    assert(!busy.empty());
+    for (const auto& span : busy) {
+        assert(span["ts"] >= 0 && span["dur"] >= 0);
+    }
+
+    std::remove(TRACE_FILE.c_str());
+    std::cout << "✓ Start while spans run passed" << std::endl;
+}
+
+void testChildProcesses() {
+    std::cout << "Testing child process spans..." << std::endl;
+
+    Trace::start(TRACE_FILE);
+    Executor executor;
+    ExecutionResult ok = executor.capture(CommandStep::query({"true"}));
+    ExecutionResult failed = executor.capture(CommandStep::query({"sh", "-c", "exit 3"}));
+    assert(ok.success && failed.exitCode == 3);
+    assert(Trace::processCount() == 2);
+    bool finished = Trace::finish();
+    assert(finished);
+
+    json trace = readTrace();
+    assert(trace["otherData"]["subprocesses"] == 2);
+
+    auto sh = spans(trace, "sh");
+    assert(sh.size() == 1);
+    assert(sh[0]["cat"] == "process");
+    assert(sh[0]["args"]["argv"] == "sh -c 'exit 3'");
+    assert(sh[0]["args"]["exit_code"] == 3);
+    assert(sh[0]["args"].count("pid") == 1);
+    assert(spans(trace, "true").size() == 1);
+
+    // The counter track rises and falls with each child
+    int64_t last = -1;
+    int samples = 0;
+    for (const auto& event : trace["traceEvents"]) {
+        if (event["ph"] == "C" && event["name"] == "subprocesses") {
+            last = event["args"]["running"];
+            assert(last == 0 || last == 1);
+            samples++;
+        }
+    }
+    assert(samples == 4 && last == 0);
+
+    std::remove(TRACE_FILE.c_str());
+    std::cout << "✓ Child process spans passed" << std::endl;
+}
+
+#endif
+
+int main() {
+    std::cout << "Running trace tests...\n" << std::endl;
+
+#ifdef UNIPM_ENABLE_TRACING
+    testNestedSpans();
+    testNothingRecordedWhenIdle();
+    testThreads();
+    testStartWhileSpansRun();
+    testChildProcesses();
+#else
+    std::cout << "Tracing is compiled out; nothing to test" << std::endl;
+#endif
+
+    std::cout << "\n✓ All trace tests passed!" << std::endl;
+    return 0;
+}